@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "alert_rules.h"
+
+/**
+ * @brief Benchmark of alert_rules_evaluate with 1000 cores and 50 rules
+ * (45 per-core, 5 machine-wide) on slowly drifting usage. Reports time per snapshot.
+ */
+
+enum {
+    number_of_cores = 1000,
+    number_of_rules = 50,
+    number_of_snapshots = 2000,
+    events_size = 256,
+};
+
+static Snapshot snapshot;
+static AlertEvent events[events_size];
+
+static inline uint64_t now_ns(void);
+
+static inline uint64_t now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+int main() {
+    AlertRules* rules = alert_rules_new(number_of_cores, number_of_rules);
+    if (rules == NULL) {
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < number_of_rules; i++) {
+        char line[128];
+        AlertRule rule;
+        if (i % 10 == 9) {
+            snprintf(line, sizeof(line), "machine%zu machine above %zu for 3 clear %zu", i, 50 + i % 40, 40 + i % 40);
+        } else if (i % 2 == 0) {
+            snprintf(line, sizeof(line), "busy%zu core above %zu for %zu clear %zu", i, 50 + i % 50, 1 + i % 10, 40 + i % 50);
+        } else {
+            snprintf(line, sizeof(line), "idle%zu core below %zu for %zu clear %zu", i, 1 + i % 20, 1 + i % 10, 5 + i % 20);
+        }
+        if (!alert_rules_parse_line(line, &rule) || !alert_rules_add(rules, &rule)) {
+            return EXIT_FAILURE;
+        }
+    }
+    srand(42);
+
+    snapshot.number_of_cores = number_of_cores;
+    for (size_t core = 0; core < number_of_cores; core++) {
+        snapshot.core_usage[core] = (double) (rand() % 100);
+    }
+
+    uint64_t evaluate_ns = 0;
+    size_t number_of_events = 0;
+    for (size_t i = 0; i < number_of_snapshots; i++) {
+        for (size_t core = 0; core < number_of_cores; core++) {
+            double usage = snapshot.core_usage[core] + (double) (rand() % 11 - 5);
+            snapshot.core_usage[core] = usage < 0.0 ? 0.0 : (usage > 100.0 ? 100.0 : usage);
+        }
+        const uint64_t begin = now_ns();
+        number_of_events += alert_rules_evaluate(rules, &snapshot, events, events_size);
+        evaluate_ns += now_ns() - begin;
+    }
+
+    printf("cores: %d, rules: %d, snapshots: %d\n", number_of_cores, number_of_rules, number_of_snapshots);
+    printf("evaluate: %.2f us per snapshot, %.2f ns per rule instance (%.1f events per snapshot)\n",
+           (double) evaluate_ns / number_of_snapshots / 1e3,
+           (double) evaluate_ns / number_of_snapshots / (number_of_cores * number_of_rules),
+           (double) number_of_events / number_of_snapshots);
+    alert_rules_delete(rules);
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "frequency_sampler.h"
+
+/**
+ * @brief Benchmark of frequency_sampler_sample with 1 and more reading threads.
+ * Usage: frequency_sampler_bench [sysfs root], default "/sys". Reports time per sample.
+ */
+
+enum {
+    number_of_samples = 1000,
+};
+
+static inline uint64_t now_ns(void);
+
+static inline uint64_t now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+int main(int argc, char* argv[]) {
+    const char* sysfs_root = argc > 1 ? argv[1] : "/sys";
+    const size_t threads[] = {1, 2, 4, 8};
+
+    for (size_t i = 0; i < sizeof(threads) / sizeof(*threads); i++) {
+        FrequencySampler* sampler = frequency_sampler_new(sysfs_root, "/dev", FREQUENCY_SOURCE_CPUFREQ, threads[i]);
+        if (sampler == NULL) {
+            fprintf(stderr, "No cpufreq files below %s\n", sysfs_root);
+            return EXIT_FAILURE;
+        }
+        uint64_t checksum = 0;
+        const uint64_t begin = now_ns();
+        for (size_t sample = 0; sample < number_of_samples; sample++) {
+            checksum += frequency_sampler_sample(sampler)[0];
+        }
+        const uint64_t elapsed_ns = now_ns() - begin;
+
+        printf("cpus: %zu, threads: %zu, sample: %.2f us (checksum %" PRIu64 ")\n",
+               frequency_sampler_number_of_cpus(sampler), threads[i],
+               (double) elapsed_ns / number_of_samples / 1e3, checksum);
+        frequency_sampler_delete(sampler);
+    }
+    return 0;
+}
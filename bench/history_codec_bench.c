@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "history_codec.h"
+
+/**
+ * @brief Benchmark of history_codec on synthetic data resembling parser output:
+ * 384 cores sampled every 100 ms, usage computed from USER_HZ tick counters.
+ * Reports compressed bytes per core sample and encode/decode time per core sample.
+ */
+
+enum {
+    number_of_cores = 384,
+    number_of_samples = 3000,
+    block_size = 1 << 20,
+};
+
+static double values[number_of_samples][number_of_cores];
+static uint64_t timestamps[number_of_samples];
+
+static inline uint64_t now_ns(void);
+
+static inline uint64_t now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+int main() {
+    uint8_t* block = malloc(block_size);
+    if (block == NULL) {
+        return EXIT_FAILURE;
+    }
+    srand(42);
+
+    /*Every core has its own load level drifting slowly, idle cores stay at 0*/
+    double load[number_of_cores];
+    for (size_t core = 0; core < number_of_cores; core++) {
+        load[core] = core % 3 == 0 ? 0.0 : (double) (rand() % 100);
+    }
+    uint64_t timestamp = 1700000000000000000u;
+    for (size_t i = 0; i < number_of_samples; i++) {
+        timestamp += 100000000u + (uint64_t) (rand() % 100000);
+        timestamps[i] = timestamp;
+        for (size_t core = 0; core < number_of_cores; core++) {
+            if (load[core] > 0.0) {
+                load[core] += (double) (rand() % 11 - 5);
+                load[core] = load[core] < 1.0 ? 1.0 : (load[core] > 100.0 ? 100.0 : load[core]);
+            }
+            /*10 ticks per 100 ms interval at USER_HZ = 100*/
+            const double total = 10.0;
+            const double busy = (double) (int) (load[core] / 10.0);
+            values[i][core] = busy / total * 100.0;
+        }
+    }
+
+    HistoryCodecEncoder* encoder = history_codec_encoder_new(number_of_cores, block, block_size);
+    size_t encoded_bytes = 0;
+    size_t encoded_samples = 0;
+    uint64_t encode_ns = 0;
+    uint64_t decode_ns = 0;
+    double decoded[number_of_cores];
+    uint64_t decoded_timestamp;
+
+    for (size_t i = 0; i < number_of_samples;) {
+        uint64_t start = now_ns();
+        while (i < number_of_samples && history_codec_encode(encoder, timestamps[i], values[i])) {
+            i++;
+        }
+        const size_t size = history_codec_encoder_finish(encoder);
+        encode_ns += now_ns() - start;
+        encoded_bytes += size;
+        encoded_samples += history_codec_encoder_number_of_samples(encoder);
+
+        start = now_ns();
+        HistoryCodecDecoder* decoder = history_codec_decoder_new(block, size);
+        while (history_codec_decode(decoder, &decoded_timestamp, decoded)) {
+        }
+        history_codec_decoder_delete(decoder);
+        decode_ns += now_ns() - start;
+
+        history_codec_encoder_reset(encoder, block, block_size);
+    }
+
+    const double core_samples = (double) encoded_samples * number_of_cores;
+    printf("cores: %d, snapshots: %zu\n", number_of_cores, encoded_samples);
+    printf("raw: %.2F bytes/sample\n", (double) sizeof(double));
+    printf("compressed: %.3F bytes/sample (%.1Fx)\n", (double) encoded_bytes / core_samples,
+           (double) sizeof(double) * core_samples / (double) encoded_bytes);
+    printf("encode: %.2F ns/sample\n", (double) encode_ns / core_samples);
+    printf("decode: %.2F ns/sample\n", (double) decode_ns / core_samples);
+
+    history_codec_encoder_delete(encoder);
+    free(block);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "hotspot.h"
+
+/**
+ * @brief Benchmark of hotspot_update with 1024 cores drifting slowly between ticks,
+ * as they do at 10 Hz. Reports time per update.
+ */
+
+enum {
+    number_of_cores = 1024,
+    number_of_updates = 10000,
+    top_n = 10,
+};
+
+static Snapshot snapshot;
+
+static inline uint64_t now_ns(void);
+
+static inline uint64_t now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+int main() {
+    Hotspot* hotspot = hotspot_new(number_of_cores, top_n, 90.0, 5);
+    if (hotspot == NULL) {
+        return EXIT_FAILURE;
+    }
+    srand(42);
+
+    snapshot.number_of_cores = number_of_cores;
+    for (size_t core = 0; core < number_of_cores; core++) {
+        snapshot.core_usage[core] = (double) (rand() % 100);
+    }
+
+    uint64_t update_ns = 0;
+    size_t hot = 0;
+    for (size_t i = 0; i < number_of_updates; i++) {
+        for (size_t core = 0; core < number_of_cores; core++) {
+            double usage = snapshot.core_usage[core] + (double) (rand() % 11 - 5);
+            snapshot.core_usage[core] = usage < 0.0 ? 0.0 : (usage > 100.0 ? 100.0 : usage);
+        }
+        const uint64_t begin = now_ns();
+        hotspot_update(hotspot, &snapshot);
+        update_ns += now_ns() - begin;
+        hot += hotspot_aggregate(hotspot)->number_of_hot;
+    }
+
+    printf("cores: %d, top: %d, updates: %d\n", number_of_cores, top_n, number_of_updates);
+    printf("update: %.2f us (average hot cores %.1f)\n", (double) update_ns / number_of_updates / 1e3,
+           (double) hot / number_of_updates);
+    hotspot_delete(hotspot);
+    return 0;
+}
@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include "circular_buffer.h"
+#include "snapshot_shm.h"
+#include "thread_reader.h"
+#include "thread_parser.h"
+#include "thread_printer.h"
+#include "thread_logger.h"
+#include "event_loop.h"
+#include "stage_overhead.h"
+#include "stat_recording.h"
+#include "snapshot_latency.h"
+#include "fake_stat.h"
+
+/**
+ * @brief Benchmark of CPU time per sample of the thread pipeline and of the single-threaded
+ * event loop. Both read generated /proc/stat with number_of_cores cores every period_ms for
+ * run_s seconds, output goes to /dev/null. The file is advanced and rewritten every period_ms by a writer thread,
+ * so that every core has usage; CPU time of the writer is not counted. Number of samples is taken from snapshot sequence.
+ * Per-snapshot CPU time and hardware counters (if perf_event_open is permitted) of every stage are
+ * taken from the last overhead report, covering report_interval snapshots.
+ * Fast replay feeds replay_ticks recorded ticks of the same cores under sine load to the event loop without delay and reports throughput of the parser and printer sinks in snapshots per second.
+ */
+
+enum {
+    number_of_cores = 384,
+    period_ms = 10,
+    run_s = 3,
+    report_interval = 50,
+    replay_ticks = 2000,
+};
+
+static char stat_path[64];
+static char recording_path[64];
+static char shm_name[64];
+static FakeStat* fake_stat;
+static int stat_file = -1;
+static atomic_bool writer_running;
+static uint64_t writer_cpu_ns;
+
+static inline uint64_t cpu_time_ns(void);
+
+/**
+ * @brief Advance fake_stat under ramp load by one tick and rewrite stat_file in place. Counters only grow,
+ * hence the content never shrinks and nothing of the previous tick is left behind. A read overlapping the rewrite
+ * may still mix two ticks, it shows as a few invalid cores and does not change the cost of a sample
+ */
+static void stat_write(void);
+
+/**
+ * @brief Rewrite stat_file every period_ms while writer_running, CPU time of the thread is stored to writer_cpu_ns
+ */
+static void* stat_writer(void* arguments);
+
+/**
+ * @brief Record replay_ticks ticks of /proc/stat-like content, period_ms apart
+ */
+static void recording_write(void);
+
+/**
+ * @brief Read sequence of the last snapshot published in shm
+ */
+static uint64_t samples_read(const SnapshotShm* shm);
+
+static void pipeline_run(FILE* input_file, SnapshotShm* shm, StageOverhead* stage_overhead);
+
+static void* stop_after_run(void* arguments);
+
+static void event_loop_bench_run(FILE* input_file, SnapshotShm* shm, StageOverhead* stage_overhead);
+
+/**
+ * @return wall time of the replay in nanoseconds
+ */
+static uint64_t replay_bench_run(SnapshotShm* shm, StageOverhead* stage_overhead);
+
+/**
+ * @brief Print the last overhead report to stderr
+ */
+static void overhead_print(const StageOverhead* stage_overhead);
+
+static inline uint64_t cpu_time_ns() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return ((uint64_t) usage.ru_utime.tv_sec + (uint64_t) usage.ru_stime.tv_sec) * 1000000000u
+           + ((uint64_t) usage.ru_utime.tv_usec + (uint64_t) usage.ru_stime.tv_usec) * 1000u;
+}
+
+static void stat_write() {
+    static char content[64 * number_of_cores + 256];
+    fake_stat_advance(fake_stat);
+    const int length = fake_stat_format(fake_stat, content, sizeof(content));
+    if (length < 0 || (size_t) length >= sizeof(content) || pwrite(stat_file, content, (size_t) length, 0) != length) {
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void* stat_writer(void* const arguments) {
+    (void) arguments;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (atomic_load(&writer_running)) {
+        next.tv_nsec += period_ms * 1000000;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        stat_write();
+    }
+    struct timespec cpu;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    writer_cpu_ns = (uint64_t) cpu.tv_sec * 1000000000u + (uint64_t) cpu.tv_nsec;
+    return NULL;
+}
+
+static void recording_write() {
+    static char content[64 * number_of_cores + 256];
+    StatRecorder* recorder = stat_recorder_new(recording_path);
+    FakeStat* fake_stat = fake_stat_new(number_of_cores, FAKE_STAT_PATTERN_SINE, 60);
+    if (recorder == NULL || fake_stat == NULL) {
+        exit(EXIT_FAILURE);
+    }
+    for (size_t tick = 0; tick < replay_ticks; tick++) {
+        fake_stat_advance(fake_stat);
+        const int length = fake_stat_format(fake_stat, content, sizeof(content));
+        if (length < 0 || (size_t) length >= sizeof(content) || !stat_recorder_add(recorder, content, (size_t) length)
+            || !stat_recorder_commit(recorder, (uint64_t) tick * period_ms * 1000000u)) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    fake_stat_delete(fake_stat);
+    stat_recorder_delete(recorder);
+}
+
+static uint64_t samples_read(const SnapshotShm* const shm) {
+    static SnapshotShmRecord record;
+    return snapshot_shm_read(shm, &record) == SNAPSHOT_SHM_SUCCESS ? record.sequence : 0;
+}
+
+static void pipeline_run(FILE* const input_file, SnapshotShm* const shm, StageOverhead* const stage_overhead) {
+    static PCPGuard char_guard = PCP_GUARD_INITIALIZER, snapshot_guard = PCP_GUARD_INITIALIZER,
+                    logger_guard = PCP_GUARD_INITIALIZER;
+    static WatchdogControlUnit reader_unit = WATCHDOG_CONTROL_UNIT_INIT, parser_unit = WATCHDOG_CONTROL_UNIT_INIT,
+                               printer_unit = WATCHDOG_CONTROL_UNIT_INIT, logger_unit = WATCHDOG_CONTROL_UNIT_INIT;
+    static pthread_mutex_t working_mutex = PTHREAD_MUTEX_INITIALIZER;
+    static bool working = true;
+    CircularBuffer* char_buffer = circular_buffer_new_mirrored(4096, sizeof(char));
+    CircularBuffer* snapshot_buffer = circular_buffer_new(4, sizeof(Snapshot));
+    CircularBuffer* logger_buffer = circular_buffer_new(50, sizeof(void*));
+    FILE* logger_file = fopen("/dev/null", "w");
+    if (char_buffer == NULL || snapshot_buffer == NULL || logger_buffer == NULL || logger_file == NULL) {
+        exit(EXIT_FAILURE);
+    }
+    setvbuf(input_file, NULL, _IOFBF, 1);
+
+    ThreadReaderArguments reader_args = {
+        .char_buffer_guard = &char_guard, .logger_buffer_guard = &logger_guard, .char_buffer = char_buffer,
+        .logger_buffer = logger_buffer, .control_unit = &reader_unit, .input_file = input_file,
+        .period = {.tv_sec = 0, .tv_nsec = period_ms * 1000000}, .working = &working, .working_mutex = &working_mutex,
+        .stage_overhead = stage_overhead,
+    };
+    ThreadParserArguments parser_args = {
+        .char_buffer = char_buffer, .snapshot_buffer = snapshot_buffer, .logger_buffer = logger_buffer,
+        .logger_buffer_guard = &logger_guard, .char_buffer_guard = &char_guard, .snapshot_buffer_guard = &snapshot_guard,
+        .control_unit = &parser_unit, .is_working = &working, .working_mutex = &working_mutex,
+        .stage_overhead = stage_overhead,
+    };
+    ThreadPrinterArguments printer_args = {
+        .circular_buffer_guard = &snapshot_guard, .logger_buffer_guard = &logger_guard, .circular_buffer = snapshot_buffer,
+        .logger_buffer = logger_buffer, .control_unit = &printer_unit, .snapshot_shm = shm,
+        .is_working = &working, .working_mutex = &working_mutex, .stage_overhead = stage_overhead,
+    };
+    ThreadLoggerArguments logger_args = {
+        .buffer_guard = &logger_guard, .logger_payload_pointer_buffer = logger_buffer, .is_working = &working,
+        .is_working_mutex = &working_mutex, .logger_output = logger_file, .control_unit = &logger_unit,
+        .stage_overhead = stage_overhead,
+    };
+
+    pthread_create(&logger_unit.thread_id, NULL, thread_logger, &logger_args);
+    pthread_create(&reader_unit.thread_id, NULL, thread_reader, &reader_args);
+    pthread_create(&parser_unit.thread_id, NULL, thread_parser, &parser_args);
+    pthread_create(&printer_unit.thread_id, NULL, thread_printer, &printer_args);
+    sleep(run_s);
+    pthread_mutex_lock(&working_mutex);
+    working = false;
+    pthread_mutex_unlock(&working_mutex);
+    pthread_join(reader_unit.thread_id, NULL);
+    pthread_join(parser_unit.thread_id, NULL);
+    pthread_join(printer_unit.thread_id, NULL);
+    pthread_join(logger_unit.thread_id, NULL);
+
+    LoggerPayload* payload = NULL;
+    while (circular_buffer_remove_single(logger_buffer, &payload) > 0) {
+        logger_payload_delete(payload);
+    }
+    circular_buffer_delete(char_buffer);
+    circular_buffer_delete(snapshot_buffer);
+    circular_buffer_delete(logger_buffer);
+    fclose(logger_file);
+}
+
+static void* stop_after_run(void* const arguments) {
+    (void) arguments;
+    sleep(run_s);
+    kill(getpid(), SIGTERM);
+    return NULL;
+}
+
+static void event_loop_bench_run(FILE* const input_file, SnapshotShm* const shm, StageOverhead* const stage_overhead) {
+    static PCPGuard logger_guard = PCP_GUARD_INITIALIZER;
+    CircularBuffer* logger_buffer = circular_buffer_new(512, sizeof(void*));
+    FILE* logger_file = fopen("/dev/null", "w");
+    if (logger_buffer == NULL || logger_file == NULL) {
+        exit(EXIT_FAILURE);
+    }
+    ThreadPrinterArguments printer_args = {
+        .logger_buffer_guard = &logger_guard, .logger_buffer = logger_buffer, .snapshot_shm = shm,
+        .stage_overhead = stage_overhead,
+    };
+    EventLoopArguments event_loop_args = {
+        .input_file = input_file, .period = {.tv_sec = 0, .tv_nsec = period_ms * 1000000},
+        .printer_arguments = &printer_args, .logger_output = logger_file,
+    };
+
+    pthread_t stopper;
+    pthread_create(&stopper, NULL, stop_after_run, NULL);
+    if (!event_loop_run(&event_loop_args)) {
+        exit(EXIT_FAILURE);
+    }
+    pthread_join(stopper, NULL);
+    circular_buffer_delete(logger_buffer);
+    fclose(logger_file);
+}
+
+static uint64_t replay_bench_run(SnapshotShm* const shm, StageOverhead* const stage_overhead) {
+    static PCPGuard logger_guard = PCP_GUARD_INITIALIZER;
+    CircularBuffer* logger_buffer = circular_buffer_new(512, sizeof(void*));
+    FILE* logger_file = fopen("/dev/null", "w");
+    StatReplay* replay = stat_replay_new(recording_path);
+    if (logger_buffer == NULL || logger_file == NULL || replay == NULL) {
+        exit(EXIT_FAILURE);
+    }
+    ThreadPrinterArguments printer_args = {
+        .logger_buffer_guard = &logger_guard, .logger_buffer = logger_buffer, .snapshot_shm = shm,
+        .stage_overhead = stage_overhead,
+    };
+    EventLoopArguments event_loop_args = {
+        .replay = replay, .replay_fast = true, .printer_arguments = &printer_args, .logger_output = logger_file,
+    };
+
+    /*The loop finishes at the end of the recording*/
+    const uint64_t begin_ns = snapshot_latency_now_ns();
+    if (!event_loop_run(&event_loop_args)) {
+        exit(EXIT_FAILURE);
+    }
+    const uint64_t elapsed_ns = snapshot_latency_now_ns() - begin_ns;
+    stat_replay_delete(replay);
+    circular_buffer_delete(logger_buffer);
+    fclose(logger_file);
+    return elapsed_ns;
+}
+
+static void overhead_print(const StageOverhead* const stage_overhead) {
+    const StageOverheadReport* report = stage_overhead_latest(stage_overhead);
+    if (report == NULL) {
+        return;
+    }
+    char message[STAGE_OVERHEAD_MESSAGE_SIZE];
+    stage_overhead_format(report, message, sizeof(message));
+    fprintf(stderr, "  %s", message);
+    stage_overhead_format_hardware(report, message, sizeof(message));
+    fprintf(stderr, "  %s", message);
+}
+
+int main() {
+    snprintf(stat_path, sizeof(stat_path), "/tmp/pipeline_bench_%ld.stat", (long) getpid());
+    snprintf(shm_name, sizeof(shm_name), "/pipeline_bench_%ld", (long) getpid());
+    snprintf(recording_path, sizeof(recording_path), "/tmp/pipeline_bench_%ld.rec", (long) getpid());
+    fake_stat = fake_stat_new(number_of_cores, FAKE_STAT_PATTERN_RAMP, 0);
+    stat_file = open(stat_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fake_stat == NULL || stat_file < 0) {
+        return EXIT_FAILURE;
+    }
+    stat_write();
+    recording_write();
+    if (freopen("/dev/null", "w", stdout) == NULL) {
+        return EXIT_FAILURE;
+    }
+    /*Blocked before any thread is created, so that only the event loop receives SIGTERM*/
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    const char* const names[] = {"threads", "event loop", "fast replay"};
+    for (size_t mode = 0; mode < 3; mode++) {
+        FILE* input_file = fopen(stat_path, "rb");
+        SnapshotShm* shm = snapshot_shm_create(shm_name);
+        StageOverhead* stage_overhead = stage_overhead_new("/proc", report_interval, true);
+        if (input_file == NULL || shm == NULL || stage_overhead == NULL) {
+            return EXIT_FAILURE;
+        }
+        const uint64_t begin = cpu_time_ns();
+        uint64_t wall_ns = 0;
+        pthread_t writer;
+        writer_cpu_ns = 0;
+        atomic_store(&writer_running, mode != 2);
+        if (mode != 2) {
+            pthread_create(&writer, NULL, stat_writer, NULL);
+        }
+        if (mode == 0) {
+            pipeline_run(input_file, shm, stage_overhead);
+        } else if (mode == 1) {
+            event_loop_bench_run(input_file, shm, stage_overhead);
+        } else {
+            wall_ns = replay_bench_run(shm, stage_overhead);
+        }
+        if (mode != 2) {
+            atomic_store(&writer_running, false);
+            pthread_join(writer, NULL);
+        }
+        const uint64_t elapsed_ns = cpu_time_ns() - begin - writer_cpu_ns;
+        const uint64_t samples = samples_read(shm);
+
+        fprintf(stderr, "%s: cores: %d, samples: %" PRIu64 ", cpu time per sample: %.2f us\n", names[mode],
+                number_of_cores, samples, samples == 0 ? 0.0 : (double) elapsed_ns / (double) samples / 1e3);
+        if (wall_ns != 0) {
+            fprintf(stderr, "  throughput: %.0f snapshots/s\n", (double) samples * 1e9 / (double) wall_ns);
+        }
+        overhead_print(stage_overhead);
+        stage_overhead_delete(stage_overhead);
+        snapshot_shm_delete(shm);
+        fclose(input_file);
+    }
+    close(stat_file);
+    fake_stat_delete(fake_stat);
+    remove(stat_path);
+    remove(recording_path);
+    return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file adaptive_period.h
+ * @brief Sampling period that follows volatility of per-core usage.
+ *
+ * After every snapshot the change of usage of every core since the previous snapshot is reduced by
+ * its quantization: usage counts whole ticks (USER_HZ), so two usages over an interval of T ticks differ
+ * by up to 2 * 100 / T points on a steady core. ADAPTIVE_PERIOD_PERCENTILE of these changes across cores
+ * is the volatility of the snapshot, a burst has to move a share of cores, not a single one.
+ * Volatility above threshold halves the period down to min_ns. Volatility below half of threshold is stable,
+ * after ADAPTIVE_PERIOD_STABLE_SNAPSHOTS stable snapshots in a row the period doubles up to max_ns.
+ * Volatility in between keeps the period and restarts counting of stable snapshots.
+ * The period starts at max_ns.
+ * budget bounds the share of one core consumed by the whole tracker process over the interval
+ * of the snapshot: above it the period doubles regardless of volatility and it is never halved
+ * if the doubled share would exceed it.
+ * The consumer of snapshots updates the period, the reader reads it from another thread.
+ */
+#ifndef ADAPTIVE_PERIOD_H
+#define ADAPTIVE_PERIOD_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "snapshot.h"
+#include "arena.h"
+
+#define ADAPTIVE_PERIOD_STABLE_SNAPSHOTS 5
+#define ADAPTIVE_PERIOD_PERCENTILE 95
+
+typedef struct AdaptivePeriod AdaptivePeriod;
+
+/**
+ * @brief Allocate scheduler
+ *
+ * @param min_ns the shortest period
+ * @param max_ns the longest period and the initial one
+ * @param threshold volatility in percentage points that makes the snapshot volatile
+ * @param budget share of one core the tracker may consume, e.g. 0.01
+ * @param ticks_per_second resolution of /proc/stat counters, sysconf(_SC_CLK_TCK)
+ * @return pointer to valid AdaptivePeriod on success, NULL on memory error or if min_ns is 0,
+ * min_ns is above max_ns, budget or ticks_per_second is not positive
+ */
+AdaptivePeriod* adaptive_period_new(uint64_t min_ns, uint64_t max_ns, double threshold, double budget, long ticks_per_second);
+
+/**
+ * @brief Carve scheduler from arena, @see adaptive_period_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(adaptive_period_footprint()) bytes left
+ * @return pointer to valid AdaptivePeriod on success, NULL if arena is exhausted or an argument is invalid as for adaptive_period_new
+ */
+AdaptivePeriod* adaptive_period_new_in(Arena* arena, uint64_t min_ns, uint64_t max_ns, double threshold, double budget,
+                                       long ticks_per_second);
+
+/**
+ * @return size of the scheduler in memory
+ */
+size_t adaptive_period_footprint(void);
+
+/**
+ * @brief Free the scheduler, scheduler carved from an arena is left to the arena
+ *
+ * @param adaptive_period pointer to valid AdaptivePeriod or NULL, in latter case nothing happens
+ */
+void adaptive_period_delete(AdaptivePeriod* adaptive_period);
+
+/**
+ * @brief Adjust the period by the snapshot. Cores with NaN usage are not compared.
+ *
+ * @param adaptive_period pointer to valid AdaptivePeriod
+ * @param snapshot snapshot with interval_ns set, 0 skips the budget check and quantization is taken from the current period
+ * @param process_cpu_ns CPU time of the tracker process when the snapshot was completed,
+ * @see adaptive_period_process_cpu_ns
+ * @return the new period in nanoseconds
+ */
+uint64_t adaptive_period_update(AdaptivePeriod* restrict adaptive_period, const Snapshot* restrict snapshot,
+                                uint64_t process_cpu_ns);
+
+/**
+ * @param adaptive_period pointer to valid AdaptivePeriod
+ * @return the current period in nanoseconds, may be called concurrently with adaptive_period_update
+ */
+uint64_t adaptive_period_current_ns(const AdaptivePeriod* adaptive_period);
+
+/**
+ * @return CPU time consumed by all threads of the process in nanoseconds
+ */
+uint64_t adaptive_period_process_cpu_ns(void);
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * @file alert_action.h
+ * @brief Destinations of alert messages.
+ *
+ * Specification is one of:
+ * "log"             message is left to the caller for thread_logger
+ * "fifo:<path>"     message is written to named pipe, dropped while no reader has it open
+ * "unix:<path>"     message is sent as single datagram to unix socket
+ * Sending never blocks; if the destination cannot accept the message, it is dropped.
+ */
+#ifndef ALERT_ACTION_H
+#define ALERT_ACTION_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "arena.h"
+
+typedef enum EAlertActionType {
+    ALERT_ACTION_LOG = 0,
+    ALERT_ACTION_FIFO = 1,
+    ALERT_ACTION_UNIX = 2,
+} EAlertActionType;
+
+typedef struct AlertAction AlertAction;
+
+/**
+ * @brief Create action from specification. Destination does not need to exist yet.
+ *
+ * @param spec action specification
+ * @return pointer to valid AlertAction on success, NULL on failure or if spec is invalid
+ */
+AlertAction* alert_action_new(const char spec[static 1]);
+
+/**
+ * @brief Carve action from arena, @see alert_action_new. Arena is not touched if spec is invalid.
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(alert_action_footprint()) bytes left
+ * @param spec action specification
+ * @return pointer to valid AlertAction on success, NULL if spec is invalid or arena is exhausted
+ */
+AlertAction* alert_action_new_in(Arena* arena, const char spec[static 1]);
+
+/**
+ * @return size of single action in memory
+ */
+size_t alert_action_footprint(void);
+
+/**
+ * @brief Close destination and free memory occupied by the action, action carved from an arena is left to the arena
+ *
+ * @param action pointer to valid AlertAction or NULL, in latter case nothing happens
+ */
+void alert_action_delete(AlertAction* action);
+
+/**
+ * @brief get type of the action
+ *
+ * @param action pointer to valid AlertAction
+ * @return type of the action
+ */
+EAlertActionType alert_action_type(const AlertAction* action);
+
+/**
+ * @brief Deliver message without blocking. Actions of type ALERT_ACTION_LOG do nothing.
+ *
+ * @param action pointer to valid AlertAction
+ * @param message message
+ * @param length length of message in bytes
+ * @return true iff the whole message was delivered
+ */
+bool alert_action_send(AlertAction* restrict action, const char message[restrict static 1], size_t length);
+
+#endif
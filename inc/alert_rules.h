@@ -0,0 +1,165 @@
+/**
+ * @file alert_rules.h
+ * @brief Threshold rules evaluated on every snapshot, with duration and hysteresis.
+ *
+ * Rule fires after its value has been beyond threshold for duration consecutive snapshots
+ * and clears once the value gets back beyond clear_threshold. Rules of core, socket and node
+ * scope keep separate state for every instance. Evaluation costs O(rules * cores) and never allocates.
+ * Socket and node values are present in snapshots only with topology enabled.
+ *
+ * Text form of a rule (one per line in rules file):
+ * <name> <core|socket|node|machine> <above|below> <threshold> [for <snapshots>] [clear <threshold>] [action <spec>]
+ * e.g. "saturated core above 95 for 5 clear 80 action unix:/run/alerts.sock"
+ * @see alert_action.h for action specification.
+ */
+#ifndef ALERT_RULES_H
+#define ALERT_RULES_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "snapshot.h"
+#include "arena.h"
+
+enum {
+    ALERT_RULE_NAME_SIZE = 32,
+    ALERT_RULE_ACTION_SIZE = 128,
+    /*Enough for message produced by alert_rules_format_event for usage in %*/
+    ALERT_EVENT_MESSAGE_SIZE = 128,
+};
+
+typedef enum EAlertScope {
+    /*Every core separately*/
+    ALERT_SCOPE_CORE = 0,
+    /*Average of all cores*/
+    ALERT_SCOPE_MACHINE = 1,
+    /*Every physical package separately*/
+    ALERT_SCOPE_SOCKET = 2,
+    /*Every NUMA node separately*/
+    ALERT_SCOPE_NODE = 3,
+} EAlertScope;
+
+typedef enum EAlertComparison {
+    ALERT_COMPARISON_ABOVE = 0,
+    ALERT_COMPARISON_BELOW = 1,
+} EAlertComparison;
+
+typedef struct AlertRule {
+    char name[ALERT_RULE_NAME_SIZE];
+    EAlertScope scope;
+    EAlertComparison comparison;
+    double threshold;
+    double clear_threshold;
+    uint32_t duration;
+    /*Empty string means the default action*/
+    char action[ALERT_RULE_ACTION_SIZE];
+} AlertRule;
+
+/**
+ * @brief State transition of a rule. instance is index of core, sysfs id of socket or node,
+ * SIZE_MAX for machine scope.
+ *
+ */
+typedef struct AlertEvent {
+    size_t rule;
+    size_t instance;
+    double value;
+    bool fired;
+} AlertEvent;
+
+typedef struct AlertRules AlertRules;
+
+/**
+ * @brief Parse text form of a rule. Omitted duration is 1, omitted clear threshold is equal to threshold.
+ *
+ * @param line null-terminated line, trailing newline is allowed
+ * @param rule pointer to memory where the rule will be stored, altered even if parsing fails
+ * @return true iff line contains valid rule
+ */
+bool alert_rules_parse_line(const char line[restrict static 1], AlertRule* restrict rule);
+
+/**
+ * @brief Allocate rule set with state for number_of_cores cores
+ *
+ * @param number_of_cores number of cores, cores above it are ignored
+ * @param capacity maximum number of rules
+ * @return pointer to valid AlertRules on success, NULL on failure or if one of the sizes is 0
+ */
+AlertRules* alert_rules_new(size_t number_of_cores, size_t capacity);
+
+/**
+ * @brief Carve rule set from arena, @see alert_rules_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(alert_rules_footprint()) bytes left
+ * @param number_of_cores number of cores, cores above it are ignored
+ * @param capacity maximum number of rules
+ * @return pointer to valid AlertRules on success, NULL if one of the sizes is 0 or arena is exhausted
+ */
+AlertRules* alert_rules_new_in(Arena* arena, size_t number_of_cores, size_t capacity);
+
+/**
+ * @param number_of_cores number of cores
+ * @param capacity maximum number of rules
+ * @return size of the rule set in memory
+ */
+size_t alert_rules_footprint(size_t number_of_cores, size_t capacity);
+
+/**
+ * @brief Free memory occupied by rule set, rule set carved from an arena is left to the arena
+ *
+ * @param rules pointer to valid AlertRules or NULL, in latter case nothing happens
+ */
+void alert_rules_delete(AlertRules* rules);
+
+/**
+ * @brief Append copy of the rule
+ *
+ * @param rules pointer to valid AlertRules
+ * @param rule pointer to valid rule
+ * @return true iff rule was added, false if the set is full
+ */
+bool alert_rules_add(AlertRules* restrict rules, const AlertRule* restrict rule);
+
+/**
+ * @brief get rule with given index
+ *
+ * @param rules pointer to valid AlertRules
+ * @param index index of the rule (order of adding)
+ * @return pointer to the rule, NULL if index is out of range
+ */
+const AlertRule* alert_rules_get(const AlertRules* rules, size_t index);
+
+/**
+ * @brief get number of rules in the set
+ *
+ * @param rules pointer to valid AlertRules
+ * @return number of rules
+ */
+size_t alert_rules_count(const AlertRules* rules);
+
+/**
+ * @brief Evaluate all rules on the snapshot. NaN values leave the state of the rule unchanged
+ * except for resetting its duration counter.
+ *
+ * @param rules pointer to valid AlertRules
+ * @param snapshot pointer to valid snapshot
+ * @param events array where state transitions will be stored
+ * @param events_size number of elements that fit into events, surplus transitions are applied but not reported
+ * @return number of events stored
+ */
+size_t alert_rules_evaluate(AlertRules* restrict rules, const Snapshot* restrict snapshot,
+                            AlertEvent* restrict events, size_t events_size);
+
+/**
+ * @brief Write one line describing the event, e.g. "alert saturated fired core 3 value 97.50\n"
+ *
+ * @param rules pointer to valid AlertRules
+ * @param event event produced by alert_rules_evaluate
+ * @param dest buffer for the message
+ * @param dest_size size of dest, ALERT_EVENT_MESSAGE_SIZE is always enough
+ * @return length of the message, @see man snprintf(3)
+ */
+int alert_rules_format_event(const AlertRules* restrict rules, const AlertEvent* restrict event,
+                             char* restrict dest, size_t dest_size);
+
+#endif
@@ -0,0 +1,35 @@
+/**
+ * @file alloc_guard.h
+ * @brief Debug mode that counts heap allocations of the whole process, enabled by building with ALLOC_GUARD.
+ *
+ * malloc, calloc, realloc, free and the aligned variants are replaced by wrappers of the glibc allocator,
+ * so allocations of stdio and threads are counted as well. After alloc_guard_seal every allocation is
+ * reported on stderr with its size and the process aborts, leaving the allocating call on the stack
+ * of the core dump. Without ALLOC_GUARD nothing is replaced, sealing does nothing and stats are zero.
+ */
+#ifndef ALLOC_GUARD_H
+#define ALLOC_GUARD_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+
+/**
+ * @brief Allocations since start of the process, enabled is set iff built with ALLOC_GUARD
+ */
+typedef struct AllocGuardStats {
+    bool enabled;
+    uint64_t allocations;
+    uint64_t bytes;
+} AllocGuardStats;
+
+/**
+ * @brief Declare initialization finished, any following allocation aborts the process
+ */
+void alloc_guard_seal(void);
+
+/**
+ * @return allocations counted so far
+ */
+AllocGuardStats alloc_guard_stats(void);
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file arena.h
+ * @brief Memory region mapped once at startup from which long-lived objects are carved.
+ *
+ * The region is a single anonymous mapping, populated when it is created, so carving never
+ * touches the heap and never faults. Objects are never freed one by one, the whole region
+ * is unmapped by arena_delete. Every object starts at ARENA_ALIGNMENT, so objects used by
+ * different threads do not share a cache line. Carving is not thread safe, it is meant for
+ * initialization.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define ARENA_ALIGNMENT 64
+
+typedef struct Arena Arena;
+
+/**
+ * @brief Map region able to hold objects of total footprint size
+ *
+ * @param size sum of arena_footprint of all objects that will be carved
+ * @return pointer to valid Arena on success, NULL if mapping failed or size is 0
+ */
+Arena* arena_new(size_t size);
+
+/**
+ * @brief Unmap the region, every carved object becomes invalid
+ *
+ * @param arena pointer to valid Arena or NULL, in latter case nothing happens
+ */
+void arena_delete(Arena* arena);
+
+/**
+ * @param size size of an object
+ * @return space the object occupies in the arena
+ */
+size_t arena_footprint(size_t size);
+
+/**
+ * @brief Carve zeroed object
+ *
+ * @param arena pointer to valid Arena
+ * @param size size of the object
+ * @return pointer aligned to ARENA_ALIGNMENT, NULL if the arena is exhausted or size is 0
+ */
+void* arena_alloc(Arena* arena, size_t size);
+
+/**
+ * @brief Lock the whole region in memory (mlock)
+ *
+ * @param arena pointer to valid Arena
+ * @return true on success, false if the limit of locked memory does not allow it
+ */
+bool arena_lock(Arena* arena);
+
+/**
+ * @return size of the mapped region in bytes
+ */
+size_t arena_size(const Arena* arena);
+
+/**
+ * @return bytes carved so far, headers and alignment included
+ */
+size_t arena_used(const Arena* arena);
+
+/**
+ * @return true if the region has been locked by arena_lock
+ */
+bool arena_locked(const Arena* arena);
+
+#endif
@@ -1,6 +1,15 @@
 /**
  * @file circular_buffer.h
  * @brief Functional API for Circular buffers (FIFO queues).
+ * If compiled with PIPELINE_STATS, every buffer counts inserts, removals, attempts to insert into
+ * full buffer and to remove from empty one and keeps its high-water mark. Counters are modified
+ * only by the thread that owns the buffer at the moment (holds its guard) and may be read by any thread.
+ * Without PIPELINE_STATS nothing is counted.
+ * Elements may be accessed in place through spans: the consumer peeks readable elements and consumes
+ * them, the producer reserves free elements and commits them. Owner of the guard takes the span,
+ * the elements may then be accessed without the guard until they are consumed or committed.
+ * A span of an ordinary buffer ends at the end of its memory, a mirrored buffer maps its memory twice
+ * back to back, so every readable or writable range is one contiguous span.
  * 
  */
 
@@ -10,7 +19,9 @@
 #include <stdlib.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <stdbool.h>
 #include <pthread.h>
+#include "arena.h"
 
 enum ECircularBufferError {
     NULL_PTR_ERROR = -1,
@@ -22,6 +33,21 @@ enum ECircularBufferError {
  */
 typedef struct CircularBuffer CircularBuffer;
 
+/**
+ * @brief Counters of a buffer since its creation, @see circular_buffer_stats
+ *
+ */
+typedef struct CircularBufferStats {
+    size_t capacity;
+    size_t high_water_mark;
+    uint64_t inserts;
+    uint64_t removals;
+    /*Insertions rejected because the buffer was full*/
+    uint64_t full_events;
+    /*Removals that found the buffer empty*/
+    uint64_t empty_events;
+} CircularBufferStats;
+
 /**
  * @brief Allocates new CircularBuffer of given size.
  * 
@@ -31,11 +57,38 @@ typedef struct CircularBuffer CircularBuffer;
  */
 CircularBuffer* circular_buffer_new(size_t buffer_size, size_t element_size);
 
+/**
+ * @brief Carve new CircularBuffer of given size from arena, @see circular_buffer_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(circular_buffer_footprint()) bytes left
+ * @param buffer_size number of elements that will fit into the buffer
+ * @param element_size Size of single element (in bytes)
+ * @return CircularBuffer* Pointer to the buffer on success. NULL if at least one of the sizes was equal to 0 or arena is exhausted
+ */
+CircularBuffer* circular_buffer_new_in(Arena* arena, size_t buffer_size, size_t element_size);
+
+/**
+ * @brief Map new mirrored CircularBuffer backed by a memfd, @see circular_buffer_new
+ *
+ * @param buffer_size number of elements that will fit into the buffer, rounded up to whole pages
+ * @param element_size Size of single element (in bytes)
+ * @return CircularBuffer* Pointer to the buffer on success. NULL if at least one of the sizes was equal to 0,
+ * element_size does not divide the rounded size or mapping failed
+ */
+CircularBuffer* circular_buffer_new_mirrored(size_t buffer_size, size_t element_size);
+
+/**
+ * @param buffer_size number of elements that will fit into the buffer
+ * @param element_size Size of single element (in bytes)
+ * @return size of the buffer in memory
+ */
+size_t circular_buffer_footprint(size_t buffer_size, size_t element_size);
+
 /**
  * @brief Deletes allocated CircularBuffer.
  * 
  * @param buffer Pointer to either valid CircularBuffer or nullptr. 
- * In former case, the pointed CircularBuffer will be deallocated. 
+ * In former case, the pointed CircularBuffer will be deallocated or unmapped, unless it was carved from an arena. 
  * In latter case, nothing will happen
  */
 void circular_buffer_delete(CircularBuffer* buffer);
@@ -61,6 +114,48 @@ int circular_buffer_insert_single(CircularBuffer* restrict buffer, const void* r
  */
 int circular_buffer_remove_single(CircularBuffer* restrict buffer, void* restrict dest);
 
+/**
+ * @brief Get the oldest readable elements that are contiguous in memory
+ *
+ * @param buffer pointer to valid CircularBuffer
+ * @param count pointer to memory where number of elements of the span shall be stored, 0 if the buffer is empty.
+ * It equals circular_buffer_read_available for a mirrored buffer.
+ * @return pointer to the first element of the span, the consumer may modify the elements until it consumes them
+ */
+void* circular_buffer_peek_span(CircularBuffer* restrict buffer, size_t* restrict count);
+
+/**
+ * @brief Remove the oldest count elements, typically after circular_buffer_peek_span
+ *
+ * @param buffer pointer to valid CircularBuffer
+ * @param count number of elements, at most circular_buffer_read_available
+ */
+void circular_buffer_consume(CircularBuffer* buffer, size_t count);
+
+/**
+ * @brief Get free elements that are contiguous in memory and follow the newest element
+ *
+ * @param buffer pointer to valid CircularBuffer
+ * @param count pointer to memory where number of elements of the span shall be stored, 0 if the buffer is full.
+ * It equals circular_buffer_write_available for a mirrored buffer.
+ * @return pointer to the first element of the span
+ */
+void* circular_buffer_reserve_span(CircularBuffer* restrict buffer, size_t* restrict count);
+
+/**
+ * @brief Insert count elements written into span of circular_buffer_reserve_span
+ *
+ * @param buffer pointer to valid CircularBuffer
+ * @param count number of elements, at most the count of the reserved span
+ */
+void circular_buffer_commit(CircularBuffer* buffer, size_t count);
+
+/**
+ * @param c_b pointer to valid CircularBuffer
+ * @return true if the buffer was created by circular_buffer_new_mirrored
+ */
+bool circular_buffer_mirrored(const CircularBuffer* c_b);
+
 /**
  * @brief Return number of elements available for write
  * 
@@ -77,5 +172,14 @@ size_t circular_buffer_write_available(const CircularBuffer* c_b);
  */
 size_t circular_buffer_read_available(const CircularBuffer* c_b);
 
+/**
+ * @brief Retrieve counters of the buffer
+ * 
+ * @param c_b pointer to valid CircularBuffer
+ * @param dest pointer to memory where the counters shall be stored, only capacity is set without PIPELINE_STATS
+ * @return true iff compiled with PIPELINE_STATS
+ */
+bool circular_buffer_stats(const CircularBuffer* restrict c_b, CircularBufferStats* restrict dest);
+
 
 #endif
@@ -0,0 +1,82 @@
+/**
+ * @file event_loop.h
+ * @brief Single-threaded execution mode. One thread waits in epoll on a timerfd (sampling period)
+ * and a signalfd (SIGTERM, SIGINT) and, on every tick, reads /proc/stat together with pressure
+ * and frequency sources, parses, runs printer sinks and writes pending log entries inline.
+ * No data passes through snapshot or char buffers and no watchdog is involved.
+ * If stage_overhead of printer_arguments is set, reading and parsing are interleaved and both are
+ * accounted to the reader stage, sinks to the printer stage and writing of log entries to the logger stage.
+ * If trace is set, the thread is attached to it as "event_loop" and SIGUSR1 writes the trace to trace_file.
+ * If replay is set, the timer fires at the recorded delay of every record (immediately if replay_fast)
+ * and the loop finishes at the end of the recording.
+ * If priming is not zero, the first tick is the baseline and the second one fires after priming.
+ * If adaptive_period is set, it is updated with every snapshot and the timer is rearmed whenever it changes,
+ * replay ignores it.
+ * If seal_allocations is set, heap allocations are sealed (alloc_guard_seal) once the loop has set itself up,
+ * before the first tick.
+ * If arena is set, the state of the loop (parser state and read buffer) is carved from it instead of the heap.
+ *
+ */
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include "psi_parser.h"
+#include "frequency_sampler.h"
+#include "topology.h"
+#include "thread_printer.h"
+#include "trace.h"
+#include "stat_recording.h"
+#include "adaptive_period.h"
+#include "arena.h"
+
+/**
+ * @brief event_loop arguments. Sources have the same meaning as in ThreadReaderArguments,
+ * sinks and logger buffer are taken from printer_arguments. logger_buffer must hold at least
+ * as many payloads as a single snapshot can produce (alerts included), it is flushed to
+ * logger_output after every line and every snapshot.
+ *
+ */
+typedef struct EventLoopArguments {
+    FILE* input_file;
+    FILE* pressure_files[PSI_RESOURCE_COUNT];
+    FrequencySampler* frequency_sampler;
+    StatRecorder* recorder;
+    StatReplay* replay;
+    bool replay_fast;
+    Topology* topology;
+    /*Sampling period, zero means 1 s*/
+    struct timespec period;
+    /*Interval between the baseline and the first snapshot, zero disables the baseline*/
+    struct timespec priming;
+    AdaptivePeriod* adaptive_period;
+    const ThreadPrinterArguments* printer_arguments;
+    FILE* logger_output;
+    Trace* trace;
+    /*Descriptor of the file the trace is written to, opened by the caller*/
+    int trace_file;
+    bool seal_allocations;
+    /*Size of the read buffer, input_file up to this size is read by a single pread, zero means 16 kB*/
+    size_t read_size;
+    /*Arena with at least event_loop_footprint(read_size) bytes left or NULL*/
+    Arena* arena;
+} EventLoopArguments;
+
+/**
+ * @brief Run the loop until SIGTERM or SIGINT arrives. Both signals (and SIGUSR1 if trace is set)
+ * shall be blocked in all threads of the process before the call, they are consumed through signalfd.
+ *
+ * @param arguments pointer to valid EventLoopArguments
+ * @return true if the loop finished because of a signal or the end of replay, false if setup or waiting failed
+ */
+bool event_loop_run(const EventLoopArguments* arguments);
+
+/**
+ * @param read_size read_size of EventLoopArguments
+ * @return space the loop carves from its arena, arena_footprint of every object included
+ */
+size_t event_loop_footprint(size_t read_size);
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file fake_stat.h
+ * @brief Generator of synthetic /proc/stat content for tests, benchmarks and fake procfs trees.
+ *
+ * Every tick adds FAKE_STAT_JIFFIES_PER_TICK jiffies to every core, split between user, system and
+ * idle by the load of the core in that tick, so usage computed between two consecutive ticks is
+ * equal to the load. Load follows a pattern:
+ * - flat:<percent>  every core has the same load (default 50),
+ * - ramp            load grows linearly from 0 % on the first core to 100 % on the last one,
+ * - sine:<ticks>    load of every core oscillates between 0 and 100 % with period of ticks
+ *                   (default 60), phase is shifted by core,
+ * - random:<seed>   load of every core is uniformly random in every tick (default seed 1).
+ */
+#ifndef FAKE_STAT_H
+#define FAKE_STAT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#define FAKE_STAT_JIFFIES_PER_TICK 100
+
+typedef enum EFakeStatPattern {
+    FAKE_STAT_PATTERN_FLAT = 0,
+    FAKE_STAT_PATTERN_RAMP = 1,
+    FAKE_STAT_PATTERN_SINE = 2,
+    FAKE_STAT_PATTERN_RANDOM = 3,
+    FAKE_STAT_PATTERN_COUNT,
+} EFakeStatPattern;
+
+typedef struct FakeStat FakeStat;
+
+/**
+ * @brief Create generator of number_of_cores cores, counters start at zero before the first tick
+ *
+ * @param number_of_cores number of cpu lines
+ * @param pattern load pattern
+ * @param parameter parameter of the pattern, @see fake_stat_pattern_parse
+ * @return pointer to valid FakeStat on success, NULL on memory error or if number_of_cores is 0
+ */
+FakeStat* fake_stat_new(size_t number_of_cores, EFakeStatPattern pattern, uint64_t parameter);
+
+/**
+ * @param fake_stat pointer to valid FakeStat or NULL, in latter case nothing happens
+ */
+void fake_stat_delete(FakeStat* fake_stat);
+
+/**
+ * @brief Parse pattern in the form name[:parameter]
+ *
+ * @param spec pattern, @see fake_stat.h
+ * @param pattern destination of the pattern
+ * @param parameter destination of the parameter, default of the pattern if omitted
+ * @return true on success, false if the name is unknown or the parameter is invalid
+ */
+bool fake_stat_pattern_parse(const char spec[restrict static 1], EFakeStatPattern* restrict pattern,
+                             uint64_t* restrict parameter);
+
+/**
+ * @brief Advance to the next tick and add jiffies of every core according to its load
+ *
+ * @param fake_stat pointer to valid FakeStat
+ */
+void fake_stat_advance(FakeStat* fake_stat);
+
+/**
+ * @param fake_stat pointer to valid FakeStat
+ * @param core core number lower than number_of_cores
+ * @return load of core in percent added by the last fake_stat_advance, 0 before the first one
+ */
+unsigned fake_stat_load(const FakeStat* fake_stat, size_t core);
+
+/**
+ * @brief Format the content of /proc/stat, aggregate cpu line, every core and the usual trailing lines
+ *
+ * @param fake_stat pointer to valid FakeStat
+ * @param buffer destination, may be NULL if size is 0
+ * @param size size of buffer
+ * @return length of the content as snprintf, content is truncated if it is not lower than size
+ */
+int fake_stat_format(const FakeStat* restrict fake_stat, char* restrict buffer, size_t size);
+
+/**
+ * @param pattern pattern to be converted
+ * @return name of the pattern, "unknown" if invalid
+ */
+const char* fake_stat_pattern_to_str(EFakeStatPattern pattern);
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * @file frequency_sampler.h
+ * @brief Sampling of current frequency of every cpu.
+ *
+ * Files of all cpus are opened once and re-read with pread every tick. Sources:
+ * cpufreq - <sysfs>/devices/system/cpu/cpu<N>/cpufreq/scaling_cur_freq
+ * msr     - effective frequency base * delta(APERF) / delta(MPERF) from <dev>/cpu/<N>/msr,
+ *           where base is cpufreq base_frequency (or cpuinfo_max_freq). Requires root and msr module.
+ * With more than one thread, cpus are split into contiguous ranges read in parallel.
+ *
+ * The reader forwards samples to the parser as lines "freq <cpu> <kHz>".
+ */
+#ifndef FREQUENCY_SAMPLER_H
+#define FREQUENCY_SAMPLER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+typedef enum EFrequencySource {
+    FREQUENCY_SOURCE_CPUFREQ = 0,
+    FREQUENCY_SOURCE_MSR = 1,
+} EFrequencySource;
+
+typedef enum EFrequencySamplerParseResult {
+    FREQUENCY_SAMPLER_DISCARD_LINE = -2,
+    FREQUENCY_SAMPLER_FAIL = -3,
+    FREQUENCY_SAMPLER_SUCCESS = 10,
+} EFrequencySamplerParseResult;
+
+typedef struct FrequencySampler FrequencySampler;
+
+/**
+ * @brief Open files of all cpus and start worker threads
+ *
+ * @param sysfs_root sysfs mount point, "/sys" on real system
+ * @param dev_root devtmpfs mount point, "/dev" on real system, used only by msr source
+ * @param source source of frequency
+ * @param number_of_threads number of threads reading files, 1 means the calling thread only
+ * @return pointer to valid FrequencySampler on success, NULL on failure, if no cpu has readable
+ * source (e.g. msr without permission) or if number_of_threads is 0
+ */
+FrequencySampler* frequency_sampler_new(const char sysfs_root[static 1], const char dev_root[static 1],
+                                        EFrequencySource source, size_t number_of_threads);
+
+/**
+ * @brief Stop worker threads, close files and free memory
+ *
+ * @param sampler pointer to valid FrequencySampler or NULL, in latter case nothing happens
+ */
+void frequency_sampler_delete(FrequencySampler* sampler);
+
+/**
+ * @brief Read frequency of every cpu. Shall be called by single thread.
+ * msr source reports average frequency since the previous call (or since frequency_sampler_new).
+ *
+ * @param sampler pointer to valid FrequencySampler
+ * @return pointer to frequencies in kHz indexed by cpu number, 0 if unknown;
+ * valid until the next call, @see frequency_sampler_number_of_cpus
+ */
+const uint32_t* frequency_sampler_sample(FrequencySampler* sampler);
+
+/**
+ * @brief get number of elements returned by frequency_sampler_sample (highest cpu number + 1)
+ *
+ * @param sampler pointer to valid FrequencySampler
+ * @return number of cpus
+ */
+size_t frequency_sampler_number_of_cpus(const FrequencySampler* sampler);
+
+/**
+ * @brief Parse line forwarded by reader, e.g. "freq 12 3500000"
+ *
+ * @param buffer null-terminated string with at least 4 characters
+ * @param cpu pointer to memory where the cpu number will be stored
+ * @param khz pointer to memory where the frequency will be stored
+ * @return FREQUENCY_SAMPLER_SUCCESS on success, FREQUENCY_SAMPLER_DISCARD_LINE if line does not start
+ * with "freq ", FREQUENCY_SAMPLER_FAIL if it is malformed
+ */
+int frequency_sampler_parse_line(const char buffer[restrict static 5], size_t* restrict cpu, uint32_t* restrict khz);
+
+#endif
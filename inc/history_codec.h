@@ -0,0 +1,130 @@
+/**
+ * @file history_codec.h
+ * @brief Compressed block format for usage history (Gorilla-style).
+ *
+ * Block starts with 16 byte header (magic, number of cores, number of samples, length in bits)
+ * followed by bit stream. Every sample consists of timestamp encoded as delta-of-delta
+ * and per-core usage values XOR-ed with the previous value of the same core.
+ * Encoding is lossless, the first sample of every block is stored verbatim.
+ */
+#ifndef HISTORY_CODEC_H
+#define HISTORY_CODEC_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+enum {
+    HISTORY_CODEC_HEADER_SIZE = 16,
+};
+
+typedef struct HistoryCodecEncoder HistoryCodecEncoder;
+typedef struct HistoryCodecDecoder HistoryCodecDecoder;
+
+/**
+ * @brief Allocate encoder writing into block provided by the caller.
+ *
+ * @param number_of_cores number of values in each sample
+ * @param block memory where encoded block will be stored, it must remain valid until block is finished
+ * @param block_size size of block in bytes, shall be greater than HISTORY_CODEC_HEADER_SIZE and smaller than 512 MiB
+ * @return pointer to valid encoder on success. NULL on failure or if any of the arguments is invalid
+ */
+HistoryCodecEncoder* history_codec_encoder_new(size_t number_of_cores, uint8_t* block, size_t block_size);
+
+/**
+ * @brief Free memory occupied by encoder. The block is not altered.
+ *
+ * @param encoder pointer to valid encoder or NULL, in latter case nothing happens
+ */
+void history_codec_encoder_delete(HistoryCodecEncoder* encoder);
+
+/**
+ * @brief Append single sample to the current block.
+ *
+ * @param encoder pointer to valid encoder
+ * @param timestamp_ns timestamp of the sample, in nanoseconds
+ * @param values array of number_of_cores values
+ * @return true iff sample was appended, false if there is not enough space left in the block;
+ * in latter case the block shall be finished and encoder reset
+ */
+bool history_codec_encode(HistoryCodecEncoder* restrict encoder, uint64_t timestamp_ns, const double values[restrict static 1]);
+
+/**
+ * @brief Write the header of the current block. It may be called after every sample, the block
+ * is valid up to the last finished sample and appending may continue.
+ *
+ * @param encoder pointer to valid encoder
+ * @return size_t number of bytes of the block that shall be stored
+ */
+size_t history_codec_encoder_finish(HistoryCodecEncoder* encoder);
+
+/**
+ * @brief Start new block. Previous block shall be finished before.
+ *
+ * @param encoder pointer to valid encoder
+ * @param block memory where encoded block will be stored
+ * @param block_size size of block in bytes, shall be greater than HISTORY_CODEC_HEADER_SIZE and smaller than 512 MiB
+ * @return true iff encoder was reset
+ */
+bool history_codec_encoder_reset(HistoryCodecEncoder* restrict encoder, uint8_t* restrict block, size_t block_size);
+
+/**
+ * @brief get number of samples appended to the current block
+ *
+ * @param encoder pointer to valid encoder
+ * @return number of samples
+ */
+size_t history_codec_encoder_number_of_samples(const HistoryCodecEncoder* encoder);
+
+/**
+ * @brief get upper bound of the encoded size of a single sample
+ *
+ * @param number_of_cores number of values in each sample
+ * @return size in bytes, a block with this much space after the header always accepts a sample
+ */
+size_t history_codec_sample_max_size(size_t number_of_cores);
+
+/**
+ * @brief get number of samples of finished block without decoding it
+ *
+ * @param block pointer to finished block
+ * @param block_size number of valid bytes in block
+ * @return number of samples, 0 if the block is malformed
+ */
+size_t history_codec_block_number_of_samples(const uint8_t* block, size_t block_size);
+
+/**
+ * @brief Allocate decoder reading finished block.
+ *
+ * @param block pointer to finished block
+ * @param block_size number of valid bytes in block
+ * @return pointer to valid decoder on success, NULL on failure or if the block is malformed
+ */
+HistoryCodecDecoder* history_codec_decoder_new(const uint8_t* block, size_t block_size);
+
+/**
+ * @brief Free memory occupied by decoder.
+ *
+ * @param decoder pointer to valid decoder or NULL, in latter case nothing happens
+ */
+void history_codec_decoder_delete(HistoryCodecDecoder* decoder);
+
+/**
+ * @brief Retrieve next sample from the block.
+ *
+ * @param decoder pointer to valid decoder
+ * @param timestamp_ns pointer to memory where timestamp will be stored
+ * @param values array with space for number_of_cores values
+ * @return true iff sample was retrieved, false if the block has been exhausted or is malformed
+ */
+bool history_codec_decode(HistoryCodecDecoder* restrict decoder, uint64_t* restrict timestamp_ns, double values[restrict static 1]);
+
+/**
+ * @brief get number of values in each sample of decoded block
+ *
+ * @param decoder pointer to valid decoder
+ * @return number of cores
+ */
+size_t history_codec_decoder_number_of_cores(const HistoryCodecDecoder* decoder);
+
+#endif
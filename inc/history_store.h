@@ -0,0 +1,126 @@
+/**
+ * @file history_store.h
+ * @brief On-disk history of per-core usage.
+ *
+ * The history is a preallocated, memory-mapped ring of fixed-size blocks of history_codec
+ * format, each holding up to HISTORY_STORE_BLOCK_RECORDS records: timestamp followed by usage
+ * of every core. Values are rounded to 1/HISTORY_STORE_RESOLUTION, far below resolution of
+ * the tick counters, so that their XOR compresses well. A block is budgeted for the worst case of
+ * usage values (under 5 bytes per value), so capacity records are always
+ * retained; only values outside [0, 128) may close a block early and shorten retention.
+ * The header stores geometry of the file and write position, so the history survives restart
+ * of the tracker, the block being appended to is closed then.
+ */
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "snapshot.h"
+
+#define HISTORY_STORE_BLOCK_RECORDS 60
+#define HISTORY_STORE_RESOLUTION 64.0
+
+typedef struct HistoryStore HistoryStore;
+
+/**
+ * @brief Single sample retrieved by query.
+ * timestamp_ns is CLOCK_REALTIME in nanoseconds.
+ *
+ */
+typedef struct HistoryStoreSample {
+    uint64_t timestamp_ns;
+    double usage;
+} HistoryStoreSample;
+
+/**
+ * @brief Open history file for appending. If the file does not exist, it is created and
+ * preallocated for capacity records. Otherwise write position is recovered from its header.
+ *
+ * @param path path to history file
+ * @param number_of_cores number of per-core values in each record
+ * @param capacity number of records kept in the ring (retention / sampling period)
+ * @param sync_interval number of appends between two msync calls, 0 means sync only on delete
+ * @return pointer to valid HistoryStore on success. NULL on failure, if one of the sizes is 0
+ * or if existing file has different geometry.
+ */
+HistoryStore* history_store_open(const char path[static 1], size_t number_of_cores, size_t capacity, size_t sync_interval);
+
+/**
+ * @brief Open existing history file for queries only.
+ *
+ * @param path path to history file
+ * @return pointer to valid HistoryStore on success, NULL on failure
+ */
+HistoryStore* history_store_open_readonly(const char path[static 1]);
+
+/**
+ * @brief Flush (if writable), unmap and close history file
+ *
+ * @param store pointer to valid HistoryStore or NULL, in latter case nothing happens
+ */
+void history_store_delete(HistoryStore* store);
+
+/**
+ * @brief Append snapshot as a new record, overwriting the oldest block if the ring is full.
+ * Cores missing in the snapshot are stored as NaN like cores without usage, surplus cores are dropped.
+ *
+ * @param store pointer to HistoryStore opened for appending
+ * @param snapshot snapshot that shall be stored
+ * @return true iff record was stored
+ */
+bool history_store_append(HistoryStore* restrict store, const Snapshot* restrict snapshot);
+
+/**
+ * @brief Append arbitrary values as a new record. Used for files whose columns are not plain
+ * per-core usage, e.g. rollups.
+ *
+ * @param store pointer to HistoryStore opened for appending
+ * @param timestamp_ns timestamp of the record
+ * @param values array of values, missing columns are stored as NaN, surplus values are dropped
+ * @param number_of_values number of elements in values
+ * @return true iff record was stored
+ */
+bool history_store_append_values(HistoryStore* restrict store, uint64_t timestamp_ns,
+                                 const double values[restrict static 1], size_t number_of_values);
+
+/**
+ * @brief Flush mapped records and the header to disk. @see man msync(2)
+ *
+ * @param store pointer to valid HistoryStore
+ * @return true iff msync succeeded
+ */
+bool history_store_sync(HistoryStore* store);
+
+/**
+ * @brief Retrieve samples of single core with timestamp in [from_ns, to_ns], oldest first.
+ *
+ * @param store pointer to valid HistoryStore
+ * @param core index of core
+ * @param from_ns lower bound of time range (inclusive)
+ * @param to_ns upper bound of time range (inclusive)
+ * @param dest array for storing samples
+ * @param dest_size number of elements that fit into dest
+ * @return number of samples stored in dest, 0 if core is out of range
+ */
+size_t history_store_query(const HistoryStore* restrict store, size_t core, uint64_t from_ns, uint64_t to_ns,
+                           HistoryStoreSample* restrict dest, size_t dest_size);
+
+/**
+ * @brief get number of records currently stored
+ *
+ * @param store pointer to valid HistoryStore
+ * @return number of valid records
+ */
+size_t history_store_count(const HistoryStore* store);
+
+/**
+ * @brief get number of per-core values in each record
+ *
+ * @param store pointer to valid HistoryStore
+ * @return number of cores
+ */
+size_t history_store_number_of_cores(const HistoryStore* store);
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @file hotspot.h
+ * @brief Summary of many-core snapshots: N busiest and N idlest cores, aggregate statistics
+ * and detection of cores that stay above threshold for K consecutive snapshots.
+ *
+ * Busiest and idlest cores are found with partial selection (quickselect), only the selected
+ * N cores are sorted, hence an update costs O(cores + N log N).
+ */
+#ifndef HOTSPOT_H
+#define HOTSPOT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "snapshot.h"
+#include "arena.h"
+
+typedef struct HotspotCore {
+    size_t core;
+    double usage;
+} HotspotCore;
+
+/**
+ * @brief Aggregate of cores with valid (not NaN) usage in the last snapshot.
+ * number_of_hot is number of cores flagged as hot spots.
+ *
+ */
+typedef struct HotspotAggregate {
+    size_t number_of_cores;
+    size_t number_of_hot;
+    double min;
+    double max;
+    double avg;
+} HotspotAggregate;
+
+typedef struct Hotspot Hotspot;
+
+/**
+ * @brief Allocate hot spot detector
+ *
+ * @param number_of_cores number of cores, cores above it are ignored
+ * @param top_n number of busiest (and idlest) cores reported
+ * @param threshold usage in % that marks the core as busy
+ * @param consecutive_samples number of consecutive snapshots above threshold after which the core is flagged
+ * @return pointer to valid Hotspot on success, NULL on failure or if any of the sizes is 0
+ */
+Hotspot* hotspot_new(size_t number_of_cores, size_t top_n, double threshold, size_t consecutive_samples);
+
+/**
+ * @brief Carve hot spot detector from arena, @see hotspot_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(hotspot_footprint()) bytes left
+ * @param number_of_cores number of cores, cores above it are ignored
+ * @param top_n number of busiest (and idlest) cores reported
+ * @param threshold usage in % that marks the core as busy
+ * @param consecutive_samples number of consecutive snapshots above threshold after which the core is flagged
+ * @return pointer to valid Hotspot on success, NULL if any of the sizes is 0 or arena is exhausted
+ */
+Hotspot* hotspot_new_in(Arena* arena, size_t number_of_cores, size_t top_n, double threshold, size_t consecutive_samples);
+
+/**
+ * @param number_of_cores number of cores
+ * @param top_n number of busiest (and idlest) cores reported
+ * @return size of the detector in memory
+ */
+size_t hotspot_footprint(size_t number_of_cores, size_t top_n);
+
+/**
+ * @brief Free memory occupied by the detector, detector carved from an arena is left to the arena
+ *
+ * @param hotspot pointer to valid Hotspot or NULL, in latter case nothing happens
+ */
+void hotspot_delete(Hotspot* hotspot);
+
+/**
+ * @brief Recompute selection and aggregate from the snapshot and update streaks of the cores.
+ * Core with NaN usage loses its streak.
+ *
+ * @param hotspot pointer to valid Hotspot
+ * @param snapshot pointer to valid snapshot
+ */
+void hotspot_update(Hotspot* restrict hotspot, const Snapshot* restrict snapshot);
+
+/**
+ * @brief get the busiest cores, the busiest first
+ *
+ * @param hotspot pointer to valid Hotspot
+ * @param count pointer to memory where number of returned cores (at most top_n) will be stored
+ * @return pointer to array valid until the next update
+ */
+const HotspotCore* hotspot_busiest(const Hotspot* restrict hotspot, size_t* restrict count);
+
+/**
+ * @brief get the idlest cores, the idlest first
+ *
+ * @param hotspot pointer to valid Hotspot
+ * @param count pointer to memory where number of returned cores (at most top_n) will be stored
+ * @return pointer to array valid until the next update
+ */
+const HotspotCore* hotspot_idlest(const Hotspot* restrict hotspot, size_t* restrict count);
+
+/**
+ * @brief get aggregate of the last snapshot
+ *
+ * @param hotspot pointer to valid Hotspot
+ * @return pointer to aggregate valid until the next update
+ */
+const HotspotAggregate* hotspot_aggregate(const Hotspot* hotspot);
+
+/**
+ * @brief check whether the core stayed above threshold for at least consecutive_samples snapshots
+ *
+ * @param hotspot pointer to valid Hotspot
+ * @param core index of core
+ * @return true iff the core is flagged, false if it is not or it is out of range
+ */
+bool hotspot_is_hot(const Hotspot* hotspot, size_t core);
+
+/**
+ * @brief get number of consecutive snapshots in which the core has been above threshold
+ *
+ * @param hotspot pointer to valid Hotspot
+ * @param core index of core
+ * @return length of the streak, 0 if the core is out of range
+ */
+size_t hotspot_streak(const Hotspot* hotspot, size_t core);
+
+#endif
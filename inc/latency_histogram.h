@@ -0,0 +1,68 @@
+/**
+ * @file latency_histogram.h
+ * @brief Log-linear (HDR-style) histogram of durations in nanoseconds.
+ *
+ * Values below 2 * LATENCY_HISTOGRAM_SUB_BUCKETS have bucket of their own. Every higher power
+ * of two is split into LATENCY_HISTOGRAM_SUB_BUCKETS linear buckets, so the relative error of
+ * a quantile is below 1 / LATENCY_HISTOGRAM_SUB_BUCKETS (~3%) from nanoseconds up to
+ * 2^LATENCY_HISTOGRAM_MAX_EXPONENT ns (~18 minutes); longer values are counted in the last bucket.
+ * Memory is constant regardless of the number of samples.
+ */
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <inttypes.h>
+
+enum {
+    LATENCY_HISTOGRAM_SUB_BITS = 5,
+    LATENCY_HISTOGRAM_SUB_BUCKETS = 1 << LATENCY_HISTOGRAM_SUB_BITS,
+    LATENCY_HISTOGRAM_MAX_EXPONENT = 40,
+    LATENCY_HISTOGRAM_BUCKETS = (LATENCY_HISTOGRAM_MAX_EXPONENT - LATENCY_HISTOGRAM_SUB_BITS + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS,
+};
+
+typedef struct LatencyHistogram {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+} LatencyHistogram;
+
+/**
+ * @brief Remove all samples from histogram
+ *
+ * @param histogram pointer to valid histogram
+ */
+void latency_histogram_clear(LatencyHistogram* histogram);
+
+/**
+ * @brief Insert single sample into histogram
+ *
+ * @param histogram pointer to valid histogram
+ * @param value_ns duration in nanoseconds
+ */
+void latency_histogram_add(LatencyHistogram* histogram, uint64_t value_ns);
+
+/**
+ * @brief Estimate quantile as the highest value of the bucket containing requested rank,
+ * never above the largest inserted value
+ *
+ * @param histogram pointer to valid histogram
+ * @param quantile number from [0, 1], e.g. 0.99 for p99
+ * @return estimated value in nanoseconds or 0 if histogram is empty
+ */
+uint64_t latency_histogram_quantile(const LatencyHistogram* histogram, double quantile);
+
+/**
+ * @param value_ns duration in nanoseconds
+ * @return index of the bucket counting value_ns
+ */
+size_t latency_histogram_bucket(uint64_t value_ns);
+
+/**
+ * @param bucket index of bucket, less than LATENCY_HISTOGRAM_BUCKETS
+ * @return the highest value counted by bucket
+ */
+uint64_t latency_histogram_bucket_max(size_t bucket);
+
+#endif
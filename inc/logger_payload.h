@@ -1,17 +1,27 @@
 /**
  * @file logger_payload.h
  * @brief interface used for sending logs to thread_logger
+ * Payloads are allocated on the heap unless a pool is attached, then they are taken from
+ * the pool of fixed-size payloads and messages longer than LOGGER_PAYLOAD_POOL_MESSAGE_SIZE - 1
+ * are truncated. The pool is shared by all threads.
  * 
  */
 
 #ifndef LOGGER_PAYLOAD_H
 #define LOGGER_PAYLOAD_H
 
+#include <stddef.h>
+#include <stdbool.h>
+
+/*Fits the longest message of the tracker, a report of stage overhead*/
+#define LOGGER_PAYLOAD_POOL_MESSAGE_SIZE 640
+
 typedef struct LoggerPayload LoggerPayload;
 
 typedef enum ELoggerPayloadType {
     LOGGER_PAYLOAD_TYPE_WARNING = 0,
     LOGGER_PAYLOAD_TYPE_ERROR = 1,
+    LOGGER_PAYLOAD_TYPE_INFO = 2,
 } ELoggerPayloadType;
 
 /**
@@ -19,10 +29,33 @@ typedef enum ELoggerPayloadType {
  * 
  * @param type type of payload
  * @param message pointer to valid string of byte size at least 1 (empty string)
- * @return pointer to newly allocated payload on success, NULL on failure or if message is an empty string
+ * @return pointer to newly allocated payload on success, NULL on failure, if message is an empty string
+ * or if the attached pool is exhausted
  */
 LoggerPayload* logger_payload_new(ELoggerPayloadType type, const char message[restrict static 1]);
 
+/**
+ * @param number_of_payloads number of payloads in the pool
+ * @return size of memory needed by the pool
+ */
+size_t logger_payload_pool_footprint(size_t number_of_payloads);
+
+/**
+ * @brief Take every following payload from pool placed in memory. Payloads allocated before
+ * are still freed to the heap.
+ *
+ * @param memory memory of at least logger_payload_pool_footprint(number_of_payloads) bytes aligned to max_align_t,
+ * it shall stay valid until logger_payload_pool_detach
+ * @param number_of_payloads number of payloads in the pool
+ * @return true on success, false if a pool is attached already or number_of_payloads is 0
+ */
+bool logger_payload_pool_attach(void* memory, size_t number_of_payloads);
+
+/**
+ * @brief Allocate following payloads on the heap again. Payloads of the pool shall be deleted before.
+ */
+void logger_payload_pool_detach(void);
+
 /**
  * @brief Free memory occupied by payload
  * 
@@ -0,0 +1,96 @@
+/**
+ * @file metrics_endpoint.h
+ * @brief Latest snapshot, overhead of the tracker and queue counters in Prometheus text exposition
+ * format, served over a unix domain socket.
+ *
+ * The endpoint owns a thread that accepts connections one by one and answers HTTP/1.x requests
+ * "GET /metrics" (or "GET /") with the latest page, then closes the connection. Pages are rendered
+ * by the publisher (printer) into a spare buffer which is then swapped in atomically, the serving
+ * thread only copies the current page to the socket. Scrapes therefore never take locks shared with
+ * the pipeline and publishing never waits for a slow client. Example:
+ * curl --unix-socket /run/tracker.sock http://localhost/metrics
+ */
+#ifndef METRICS_ENDPOINT_H
+#define METRICS_ENDPOINT_H
+
+#include <stdbool.h>
+#include "snapshot.h"
+#include "stage_overhead.h"
+#include "circular_buffer.h"
+#include "pcp_guard.h"
+#include "snapshot_latency.h"
+#include "arena.h"
+
+#ifndef METRICS_ENDPOINT_MAX_QUEUES
+#define METRICS_ENDPOINT_MAX_QUEUES 8
+#endif
+
+typedef struct MetricsEndpoint MetricsEndpoint;
+
+/**
+ * @brief Bind the socket (an existing socket file at path is replaced) and start the serving thread.
+ * Until the first page is published, requests are answered with 503.
+ *
+ * @param path filesystem path of the socket, shorter than sun_path
+ * @return pointer to valid MetricsEndpoint on success, NULL on failure
+ */
+MetricsEndpoint* metrics_endpoint_new(const char path[static 2]);
+
+/**
+ * @brief Carve endpoint with its pages from arena and start it, @see metrics_endpoint_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(metrics_endpoint_footprint()) bytes left
+ * @param path filesystem path of the socket, shorter than sun_path
+ * @return pointer to valid MetricsEndpoint on success, NULL on failure or if arena is exhausted
+ */
+MetricsEndpoint* metrics_endpoint_new_in(Arena* arena, const char path[static 2]);
+
+/**
+ * @return size of the endpoint with its pages in memory
+ */
+size_t metrics_endpoint_footprint(void);
+
+/**
+ * @brief Stop the serving thread, close and unlink the socket and free the endpoint,
+ * endpoint carved from an arena is left to the arena
+ *
+ * @param endpoint pointer to valid MetricsEndpoint or NULL, in latter case nothing happens
+ */
+void metrics_endpoint_delete(MetricsEndpoint* endpoint);
+
+/**
+ * @brief Export counters of a queue (buffer and its guard) in every page, @see circular_buffer_stats.
+ * Counters are present only if the tracker is compiled with PIPELINE_STATS. Shall be called before
+ * the first publication.
+ *
+ * @param endpoint pointer to valid MetricsEndpoint
+ * @param name label of the queue, shall outlive the endpoint
+ * @param buffer buffer of the queue, shall outlive the endpoint
+ * @param guard guard of the buffer, shall outlive the endpoint
+ * @return true on success, false if METRICS_ENDPOINT_MAX_QUEUES queues are registered already
+ */
+bool metrics_endpoint_add_queue(MetricsEndpoint* restrict endpoint, const char name[restrict static 1],
+                                const CircularBuffer* restrict buffer, const PCPGuard* restrict guard);
+
+/**
+ * @brief Export age of snapshots since start as summary with quantiles in every page.
+ * latency is read while rendering, it shall be recorded by the thread that publishes.
+ * Shall be called before the first publication.
+ *
+ * @param endpoint pointer to valid MetricsEndpoint
+ * @param latency latency of snapshots, shall outlive the endpoint
+ */
+void metrics_endpoint_set_latency(MetricsEndpoint* restrict endpoint, const SnapshotLatency* restrict latency);
+
+/**
+ * @brief Render page from snapshot and swap it in. Shall be called by single thread only.
+ *
+ * @param endpoint pointer to valid MetricsEndpoint
+ * @param snapshot latest snapshot
+ * @param overhead latest report of the tracker overhead or NULL
+ * @return true on success, false if the page does not fit into the buffer, the previous page is served then
+ */
+bool metrics_endpoint_publish(MetricsEndpoint* restrict endpoint, const Snapshot* restrict snapshot,
+                              const StageOverheadReport* restrict overhead);
+
+#endif
@@ -1,6 +1,8 @@
 /**
  * @file pcp_guard.h
  * @brief Structures and wrapper functions for solving PCP problem.
+ * If compiled with PIPELINE_STATS, guard counts waits of producer (buffer full) and consumer
+ * (buffer empty) and the time they spent in them, @see pcp_guard_stats.
  * 
  */
 
@@ -8,7 +10,12 @@
 #define PCP_GUARD_H
 
 #include <pthread.h>
+#include <stdbool.h>
+#include <inttypes.h>
 #include <time.h>
+#ifdef PIPELINE_STATS
+#include <stdatomic.h>
+#endif
 
 /**
  * @brief Constants returned by some of the functions
@@ -22,19 +29,41 @@ typedef enum EPCPStatus {
     NULL_ARGUMENT,
 }EPCPStatus;
 
+#ifdef PIPELINE_STATS
+#define PCP_GUARD_INITIALIZER {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0, 0}
+#else
 #define PCP_GUARD_INITIALIZER {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER}
+#endif
 
 /**
  * @brief Structure combining two conditional variables,
- * one for producer and one for consumer and mutex
+ * one for producer and one for consumer and mutex.
+ * Wait counters are modified with the mutex locked.
  * 
  */
 typedef struct PCPGuard {
     pthread_mutex_t mutex;
     pthread_cond_t producer;
     pthread_cond_t consumer;
+#ifdef PIPELINE_STATS
+    _Atomic uint64_t producer_waits;
+    _Atomic uint64_t producer_wait_ns;
+    _Atomic uint64_t consumer_waits;
+    _Atomic uint64_t consumer_wait_ns;
+#endif
 } PCPGuard;
 
+/**
+ * @brief Waits of guard since its initialization, @see pcp_guard_stats
+ *
+ */
+typedef struct PCPGuardStats {
+    uint64_t producer_waits;
+    uint64_t producer_wait_ns;
+    uint64_t consumer_waits;
+    uint64_t consumer_wait_ns;
+} PCPGuardStats;
+
 
 /**
  * @brief Initialize fields in target PCPGuard.
@@ -61,6 +90,35 @@ EPCPStatus pcp_guard_init(PCPGuard* guard);
  */
 EPCPStatus pcp_guard_destroy(PCPGuard* guard);
 
+/**
+ * @brief Retrieve wait counters of the guard
+ * 
+ * @param guard pointer to valid PCPGuard
+ * @param dest pointer to memory where the counters shall be stored, zeroed without PIPELINE_STATS
+ * @return true iff compiled with PIPELINE_STATS
+ */
+bool pcp_guard_stats(const PCPGuard* restrict guard, PCPGuardStats* restrict dest);
+
+#ifdef PIPELINE_STATS
+/**
+ * @brief get CLOCK_MONOTONIC in nanoseconds, start of a wait
+ */
+inline uint64_t pcp_guard_stats_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * UINT64_C(1000000000) + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * @brief Count single wait that started at start_ns, shall be called with the mutex locked
+ */
+inline void pcp_guard_stats_wait_end(_Atomic uint64_t* waits, _Atomic uint64_t* wait_ns, uint64_t start_ns) {
+    const uint64_t elapsed_ns = pcp_guard_stats_now_ns() - start_ns;
+    atomic_store_explicit(waits, atomic_load_explicit(waits, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(wait_ns, atomic_load_explicit(wait_ns, memory_order_relaxed) + elapsed_ns, memory_order_relaxed);
+}
+#endif
+
 /**
  * @brief wrapper for pthread_mutex_lock. The function behaves exactly as though
  * pthread_mutex_lock(PCPGuard->mutex) would be called. @see man pthread_mutex_lock(3)
@@ -113,7 +171,14 @@ inline int pcp_guard_notify_consumer(PCPGuard* guard) {
  * @return int return value of pthread_cond_signal
  */
 inline int pcp_guard_wait_for_producer(PCPGuard* guard) {
+#ifdef PIPELINE_STATS
+    const uint64_t start_ns = pcp_guard_stats_now_ns();
+    const int result = pthread_cond_wait(&(guard->consumer), &(guard->mutex));
+    pcp_guard_stats_wait_end(&guard->consumer_waits, &guard->consumer_wait_ns, start_ns);
+    return result;
+#else
     return pthread_cond_wait(&(guard->consumer), &(guard->mutex));
+#endif
 }
 
 /**
@@ -124,7 +189,14 @@ inline int pcp_guard_wait_for_producer(PCPGuard* guard) {
  * @return int return value of pthread_cond_signal
  */
 inline int pcp_guard_wait_for_consumer(PCPGuard* guard) {
+#ifdef PIPELINE_STATS
+    const uint64_t start_ns = pcp_guard_stats_now_ns();
+    const int result = pthread_cond_wait(&(guard->producer), &(guard->mutex));
+    pcp_guard_stats_wait_end(&guard->producer_waits, &guard->producer_wait_ns, start_ns);
+    return result;
+#else
     return pthread_cond_wait(&(guard->producer), &(guard->mutex));
+#endif
 }
 
 
@@ -137,7 +209,14 @@ inline int pcp_guard_wait_for_consumer(PCPGuard* guard) {
  * @return int return value of pthread_cond_timedwait
  */
 inline int pcp_guard_timed_wait_for_producer(PCPGuard* restrict guard, const struct timespec *restrict abstime) {
+#ifdef PIPELINE_STATS
+    const uint64_t start_ns = pcp_guard_stats_now_ns();
+    const int result = pthread_cond_timedwait(&(guard->producer), &(guard->mutex), abstime);
+    pcp_guard_stats_wait_end(&guard->consumer_waits, &guard->consumer_wait_ns, start_ns);
+    return result;
+#else
     return pthread_cond_timedwait(&(guard->producer), &(guard->mutex), abstime);
+#endif
 }
 
 #endif
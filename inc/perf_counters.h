@@ -0,0 +1,62 @@
+/**
+ * @file perf_counters.h
+ * @brief Hardware counters of the calling thread (cycles, instructions, cache misses, branch misses)
+ * opened with perf_event_open as one group, so all of them are read by single read(2) and cover
+ * the same time. Counters are followed across cpus, only the thread that opened them is counted.
+ *
+ * Access is governed by /proc/sys/kernel/perf_event_paranoid: kernel mode is counted if allowed,
+ * otherwise only user mode. Counters the hardware or hypervisor does not provide are left out,
+ * @see perf_counters_available. Values are scaled if the kernel multiplexes the counters.
+ */
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+
+typedef enum EPerfCounter {
+    PERF_COUNTER_CYCLES = 0,
+    PERF_COUNTER_INSTRUCTIONS = 1,
+    PERF_COUNTER_CACHE_MISSES = 2,
+    PERF_COUNTER_BRANCH_MISSES = 3,
+    PERF_COUNTER_COUNT = 4,
+} EPerfCounter;
+
+typedef struct PerfCounters PerfCounters;
+
+/**
+ * @brief Open and start counters of the calling thread
+ *
+ * @return pointer to valid PerfCounters on success, NULL on memory error or if no counter could be
+ * opened (no PMU, denied by perf_event_paranoid, seccomp of the container)
+ */
+PerfCounters* perf_counters_open(void);
+
+/**
+ * @brief Stop counters and free them, may be called from any thread
+ *
+ * @param counters pointer to valid PerfCounters or NULL, in latter case nothing happens
+ */
+void perf_counters_close(PerfCounters* counters);
+
+/**
+ * @param counters pointer to valid PerfCounters
+ * @return mask of counters that are counted, bit (1 << EPerfCounter)
+ */
+uint32_t perf_counters_available(const PerfCounters* counters);
+
+/**
+ * @brief Read values counted since open
+ *
+ * @param counters pointer to valid PerfCounters
+ * @param values destination indexed by EPerfCounter, unavailable counters are 0
+ * @return true on success, false if reading failed
+ */
+bool perf_counters_read(PerfCounters* restrict counters, uint64_t values[restrict static PERF_COUNTER_COUNT]);
+
+/**
+ * @return name of the counter, e.g. "cache-misses"
+ */
+const char* perf_counter_to_str(EPerfCounter counter);
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file placement.h
+ * @brief CPU affinity of pipeline threads. Policies:
+ * none                   - threads are not pinned
+ * housekeeping:<cpulist> - every stage is pinned to the housekeeping cpus, e.g. "housekeeping:0-1"
+ * siblings[:<cpu>]       - reader is pinned to cpu (default 0) and parser to its SMT sibling, so the
+ *                          characters they exchange stay in the shared L1/L2; other stages may run on
+ *                          both. Without SMT both are pinned to cpu.
+ */
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "topology.h"
+
+typedef enum EPlacementPolicy {
+    PLACEMENT_POLICY_NONE = 0,
+    PLACEMENT_POLICY_HOUSEKEEPING = 1,
+    PLACEMENT_POLICY_SIBLINGS = 2,
+} EPlacementPolicy;
+
+typedef enum EPlacementStage {
+    PLACEMENT_STAGE_READER = 0,
+    PLACEMENT_STAGE_PARSER = 1,
+    PLACEMENT_STAGE_PRINTER = 2,
+    PLACEMENT_STAGE_LOGGER = 3,
+    PLACEMENT_STAGE_WATCHDOG = 4,
+    PLACEMENT_STAGE_COUNT = 5,
+} EPlacementStage;
+
+typedef struct Placement Placement;
+
+/**
+ * @brief Parse policy and resolve cpus of every stage
+ *
+ * @param spec policy, @see placement.h
+ * @param topology pointer to valid Topology, used by siblings policy only, may be NULL otherwise
+ * @return pointer to valid Placement on success, NULL on failure, if spec is malformed,
+ * if housekeeping set is empty or if cpu of siblings policy is offline
+ */
+Placement* placement_new(const char spec[static 1], const Topology* topology);
+
+/**
+ * @brief Free memory occupied by placement
+ *
+ * @param placement pointer to valid Placement or NULL, in latter case nothing happens
+ */
+void placement_delete(Placement* placement);
+
+/**
+ * @brief Pin thread of given stage with pthread_setaffinity_np
+ *
+ * @param placement pointer to valid Placement
+ * @param stage stage the thread runs
+ * @param thread thread to pin
+ * @return true iff thread was pinned or policy is none
+ */
+bool placement_apply(const Placement* placement, EPlacementStage stage, pthread_t thread);
+
+/**
+ * @brief get policy of placement
+ *
+ * @param placement pointer to valid Placement
+ * @return policy
+ */
+EPlacementPolicy placement_policy(const Placement* placement);
+
+/**
+ * @brief Check whether stage may run on cpu
+ *
+ * @param placement pointer to valid Placement
+ * @param stage stage
+ * @param cpu cpu number
+ * @return true iff cpu belongs to the set of the stage, always true for policy none
+ */
+bool placement_stage_has_cpu(const Placement* placement, EPlacementStage stage, size_t cpu);
+
+/**
+ * @brief get the pointer to read-only string representing stage
+ *
+ * @param stage stage
+ * @return const char* pointer to read-only name of the stage, e.g. "parser"
+ */
+const char* placement_stage_to_str(EPlacementStage stage);
+
+#endif
@@ -6,7 +6,9 @@
 #ifndef PROC_PARSER_H
 #define PROC_PARSER_H
 
+#include <stdbool.h>
 #include <inttypes.h>
+#include <stddef.h>
 
 typedef enum EProcParserResult {
     PROC_PARSER_TOTAL_USAGE_LINE = -1,
@@ -39,6 +41,25 @@ typedef struct ProcParserCpuTime {
  */
 int proc_parser_parse_line(const char buffer[restrict static 5], uint64_t result[restrict static 10]);
 
+/**
+ * @brief get number of the cpu the line belongs to. Offline cpus are missing in /proc/stat,
+ * hence the number may differ from position of the line.
+ *
+ * @param buffer null-terminated string with at least 4 characters
+ * @return number following 'cpu' prefix, -1 if line does not start with 'cpu[0-9]'
+ */
+long proc_parser_cpu_number(const char buffer[static 5]);
+
+/**
+ * @brief Get number of cores covered by whole proc/stat content, i.e. the highest cpu number plus one.
+ * Offline cpus below the highest one are counted, they may come online later.
+ *
+ * @param content proc/stat content, it does not have to be null-terminated
+ * @param length number of characters in content
+ * @return number of cores, 0 if content contains no line starting with 'cpu[0-9]'
+ */
+size_t proc_parser_count_cores(const char content[], size_t length);
+
 /**
  * @brief use row retrieved from proc/stat to compute idle time and total time
  * 
@@ -47,12 +68,23 @@ int proc_parser_parse_line(const char buffer[restrict static 5], uint64_t result
  */
 ProcParserCpuTime proc_parser_compute_core_time(const uint64_t core_line[static 10]);
 
+/**
+ * @brief Check that no field of core line decreased. Counters go backwards after reset
+ * (VM migration, cpu hotplug) or wraparound of 32-bit fields, usage computed across it is meaningless.
+ *
+ * @param previous fields of the core line from the previous tick
+ * @param current fields of the core line from the current tick
+ * @return true if every field of current is not lower than the same field of previous
+ */
+bool proc_parser_counters_monotonic(const uint64_t previous[static 10], const uint64_t current[static 10]);
+
 /**
  * @brief Compute core usage in %.
  * 
  * @param previous previous time
  * @param current current time
- * @return double value between [0,1] representing % of average core usage.
+ * @return double value between [0,1] representing % of average core usage,
+ * NaN if total time did not grow or if total or idle time went backwards.
  */
 double proc_parser_cpu_time_compute_usage(const ProcParserCpuTime* previous, const ProcParserCpuTime* current);
 
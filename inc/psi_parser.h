@@ -0,0 +1,78 @@
+/**
+ * @file psi_parser.h
+ * @brief Support functions for parsing Pressure Stall Information (/proc/pressure/?) lines
+ *
+ * The reader forwards every line of /proc/pressure/<resource> prefixed with "psi <resource> ",
+ * e.g. "psi cpu some avg10=0.12 avg60=0.05 avg300=0.01 total=123456".
+ */
+#ifndef PSI_PARSER_H
+#define PSI_PARSER_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+typedef enum EPsiParserResult {
+    PSI_PARSER_DISCARD_LINE = -2,
+    PSI_PARSER_FAIL = -3,
+    PSI_PARSER_SUCCESS = 10,
+} EPsiParserResult;
+
+/**
+ * @brief Resources for which kernel reports pressure
+ *
+ */
+typedef enum EPsiResource {
+    PSI_RESOURCE_CPU = 0,
+    PSI_RESOURCE_IO = 1,
+    PSI_RESOURCE_MEMORY = 2,
+    PSI_RESOURCE_COUNT = 3,
+} EPsiResource;
+
+/**
+ * @brief Kind of stall: "some" - at least one task stalled, "full" - all non-idle tasks stalled
+ *
+ */
+typedef enum EPsiKind {
+    PSI_KIND_SOME = 0,
+    PSI_KIND_FULL = 1,
+} EPsiKind;
+
+typedef struct PsiParserLine {
+    EPsiResource resource;
+    EPsiKind kind;
+    double avg10;
+    double avg60;
+    double avg300;
+    uint64_t total;
+} PsiParserLine;
+
+/**
+ * @brief Parse prefixed pressure line contained in buffer. sscanf is not used,
+ * numbers are converted in place.
+ *
+ * @param buffer null-terminated string with at least 4 characters
+ * @param result pointer to structure where parsed values shall be stored. It is altered only on success
+ * @return PSI_PARSER_SUCCESS if all values were parsed successfully
+ * @return PSI_PARSER_DISCARD_LINE if line did not start with "psi " and was skipped
+ * @return PSI_PARSER_FAIL if line started with "psi " but was malformed
+ */
+int psi_parser_parse_line(const char buffer[restrict static 5], PsiParserLine* restrict result);
+
+/**
+ * @brief Compute amount of stall time (in microseconds) between two readings of total counter
+ *
+ * @param previous value of total counter retrieved during previous tick
+ * @param current value of total counter retrieved during current tick
+ * @return difference between counters or 0 if counter went backwards
+ */
+uint64_t psi_parser_stall_delta(uint64_t previous, uint64_t current);
+
+/**
+ * @brief get the pointer to read-only string with name of the resource as used in /proc/pressure
+ *
+ * @param resource pressure resource
+ * @return const char* pointer to read-only string, NULL if resource is out of range
+ */
+const char* psi_parser_resource_to_str(EPsiResource resource);
+
+#endif
@@ -0,0 +1,123 @@
+/**
+ * @file rollup.h
+ * @brief Incremental downsampling of snapshots into 10 s, 1 min and 1 h windows.
+ *
+ * Every tier keeps min, max, sum and usage histogram of every core for the current window,
+ * so memory does not depend on the number of samples. Average is weighted by interval_ns of
+ * every snapshot, so it stays the share of time the core was busy when the sampling period varies. Window boundaries are aligned to
+ * wall-clock (multiples of window length since the Epoch), hence rollups of different
+ * hosts line up.
+ */
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "snapshot.h"
+#include "arena.h"
+
+typedef enum ERollupTier {
+    ROLLUP_TIER_10S = 0,
+    ROLLUP_TIER_1MIN = 1,
+    ROLLUP_TIER_1H = 2,
+    ROLLUP_TIER_COUNT = 3,
+} ERollupTier;
+
+/**
+ * @brief Statistics of single core. Stored in history files in this order,
+ * hence column of the statistic is core * ROLLUP_STATISTICS_COUNT + offset.
+ *
+ */
+typedef struct RollupCoreStats {
+    double min;
+    double max;
+    double avg;
+    double p95;
+} RollupCoreStats;
+
+enum {
+    ROLLUP_STATISTICS_COUNT = sizeof(RollupCoreStats) / sizeof(double),
+};
+
+/**
+ * @brief Completed window. start_ns is CLOCK_REALTIME in nanoseconds,
+ * cores has number_of_cores elements.
+ *
+ */
+typedef struct RollupWindow {
+    ERollupTier tier;
+    uint64_t start_ns;
+    size_t number_of_samples;
+    size_t number_of_cores;
+    const RollupCoreStats* cores;
+} RollupWindow;
+
+typedef struct Rollup Rollup;
+
+/**
+ * @brief Allocate aggregator for all tiers
+ *
+ * @param number_of_cores number of cores that will be aggregated, cores above it are ignored
+ * @return pointer to valid Rollup on success, NULL on failure or if number_of_cores is 0
+ */
+Rollup* rollup_new(size_t number_of_cores);
+
+/**
+ * @brief Carve aggregator from arena, @see rollup_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(rollup_footprint()) bytes left
+ * @param number_of_cores number of cores that will be aggregated, cores above it are ignored
+ * @return pointer to valid Rollup on success, NULL if number_of_cores is 0 or arena is exhausted
+ */
+Rollup* rollup_new_in(Arena* arena, size_t number_of_cores);
+
+/**
+ * @param number_of_cores number of cores that will be aggregated
+ * @return size of the aggregator in memory
+ */
+size_t rollup_footprint(size_t number_of_cores);
+
+/**
+ * @brief Free memory occupied by the aggregator, aggregator carved from an arena is left to the arena
+ *
+ * @param rollup pointer to valid Rollup or NULL, in latter case nothing happens
+ */
+void rollup_delete(Rollup* rollup);
+
+/**
+ * @brief Add snapshot to current window of every tier. If the snapshot belongs to later window
+ * than the current one, the current window is completed first.
+ *
+ * @param rollup pointer to valid Rollup
+ * @param snapshot snapshot with timestamp set
+ * @return true iff at least one window has been completed, @see rollup_completed
+ */
+bool rollup_add(Rollup* restrict rollup, const Snapshot* restrict snapshot);
+
+/**
+ * @brief get window of given tier completed during the last call of rollup_add
+ *
+ * @param rollup pointer to valid Rollup
+ * @param tier tier of the window
+ * @return pointer to window valid until the next call of rollup_add, NULL if the tier has not completed a window
+ */
+const RollupWindow* rollup_completed(const Rollup* rollup, ERollupTier tier);
+
+/**
+ * @brief get length of window of the tier
+ *
+ * @param tier rollup tier
+ * @return length in nanoseconds
+ */
+uint64_t rollup_tier_length_ns(ERollupTier tier);
+
+/**
+ * @brief get the pointer to read-only string with short name of the tier ("10s", "1m", "1h")
+ *
+ * @param tier rollup tier
+ * @return const char* pointer to read-only string
+ */
+const char* rollup_tier_to_str(ERollupTier tier);
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file self_usage.h
+ * @brief CPU time consumed by threads of the tracker itself, attributed to cores.
+ *
+ * utime + stime of every thread is read from <proc>/self/task/<tid>/stat and the difference since
+ * the previous update is attributed to the cpu the thread ran on last ("processor" field). This is
+ * exact for pinned threads and an approximation for threads that migrate within one period.
+ * The result is the share of each core's time consumed by the tracker, in the same scale as
+ * core usage, so it can be subtracted from it.
+ */
+#ifndef SELF_USAGE_H
+#define SELF_USAGE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "snapshot.h"
+
+typedef struct SelfUsage SelfUsage;
+
+/**
+ * @brief Create tracker of own threads
+ *
+ * @param proc_root procfs mount point, "/proc" on real system
+ * @return pointer to valid SelfUsage on success, NULL on failure
+ */
+SelfUsage* self_usage_new(const char proc_root[static 1]);
+
+/**
+ * @brief Free memory occupied by self_usage
+ *
+ * @param self_usage pointer to valid SelfUsage or NULL, in latter case nothing happens
+ */
+void self_usage_delete(SelfUsage* self_usage);
+
+/**
+ * @brief Read time of own threads and compute their share of every core of the snapshot since
+ * the previous update
+ *
+ * @param self_usage pointer to valid SelfUsage
+ * @param snapshot snapshot whose core_time and core_cpu are used as reference
+ * @return true iff the task directory was read
+ */
+bool self_usage_update(SelfUsage* restrict self_usage, const Snapshot* restrict snapshot);
+
+/**
+ * @brief get share of core's time consumed by the tracker between the last two updates
+ *
+ * @param self_usage pointer to valid SelfUsage
+ * @param index position of the core in the snapshot passed to the last update
+ * @return usage in % of the core's time, NaN before the second update or if index is out of range
+ */
+double self_usage_get(const SelfUsage* self_usage, size_t index);
+
+/**
+ * @brief Parse content of /proc/<pid>/task/<tid>/stat
+ *
+ * @param buffer null-terminated content of stat file
+ * @param ticks pointer to memory where utime + stime (clock ticks) will be stored
+ * @param cpu pointer to memory where the cpu the thread ran on last will be stored
+ * @return true iff buffer is well-formed
+ */
+bool self_usage_parse_stat(const char buffer[restrict static 1], uint64_t* restrict ticks, size_t* restrict cpu);
+
+#endif
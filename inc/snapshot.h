@@ -0,0 +1,99 @@
+/**
+ * @file snapshot.h
+ * @brief Message sent from thread_parser to thread_printer. Single snapshot contains
+ * everything computed from one tick of the reader: usage of every core and, if enabled,
+ * pressure stall information and frequency of cores sampled in the same tick and usage of sockets
+ * and NUMA nodes.
+ *
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <time.h>
+#include "psi_parser.h"
+#include "proc_parser.h"
+
+#ifndef SNAPSHOT_MAX_CORES
+#define SNAPSHOT_MAX_CORES 1024
+#endif
+
+#ifndef SNAPSHOT_MAX_PACKAGES
+#define SNAPSHOT_MAX_PACKAGES 64
+#endif
+
+#ifndef SNAPSHOT_MAX_NODES
+#define SNAPSHOT_MAX_NODES 64
+#endif
+
+/**
+ * @brief Pressure of single resource. Stall times are computed from
+ * differences of total counters between two consecutive ticks
+ *
+ */
+typedef struct SnapshotPressure {
+    bool available;
+    double some_avg10;
+    double full_avg10;
+    uint64_t some_total;
+    uint64_t full_total;
+    uint64_t some_stall_us;
+    uint64_t full_stall_us;
+} SnapshotPressure;
+
+/**
+ * @brief Usage of a socket (physical package) or NUMA node, id is the one used by sysfs.
+ * Computed from summed time counters of its cores, not from average of core usages.
+ *
+ */
+typedef struct SnapshotGroupUsage {
+    uint32_t id;
+    double usage;
+} SnapshotGroupUsage;
+
+/**
+ * @brief sequence is incremented by parser with every emitted snapshot,
+ * timestamp (CLOCK_REALTIME) is taken when the snapshot is complete.
+ * capture_ns (CLOCK_MONOTONIC) is the stamp the reader sent at the start of the tick, 0 if there was none,
+ * parsed_ns (CLOCK_MONOTONIC) is taken together with timestamp, @see snapshot_latency.h.
+ * interval_ns is the time between capture_ns of the previous tick and of this one, the interval usage
+ * was computed over, 0 if unknown (first tick or no tick stamps).
+ * core_time holds raw counters from which core_usage was computed, core_cpu is the cpu number
+ * of every core (N of "cpuN" line), arrays are indexed by position in /proc/stat.
+ * core_invalid is set for cores whose counters went backwards or whose cpu number changed since the previous tick,
+ * their usage is NaN and the next tick is computed from the current counters, number_of_invalid_cores counts them.
+ * core_stale is set for cores whose counters did not advance since the previous tick, e.g. when /proc/stat is
+ * updated less often than it is sampled, their usage is NaN and the previous tick stays the baseline of the next one,
+ * number_of_stale_cores counts them. Sinks treat usage of invalid and stale cores as missing.
+ * first_complete is set only in the first snapshot in which every core has usage, neither invalid nor stale.
+ * core_frequency_khz is valid only if has_frequency is set, 0 means the frequency of the core is unknown.
+ * Package and node usages are present only if topology is enabled, otherwise their counts are 0.
+ *
+ */
+typedef struct Snapshot {
+    uint64_t sequence;
+    struct timespec timestamp;
+    uint64_t capture_ns;
+    uint64_t parsed_ns;
+    uint64_t interval_ns;
+    size_t number_of_cores;
+    double core_usage[SNAPSHOT_MAX_CORES];
+    ProcParserCpuTime core_time[SNAPSHOT_MAX_CORES];
+    uint32_t core_cpu[SNAPSHOT_MAX_CORES];
+    bool core_invalid[SNAPSHOT_MAX_CORES];
+    size_t number_of_invalid_cores;
+    bool core_stale[SNAPSHOT_MAX_CORES];
+    size_t number_of_stale_cores;
+    bool first_complete;
+    bool has_frequency;
+    uint32_t core_frequency_khz[SNAPSHOT_MAX_CORES];
+    SnapshotPressure pressure[PSI_RESOURCE_COUNT];
+    size_t number_of_packages;
+    SnapshotGroupUsage package_usage[SNAPSHOT_MAX_PACKAGES];
+    size_t number_of_nodes;
+    SnapshotGroupUsage node_usage[SNAPSHOT_MAX_NODES];
+} Snapshot;
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @file snapshot_latency.h
+ * @brief Age of snapshots on their way through the pipeline.
+ *
+ * The reader stamps every tick with CLOCK_MONOTONIC at its start by sending line "tick <ns>"
+ * before any data of the tick, the parser stores the stamp in the snapshot as capture_ns together
+ * with parsed_ns taken when the snapshot is complete. The printer records two ages of every snapshot:
+ * at parse completion (parsed_ns - capture_ns) and at output, after every sink has run. Both are
+ * kept in log-linear histograms since start and over the last interval snapshots, the latter being
+ * reported every interval snapshots. Growing output age with flat parse age means the snapshot queue
+ * or the sinks fall behind, growing parse age means the char queue or the parser does.
+ */
+#ifndef SNAPSHOT_LATENCY_H
+#define SNAPSHOT_LATENCY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "latency_histogram.h"
+#include "snapshot.h"
+#include "arena.h"
+
+/*Enough for report of every point, @see snapshot_latency_format*/
+#define SNAPSHOT_LATENCY_MESSAGE_SIZE 320
+
+enum {
+    SNAPSHOT_LATENCY_DISCARD_LINE = -2,
+    SNAPSHOT_LATENCY_FAIL = -3,
+    SNAPSHOT_LATENCY_SUCCESS = 10,
+};
+
+typedef enum ELatencyPoint {
+    LATENCY_POINT_PARSE = 0,
+    LATENCY_POINT_OUTPUT = 1,
+    LATENCY_POINT_COUNT = 2,
+} ELatencyPoint;
+
+typedef struct SnapshotLatency SnapshotLatency;
+
+/**
+ * @brief Create empty histograms of both points
+ *
+ * @param interval number of snapshots covered by single report, at least 1
+ * @return pointer to valid SnapshotLatency on success, NULL on failure or if interval is 0
+ */
+SnapshotLatency* snapshot_latency_new(size_t interval);
+
+/**
+ * @brief Carve empty histograms from arena, @see snapshot_latency_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(snapshot_latency_footprint()) bytes left
+ * @param interval number of snapshots covered by single report, at least 1
+ * @return pointer to valid SnapshotLatency on success, NULL if interval is 0 or arena is exhausted
+ */
+SnapshotLatency* snapshot_latency_new_in(Arena* arena, size_t interval);
+
+/**
+ * @return size of the latency histograms in memory
+ */
+size_t snapshot_latency_footprint(void);
+
+/**
+ * @brief Free memory occupied by latency, latency carved from an arena is left to the arena
+ *
+ * @param latency pointer to valid SnapshotLatency or NULL, in latter case nothing happens
+ */
+void snapshot_latency_delete(SnapshotLatency* latency);
+
+/**
+ * @return CLOCK_MONOTONIC in nanoseconds, the clock of capture_ns and parsed_ns
+ */
+uint64_t snapshot_latency_now_ns(void);
+
+/**
+ * @brief Record ages of snapshot output at now_ns. Snapshots without stamp (capture_ns 0) are skipped.
+ * Shall be called by single thread only.
+ *
+ * @param latency pointer to valid SnapshotLatency
+ * @param snapshot snapshot that has just been output
+ * @param now_ns current value of snapshot_latency_now_ns
+ * @return true if interval snapshots have been recorded since the previous report, the report is due
+ */
+bool snapshot_latency_record(SnapshotLatency* restrict latency, const Snapshot* restrict snapshot, uint64_t now_ns);
+
+/**
+ * @param latency pointer to valid SnapshotLatency
+ * @param point point of measurement
+ * @return histogram of every snapshot recorded since creation
+ */
+const LatencyHistogram* snapshot_latency_total(const SnapshotLatency* latency, ELatencyPoint point);
+
+/**
+ * @brief Format the current interval as single line, e.g.
+ * "Latency over 10 snapshots: parse p50 120us p90 150us p99 300us max 310us, output p50 ...\n"
+ *
+ * @param latency pointer to valid SnapshotLatency
+ * @param buffer destination
+ * @param size size of buffer, SNAPSHOT_LATENCY_MESSAGE_SIZE is enough
+ * @return result of snprintf
+ */
+int snapshot_latency_format(const SnapshotLatency* restrict latency, char* restrict buffer, size_t size);
+
+/**
+ * @brief Format stamp line sent by the reader at the start of tick
+ *
+ * @param capture_ns value of snapshot_latency_now_ns at the start of tick
+ * @param buffer destination
+ * @param size size of buffer, 32 is enough
+ * @return result of snprintf
+ */
+int snapshot_latency_format_line(uint64_t capture_ns, char* buffer, size_t size);
+
+/**
+ * @brief Parse stamp line "tick <ns>"
+ *
+ * @param buffer null-terminated line
+ * @param capture_ns destination of the stamp
+ * @return SNAPSHOT_LATENCY_SUCCESS on success, SNAPSHOT_LATENCY_DISCARD_LINE if line does not start
+ * with "tick ", SNAPSHOT_LATENCY_FAIL if it is malformed
+ */
+int snapshot_latency_parse_line(const char buffer[restrict static 5], uint64_t* restrict capture_ns);
+
+/**
+ * @return name of the point, e.g. "output"
+ */
+const char* snapshot_latency_point_to_str(ELatencyPoint point);
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * @file snapshot_shm.h
+ * @brief Publication of the latest snapshot in POSIX shared memory segment.
+ *
+ * Single writer (the tracker) stores every snapshot in the segment guarded by seqlock.
+ * Any number of local readers can retrieve consistent copy of the latest snapshot
+ * without syscalls and without blocking the writer. Readers shall link only this module.
+ */
+#ifndef SNAPSHOT_SHM_H
+#define SNAPSHOT_SHM_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "snapshot.h"
+#include "proc_parser.h"
+#include "usage_stats.h"
+#include "stage_overhead.h"
+
+typedef enum ESnapshotShmStatus {
+    SNAPSHOT_SHM_SUCCESS = 0,
+    /*Nothing has been published yet*/
+    SNAPSHOT_SHM_EMPTY = 1,
+    /*Writer kept modifying the segment during every attempt*/
+    SNAPSHOT_SHM_BUSY = 2,
+    SNAPSHOT_SHM_NULL_ARGUMENT = 3,
+} ESnapshotShmStatus;
+
+/**
+ * @brief Handle to mapped segment, either writable (created by the tracker) or read-only.
+ *
+ */
+typedef struct SnapshotShm SnapshotShm;
+
+/**
+ * @brief Copy of the published snapshot.
+ * timestamp_ns is CLOCK_REALTIME in nanoseconds, sequence is snapshot sequence number assigned by the parser.
+ * interval_ns is the interval usage was computed over, 0 if unknown.
+ * Only first number_of_cores elements of the arrays are valid, core_usage is NaN for cores without usage
+ * in the snapshot (counters reset or not advanced @see snapshot.h).
+ * core_statistics are valid iff has_statistics is set, @see usage_stats.h for their layout.
+ * Overhead of the tracker is valid iff has_overhead is set, it is the latest closed report
+ * @see stage_overhead.h, stages are indexed by EPlacementStage.
+ *
+ */
+typedef struct SnapshotShmRecord {
+    uint64_t sequence;
+    uint64_t timestamp_ns;
+    uint64_t interval_ns;
+    uint64_t number_of_cores;
+    uint64_t has_statistics;
+    uint64_t has_overhead;
+    double stage_cpu_us_per_snapshot[PLACEMENT_STAGE_COUNT];
+    uint64_t rss_kb;
+    uint64_t peak_rss_kb;
+    double core_usage[SNAPSHOT_MAX_CORES];
+    ProcParserCpuTime core_time[SNAPSHOT_MAX_CORES];
+    double core_statistics[SNAPSHOT_MAX_CORES * USAGE_STATISTIC_COUNT];
+} SnapshotShmRecord;
+
+/**
+ * @brief Create (or take over existing) segment and map it for writing.
+ *
+ * @param name POSIX shared memory object name, e.g. "/tieto_snapshot" @see man shm_open(3)
+ * @return pointer to valid handle on success, NULL on failure
+ */
+SnapshotShm* snapshot_shm_create(const char name[static 2]);
+
+/**
+ * @brief Map existing segment read-only.
+ *
+ * @param name name used by the writer
+ * @return pointer to valid handle on success, NULL on failure or if the segment
+ * was created by incompatible version of the tracker
+ */
+SnapshotShm* snapshot_shm_open(const char name[static 2]);
+
+/**
+ * @brief Unmap the segment and free the handle. If handle was created with snapshot_shm_create,
+ * the segment is unlinked as well.
+ *
+ * @param shm pointer to valid handle or NULL, in latter case nothing happens
+ */
+void snapshot_shm_delete(SnapshotShm* shm);
+
+/**
+ * @brief Store snapshot in the segment. Shall be called by single thread only.
+ *
+ * @param shm pointer to handle created with snapshot_shm_create
+ * @param snapshot snapshot that shall be published
+ * @param statistics core-major statistics of statistics_cores cores @see usage_stats_values, or NULL.
+ * Statistics of cores above statistics_cores are published as NaN.
+ * @param statistics_cores number of cores in statistics
+ * @param overhead latest report of the tracker overhead or NULL
+ */
+void snapshot_shm_publish(SnapshotShm* restrict shm, const Snapshot* restrict snapshot,
+                          const double* restrict statistics, size_t statistics_cores,
+                          const StageOverheadReport* restrict overhead);
+
+/**
+ * @brief Retrieve consistent copy of the latest snapshot. Never blocks the writer.
+ *
+ * @param shm pointer to valid handle
+ * @param dest pointer to memory where the copy shall be stored. Altered even if function fails.
+ * @return SNAPSHOT_SHM_SUCCESS iff dest contains consistent copy
+ */
+ESnapshotShmStatus snapshot_shm_read(const SnapshotShm* restrict shm, SnapshotShmRecord* restrict dest);
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ * @file stage_overhead.h
+ * @brief Cost of the tracker itself, per pipeline stage.
+ *
+ * Every stage periodically accounts the CPU time its thread consumed (CLOCK_THREAD_CPUTIME_ID)
+ * since its previous accounting together with the number of messages it processed in the meantime
+ * (ticks for reader, snapshots for parser and printer, log entries for logger, checks for watchdog).
+ * Accounting is lock-free and may be done from any thread. The printer counts snapshots and every
+ * interval snapshots closes a report: CPU us per snapshot of every stage and resident set size of
+ * the process together with its peak (VmRSS and VmHWM of <proc>/self/status).
+ *
+ * With hardware counting, every thread that accounts opens its own perf_counters on its first
+ * accounting and from then on adds their deltas to the stage as well. The counters are closed when
+ * the thread exits. Threads denied access by the kernel only account CPU time, their stage is left
+ * out of the hardware mask of the report.
+ */
+#ifndef STAGE_OVERHEAD_H
+#define STAGE_OVERHEAD_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "placement.h"
+#include "perf_counters.h"
+
+/*Enough for report with every stage, @see stage_overhead_format and stage_overhead_format_hardware*/
+#define STAGE_OVERHEAD_MESSAGE_SIZE 640
+
+typedef struct StageOverhead StageOverhead;
+
+/**
+ * @brief Single report, values cover the snapshots since the previous report.
+ * sequence starts with 1, rss_kb and peak_rss_kb are 0 if status could not be read.
+ *
+ */
+typedef struct StageOverheadReport {
+    uint64_t sequence;
+    uint64_t number_of_snapshots;
+    uint64_t cpu_us[PLACEMENT_STAGE_COUNT];
+    uint64_t messages[PLACEMENT_STAGE_COUNT];
+    double cpu_us_per_snapshot[PLACEMENT_STAGE_COUNT];
+    uint64_t rss_kb;
+    uint64_t peak_rss_kb;
+    /*Hardware counting is enabled, counters of stage are valid if bit (1 << EPerfCounter) of its mask is set*/
+    bool hardware;
+    uint32_t hardware_mask[PLACEMENT_STAGE_COUNT];
+    double hardware_per_snapshot[PLACEMENT_STAGE_COUNT][PERF_COUNTER_COUNT];
+} StageOverheadReport;
+
+/**
+ * @brief Create accounting of stages
+ *
+ * @param proc_root procfs mount point, "/proc" on real system
+ * @param interval number of snapshots covered by single report, at least 1
+ * @param hardware count cycles, instructions, cache and branch misses of stages as well
+ * @return pointer to valid StageOverhead on success, NULL on failure or if interval is 0
+ */
+StageOverhead* stage_overhead_new(const char proc_root[static 1], size_t interval, bool hardware);
+
+/**
+ * @brief Free memory occupied by stage_overhead
+ *
+ * @param stage_overhead pointer to valid StageOverhead or NULL, in latter case nothing happens
+ */
+void stage_overhead_delete(StageOverhead* stage_overhead);
+
+/**
+ * @brief get CPU time consumed by the calling thread
+ *
+ * @return CPU time of the calling thread in nanoseconds
+ */
+uint64_t stage_overhead_thread_cpu_ns(void);
+
+/**
+ * @brief Open hardware counters of the calling thread, counting starts now. Without the call
+ * they are opened by the first accounting of the thread. Nothing happens without hardware counting.
+ *
+ * @param stage_overhead pointer to valid StageOverhead or NULL, in latter case nothing happens
+ */
+void stage_overhead_thread_attach(StageOverhead* stage_overhead);
+
+/**
+ * @brief Account CPU time the calling thread consumed since mark_ns to stage, and with hardware
+ * counting its counters since its previous accounting
+ *
+ * @param stage_overhead pointer to valid StageOverhead or NULL, in latter case only the clock is read
+ * @param stage stage the time is accounted to
+ * @param mark_ns value returned by the previous call or by stage_overhead_thread_cpu_ns in the same thread
+ * @param messages number of messages processed since mark_ns
+ * @return new mark, CPU time of the calling thread in nanoseconds
+ */
+uint64_t stage_overhead_account(StageOverhead* stage_overhead, EPlacementStage stage, uint64_t mark_ns, uint64_t messages);
+
+/**
+ * @brief Count single snapshot and close the report if interval snapshots have been counted.
+ * Shall be called by single thread only.
+ *
+ * @param stage_overhead pointer to valid StageOverhead
+ * @return pointer to the new report, valid until the next report is closed, or NULL if the report is not due
+ */
+const StageOverheadReport* stage_overhead_snapshot(StageOverhead* stage_overhead);
+
+/**
+ * @brief get the latest closed report
+ *
+ * @param stage_overhead pointer to valid StageOverhead
+ * @return pointer to the latest report or NULL if none has been closed yet
+ */
+const StageOverheadReport* stage_overhead_latest(const StageOverhead* stage_overhead);
+
+/**
+ * @brief Format report as single line, e.g.
+ * "Overhead per snapshot: reader 12.50us parser 40.10us ... rss 1200 kB peak 1300 kB\n"
+ *
+ * @param report pointer to valid report
+ * @param buffer destination
+ * @param size size of buffer, STAGE_OVERHEAD_MESSAGE_SIZE is enough
+ * @return result of snprintf
+ */
+int stage_overhead_format(const StageOverheadReport* restrict report, char* restrict buffer, size_t size);
+
+/**
+ * @brief Format hardware counters of report as single line, e.g.
+ * "Hardware per snapshot: reader cycles 120000 instructions 250000 cache-misses 300 branch-misses 900, parser n/a, ...\n"
+ * or "Hardware counters unavailable\n" if no stage could count
+ *
+ * @param report pointer to valid report with hardware set
+ * @param buffer destination
+ * @param size size of buffer, STAGE_OVERHEAD_MESSAGE_SIZE is enough
+ * @return result of snprintf
+ */
+int stage_overhead_format_hardware(const StageOverheadReport* restrict report, char* restrict buffer, size_t size);
+
+/**
+ * @brief Extract VmRSS and VmHWM from content of /proc/<pid>/status
+ *
+ * @param buffer content of status file
+ * @param rss_kb destination of VmRSS in kB
+ * @param peak_rss_kb destination of VmHWM in kB
+ * @return true iff both values were found
+ */
+bool stage_overhead_parse_status(const char buffer[restrict static 1], uint64_t* restrict rss_kb, uint64_t* restrict peak_rss_kb);
+
+#endif
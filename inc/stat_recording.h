@@ -0,0 +1,126 @@
+/**
+ * @file stat_recording.h
+ * @brief Recording of raw /proc/stat content of every tick, replayed later instead of the live file.
+ *
+ * File starts with 8 byte magic "STATREC1" followed by records. Every record starts with
+ * the time elapsed since the previous record (LEB128 varint, nanoseconds, 0 for the first one)
+ * and a kind byte:
+ * - STAT_RECORDING_RAW: varint length and the content verbatim,
+ * - STAT_RECORDING_DELTA: varint count of numbers and zigzag varint difference of every number
+ *   from the same number of the previous record.
+ * Content is split into numbers (runs of digits) and the text between them. A record whose text
+ * is identical to the text of the previous record is stored as delta, which makes a tick of
+ * /proc/stat about 1-2 bytes per counter. Text changes (cpu hotplug) fall back to raw. Encoding is
+ * lossless, contents that cannot be split exactly (leading zeros, numbers above 19 digits) are raw.
+ */
+#ifndef STAT_RECORDING_H
+#define STAT_RECORDING_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+/*Content of longer ticks is not recorded, /proc/stat of 1024 cpus has about 150 kB*/
+#define STAT_RECORDING_MAX_RECORD (1024 * 1024)
+
+enum {
+    STAT_RECORDING_RAW = 0,
+    STAT_RECORDING_DELTA = 1,
+};
+
+typedef struct StatRecorder StatRecorder;
+typedef struct StatReplay StatReplay;
+
+/**
+ * @brief Create (or truncate) file at path and write its magic
+ *
+ * @param path path of the recording
+ * @return pointer to valid StatRecorder on success, NULL on failure
+ */
+StatRecorder* stat_recorder_new(const char path[static 1]);
+
+/**
+ * @brief Close the recording, the pending record is dropped
+ *
+ * @param recorder pointer to valid StatRecorder or NULL, in latter case nothing happens
+ */
+void stat_recorder_delete(StatRecorder* recorder);
+
+/**
+ * @brief Append data to the pending record, content of single tick may be added in any number of pieces
+ *
+ * @param recorder pointer to valid StatRecorder
+ * @param data content
+ * @param length number of bytes of data
+ * @return true on success, false if the record would exceed STAT_RECORDING_MAX_RECORD or memory error
+ */
+bool stat_recorder_add(StatRecorder* restrict recorder, const char* restrict data, size_t length);
+
+/**
+ * @brief Encode the pending record, write it to the file and start the next one.
+ * The pending record is dropped if adding to it failed.
+ *
+ * @param recorder pointer to valid StatRecorder
+ * @param timestamp_ns CLOCK_MONOTONIC of the tick start
+ * @return true on success, false on write error or if the record was dropped
+ */
+bool stat_recorder_commit(StatRecorder* recorder, uint64_t timestamp_ns);
+
+/**
+ * @brief Allocate buffers for records of up to record_size bytes, buffers grow on demand otherwise.
+ * Adding and committing such records does not allocate afterwards.
+ *
+ * @param recorder pointer to valid StatRecorder
+ * @param record_size largest expected record in bytes
+ * @return true on success, false on memory error
+ */
+bool stat_recorder_reserve(StatRecorder* recorder, size_t record_size);
+
+/**
+ * @brief Open recording for replay
+ *
+ * @param path path of the recording
+ * @return pointer to valid StatReplay on success, NULL on failure or if the file is not a recording
+ */
+StatReplay* stat_replay_new(const char path[static 1]);
+
+/**
+ * @brief Close the recording
+ *
+ * @param replay pointer to valid StatReplay or NULL, in latter case nothing happens
+ */
+void stat_replay_delete(StatReplay* replay);
+
+/**
+ * @brief Decode the next record
+ *
+ * @param replay pointer to valid StatReplay
+ * @return true on success, false at the end of the recording or if the record is truncated or malformed
+ */
+bool stat_replay_next(StatReplay* replay);
+
+/**
+ * @brief Allocate buffers for records of up to record_size bytes, @see stat_recorder_reserve
+ *
+ * @param replay pointer to valid StatReplay
+ * @param record_size largest expected record in bytes
+ * @return true on success, false on memory error
+ */
+bool stat_replay_reserve(StatReplay* replay, size_t record_size);
+
+/**
+ * @brief get content of the current record
+ *
+ * @param replay pointer to valid StatReplay after successful stat_replay_next
+ * @param length destination of the number of bytes of content
+ * @return content, valid until the next call of stat_replay_next
+ */
+const char* stat_replay_data(const StatReplay* restrict replay, size_t* restrict length);
+
+/**
+ * @param replay pointer to valid StatReplay after successful stat_replay_next
+ * @return time between the previous record and the current one in nanoseconds as recorded
+ */
+uint64_t stat_replay_delay_ns(const StatReplay* replay);
+
+#endif
@@ -4,7 +4,8 @@
  *  The function reads pointers to logger_payloads from CircularBuffer and creates
  *  log entry in logger_output file. After payload has been successfully stored, the payload is
  *  deleted. Hence it is not safe to refer to payloads in any other way once they've been inserted
- *  into the buffer.
+ *  into the buffer. If stage_overhead is not NULL, CPU time of the thread is accounted to the logger stage.
+ *  If trace is not NULL, the thread records writing of every entry and waits for entries.
  */
 
 #ifndef LOGGER_H
@@ -12,10 +13,13 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <semaphore.h>
 #include "pcp_guard.h"
 #include "circular_buffer.h"
 #include "watchdog.h"
 #include "logger_payload.h"
+#include "stage_overhead.h"
+#include "trace.h"
 
 typedef struct ThreadLoggerArguments {
 
@@ -25,11 +29,27 @@ typedef struct ThreadLoggerArguments {
     pthread_mutex_t* is_working_mutex;
     FILE* logger_output;
     WatchdogControlUnit* control_unit;
+    StageOverhead* stage_overhead;
+    Trace* trace;
+    /*Posted once the thread has set itself up, nothing it does afterwards allocates. May be NULL*/
+    sem_t* started;
 
 } ThreadLoggerArguments;
 
 void* thread_logger(void* thread_logger_args);
 
+/**
+ * @brief Persist and delete every payload waiting in the buffer. Used instead of thread_logger
+ * by the single-threaded mode.
+ *
+ * @param payload_buffer_guard pointer to valid pcp_guard protecting payload buffer
+ * @param payload_ptr_buffer pointer to valid pointer buffer
+ * @param logger_output file where the log entries are written
+ * @return number of persisted payloads
+ */
+size_t thread_logger_flush(PCPGuard* restrict payload_buffer_guard, CircularBuffer* restrict payload_ptr_buffer,
+                           FILE* restrict logger_output);
+
 /**
  * @brief wrapper function for sending payload to logger
  * 
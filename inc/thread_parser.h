@@ -1,8 +1,17 @@
 /**
  * @file thread_parser.h
  * @brief Parsing thread that uses char_buffer to receive bytes of raw data and
- * double_buffer to send % of core usage as double value. Each sequence of parsed data is
- * separated with THREAD_PARSER_END
+ * snapshot_buffer to send Snapshot containing % of usage of every core together with
+ * pressure stall information and frequencies ("freq <cpu> <kHz>" lines) received in the same tick.
+ * A tick containing line THREAD_PARSER_BASELINE_LINE only establishes the counters usage of the next
+ * tick is computed from and no snapshot is emitted for it, without it the first snapshot holds usage since boot.
+ * If topology is not NULL, usage of every socket and NUMA node is aggregated as well
+ * and the topology is rescanned when the number of cpus in /proc/stat changes (hotplug).
+ * If stage_overhead is not NULL, CPU time of the thread is accounted to the parser stage after every snapshot.
+ * If trace is not NULL, the thread records parsing of lines, computation of usage and waits on both buffers.
+ * If adaptive_period is not NULL, it is updated with every snapshot and CPU time of the process.
+ * char_buffer has to be mirrored (circular_buffer_new_mirrored), lines are terminated and parsed in place
+ * in the buffer, a line longer than the buffer is dropped.
  *
  */
 #ifndef THREAD_PARSER_H
@@ -10,25 +19,44 @@
 
 #include <stdio.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <stdbool.h>
 
 #include "circular_buffer.h"
 #include "watchdog.h"
 #include "pcp_guard.h"
+#include "snapshot.h"
+#include "topology.h"
+#include "stage_overhead.h"
+#include "trace.h"
+#include "adaptive_period.h"
+#include "arena.h"
+
+/*Line marking the current tick as the baseline*/
+#define THREAD_PARSER_BASELINE_LINE "baseline"
 
 /**
- * Used for separating one sequence of output data from another
+ * @brief Parsing state carried between characters and ticks: partial line, previous counters
+ * and the snapshot being built. thread_parser owns one; single-threaded mode feeds it directly.
  */
-#define THREAD_PARSER_END -1.0
+typedef struct ThreadParserState ThreadParserState;
 
 typedef struct ThreadParserArguments {
     CircularBuffer* char_buffer;
-    CircularBuffer* double_buffer;
+    CircularBuffer* snapshot_buffer;
     CircularBuffer* logger_buffer;
     PCPGuard* logger_buffer_guard;
     PCPGuard* char_buffer_guard;
-    PCPGuard* double_buffer_guard;
+    PCPGuard* snapshot_buffer_guard;
     WatchdogControlUnit* control_unit;
+    Topology* topology;
+    StageOverhead* stage_overhead;
+    Trace* trace;
+    AdaptivePeriod* adaptive_period;
+    /*Parsing state carved from an arena by the caller, with NULL the thread allocates its own*/
+    ThreadParserState* state;
+    /*Posted once the thread has set itself up, nothing it does afterwards allocates. May be NULL*/
+    sem_t* started;
     bool* is_working;
     pthread_mutex_t* working_mutex;
 
@@ -36,4 +64,57 @@ typedef struct ThreadParserArguments {
 
 void* thread_parser(void* parser_arguments);
 
+/**
+ * @brief Allocate parsing state
+ *
+ * @param topology pointer to Topology used for socket and node usage or NULL
+ * @return pointer to valid ThreadParserState on success, NULL on failure
+ */
+ThreadParserState* thread_parser_state_new(Topology* topology);
+
+/**
+ * @brief Carve parsing state from arena, @see thread_parser_state_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(thread_parser_state_footprint()) bytes left
+ * @param topology pointer to Topology used for socket and node usage or NULL
+ * @return pointer to valid ThreadParserState on success, NULL if arena is exhausted
+ */
+ThreadParserState* thread_parser_state_new_in(Arena* arena, Topology* topology);
+
+/**
+ * @return size of the parsing state in memory
+ */
+size_t thread_parser_state_footprint(void);
+
+/**
+ * @brief Free parsing state, state carved from an arena is left to the arena
+ *
+ * @param state pointer to valid ThreadParserState or NULL, in latter case nothing happens
+ */
+void thread_parser_state_delete(ThreadParserState* state);
+
+/**
+ * @brief Consume single character of reader output
+ *
+ * @param state pointer to valid ThreadParserState
+ * @param input_char next character
+ * @param logger_guard pcp_guard protecting logger_buffer
+ * @param logger_buffer buffer of logger payloads used for warnings
+ * @return pointer to completed snapshot, valid until the next call, or NULL if the tick is not complete
+ */
+const Snapshot* thread_parser_state_feed(ThreadParserState* restrict state, char input_char,
+                                         PCPGuard* restrict logger_guard, CircularBuffer* restrict logger_buffer);
+
+/**
+ * @brief Consume single complete line of reader output, @see thread_parser_state_feed
+ *
+ * @param state pointer to valid ThreadParserState, partial line accumulated by thread_parser_state_feed is kept
+ * @param line line without its newline
+ * @param logger_guard pcp_guard protecting logger_buffer
+ * @param logger_buffer buffer of logger payloads used for warnings
+ * @return pointer to completed snapshot, valid until the next call, or NULL if the tick is not complete
+ */
+const Snapshot* thread_parser_state_feed_line(ThreadParserState* state, const char line[static 1],
+                                              PCPGuard* restrict logger_guard, CircularBuffer* restrict logger_buffer);
+
 #endif
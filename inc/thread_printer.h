@@ -1,21 +1,56 @@
 /**
  * @file thread_printer.h
- * @brief Thread that receives parsed data through circular_buffer_guard
- * and prints it to terminal.
+ * @brief Thread that receives snapshots through circular_buffer
+ * and prints them to terminal.
  * 
  */
 #ifndef THREAD_PRINTER_H
 #define THREAD_PRINTER_H
 
 #include <stdbool.h>
+#include <semaphore.h>
 #include "pcp_guard.h"
 #include "watchdog.h"
 #include "circular_buffer.h"
+#include "snapshot_shm.h"
+#include "history_store.h"
+#include "rollup.h"
+#include "usage_stats.h"
+#include "hotspot.h"
+#include "alert_rules.h"
+#include "alert_action.h"
+#include "self_usage.h"
+#include "stage_overhead.h"
+#include "metrics_endpoint.h"
+#include "trace.h"
+#include "snapshot_latency.h"
+#include "snapshot.h"
 
 /**
  * @brief thread_printer arguments:
- * circular double buffer for retrieving parsed data
- * and guard for synchronization
+ * circular buffer of Snapshots for retrieving parsed data
+ * and guard for synchronization. If snapshot_shm is not NULL,
+ * every snapshot is published there before being printed.
+ * If history_store is not NULL, every snapshot is appended to it.
+ * If rollup is not NULL, every snapshot is aggregated and completed windows are printed
+ * and appended to non-NULL rollup_stores of their tiers.
+ * If usage_stats is not NULL, it is updated with every snapshot and published together with it;
+ * statistics selected by usage_stats_mask (1 << EUsageStatistic) are printed next to usage.
+ * If hotspot is not NULL, only the busiest and idlest cores, aggregate and hot spots are printed
+ * instead of the full listing.
+ * If alert_rules is not NULL, rules are evaluated on every snapshot before any other processing
+ * and transitions are sent to alert_actions[rule index] (log actions through logger_buffer).
+ * If self_usage is not NULL, share of every core consumed by the tracker is printed next to usage.
+ * If stage_overhead is not NULL, every snapshot is counted there and CPU time of the thread is accounted
+ * to the printer stage; closed reports are printed, logged and the latest one is published with snapshots.
+ * If metrics_endpoint is not NULL, every snapshot is rendered there together with the latest overhead report.
+ * If trace is not NULL, the thread records handling of every snapshot and waits on circular_buffer.
+ * If snapshot_latency is not NULL, ages of every snapshot are recorded after all other sinks and its
+ * reports are logged.
+ * If start_ns is not 0, time from start_ns (snapshot_latency_now_ns) to output of the first snapshot with usage
+ * of every core (first_complete) is logged.
+ * If number_of_cores is not 0, it is the number of cores per-core sinks were created for; snapshots with more cores
+ * are logged once per new core count, sinks keep covering only the first number_of_cores of them.
  * 
  */
 typedef struct ThreadPrinterArguments
@@ -25,6 +60,24 @@ typedef struct ThreadPrinterArguments
     CircularBuffer* circular_buffer;
     CircularBuffer* logger_buffer;    
     WatchdogControlUnit* control_unit;
+    SnapshotShm* snapshot_shm;
+    HistoryStore* history_store;
+    Rollup* rollup;
+    HistoryStore* rollup_stores[ROLLUP_TIER_COUNT];
+    UsageStats* usage_stats;
+    uint32_t usage_stats_mask;
+    Hotspot* hotspot;
+    AlertRules* alert_rules;
+    AlertAction* const* alert_actions;
+    SelfUsage* self_usage;
+    StageOverhead* stage_overhead;
+    MetricsEndpoint* metrics_endpoint;
+    Trace* trace;
+    SnapshotLatency* snapshot_latency;
+    uint64_t start_ns;
+    size_t number_of_cores;
+    /*Posted once the thread has set itself up, nothing it does afterwards allocates. May be NULL*/
+    sem_t* started;
     bool* is_working;
     pthread_mutex_t* working_mutex;
 } ThreadPrinterArguments;
@@ -32,4 +85,13 @@ typedef struct ThreadPrinterArguments
 
 void* thread_printer(void* printer_arguments);
 
+/**
+ * @brief Run every sink of printer_arguments on single snapshot, as thread_printer does after
+ * receiving it. Used directly by the single-threaded mode; buffer and guard of snapshots are ignored.
+ *
+ * @param printer_arguments arguments with sinks and logger buffer
+ * @param snapshot snapshot to process, snapshots without cores are skipped
+ */
+void thread_printer_handle_snapshot(const ThreadPrinterArguments* restrict printer_arguments, const Snapshot* restrict snapshot);
+
 #endif
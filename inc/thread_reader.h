@@ -1,17 +1,39 @@
 /**
  * @file thread_reader.h
  * @brief Thread that reads raw data from input_file (pointing to /proc/stat) and sends it through
- * char_buffer
+ * char_buffer. If pressure_files are set, at the beginning of each tick every line of each
+ * non-NULL pressure file is sent before /proc/stat, prefixed with "psi <resource> ".
+ * If frequency_sampler is set, every known frequency is sent as "freq <cpu> <kHz>" in the same tick.
+ * Every tick starts with line "tick <ns>", the time it started, @see snapshot_latency.h.
+ * If stage_overhead is set, CPU time of the thread is accounted to the reader stage after every tick.
+ * If trace is set, the thread records every tick as read event and waits on the full char_buffer.
+ * If recorder is set, content of input_file of every tick is recorded, @see stat_recording.h.
+ * If replay is set, input_file is not read (it may be NULL) and neither are pressure files and frequency,
+ * every tick sends content of the next record of replay after the recorded delay (without delay if
+ * replay_fast). At the end of the recording the thread logs it and sends SIGTERM to the process.
+ * If priming is not zero, the first tick is marked as the baseline and the next one is read after priming
+ * instead of period, so the first snapshot holds usage over priming instead of since boot, @see thread_parser.h.
+ * Replay marks its first record as the baseline and keeps the recorded delays.
+ * If adaptive_period is set, it replaces period, the reader sleeps the period decided after the latest
+ * snapshot the parser completed. Replay ignores it.
  * 
  */
 #ifndef THREAD_READER_H
 #define THREAD_READER_H
 
 #include <stdio.h>
+#include <time.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include "pcp_guard.h"
 #include "watchdog.h"
 #include "circular_buffer.h"
+#include "psi_parser.h"
+#include "frequency_sampler.h"
+#include "stage_overhead.h"
+#include "trace.h"
+#include "stat_recording.h"
+#include "adaptive_period.h"
 
 typedef struct ThreadReaderArguments {
     PCPGuard* char_buffer_guard;
@@ -20,6 +42,20 @@ typedef struct ThreadReaderArguments {
     CircularBuffer* logger_buffer;
     WatchdogControlUnit* control_unit;
     FILE* input_file;
+    FILE* pressure_files[PSI_RESOURCE_COUNT];
+    FrequencySampler* frequency_sampler;
+    StageOverhead* stage_overhead;
+    Trace* trace;
+    StatRecorder* recorder;
+    StatReplay* replay;
+    bool replay_fast;
+    /*Sleep between two reads of input_file, zero means 1 s*/
+    struct timespec period;
+    /*Interval between the baseline and the first snapshot, zero disables the baseline*/
+    struct timespec priming;
+    AdaptivePeriod* adaptive_period;
+    /*Posted once the thread has set itself up, nothing it does afterwards allocates. May be NULL*/
+    sem_t* started;
     bool* working;
     pthread_mutex_t* working_mutex;
 
@@ -2,19 +2,25 @@
  * @file thread_watchdog.h   
  * @brief thread that uses watchdog to oversee threads
  * if one of the threads does not ping their control_unit, then
- * the entire program will be aborted.
+ * the entire program will be aborted. If stage_overhead is not NULL, CPU time of the thread
+ * is accounted to the watchdog stage after every check.
  * 
  */
 #ifndef THREAD_WATCHDOG_H
 #define THREAD_WATCHDOG_H
 
 #include <pthread.h>
+#include <semaphore.h>
 #include "watchdog.h"
+#include "stage_overhead.h"
 
 typedef struct ThreadWatchdogArguments {
     Watchdog* watchdog;
     bool* is_working;
     pthread_mutex_t* mutex;
+    StageOverhead* stage_overhead;
+    /*Posted once the thread has set itself up, nothing it does afterwards allocates. May be NULL*/
+    sem_t* started;
 
 } ThreadWatchdogArguments;
 
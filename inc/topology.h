@@ -0,0 +1,126 @@
+/**
+ * @file topology.h
+ * @brief CPU topology read from sysfs: package (socket), NUMA node, core and SMT sibling of every cpu.
+ *
+ * Packages and nodes get dense indices (ordered by their sysfs ids), so per-group
+ * accumulators can be plain arrays. Topology is read once and rescanned only on request,
+ * e.g. when the set of online cpus changes.
+ */
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "snapshot.h"
+#include "arena.h"
+
+/**
+ * @brief Placement of single cpu. package and node are dense indices,
+ * first_sibling is the lowest cpu number sharing the core, thread is position among SMT siblings.
+ *
+ */
+typedef struct TopologyCpu {
+    bool online;
+    uint32_t package;
+    uint32_t node;
+    uint32_t core_id;
+    uint32_t first_sibling;
+    uint32_t thread;
+} TopologyCpu;
+
+typedef struct Topology Topology;
+
+/**
+ * @brief Read topology of cpus below root
+ *
+ * @param root sysfs mount point, "/sys" on real system
+ * @return pointer to valid Topology on success, NULL on failure or if root has no cpus
+ */
+Topology* topology_new(const char root[static 1]);
+
+/**
+ * @brief Carve topology from arena and read it, @see topology_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(topology_footprint(root)) bytes left
+ * @param root sysfs mount point, "/sys" on real system
+ * @return pointer to valid Topology on success, NULL if arena is exhausted or root has no cpus
+ */
+Topology* topology_new_in(Arena* arena, const char root[static 1]);
+
+/**
+ * @param root sysfs mount point
+ * @return size of the topology in memory
+ */
+size_t topology_footprint(const char root[static 1]);
+
+/**
+ * @brief Free memory occupied by topology, topology carved from an arena is left to the arena
+ *
+ * @param topology pointer to valid Topology or NULL, in latter case nothing happens
+ */
+void topology_delete(Topology* topology);
+
+/**
+ * @brief Read topology again from the same root. On failure the previous topology is kept.
+ * Does not allocate, the scan is read into space reserved by topology_new.
+ *
+ * @param topology pointer to valid Topology
+ * @return true iff topology was read
+ */
+bool topology_rescan(Topology* topology);
+
+/**
+ * @brief get cpu with given number
+ *
+ * @param topology pointer to valid Topology
+ * @param cpu cpu number as used by sysfs and /proc/stat
+ * @return pointer to cpu valid until the next rescan, NULL if cpu is unknown or offline
+ */
+const TopologyCpu* topology_cpu(const Topology* topology, size_t cpu);
+
+/**
+ * @brief get number of packages (sockets) with at least one online cpu
+ *
+ * @param topology pointer to valid Topology
+ * @return number of packages, at most SNAPSHOT_MAX_PACKAGES
+ */
+size_t topology_number_of_packages(const Topology* topology);
+
+/**
+ * @brief get number of NUMA nodes with at least one online cpu
+ *
+ * @param topology pointer to valid Topology
+ * @return number of nodes, at most SNAPSHOT_MAX_NODES
+ */
+size_t topology_number_of_nodes(const Topology* topology);
+
+/**
+ * @brief get sysfs id of the package
+ *
+ * @param topology pointer to valid Topology
+ * @param package dense index of package
+ * @return physical_package_id
+ */
+uint32_t topology_package_id(const Topology* topology, size_t package);
+
+/**
+ * @brief get sysfs id of the node
+ *
+ * @param topology pointer to valid Topology
+ * @param node dense index of node
+ * @return node number
+ */
+uint32_t topology_node_id(const Topology* topology, size_t node);
+
+/**
+ * @brief Parse cpulist format used by sysfs and cpusets, e.g. "0-3,8,10-11"
+ *
+ * @param list null-terminated list, may end with newline
+ * @param set array where set[cpu] is set for every listed cpu below set_size, others are cleared
+ * @param set_size number of elements of set
+ * @return true iff list is well-formed
+ */
+bool topology_cpulist_parse(const char list[static 1], bool set[static 1], size_t set_size);
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ * @file trace.h
+ * @brief Flight recorder of begin/end events of the pipeline stages, dumped in Chrome trace event
+ * format (JSON, opens in chrome://tracing and ui.perfetto.dev).
+ *
+ * Every thread attached to a Trace owns a ring of its latest events. The ring is written by its
+ * thread only, without locks or read-modify-write atomics, and the oldest events are overwritten.
+ * A dump may run concurrently with the writers, events overwritten while being copied are dropped.
+ * Timestamps are CLOCK_MONOTONIC, read through vDSO without a system call.
+ *
+ * Everything a dump needs (a copy of one ring and the output buffer) is allocated with the trace and
+ * the output is written by write(2), so dumping does not allocate and works after alloc_guard_seal.
+ * Dumps of the same trace shall not run concurrently with each other.
+ *
+ * TRACE_BEGIN and TRACE_END compile to nothing unless PIPELINE_TRACE is defined. If it is, a thread
+ * that is not attached to a trace pays a single branch on a thread-local pointer per event.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "arena.h"
+
+#ifndef TRACE_MAX_THREADS
+#define TRACE_MAX_THREADS 8
+#endif
+
+/*Events kept per thread, 16 B each*/
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 65536
+#endif
+
+/*JSON is formatted into a buffer of this size, it is written whenever the next event does not fit*/
+#ifndef TRACE_OUTPUT_SIZE
+#define TRACE_OUTPUT_SIZE 65536
+#endif
+
+typedef enum ETraceEvent {
+    TRACE_EVENT_READ = 0,
+    TRACE_EVENT_PARSE = 1,
+    TRACE_EVENT_COMPUTE = 2,
+    TRACE_EVENT_ENQUEUE_WAIT = 3,
+    TRACE_EVENT_DEQUEUE_WAIT = 4,
+    TRACE_EVENT_PRINT = 5,
+    TRACE_EVENT_LOG = 6,
+    TRACE_EVENT_COUNT = 7,
+} ETraceEvent;
+
+typedef struct Trace Trace;
+typedef struct TraceRing TraceRing;
+
+/**
+ * @brief Ring of the calling thread, NULL if the thread is not attached
+ */
+extern _Thread_local TraceRing* trace_thread_ring;
+
+/**
+ * @param ring_size events kept per thread, power of two
+ * @return pointer to valid Trace on success, NULL on failure or if ring_size is not a power of two
+ */
+Trace* trace_new(size_t ring_size);
+
+/**
+ * @brief Carve trace from arena, @see trace_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(trace_footprint()) bytes left
+ * @param ring_size events kept per thread, power of two
+ * @return pointer to valid Trace on success, NULL if ring_size is not a power of two or arena is exhausted
+ */
+Trace* trace_new_in(Arena* arena, size_t ring_size);
+
+/**
+ * @param ring_size events kept per thread
+ * @return size of the trace with all its rings in memory
+ */
+size_t trace_footprint(size_t ring_size);
+
+/**
+ * @brief Free the trace. Attached threads shall be finished or detached. Trace carved from an arena is left to the arena.
+ *
+ * @param trace pointer to valid Trace or NULL, in latter case nothing happens
+ */
+void trace_delete(Trace* trace);
+
+/**
+ * @brief Give the calling thread its own ring, events of the thread are recorded from now on
+ *
+ * @param trace pointer to valid Trace or NULL, in latter case the thread is detached
+ * @param name name of the thread shown in the trace, truncated to 15 characters
+ * @return true on success, false if trace is NULL or TRACE_MAX_THREADS threads are attached already
+ */
+bool trace_thread_attach(Trace* restrict trace, const char name[restrict static 1]);
+
+/**
+ * @brief Append event to ring, use TRACE_BEGIN and TRACE_END instead
+ *
+ * @param ring pointer to valid TraceRing
+ * @param event recorded event
+ * @param begin true for beginning of the event, false for its end
+ */
+void trace_record(TraceRing* ring, ETraceEvent event, bool begin);
+
+/**
+ * @brief Write events of every attached thread as Chrome trace JSON. Ends without a matching
+ * beginning (the beginning was overwritten) are skipped.
+ *
+ * @param trace pointer to valid Trace
+ * @param output file descriptor the JSON is written to from its current offset
+ * @return true on success, false on write error
+ */
+bool trace_dump(Trace* trace, int output);
+
+/**
+ * @brief Replace content of file with trace_dump, the file is truncated and written from its beginning
+ *
+ * @param trace pointer to valid Trace
+ * @param file descriptor of regular file opened for writing
+ * @return true on success, false on error
+ */
+bool trace_dump_file(Trace* trace, int file);
+
+/**
+ * @return name of the event used in the trace
+ */
+const char* trace_event_to_str(ETraceEvent event);
+
+#ifdef PIPELINE_TRACE
+#define TRACE_BEGIN(event) do { \
+        if (__builtin_expect(trace_thread_ring != NULL, 0)) { \
+            trace_record(trace_thread_ring, (event), true); \
+        } \
+    } while (0)
+#define TRACE_END(event) do { \
+        if (__builtin_expect(trace_thread_ring != NULL, 0)) { \
+            trace_record(trace_thread_ring, (event), false); \
+        } \
+    } while (0)
+#else
+#define TRACE_BEGIN(event) ((void) 0)
+#define TRACE_END(event) ((void) 0)
+#endif
+
+#endif
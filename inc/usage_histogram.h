@@ -0,0 +1,55 @@
+/**
+ * @file usage_histogram.h
+ * @brief Fixed-bucket histogram of usage values (in %) used for streaming quantiles.
+ *
+ * Bucket k holds values from [k, k + 1), the last bucket holds values >= 100.
+ * Memory is constant regardless of the number of samples, quantiles are exact up to
+ * the bucket width (1%).
+ */
+#ifndef USAGE_HISTOGRAM_H
+#define USAGE_HISTOGRAM_H
+
+#include <inttypes.h>
+
+enum {
+    USAGE_HISTOGRAM_BUCKETS = 101,
+};
+
+typedef struct UsageHistogram {
+    uint32_t count;
+    uint32_t buckets[USAGE_HISTOGRAM_BUCKETS];
+} UsageHistogram;
+
+/**
+ * @brief Remove all samples from histogram
+ *
+ * @param histogram pointer to valid histogram
+ */
+void usage_histogram_clear(UsageHistogram* histogram);
+
+/**
+ * @brief Insert single sample into histogram. NaN is ignored.
+ *
+ * @param histogram pointer to valid histogram
+ * @param value usage in %, values below 0 are counted as 0
+ */
+void usage_histogram_add(UsageHistogram* histogram, double value);
+
+/**
+ * @brief Remove sample previously inserted with usage_histogram_add. Used for sliding windows.
+ *
+ * @param histogram pointer to valid histogram
+ * @param value the same value that was inserted
+ */
+void usage_histogram_remove(UsageHistogram* histogram, double value);
+
+/**
+ * @brief Estimate quantile, the value is interpolated inside the bucket containing requested rank.
+ *
+ * @param histogram pointer to valid histogram
+ * @param quantile number from [0, 1], e.g. 0.95 for p95
+ * @return estimated value or NaN if histogram is empty
+ */
+double usage_histogram_quantile(const UsageHistogram* histogram, double quantile);
+
+#endif
@@ -0,0 +1,117 @@
+/**
+ * @file usage_stats.h
+ * @brief Smoothed per-core statistics updated incrementally with every snapshot.
+ *
+ * EWMAs with half-lives of 10 s, 1 min and 5 min take the real time between snapshots
+ * into account, so they do not depend on the sampling period. Quantiles are estimated
+ * from usage histogram over sliding window of the last window_size snapshots and clamped
+ * to the minimum and maximum usage in the window, a constant series reports its exact value.
+ * Values are kept core-major: value of statistic s of core c is at c * USAGE_STATISTIC_COUNT + s.
+ */
+#ifndef USAGE_STATS_H
+#define USAGE_STATS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "snapshot.h"
+#include "arena.h"
+
+typedef enum EUsageStatistic {
+    USAGE_STATISTIC_EWMA_10S = 0,
+    USAGE_STATISTIC_EWMA_1MIN = 1,
+    USAGE_STATISTIC_EWMA_5MIN = 2,
+    USAGE_STATISTIC_P50 = 3,
+    USAGE_STATISTIC_P95 = 4,
+    USAGE_STATISTIC_P99 = 5,
+    USAGE_STATISTIC_COUNT = 6,
+} EUsageStatistic;
+
+typedef struct UsageStats UsageStats;
+
+/**
+ * @brief Allocate statistics of number_of_cores cores
+ *
+ * @param number_of_cores number of cores, cores above it are ignored
+ * @param window_size number of snapshots in the sliding window of quantiles
+ * @return pointer to valid UsageStats on success, NULL on failure or if one of the sizes is 0
+ */
+UsageStats* usage_stats_new(size_t number_of_cores, size_t window_size);
+
+/**
+ * @brief Carve statistics from arena, @see usage_stats_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(usage_stats_footprint()) bytes left
+ * @param number_of_cores number of cores, cores above it are ignored
+ * @param window_size number of snapshots in the sliding window of quantiles
+ * @return pointer to valid UsageStats on success, NULL if one of the sizes is 0 or arena is exhausted
+ */
+UsageStats* usage_stats_new_in(Arena* arena, size_t number_of_cores, size_t window_size);
+
+/**
+ * @param number_of_cores number of cores
+ * @param window_size number of snapshots in the sliding window of quantiles
+ * @return size of the statistics in memory
+ */
+size_t usage_stats_footprint(size_t number_of_cores, size_t window_size);
+
+/**
+ * @brief Free memory occupied by statistics, statistics carved from an arena are left to the arena
+ *
+ * @param stats pointer to valid UsageStats or NULL, in latter case nothing happens
+ */
+void usage_stats_delete(UsageStats* stats);
+
+/**
+ * @brief Update all statistics with the snapshot. NaN usage leaves EWMAs of the core unchanged
+ * and is not counted in quantiles.
+ *
+ * @param stats pointer to valid UsageStats
+ * @param snapshot snapshot with timestamp set
+ */
+void usage_stats_update(UsageStats* restrict stats, const Snapshot* restrict snapshot);
+
+/**
+ * @brief get single statistic of the core
+ *
+ * @param stats pointer to valid UsageStats
+ * @param core index of core
+ * @param statistic requested statistic
+ * @return value of the statistic, NaN if the core is out of range or has no samples yet
+ */
+double usage_stats_get(const UsageStats* stats, size_t core, EUsageStatistic statistic);
+
+/**
+ * @brief get all statistics, core-major
+ *
+ * @param stats pointer to valid UsageStats
+ * @return pointer to number_of_cores * USAGE_STATISTIC_COUNT values, valid until the next update
+ */
+const double* usage_stats_values(const UsageStats* stats);
+
+/**
+ * @brief get number of cores covered by statistics
+ *
+ * @param stats pointer to valid UsageStats
+ * @return number of cores
+ */
+size_t usage_stats_number_of_cores(const UsageStats* stats);
+
+/**
+ * @brief Parse comma separated list of statistic names, e.g. "ewma1m,p95"
+ *
+ * @param list string with names @see usage_stats_statistic_to_str
+ * @param mask pointer to memory where bit mask (1 << EUsageStatistic) will be stored
+ * @return true iff every name in the list is known
+ */
+bool usage_stats_mask_parse(const char list[restrict static 1], uint32_t* restrict mask);
+
+/**
+ * @brief get the pointer to read-only string with name of the statistic
+ *
+ * @param statistic statistic
+ * @return const char* pointer to read-only string
+ */
+const char* usage_stats_statistic_to_str(EUsageStatistic statistic);
+
+#endif
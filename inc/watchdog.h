@@ -11,6 +11,7 @@
 #include <inttypes.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include "arena.h"
 
 /**
  * @brief type used for storing control units and operating on them.
@@ -63,9 +64,25 @@ inline void watchdog_finish(WatchdogControlUnit* unit) {
  * @return pointer to valid watchdog on success, NULL on failure.
  */
 Watchdog* watchdog_new(size_t number_of_puppies);
+
+/**
+ * @brief Carve new watchdog from arena, @see watchdog_new
+ *
+ * @param arena pointer to valid Arena with at least arena_footprint(watchdog_footprint()) bytes left
+ * @param number_of_puppies max number of control units that newly created watchdog shall oversee
+ * @return pointer to valid watchdog on success, NULL if number_of_puppies is 0 or arena is exhausted.
+ */
+Watchdog* watchdog_new_in(Arena* arena, size_t number_of_puppies);
+
+/**
+ * @param number_of_puppies max number of control units
+ * @return size of the watchdog in memory
+ */
+size_t watchdog_footprint(size_t number_of_puppies);
 /**
  * @brief create new watchdog that will be able to oversee number_of_puppies control units at most
  * @param watchdog pointer to valid watchdog on success, NULL on failure or if number_of_puppies is equal to 0.
+ * Watchdog carved from an arena is left to the arena.
  */
 void watchdog_delete(Watchdog* watchdog);
 /**
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "adaptive_period.h"
+
+struct AdaptivePeriod {
+    uint64_t min_ns;
+    uint64_t max_ns;
+    double threshold;
+    double budget;
+    double ticks_per_second;
+    /*Written by the consumer of snapshots, read by the reader*/
+    _Atomic uint64_t period_ns;
+    size_t stable_snapshots;
+    bool cpu_known;
+    uint64_t previous_cpu_ns;
+    size_t number_of_cores;
+    /*Memory belongs to an arena and is not freed by adaptive_period_delete*/
+    bool arena_owned;
+    double previous_usage[SNAPSHOT_MAX_CORES];
+    /*Changes above quantization of the current snapshot, the largest ones sorted in descending order*/
+    double changes[SNAPSHOT_MAX_CORES];
+};
+
+/**
+ * @brief Compute changes of usage of cores beyond quantization of the interval and remember usage
+ * @return number of cores whose change is known
+ */
+static inline size_t changes_compute(AdaptivePeriod* restrict adaptive_period, const Snapshot* restrict snapshot);
+
+/**
+ * @brief Select ADAPTIVE_PERIOD_PERCENTILE of changes, the array is partially reordered
+ */
+static inline double changes_percentile(double changes[static 1], size_t number_of_changes);
+
+/**
+ * @brief Initialize zeroed scheduler
+ */
+static inline AdaptivePeriod* adaptive_period_initialize(AdaptivePeriod* result, uint64_t min_ns, uint64_t max_ns, double threshold,
+                                                         double budget, long ticks_per_second);
+
+AdaptivePeriod* adaptive_period_new(const uint64_t min_ns, const uint64_t max_ns, const double threshold, const double budget,
+                                    const long ticks_per_second) {
+    if (min_ns == 0 || min_ns > max_ns || !(budget > 0.0) || ticks_per_second <= 0) {
+        return NULL;
+    }
+    AdaptivePeriod* result = calloc(1, sizeof(*result));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    return adaptive_period_initialize(result, min_ns, max_ns, threshold, budget, ticks_per_second);
+}
+
+AdaptivePeriod* adaptive_period_new_in(Arena* const arena, const uint64_t min_ns, const uint64_t max_ns, const double threshold,
+                                       const double budget, const long ticks_per_second) {
+    if (min_ns == 0 || min_ns > max_ns || !(budget > 0.0) || ticks_per_second <= 0) {
+        return NULL;
+    }
+    AdaptivePeriod* result = arena_alloc(arena, sizeof(*result));
+    if (result == NULL) {
+        return NULL;
+    }
+    result->arena_owned = true;
+    return adaptive_period_initialize(result, min_ns, max_ns, threshold, budget, ticks_per_second);
+}
+
+size_t adaptive_period_footprint() {
+    return sizeof(AdaptivePeriod);
+}
+
+void adaptive_period_delete(AdaptivePeriod* const adaptive_period) {
+    if (adaptive_period != NULL && adaptive_period->arena_owned) {
+        return;
+    }
+    free(adaptive_period);
+}
+
+uint64_t adaptive_period_update(AdaptivePeriod* const restrict adaptive_period, const Snapshot* const restrict snapshot,
+                                const uint64_t process_cpu_ns) {
+    const size_t number_of_changes = changes_compute(adaptive_period, snapshot);
+    const double change = number_of_changes == 0 ? 0.0 : changes_percentile(adaptive_period->changes, number_of_changes);
+
+    /*Share of one core consumed by the tracker since the previous snapshot*/
+    double share = 0.0;
+    if (adaptive_period->cpu_known && snapshot->interval_ns != 0 && process_cpu_ns >= adaptive_period->previous_cpu_ns) {
+        share = (double) (process_cpu_ns - adaptive_period->previous_cpu_ns) / (double) snapshot->interval_ns;
+    }
+    adaptive_period->cpu_known = true;
+    adaptive_period->previous_cpu_ns = process_cpu_ns;
+
+    uint64_t period_ns = atomic_load_explicit(&adaptive_period->period_ns, memory_order_relaxed);
+    const uint64_t longer_ns = period_ns > adaptive_period->max_ns / 2 ? adaptive_period->max_ns : 2 * period_ns;
+    const uint64_t shorter_ns = period_ns / 2 < adaptive_period->min_ns ? adaptive_period->min_ns : period_ns / 2;
+    if (share > adaptive_period->budget) {
+        period_ns = longer_ns;
+        adaptive_period->stable_snapshots = 0;
+    }
+    else if (change > adaptive_period->threshold) {
+        /*Halving the period roughly doubles the cost of sampling*/
+        if (2.0 * share <= adaptive_period->budget) {
+            period_ns = shorter_ns;
+        }
+        adaptive_period->stable_snapshots = 0;
+    }
+    else if (change > adaptive_period->threshold / 2.0) {
+        /*Hysteresis: neither volatile nor stable, the period is kept*/
+        adaptive_period->stable_snapshots = 0;
+    }
+    else if (++adaptive_period->stable_snapshots >= ADAPTIVE_PERIOD_STABLE_SNAPSHOTS) {
+        period_ns = longer_ns;
+        adaptive_period->stable_snapshots = 0;
+    }
+    atomic_store_explicit(&adaptive_period->period_ns, period_ns, memory_order_relaxed);
+    return period_ns;
+}
+
+uint64_t adaptive_period_current_ns(const AdaptivePeriod* const adaptive_period) {
+    return atomic_load_explicit(&adaptive_period->period_ns, memory_order_relaxed);
+}
+
+uint64_t adaptive_period_process_cpu_ns() {
+    struct timespec now;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now) != 0) {
+        return 0;
+    }
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+static inline size_t changes_compute(AdaptivePeriod* const restrict adaptive_period, const Snapshot* const restrict snapshot) {
+    const size_t number_of_cores = snapshot->number_of_cores;
+    /*Usage counts whole ticks, each of two usages may be off by one tick of the interval*/
+    const uint64_t interval_ns = snapshot->interval_ns != 0 ? snapshot->interval_ns
+                                 : atomic_load_explicit(&adaptive_period->period_ns, memory_order_relaxed);
+    const double interval_ticks = (double) interval_ns / 1e9 * adaptive_period->ticks_per_second;
+    const double quantization = interval_ticks > 0.0 ? 2.0 * 100.0 / interval_ticks : 0.0;
+
+    size_t result = 0;
+    for (size_t core = 0; core < number_of_cores; core++) {
+        const double usage = snapshot->core_usage[core];
+        if (core < adaptive_period->number_of_cores && !isnan(usage) && !isnan(adaptive_period->previous_usage[core])) {
+            const double change = fabs(usage - adaptive_period->previous_usage[core]) - quantization;
+            adaptive_period->changes[result++] = change > 0.0 ? change : 0.0;
+        }
+        adaptive_period->previous_usage[core] = usage;
+    }
+    adaptive_period->number_of_cores = number_of_cores;
+    return result;
+}
+
+static inline double changes_percentile(double changes[const static 1], const size_t number_of_changes) {
+    /*Rank of the percentile counted from the largest change, partial insertion sort of the largest ones*/
+    const size_t rank = number_of_changes - (number_of_changes * ADAPTIVE_PERIOD_PERCENTILE + 99) / 100 + 1;
+    for (size_t i = 1; i < number_of_changes; i++) {
+        const double change = changes[i];
+        if (i >= rank && change <= changes[rank - 1]) {
+            continue;
+        }
+        size_t position = i < rank ? i : rank - 1;
+        while (position > 0 && changes[position - 1] < change) {
+            changes[position] = changes[position - 1];
+            position--;
+        }
+        changes[position] = change;
+    }
+    return changes[rank - 1];
+}
+
+static inline AdaptivePeriod* adaptive_period_initialize(AdaptivePeriod* const result, const uint64_t min_ns, const uint64_t max_ns,
+                                                         const double threshold, const double budget, const long ticks_per_second) {
+    result->min_ns = min_ns;
+    result->max_ns = max_ns;
+    result->threshold = threshold;
+    result->budget = budget;
+    result->ticks_per_second = (double) ticks_per_second;
+    atomic_init(&result->period_ns, max_ns);
+    return result;
+}
@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "alert_action.h"
+
+struct AlertAction {
+    EAlertActionType type;
+    int fd;
+    struct sockaddr_un address;
+    /*Memory belongs to an arena and is not freed by alert_action_delete*/
+    bool arena_owned;
+};
+
+/**
+ * @brief Fill action from specification, opens the socket of ALERT_ACTION_UNIX
+ * @return false if spec is invalid or the socket cannot be created
+ */
+static inline bool action_parse(const char spec[static 1], AlertAction* result);
+
+/**
+ * @brief Open FIFO for writing if it is not open yet, fails while there is no reader
+ */
+static inline bool fifo_open(AlertAction* action);
+
+AlertAction* alert_action_new(const char spec[const static 1]) {
+    AlertAction action;
+    if (!action_parse(spec, &action)) {
+        return NULL;
+    }
+    AlertAction* result = malloc(sizeof(*result));
+    if (result == NULL) {
+        errno = 0;
+        if (action.fd != -1) {
+            close(action.fd);
+        }
+        return NULL;
+    }
+    *result = action;
+    return result;
+}
+
+AlertAction* alert_action_new_in(Arena* const arena, const char spec[const static 1]) {
+    AlertAction action;
+    if (!action_parse(spec, &action)) {
+        return NULL;
+    }
+    AlertAction* result = arena_alloc(arena, sizeof(*result));
+    if (result == NULL) {
+        if (action.fd != -1) {
+            close(action.fd);
+        }
+        return NULL;
+    }
+    *result = action;
+    result->arena_owned = true;
+    return result;
+}
+
+size_t alert_action_footprint() {
+    return sizeof(AlertAction);
+}
+
+void alert_action_delete(AlertAction* const action) {
+    if (action == NULL) {
+        return;
+    }
+    if (action->fd != -1) {
+        close(action->fd);
+    }
+    if (!action->arena_owned) {
+        free(action);
+    }
+}
+
+EAlertActionType alert_action_type(const AlertAction* const action) {
+    return action->type;
+}
+
+bool alert_action_send(AlertAction* const restrict action, const char message[const restrict static 1], const size_t length) {
+    switch (action->type) {
+        case ALERT_ACTION_FIFO: {
+            if (!fifo_open(action)) {
+                return false;
+            }
+            const ssize_t written = write(action->fd, message, length);
+            if (written == -1 && errno == EPIPE) {
+                /*Reader has gone, the next message reopens the FIFO*/
+                close(action->fd);
+                action->fd = -1;
+            }
+            return written == (ssize_t) length;
+        }
+        case ALERT_ACTION_UNIX:
+            return sendto(action->fd, message, length, MSG_DONTWAIT | MSG_NOSIGNAL,
+                          (const struct sockaddr*) &action->address, sizeof(action->address)) == (ssize_t) length;
+        default:
+            return false;
+    }
+}
+
+static inline bool fifo_open(AlertAction* const action) {
+    if (action->fd != -1) {
+        return true;
+    }
+    /*Non-blocking open fails with ENXIO instead of waiting for a reader*/
+    action->fd = open(action->address.sun_path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    return action->fd != -1;
+}
+
+static inline bool action_parse(const char spec[const static 1], AlertAction* const result) {
+    memset(result, 0, sizeof(*result));
+    result->fd = -1;
+    result->address.sun_family = AF_UNIX;
+
+    if (strcmp(spec, "log") == 0) {
+        result->type = ALERT_ACTION_LOG;
+        return true;
+    }
+    const char* separator = strchr(spec, ':');
+    const size_t type_length = separator == NULL ? 0 : (size_t) (separator - spec);
+    if (type_length == 4 && strncmp(spec, "fifo", type_length) == 0) {
+        result->type = ALERT_ACTION_FIFO;
+    } else if (type_length == 4 && strncmp(spec, "unix", type_length) == 0) {
+        result->type = ALERT_ACTION_UNIX;
+    } else {
+        return false;
+    }
+
+    const size_t path_length = strlen(spec) - type_length - 1;
+    if (path_length == 0 || path_length >= sizeof(result->address.sun_path)) {
+        return false;
+    }
+    snprintf(result->address.sun_path, sizeof(result->address.sun_path), "%s", separator + 1);
+
+    if (result->type == ALERT_ACTION_UNIX) {
+        result->fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (result->fd == -1) {
+            return false;
+        }
+    }
+    return true;
+}
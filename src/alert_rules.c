@@ -0,0 +1,301 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "alert_rules.h"
+
+enum {
+    /*Longest accepted line*/
+    ALERT_RULES_LINE_SIZE = 512,
+};
+
+typedef struct AlertState {
+    uint32_t streak;
+    bool firing;
+} AlertState;
+
+struct AlertRules {
+    size_t number_of_cores;
+    size_t capacity;
+    size_t count;
+    /*Number of states of single rule, enough for any scope*/
+    size_t stride;
+    /*Memory belongs to an arena and is not freed by alert_rules_delete*/
+    bool arena_owned;
+    /*capacity * stride states behind the rules, each rule uses its part according to scope*/
+    AlertState* states;
+    AlertRule rules[]; /*FAM*/
+};
+
+/**
+ * @brief Advance state of single rule instance with the value
+ * @return true iff the state changed
+ */
+static inline bool state_update(AlertState* state, const AlertRule* rule, double value);
+
+static inline bool parse_double(const char* token, double* value);
+
+/**
+ * @brief Evaluate rule of socket or node scope
+ */
+static inline size_t groups_evaluate(AlertState* states, const AlertRule* rule, size_t rule_index,
+                                     const SnapshotGroupUsage* groups, size_t number_of_groups,
+                                     AlertEvent* events, size_t stored, size_t events_size);
+
+/**
+ * @return number of states of single rule
+ */
+static inline size_t rule_stride(size_t number_of_cores);
+
+/**
+ * @brief Lay out rule set in zeroed memory of alert_rules_footprint bytes
+ */
+static inline AlertRules* rules_initialize(void* memory, size_t number_of_cores, size_t capacity);
+
+AlertRules* alert_rules_new(const size_t number_of_cores, const size_t capacity) {
+    if (number_of_cores == 0 || capacity == 0) {
+        return NULL;
+    }
+
+    void* memory = calloc(1, alert_rules_footprint(number_of_cores, capacity));
+    if (memory == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    return rules_initialize(memory, number_of_cores, capacity);
+}
+
+AlertRules* alert_rules_new_in(Arena* const arena, const size_t number_of_cores, const size_t capacity) {
+    if (number_of_cores == 0 || capacity == 0) {
+        return NULL;
+    }
+
+    void* memory = arena_alloc(arena, alert_rules_footprint(number_of_cores, capacity));
+    if (memory == NULL) {
+        return NULL;
+    }
+    AlertRules* result = rules_initialize(memory, number_of_cores, capacity);
+    result->arena_owned = true;
+    return result;
+}
+
+size_t alert_rules_footprint(const size_t number_of_cores, const size_t capacity) {
+    return sizeof(AlertRules) + (sizeof(AlertRule) + sizeof(AlertState) * rule_stride(number_of_cores)) * capacity;
+}
+
+void alert_rules_delete(AlertRules* const rules) {
+    if (rules != NULL && rules->arena_owned) {
+        return;
+    }
+    free(rules);
+}
+
+bool alert_rules_add(AlertRules* const restrict rules, const AlertRule* const restrict rule) {
+    if (rules->count == rules->capacity) {
+        return false;
+    }
+    rules->rules[rules->count++] = *rule;
+    return true;
+}
+
+const AlertRule* alert_rules_get(const AlertRules* const rules, const size_t index) {
+    return index < rules->count ? &rules->rules[index] : NULL;
+}
+
+size_t alert_rules_count(const AlertRules* const rules) {
+    return rules->count;
+}
+
+bool alert_rules_parse_line(const char line[const restrict static 1], AlertRule* const restrict rule) {
+    char copy[ALERT_RULES_LINE_SIZE];
+    char* save = NULL;
+    if (strlen(line) >= sizeof(copy)) {
+        return false;
+    }
+    strcpy(copy, line);
+    *rule = (AlertRule) {.duration = 1};
+
+    const char* name = strtok_r(copy, " \t\n", &save);
+    const char* scope = strtok_r(NULL, " \t\n", &save);
+    const char* comparison = strtok_r(NULL, " \t\n", &save);
+    const char* threshold = strtok_r(NULL, " \t\n", &save);
+    if (threshold == NULL || strlen(name) >= sizeof(rule->name)) {
+        return false;
+    }
+    strcpy(rule->name, name);
+
+    if (strcmp(scope, "core") == 0) {
+        rule->scope = ALERT_SCOPE_CORE;
+    } else if (strcmp(scope, "machine") == 0) {
+        rule->scope = ALERT_SCOPE_MACHINE;
+    } else if (strcmp(scope, "socket") == 0) {
+        rule->scope = ALERT_SCOPE_SOCKET;
+    } else if (strcmp(scope, "node") == 0) {
+        rule->scope = ALERT_SCOPE_NODE;
+    } else {
+        return false;
+    }
+    if (strcmp(comparison, "above") == 0) {
+        rule->comparison = ALERT_COMPARISON_ABOVE;
+    } else if (strcmp(comparison, "below") == 0) {
+        rule->comparison = ALERT_COMPARISON_BELOW;
+    } else {
+        return false;
+    }
+    if (!parse_double(threshold, &rule->threshold)) {
+        return false;
+    }
+    rule->clear_threshold = rule->threshold;
+
+    const char* keyword = NULL;
+    while ((keyword = strtok_r(NULL, " \t\n", &save)) != NULL) {
+        const char* value = strtok_r(NULL, " \t\n", &save);
+        if (value == NULL) {
+            return false;
+        }
+        if (strcmp(keyword, "for") == 0) {
+            char* end = NULL;
+            const unsigned long duration = strtoul(value, &end, 10);
+            if (*end != '\0' || duration == 0 || duration > UINT32_MAX) {
+                return false;
+            }
+            rule->duration = (uint32_t) duration;
+        } else if (strcmp(keyword, "clear") == 0) {
+            if (!parse_double(value, &rule->clear_threshold)) {
+                return false;
+            }
+        } else if (strcmp(keyword, "action") == 0 && strlen(value) < sizeof(rule->action)) {
+            strcpy(rule->action, value);
+        } else {
+            return false;
+        }
+    }
+
+    /*Hysteresis band must not be inverted*/
+    if (rule->comparison == ALERT_COMPARISON_ABOVE) {
+        return rule->clear_threshold <= rule->threshold;
+    }
+    return rule->clear_threshold >= rule->threshold;
+}
+
+size_t alert_rules_evaluate(AlertRules* const restrict rules, const Snapshot* const restrict snapshot,
+                            AlertEvent* const restrict events, const size_t events_size) {
+    const size_t number_of_cores = snapshot->number_of_cores < rules->number_of_cores ? snapshot->number_of_cores : rules->number_of_cores;
+    size_t stored = 0;
+
+    /*Machine value is computed once for all rules*/
+    double machine = 0.0;
+    size_t valid = 0;
+    for (size_t core = 0; core < number_of_cores; core++) {
+        if (!isnan(snapshot->core_usage[core])) {
+            machine += snapshot->core_usage[core];
+            valid++;
+        }
+    }
+    machine = valid > 0 ? machine / (double) valid : NAN;
+
+    for (size_t i = 0; i < rules->count; i++) {
+        const AlertRule* rule = &rules->rules[i];
+        AlertState* states = &rules->states[i * rules->stride];
+
+        switch (rule->scope) {
+            case ALERT_SCOPE_MACHINE:
+                if (state_update(&states[0], rule, machine) && stored < events_size) {
+                    events[stored++] = (AlertEvent) {.rule = i, .instance = SIZE_MAX, .value = machine, .fired = states[0].firing};
+                }
+                break;
+            case ALERT_SCOPE_SOCKET:
+                stored = groups_evaluate(states, rule, i, snapshot->package_usage, snapshot->number_of_packages,
+                                         events, stored, events_size);
+                break;
+            case ALERT_SCOPE_NODE:
+                stored = groups_evaluate(states, rule, i, snapshot->node_usage, snapshot->number_of_nodes,
+                                         events, stored, events_size);
+                break;
+            default:
+                for (size_t core = 0; core < number_of_cores; core++) {
+                    const double value = snapshot->core_usage[core];
+                    if (state_update(&states[core], rule, value) && stored < events_size) {
+                        events[stored++] = (AlertEvent) {.rule = i, .instance = core, .value = value, .fired = states[core].firing};
+                    }
+                }
+                break;
+        }
+    }
+    return stored;
+}
+
+int alert_rules_format_event(const AlertRules* const restrict rules, const AlertEvent* const restrict event,
+                             char* const restrict dest, const size_t dest_size) {
+    const AlertRule* rule = &rules->rules[event->rule];
+    static const char* scope_str[] = {"core", "machine", "socket", "node"};
+    const char* transition = event->fired ? "fired" : "cleared";
+
+    if (event->instance == SIZE_MAX) {
+        return snprintf(dest, dest_size, "alert %s %s machine value %.2F\n", rule->name, transition, event->value);
+    }
+    return snprintf(dest, dest_size, "alert %s %s %s %zu value %.2F\n", rule->name, transition, scope_str[rule->scope],
+                    event->instance, event->value);
+}
+
+static inline bool state_update(AlertState* const state, const AlertRule* const rule, const double value) {
+    if (isnan(value)) {
+        state->streak = 0;
+        return false;
+    }
+    const bool above = rule->comparison == ALERT_COMPARISON_ABOVE;
+
+    if (state->firing) {
+        if (above ? value < rule->clear_threshold : value > rule->clear_threshold) {
+            state->firing = false;
+            state->streak = 0;
+            return true;
+        }
+        return false;
+    }
+
+    if (above ? value > rule->threshold : value < rule->threshold) {
+        state->streak++;
+    } else {
+        state->streak = 0;
+    }
+    if (state->streak >= rule->duration) {
+        state->firing = true;
+        return true;
+    }
+    return false;
+}
+
+static inline size_t groups_evaluate(AlertState* const states, const AlertRule* const rule, const size_t rule_index,
+                                     const SnapshotGroupUsage* const groups, const size_t number_of_groups,
+                                     AlertEvent* const events, size_t stored, const size_t events_size) {
+    /*State is kept per dense index, it follows the group as long as topology does not change*/
+    for (size_t i = 0; i < number_of_groups; i++) {
+        if (state_update(&states[i], rule, groups[i].usage) && stored < events_size) {
+            events[stored++] = (AlertEvent) {.rule = rule_index, .instance = groups[i].id, .value = groups[i].usage,
+                                             .fired = states[i].firing};
+        }
+    }
+    return stored;
+}
+
+static inline bool parse_double(const char* const token, double* const value) {
+    char* end = NULL;
+    *value = strtod(token, &end);
+    return end != token && *end == '\0' && !isnan(*value);
+}
+
+static inline size_t rule_stride(const size_t number_of_cores) {
+    const size_t stride = number_of_cores > SNAPSHOT_MAX_PACKAGES ? number_of_cores : SNAPSHOT_MAX_PACKAGES;
+    return stride > SNAPSHOT_MAX_NODES ? stride : SNAPSHOT_MAX_NODES;
+}
+
+static inline AlertRules* rules_initialize(void* const memory, const size_t number_of_cores, const size_t capacity) {
+    AlertRules* result = memory;
+    result->states = (AlertState*) &result->rules[capacity];
+    result->number_of_cores = number_of_cores;
+    result->capacity = capacity;
+    result->stride = rule_stride(number_of_cores);
+    return result;
+}
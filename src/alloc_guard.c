@@ -0,0 +1,107 @@
+#include "alloc_guard.h"
+
+#ifdef ALLOC_GUARD
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <malloc.h>
+
+/*Entry points of the glibc allocator, exported for replacements of malloc*/
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* pointer, size_t size);
+extern void __libc_free(void* pointer);
+extern void* __libc_memalign(size_t alignment, size_t size);
+
+static _Atomic uint64_t allocations;
+static _Atomic uint64_t allocated_bytes;
+static atomic_bool sealed;
+
+/**
+ * @brief Count allocation of size bytes, abort if it happens after seal
+ */
+static inline void allocation_count(size_t size);
+
+void* malloc(const size_t size) {
+    allocation_count(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(const size_t count, const size_t size) {
+    allocation_count(count * size);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* const pointer, const size_t size) {
+    /*Shrinking to zero frees*/
+    if (size != 0) {
+        allocation_count(size);
+    }
+    return __libc_realloc(pointer, size);
+}
+
+void free(void* const pointer) {
+    __libc_free(pointer);
+}
+
+void* memalign(const size_t alignment, const size_t size) {
+    allocation_count(size);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(const size_t alignment, const size_t size) {
+    allocation_count(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** const result, const size_t alignment, const size_t size) {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    allocation_count(size);
+    void* pointer = __libc_memalign(alignment, size);
+    if (pointer == NULL) {
+        return ENOMEM;
+    }
+    *result = pointer;
+    return 0;
+}
+
+void alloc_guard_seal() {
+    atomic_store_explicit(&sealed, true, memory_order_release);
+}
+
+AllocGuardStats alloc_guard_stats() {
+    return (AllocGuardStats) {
+        .enabled = true,
+        .allocations = atomic_load_explicit(&allocations, memory_order_relaxed),
+        .bytes = atomic_load_explicit(&allocated_bytes, memory_order_relaxed),
+    };
+}
+
+static inline void allocation_count(const size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&allocated_bytes, size, memory_order_relaxed);
+    if (atomic_load_explicit(&sealed, memory_order_acquire)) {
+        /*stdio could allocate again, the message is formatted on the stack and written directly*/
+        char message[96];
+        const int length = snprintf(message, sizeof(message), "Allocation of %zu bytes after initialization\n", size);
+        if (length > 0 && write(STDERR_FILENO, message, (size_t) length) < 0) {
+            errno = 0;
+        }
+        abort();
+    }
+}
+
+#else
+
+void alloc_guard_seal() {
+}
+
+AllocGuardStats alloc_guard_stats() {
+    return (AllocGuardStats) {.enabled = false, .allocations = 0, .bytes = 0};
+}
+
+#endif
@@ -0,0 +1,73 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include "arena.h"
+
+struct Arena {
+    size_t size;
+    size_t used;
+    bool locked;
+    /*Objects follow the header at the next multiple of ARENA_ALIGNMENT*/
+};
+
+Arena* arena_new(const size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+    const size_t total = arena_footprint(sizeof(Arena)) + arena_footprint(size);
+    void* region = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (region == MAP_FAILED) {
+        errno = 0;
+        return NULL;
+    }
+    Arena* result = region;
+    result->size = total;
+    result->used = arena_footprint(sizeof(Arena));
+    result->locked = false;
+    return result;
+}
+
+void arena_delete(Arena* const arena) {
+    if (arena == NULL) {
+        return;
+    }
+    if (arena->locked) {
+        munlock(arena, arena->size);
+    }
+    munmap(arena, arena->size);
+}
+
+size_t arena_footprint(const size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+void* arena_alloc(Arena* const arena, const size_t size) {
+    const size_t footprint = arena_footprint(size);
+    if (size == 0 || footprint < size || footprint > arena->size - arena->used) {
+        return NULL;
+    }
+    void* result = (uint8_t*) arena + arena->used;
+    arena->used += footprint;
+    return result;
+}
+
+bool arena_lock(Arena* const arena) {
+    if (!arena->locked && mlock(arena, arena->size) != 0) {
+        errno = 0;
+        return false;
+    }
+    arena->locked = true;
+    return true;
+}
+
+size_t arena_size(const Arena* const arena) {
+    return arena->size;
+}
+
+size_t arena_used(const Arena* const arena) {
+    return arena->used;
+}
+
+bool arena_locked(const Arena* const arena) {
+    return arena->locked;
+}
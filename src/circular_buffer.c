@@ -1,18 +1,53 @@
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "circular_buffer.h"
 
+#ifdef PIPELINE_STATS
+#include <stdatomic.h>
+
+/*Only the owner of the buffer modifies counters, plain load and store is enough and cheaper than atomic add*/
+#define STATS_ADD(counter, value) \
+    atomic_store_explicit(&(counter), atomic_load_explicit(&(counter), memory_order_relaxed) + (value), memory_order_relaxed)
+#define STATS_MAX(counter, value) \
+    if ((value) > atomic_load_explicit(&(counter), memory_order_relaxed)) { \
+        atomic_store_explicit(&(counter), (value), memory_order_relaxed); \
+    }
+#else
+#define STATS_ADD(counter, value)
+#define STATS_MAX(counter, value)
+#endif
+
 struct CircularBuffer {
     size_t read_index;
     size_t write_index;
     size_t element_size;
     size_t buffer_max_size;
     size_t num_of_elements;
-    
-    uint8_t buffer[]; /*FAM*/
+    /*Memory belongs to an arena and is not freed by circular_buffer_delete*/
+    bool arena_owned;
+    /*Size of the whole mapping of a mirrored buffer, header included, 0 if the buffer is not mirrored*/
+    size_t mapping_size;
+    /*Elements follow the header, or the header page of a mirrored buffer*/
+    uint8_t* buffer;
+#ifdef PIPELINE_STATS
+    _Atomic size_t high_water_mark;
+    _Atomic uint64_t inserts;
+    _Atomic uint64_t removals;
+    _Atomic uint64_t full_events;
+    _Atomic uint64_t empty_events;
+#endif
 };
 
+/**
+ * @brief Map memory of size bytes twice back to back after header_size bytes of anonymous memory
+ * @return start of the mapping or NULL
+ */
+static uint8_t* mirror_map(size_t header_size, size_t size);
+
 CircularBuffer* circular_buffer_new(size_t buffer_size, size_t element_size) {
     if (buffer_size == 0 || element_size == 0) {
         return NULL;
@@ -26,13 +61,69 @@ CircularBuffer* circular_buffer_new(size_t buffer_size, size_t element_size) {
         return NULL;
     }
 
+    result->buffer = (uint8_t*) (result + 1);
     result->buffer_max_size = buffer_size;
     result->element_size = element_size;
 
     return result;
 }
 
+CircularBuffer* circular_buffer_new_in(Arena* const arena, const size_t buffer_size, const size_t element_size) {
+    if (buffer_size == 0 || element_size == 0) {
+        return NULL;
+    }
+
+    CircularBuffer* result = arena_alloc(arena, circular_buffer_footprint(buffer_size, element_size));
+    if (result == NULL) {
+        return NULL;
+    }
+
+    result->buffer = (uint8_t*) (result + 1);
+    result->buffer_max_size = buffer_size;
+    result->element_size = element_size;
+    result->arena_owned = true;
+
+    return result;
+}
+
+CircularBuffer* circular_buffer_new_mirrored(const size_t buffer_size, const size_t element_size) {
+    const long page_size = sysconf(_SC_PAGESIZE);
+    if (buffer_size == 0 || element_size == 0 || page_size <= 0 || buffer_size > SIZE_MAX / 2 / element_size) {
+        return NULL;
+    }
+    const size_t page = (size_t) page_size;
+    const size_t size = (buffer_size * element_size + page - 1) / page * page;
+    if (size % element_size != 0) {
+        return NULL;
+    }
+    const size_t header_size = (sizeof(CircularBuffer) + page - 1) / page * page;
+
+    uint8_t* mapping = mirror_map(header_size, size);
+    if (mapping == NULL) {
+        return NULL;
+    }
+    /*Anonymous mapping is zeroed*/
+    CircularBuffer* result = (CircularBuffer*) mapping;
+    result->buffer = mapping + header_size;
+    result->buffer_max_size = size / element_size;
+    result->element_size = element_size;
+    result->mapping_size = header_size + 2 * size;
+
+    return result;
+}
+
+size_t circular_buffer_footprint(const size_t buffer_size, const size_t element_size) {
+    return sizeof(CircularBuffer) + buffer_size * element_size;
+}
+
 void circular_buffer_delete(CircularBuffer* const buffer) {
+    if (buffer != NULL && buffer->arena_owned) {
+        return;
+    }
+    if (buffer != NULL && buffer->mapping_size != 0) {
+        munmap(buffer, buffer->mapping_size);
+        return;
+    }
     free(buffer); 
 }
 
@@ -45,8 +136,11 @@ int circular_buffer_insert_single(CircularBuffer* const restrict buffer, const v
         buffer->num_of_elements++;
         buffer->write_index++;
         buffer->write_index %= buffer->buffer_max_size;
+        STATS_ADD(buffer->inserts, 1);
+        STATS_MAX(buffer->high_water_mark, buffer->num_of_elements);
         return 1;
     }
+    STATS_ADD(buffer->full_events, 1);
     return 0;
 }
 
@@ -55,6 +149,7 @@ int circular_buffer_remove_single(CircularBuffer* const restrict buffer, void* c
         return NULL_PTR_ERROR;
     }
     else if (buffer->num_of_elements == 0) {
+        STATS_ADD(buffer->empty_events, 1);
         return 0;
     }
     else {
@@ -62,10 +157,50 @@ int circular_buffer_remove_single(CircularBuffer* const restrict buffer, void* c
         buffer->num_of_elements--;
         buffer->read_index++;
         buffer->read_index %= buffer->buffer_max_size;
+        STATS_ADD(buffer->removals, 1);
         return 1;
     }
 }
 
+void* circular_buffer_peek_span(CircularBuffer* const restrict buffer, size_t* const restrict count) {
+    *count = buffer->num_of_elements;
+    if (buffer->mapping_size == 0 && buffer->read_index + *count > buffer->buffer_max_size) {
+        *count = buffer->buffer_max_size - buffer->read_index;
+    }
+    if (*count == 0) {
+        STATS_ADD(buffer->empty_events, 1);
+    }
+    return &buffer->buffer[buffer->read_index * buffer->element_size];
+}
+
+void circular_buffer_consume(CircularBuffer* const buffer, const size_t count) {
+    buffer->num_of_elements -= count;
+    buffer->read_index = (buffer->read_index + count) % buffer->buffer_max_size;
+    STATS_ADD(buffer->removals, count);
+}
+
+void* circular_buffer_reserve_span(CircularBuffer* const restrict buffer, size_t* const restrict count) {
+    *count = buffer->buffer_max_size - buffer->num_of_elements;
+    if (buffer->mapping_size == 0 && buffer->write_index + *count > buffer->buffer_max_size) {
+        *count = buffer->buffer_max_size - buffer->write_index;
+    }
+    if (*count == 0) {
+        STATS_ADD(buffer->full_events, 1);
+    }
+    return &buffer->buffer[buffer->write_index * buffer->element_size];
+}
+
+void circular_buffer_commit(CircularBuffer* const buffer, const size_t count) {
+    buffer->num_of_elements += count;
+    buffer->write_index = (buffer->write_index + count) % buffer->buffer_max_size;
+    STATS_ADD(buffer->inserts, count);
+    STATS_MAX(buffer->high_water_mark, buffer->num_of_elements);
+}
+
+bool circular_buffer_mirrored(const CircularBuffer* const c_b) {
+    return c_b->mapping_size != 0;
+}
+
 size_t circular_buffer_read_available(const CircularBuffer* const c_b) {
     return c_b->num_of_elements;
 }
@@ -74,3 +209,49 @@ size_t circular_buffer_write_available(const CircularBuffer* const c_b) {
     return c_b->buffer_max_size - c_b->num_of_elements;
 }
 
+bool circular_buffer_stats(const CircularBuffer* const restrict c_b, CircularBufferStats* const restrict dest) {
+    *dest = (CircularBufferStats) {.capacity = c_b->buffer_max_size};
+#ifdef PIPELINE_STATS
+    dest->high_water_mark = atomic_load_explicit(&c_b->high_water_mark, memory_order_relaxed);
+    dest->inserts = atomic_load_explicit(&c_b->inserts, memory_order_relaxed);
+    dest->removals = atomic_load_explicit(&c_b->removals, memory_order_relaxed);
+    dest->full_events = atomic_load_explicit(&c_b->full_events, memory_order_relaxed);
+    dest->empty_events = atomic_load_explicit(&c_b->empty_events, memory_order_relaxed);
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+static uint8_t* mirror_map(const size_t header_size, const size_t size) {
+    const int fd = memfd_create("circular_buffer", MFD_CLOEXEC);
+    if (fd == -1) {
+        errno = 0;
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t) size) != 0) {
+        close(fd);
+        errno = 0;
+        return NULL;
+    }
+    /*Reserve the whole range first, both views of the memfd replace its tail*/
+    uint8_t* mapping = mmap(NULL, header_size + 2 * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        errno = 0;
+        return NULL;
+    }
+    for (size_t view = 0; view < 2; view++) {
+        if (mmap(mapping + header_size + view * size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED | MAP_POPULATE,
+                 fd, 0) == MAP_FAILED) {
+            munmap(mapping, header_size + 2 * size);
+            close(fd);
+            errno = 0;
+            return NULL;
+        }
+    }
+    /*Mappings keep the memory alive*/
+    close(fd);
+    return mapping;
+}
\ No newline at end of file
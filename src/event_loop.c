@@ -0,0 +1,425 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include "event_loop.h"
+#include "thread_parser.h"
+#include "thread_logger.h"
+#include "snapshot_latency.h"
+#include "alloc_guard.h"
+
+enum {
+    /*Default size of the read buffer, /proc/stat of 1024 cpus has about 150 kB*/
+    EVENT_LOOP_READ_SIZE = 16384,
+    EVENT_LOOP_MAX_EVENTS = 2,
+    /*Free logger slots kept while parsing a batch of lines, a line logs at most one warning*/
+    EVENT_LOOP_LOG_RESERVE = 8,
+    /*Longest prefixed line of pressure file*/
+    EVENT_LOOP_PRESSURE_LINE_SIZE = 256,
+};
+
+typedef struct EventLoopContext {
+    const EventLoopArguments* arguments;
+    ThreadParserState* parser_state;
+    PCPGuard* logger_guard;
+    CircularBuffer* logger_buffer;
+    StageOverhead* stage_overhead;
+    /*CPU time of the thread at the last accounting to stage_overhead*/
+    uint64_t cpu_mark_ns;
+    /*The next tick is marked as the baseline*/
+    bool baseline;
+    /*Interval of the timer, changed by adaptive_period*/
+    uint64_t period_ns;
+    size_t read_size;
+    char read_buffer[];
+} EventLoopContext;
+
+/**
+ * @brief Read every source once and process the resulting snapshot
+ */
+static void tick(EventLoopContext* context);
+
+/**
+ * @brief Parse complete lines of span in place, run printer sinks on completed snapshot and flush logs
+ * once after the batch (and whenever the logger buffer is about to fill)
+ * @return number of consumed characters, i.e. up to and including the last newline
+ */
+static size_t feed(EventLoopContext* context, char* span, size_t length);
+
+/**
+ * @brief Feed read_buffer holding count characters and move the partial last line to its beginning
+ * @return number of characters of the partial line, 0 if it filled the whole buffer and was dropped
+ */
+static size_t feed_read_buffer(EventLoopContext* context, size_t count);
+
+/**
+ * @brief Feed content of replay record, copied in chunks to read_buffer
+ */
+static void feed_content(EventLoopContext* context, const char* content, size_t length);
+
+/**
+ * @brief Feed content of pressure file, every line prefixed with "psi <resource> " as the reader does
+ */
+static void feed_pressure(EventLoopContext* context, FILE* pressure_file, EPsiResource resource);
+
+static void feed_frequency(EventLoopContext* context, FrequencySampler* frequency_sampler);
+
+/**
+ * @brief Load the next record of replay and arm timer_fd to its recorded delay (1 ns if fast)
+ * @return false at the end of the recording or on timer error
+ */
+static bool replay_schedule(EventLoopContext* context, int timer_fd);
+
+/**
+ * @brief Write the trace to its file and log the result
+ */
+static void trace_dump_request(EventLoopContext* context);
+
+/**
+ * @brief Feed whole content of file read from offset 0 with pread, record chunks if recorder is set.
+ * A file that fits into the read buffer is taken by a single pread, a writer rewriting it in place
+ * then races only that read instead of every gap between chunks
+ * @return false on read error
+ */
+static bool feed_file(EventLoopContext* context, FILE* file);
+
+size_t event_loop_footprint(const size_t read_size) {
+    return arena_footprint(sizeof(EventLoopContext) + (read_size != 0 ? read_size : EVENT_LOOP_READ_SIZE))
+           + arena_footprint(thread_parser_state_footprint());
+}
+
+bool event_loop_run(const EventLoopArguments* const arguments) {
+    const size_t read_size = arguments->read_size != 0 ? arguments->read_size : EVENT_LOOP_READ_SIZE;
+    EventLoopContext* context = arguments->arena != NULL ? arena_alloc(arguments->arena, sizeof(*context) + read_size)
+                                                         : malloc(sizeof(*context) + read_size);
+    if (context == NULL) {
+        errno = 0;
+        return false;
+    }
+    context->arguments = arguments;
+    context->read_size = read_size;
+    context->logger_guard = arguments->printer_arguments->logger_buffer_guard;
+    context->logger_buffer = arguments->printer_arguments->logger_buffer;
+    context->stage_overhead = arguments->printer_arguments->stage_overhead;
+    stage_overhead_thread_attach(context->stage_overhead);
+    context->cpu_mark_ns = stage_overhead_thread_cpu_ns();
+    context->baseline = arguments->priming.tv_sec != 0 || arguments->priming.tv_nsec != 0;
+    context->parser_state = arguments->arena != NULL ? thread_parser_state_new_in(arguments->arena, arguments->topology)
+                                                     : thread_parser_state_new(arguments->topology);
+    if (context->parser_state == NULL) {
+        if (arguments->arena == NULL) {
+            free(context);
+        }
+        return false;
+    }
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    if (arguments->trace != NULL) {
+        sigaddset(&mask, SIGUSR1);
+        trace_thread_attach(arguments->trace, "event_loop");
+    }
+    const int signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+    const int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    bool result = signal_fd != -1 && timer_fd != -1 && epoll_fd != -1;
+
+    struct itimerspec timer = {
+        .it_interval = arguments->period,
+        /*The first tick fires immediately*/
+        .it_value = {.tv_sec = 0, .tv_nsec = 1},
+    };
+    if (timer.it_interval.tv_sec == 0 && timer.it_interval.tv_nsec == 0) {
+        timer.it_interval.tv_sec = 1;
+    }
+    if (arguments->adaptive_period != NULL) {
+        const uint64_t period_ns = adaptive_period_current_ns(arguments->adaptive_period);
+        timer.it_interval = (struct timespec) {.tv_sec = (time_t) (period_ns / 1000000000u), .tv_nsec = (long) (period_ns % 1000000000u)};
+    }
+    context->period_ns = (uint64_t) timer.it_interval.tv_sec * 1000000000u + (uint64_t) timer.it_interval.tv_nsec;
+    /*Replay arms the timer once per record*/
+    if (arguments->replay != NULL) {
+        timer.it_interval = (struct timespec) {.tv_sec = 0, .tv_nsec = 0};
+    }
+    struct epoll_event event = {.events = EPOLLIN};
+    if (result) {
+        event.data.fd = signal_fd;
+        result = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &event) == 0;
+    }
+    if (result) {
+        event.data.fd = timer_fd;
+        result = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event) == 0
+                 && (arguments->replay != NULL || timerfd_settime(timer_fd, 0, &timer, NULL) == 0);
+    }
+
+    bool running = result && (arguments->replay == NULL || replay_schedule(context, timer_fd));
+    if (running && arguments->seal_allocations) {
+        alloc_guard_seal();
+    }
+    while (running) {
+        struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+        const int ready = epoll_wait(epoll_fd, events, EVENT_LOOP_MAX_EVENTS, -1);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                errno = 0;
+                continue;
+            }
+            result = false;
+            break;
+        }
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.fd == signal_fd) {
+                struct signalfd_siginfo info;
+                if (read(signal_fd, &info, sizeof(info)) != (ssize_t) sizeof(info)) {
+                    continue;
+                }
+                if (info.ssi_signo == SIGUSR1) {
+                    trace_dump_request(context);
+                } else {
+                    running = false;
+                }
+                continue;
+            }
+            /*Missed expirations are not made up, the next tick covers the whole interval*/
+            uint64_t expirations;
+            if (read(timer_fd, &expirations, sizeof(expirations)) == (ssize_t) sizeof(expirations)) {
+                const bool baseline = context->baseline;
+                tick(context);
+                if (arguments->replay != NULL) {
+                    running = replay_schedule(context, timer_fd);
+                }
+                else if (baseline) {
+                    /*The first snapshot follows the baseline after priming, then the period applies*/
+                    timer.it_value = arguments->priming;
+                    result = timerfd_settime(timer_fd, 0, &timer, NULL) == 0;
+                    running = result;
+                }
+                else if (arguments->adaptive_period != NULL
+                         && adaptive_period_current_ns(arguments->adaptive_period) != context->period_ns) {
+                    context->period_ns = adaptive_period_current_ns(arguments->adaptive_period);
+                    timer.it_interval = (struct timespec) {.tv_sec = (time_t) (context->period_ns / 1000000000u),
+                                                           .tv_nsec = (long) (context->period_ns % 1000000000u)};
+                    timer.it_value = timer.it_interval;
+                    result = timerfd_settime(timer_fd, 0, &timer, NULL) == 0;
+                    running = result;
+                }
+            }
+        }
+    }
+
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
+    if (timer_fd != -1) {
+        close(timer_fd);
+    }
+    if (signal_fd != -1) {
+        close(signal_fd);
+    }
+    thread_logger_flush(context->logger_guard, context->logger_buffer, arguments->logger_output);
+    thread_parser_state_delete(context->parser_state);
+    if (arguments->arena == NULL) {
+        free(context);
+    }
+    return result;
+}
+
+static void tick(EventLoopContext* const context) {
+    const EventLoopArguments* arguments = context->arguments;
+
+    char line[32];
+    const uint64_t tick_ns = snapshot_latency_now_ns();
+    const int length = snapshot_latency_format_line(tick_ns, line, sizeof(line));
+    feed(context, line, (size_t) length);
+    if (context->baseline) {
+        char baseline[] = THREAD_PARSER_BASELINE_LINE "\n";
+        feed(context, baseline, sizeof(baseline) - 1);
+        context->baseline = false;
+    }
+
+    if (arguments->replay != NULL) {
+        size_t content_length = 0;
+        const char* content = stat_replay_data(arguments->replay, &content_length);
+        feed_content(context, content, content_length);
+    }
+    for (size_t i = 0; arguments->replay == NULL && i < PSI_RESOURCE_COUNT; i++) {
+        if (arguments->pressure_files[i] != NULL) {
+            feed_pressure(context, arguments->pressure_files[i], (EPsiResource) i);
+        }
+    }
+    if (arguments->replay == NULL && arguments->frequency_sampler != NULL) {
+        feed_frequency(context, arguments->frequency_sampler);
+    }
+    if (arguments->replay == NULL && !feed_file(context, arguments->input_file)) {
+        thread_logger_send_log(context->logger_guard, context->logger_buffer,
+                               "File error during read attempt\n", LOGGER_PAYLOAD_TYPE_ERROR);
+    }
+    if (arguments->recorder != NULL && !stat_recorder_commit(arguments->recorder, tick_ns)) {
+        thread_logger_send_log(context->logger_guard, context->logger_buffer,
+                               "Recording of tick failed\n", LOGGER_PAYLOAD_TYPE_WARNING);
+    }
+    StageOverhead* stage_overhead = context->stage_overhead;
+    if (stage_overhead != NULL) {
+        context->cpu_mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_READER, context->cpu_mark_ns, 1);
+    }
+    const size_t flushed = thread_logger_flush(context->logger_guard, context->logger_buffer, arguments->logger_output);
+    if (stage_overhead != NULL) {
+        context->cpu_mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_LOGGER, context->cpu_mark_ns, flushed);
+    }
+}
+
+static size_t feed(EventLoopContext* const context, char* const span, const size_t length) {
+    PCPGuard* logger_guard = context->logger_guard;
+    CircularBuffer* logger_buffer = context->logger_buffer;
+    FILE* logger_output = context->arguments->logger_output;
+    size_t consumed = 0;
+    char* line_end;
+    for (size_t scanned = 0; (line_end = memchr(span + scanned, '\n', length - scanned)) != NULL; scanned = consumed) {
+        *line_end = '\0';
+        const Snapshot* snapshot = thread_parser_state_feed_line(context->parser_state, span + consumed, logger_guard, logger_buffer);
+        consumed = (size_t) (line_end - span) + 1;
+        if (snapshot == NULL) {
+            /*Logging blocks on full buffer and nothing else empties it*/
+            if (circular_buffer_write_available(logger_buffer) < EVENT_LOOP_LOG_RESERVE) {
+                thread_logger_flush(logger_guard, logger_buffer, logger_output);
+            }
+            continue;
+        }
+        if (context->arguments->adaptive_period != NULL) {
+            adaptive_period_update(context->arguments->adaptive_period, snapshot, adaptive_period_process_cpu_ns());
+        }
+        StageOverhead* stage_overhead = context->stage_overhead;
+        if (stage_overhead != NULL) {
+            context->cpu_mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_READER, context->cpu_mark_ns, 0);
+        }
+        /*Sinks may log a payload per alert rule, they get the whole buffer*/
+        if (circular_buffer_read_available(logger_buffer) > 0) {
+            thread_logger_flush(logger_guard, logger_buffer, logger_output);
+        }
+        TRACE_BEGIN(TRACE_EVENT_PRINT);
+        thread_printer_handle_snapshot(context->arguments->printer_arguments, snapshot);
+        TRACE_END(TRACE_EVENT_PRINT);
+        if (stage_overhead != NULL) {
+            context->cpu_mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_PRINTER, context->cpu_mark_ns, 1);
+        }
+    }
+    if (circular_buffer_read_available(logger_buffer) > 0) {
+        thread_logger_flush(logger_guard, logger_buffer, logger_output);
+    }
+    return consumed;
+}
+
+static size_t feed_read_buffer(EventLoopContext* const context, const size_t count) {
+    const size_t consumed = feed(context, context->read_buffer, count);
+    const size_t pending = count - consumed;
+    if (pending == context->read_size) {
+        thread_logger_send_log(context->logger_guard, context->logger_buffer,
+                               "Event loop: Line does not fit into the read buffer\n", LOGGER_PAYLOAD_TYPE_WARNING);
+        return 0;
+    }
+    memmove(context->read_buffer, context->read_buffer + consumed, pending);
+    return pending;
+}
+
+static void feed_content(EventLoopContext* const context, const char* const content, const size_t length) {
+    size_t pending = 0;
+    for (size_t offset = 0; offset < length;) {
+        const size_t free_space = context->read_size - pending;
+        const size_t chunk = length - offset < free_space ? length - offset : free_space;
+        memcpy(context->read_buffer + pending, content + offset, chunk);
+        offset += chunk;
+        pending = feed_read_buffer(context, pending + chunk);
+    }
+}
+
+static void feed_pressure(EventLoopContext* const context, FILE* const pressure_file, const EPsiResource resource) {
+    /*Pressure files have a few short lines, the whole content fits into the read buffer*/
+    TRACE_BEGIN(TRACE_EVENT_READ);
+    const ssize_t length = pread(fileno(pressure_file), context->read_buffer, context->read_size, 0);
+    TRACE_END(TRACE_EVENT_READ);
+    if (length <= 0) {
+        return;
+    }
+    const char* line = context->read_buffer;
+    const char* end = context->read_buffer + length;
+    char prefixed[EVENT_LOOP_PRESSURE_LINE_SIZE];
+    while (line < end) {
+        const char* newline = memchr(line, '\n', (size_t) (end - line));
+        const char* line_end = newline == NULL ? end : newline;
+        const int prefixed_length = snprintf(prefixed, sizeof(prefixed), "psi %s %.*s\n", psi_parser_resource_to_str(resource),
+                                             (int) (line_end - line), line);
+        if (prefixed_length > 0 && (size_t) prefixed_length < sizeof(prefixed)) {
+            feed(context, prefixed, (size_t) prefixed_length);
+        }
+        line = line_end + 1;
+    }
+}
+
+static void feed_frequency(EventLoopContext* const context, FrequencySampler* const frequency_sampler) {
+    const uint32_t* frequency_khz = frequency_sampler_sample(frequency_sampler);
+    const size_t number_of_cpus = frequency_sampler_number_of_cpus(frequency_sampler);
+    char line[48];
+
+    for (size_t cpu = 0; cpu < number_of_cpus; cpu++) {
+        if (frequency_khz[cpu] == 0) {
+            continue;
+        }
+        const int length = snprintf(line, sizeof(line), "freq %zu %" PRIu32 "\n", cpu, frequency_khz[cpu]);
+        feed(context, line, (size_t) length);
+    }
+}
+
+static bool feed_file(EventLoopContext* const context, FILE* const file) {
+    const int fd = fileno(file);
+    off_t offset = 0;
+    size_t pending = 0;
+    while (true) {
+        TRACE_BEGIN(TRACE_EVENT_READ);
+        const ssize_t length = pread(fd, context->read_buffer + pending, context->read_size - pending, offset);
+        TRACE_END(TRACE_EVENT_READ);
+        if (length == -1) {
+            errno = 0;
+            return false;
+        }
+        if (length == 0) {
+            return true;
+        }
+        /*Parsing terminates lines in place, the chunk is recorded before*/
+        if (context->arguments->recorder != NULL) {
+            stat_recorder_add(context->arguments->recorder, context->read_buffer + pending, (size_t) length);
+        }
+        pending = feed_read_buffer(context, pending + (size_t) length);
+        offset += length;
+    }
+}
+
+static bool replay_schedule(EventLoopContext* const context, const int timer_fd) {
+    const EventLoopArguments* arguments = context->arguments;
+    if (!stat_replay_next(arguments->replay)) {
+        thread_logger_send_log(context->logger_guard, context->logger_buffer, "Replay finished\n", LOGGER_PAYLOAD_TYPE_INFO);
+        return false;
+    }
+    const uint64_t delay_ns = stat_replay_delay_ns(arguments->replay);
+    /*Zero it_value would disarm the timer*/
+    struct itimerspec timer = {.it_value = {.tv_sec = 0, .tv_nsec = 1}};
+    if (!arguments->replay_fast && delay_ns != 0) {
+        timer.it_value = (struct timespec) {.tv_sec = (time_t) (delay_ns / 1000000000u), .tv_nsec = (long) (delay_ns % 1000000000u)};
+    }
+    return timerfd_settime(timer_fd, 0, &timer, NULL) == 0;
+}
+
+static void trace_dump_request(EventLoopContext* const context) {
+    const EventLoopArguments* arguments = context->arguments;
+    if (trace_dump_file(arguments->trace, arguments->trace_file)) {
+        thread_logger_send_log(context->logger_guard, context->logger_buffer, "Trace written\n", LOGGER_PAYLOAD_TYPE_INFO);
+    } else {
+        thread_logger_send_log(context->logger_guard, context->logger_buffer, "Writing trace failed\n", LOGGER_PAYLOAD_TYPE_ERROR);
+    }
+    thread_logger_flush(context->logger_guard, context->logger_buffer, arguments->logger_output);
+}
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "fake_stat.h"
+
+/**
+ * @brief Generator of fake procfs tree for running the tracker with -d root.
+ * Usage: fake_proc <root> <cores> [pattern [period_ms [ticks]]]
+ * Creates root/stat and rewrites it in place every period_ms (default 1000) for ticks ticks
+ * (default 0, until killed). Patterns are described in fake_stat.h, default flat:50.
+ * The file is truncated once when opened and then rewritten by a single pwrite at offset 0 without truncation,
+ * it never shrinks as counters only grow. The rewrite is not atomic for readers: a read racing it may return
+ * a mix of two ticks (torn read), likelier the larger the file, i.e. at 1000+ cores. The tracker reads the file
+ * by a single read per tick, which keeps the window to that one read; a torn tick shows as one bogus sample.
+ */
+
+static inline bool parse_number(const char* text, uint64_t* result);
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 6) {
+        fprintf(stderr, "Usage: %s <root> <cores> [pattern [period_ms [ticks]]]\n"
+                        "  pattern is flat:<percent>, ramp, sine:<ticks> or random:<seed>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t number_of_cores = 0;
+    uint64_t period_ms = 1000;
+    uint64_t ticks = 0;
+    EFakeStatPattern pattern = FAKE_STAT_PATTERN_FLAT;
+    uint64_t parameter = 50;
+    if (!parse_number(argv[2], &number_of_cores) || number_of_cores == 0
+        || (argc > 4 && (!parse_number(argv[4], &period_ms) || period_ms == 0)) || (argc > 5 && !parse_number(argv[5], &ticks))) {
+        fprintf(stderr, "Invalid number\n");
+        return EXIT_FAILURE;
+    }
+    if (argc > 3 && !fake_stat_pattern_parse(argv[3], &pattern, &parameter)) {
+        fprintf(stderr, "Invalid pattern %s\n", argv[3]);
+        return EXIT_FAILURE;
+    }
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/stat", argv[1]);
+    if (mkdir(argv[1], 0755) != 0 && errno != EEXIST) {
+        perror("Cannot create root");
+        return EXIT_FAILURE;
+    }
+    errno = 0;
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    FakeStat* fake_stat = fake_stat_new((size_t) number_of_cores, pattern, parameter);
+    if (fd == -1 || fake_stat == NULL) {
+        perror("Cannot create stat");
+        if (fd != -1) {
+            close(fd);
+        }
+        fake_stat_delete(fake_stat);
+        return EXIT_FAILURE;
+    }
+
+    char* content = NULL;
+    size_t capacity = 0;
+    bool result = true;
+    const struct timespec period = {.tv_sec = (time_t) (period_ms / 1000), .tv_nsec = (long) (period_ms % 1000) * 1000000};
+    for (uint64_t tick = 0; ticks == 0 || tick < ticks; tick++) {
+        fake_stat_advance(fake_stat);
+        const int length = fake_stat_format(fake_stat, content, capacity);
+        if (length >= 0 && (size_t) length >= capacity) {
+            capacity = 2 * (size_t) length + 1;
+            free(content);
+            content = malloc(capacity);
+            if (content == NULL) {
+                perror("Memory error");
+                result = false;
+                break;
+            }
+            fake_stat_format(fake_stat, content, capacity);
+        }
+        if (length < 0 || pwrite(fd, content, (size_t) length, 0) != (ssize_t) length) {
+            perror("Write error");
+            result = false;
+            break;
+        }
+        nanosleep(&period, NULL);
+    }
+
+    free(content);
+    fake_stat_delete(fake_stat);
+    close(fd);
+    return result ? 0 : EXIT_FAILURE;
+}
+
+static inline bool parse_number(const char* const text, uint64_t* const result) {
+    char* end = NULL;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0') {
+        errno = 0;
+        return false;
+    }
+    *result = (uint64_t) value;
+    return true;
+}
@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "fake_stat.h"
+
+typedef struct FakeStatCore {
+    uint64_t user;
+    uint64_t system;
+    uint64_t idle;
+    unsigned load;
+} FakeStatCore;
+
+struct FakeStat {
+    size_t number_of_cores;
+    EFakeStatPattern pattern;
+    uint64_t parameter;
+    uint64_t tick;
+    /*xorshift64 state of the random pattern*/
+    uint64_t random_state;
+    FakeStatCore cores[];
+};
+
+/**
+ * @brief Load of core in percent in the current tick
+ */
+static unsigned load_compute(FakeStat* fake_stat, size_t core);
+
+FakeStat* fake_stat_new(const size_t number_of_cores, const EFakeStatPattern pattern, const uint64_t parameter) {
+    if (number_of_cores == 0 || (size_t) pattern >= FAKE_STAT_PATTERN_COUNT) {
+        return NULL;
+    }
+    FakeStat* result = calloc(1, sizeof(*result) + number_of_cores * sizeof(*result->cores));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    result->number_of_cores = number_of_cores;
+    result->pattern = pattern;
+    result->parameter = parameter;
+    /*Zero state would stay zero*/
+    result->random_state = parameter != 0 ? parameter : 1;
+    return result;
+}
+
+void fake_stat_delete(FakeStat* const fake_stat) {
+    free(fake_stat);
+}
+
+bool fake_stat_pattern_parse(const char spec[const restrict static 1], EFakeStatPattern* const restrict pattern,
+                             uint64_t* const restrict parameter) {
+    static const uint64_t defaults[FAKE_STAT_PATTERN_COUNT] = {50, 0, 60, 1};
+    const size_t name_length = strcspn(spec, ":");
+    size_t i = 0;
+    while (i < FAKE_STAT_PATTERN_COUNT) {
+        const char* name = fake_stat_pattern_to_str((EFakeStatPattern) i);
+        if (strlen(name) == name_length && strncmp(spec, name, name_length) == 0) {
+            break;
+        }
+        i++;
+    }
+    if (i == FAKE_STAT_PATTERN_COUNT) {
+        return false;
+    }
+    uint64_t value = defaults[i];
+    if (spec[name_length] == ':') {
+        const char* digits = spec + name_length + 1;
+        char* end = NULL;
+        errno = 0;
+        value = strtoull(digits, &end, 10);
+        if (*digits < '0' || *digits > '9' || *end != '\0' || errno != 0) {
+            errno = 0;
+            return false;
+        }
+    }
+    if ((i == FAKE_STAT_PATTERN_FLAT && value > 100) || (i == FAKE_STAT_PATTERN_SINE && value == 0)
+        || (i == FAKE_STAT_PATTERN_RAMP && spec[name_length] == ':')) {
+        return false;
+    }
+    *pattern = (EFakeStatPattern) i;
+    *parameter = value;
+    return true;
+}
+
+void fake_stat_advance(FakeStat* const fake_stat) {
+    for (size_t core = 0; core < fake_stat->number_of_cores; core++) {
+        FakeStatCore* counters = &fake_stat->cores[core];
+        const unsigned load = load_compute(fake_stat, core);
+        const uint64_t busy = (uint64_t) load * FAKE_STAT_JIFFIES_PER_TICK / 100;
+        /*Busy time is split 7:3 between user and system*/
+        const uint64_t user = busy * 7 / 10;
+        counters->user += user;
+        counters->system += busy - user;
+        counters->idle += FAKE_STAT_JIFFIES_PER_TICK - busy;
+        counters->load = load;
+    }
+    fake_stat->tick++;
+}
+
+unsigned fake_stat_load(const FakeStat* const fake_stat, const size_t core) {
+    return fake_stat->cores[core].load;
+}
+
+int fake_stat_format(const FakeStat* const restrict fake_stat, char* const restrict buffer, const size_t size) {
+    uint64_t user = 0;
+    uint64_t system = 0;
+    uint64_t idle = 0;
+    for (size_t core = 0; core < fake_stat->number_of_cores; core++) {
+        user += fake_stat->cores[core].user;
+        system += fake_stat->cores[core].system;
+        idle += fake_stat->cores[core].idle;
+    }
+    size_t length = 0;
+    int written = snprintf(buffer, size, "cpu  %" PRIu64 " 0 %" PRIu64 " %" PRIu64 " 0 0 0 0 0 0\n", user, system, idle);
+    for (size_t core = 0; core < fake_stat->number_of_cores && written >= 0; core++) {
+        length += (size_t) written;
+        const FakeStatCore* counters = &fake_stat->cores[core];
+        written = snprintf(length < size ? buffer + length : NULL, length < size ? size - length : 0,
+                           "cpu%zu %" PRIu64 " 0 %" PRIu64 " %" PRIu64 " 0 0 0 0 0 0\n", core, counters->user,
+                           counters->system, counters->idle);
+    }
+    if (written >= 0) {
+        length += (size_t) written;
+        written = snprintf(length < size ? buffer + length : NULL, length < size ? size - length : 0,
+                           "intr %" PRIu64 " 0 0\nctxt %" PRIu64 "\nbtime 1700000000\nprocesses %" PRIu64 "\n",
+                           fake_stat->tick * 100, fake_stat->tick * 1000, 1 + fake_stat->tick);
+    }
+    return written < 0 ? written : (int) (length + (size_t) written);
+}
+
+const char* fake_stat_pattern_to_str(const EFakeStatPattern pattern) {
+    static const char* const names[FAKE_STAT_PATTERN_COUNT] = {"flat", "ramp", "sine", "random"};
+    return (size_t) pattern < FAKE_STAT_PATTERN_COUNT ? names[pattern] : "unknown";
+}
+
+static unsigned load_compute(FakeStat* const fake_stat, const size_t core) {
+    const size_t number_of_cores = fake_stat->number_of_cores;
+    switch (fake_stat->pattern) {
+        case FAKE_STAT_PATTERN_FLAT:
+            return (unsigned) fake_stat->parameter;
+        case FAKE_STAT_PATTERN_RAMP:
+            return number_of_cores == 1 ? 100 : (unsigned) (core * 100 / (number_of_cores - 1));
+        case FAKE_STAT_PATTERN_SINE: {
+            const double phase = (double) (fake_stat->tick % fake_stat->parameter) / (double) fake_stat->parameter
+                                 + (double) core / (double) number_of_cores;
+            return (unsigned) lround(50.0 + 50.0 * sin(2.0 * M_PI * phase));
+        }
+        case FAKE_STAT_PATTERN_RANDOM: {
+            uint64_t state = fake_stat->random_state;
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            fake_stat->random_state = state;
+            return (unsigned) (state % 101);
+        }
+        default:
+            return 0;
+    }
+}
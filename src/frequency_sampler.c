@@ -0,0 +1,377 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include "frequency_sampler.h"
+#include "snapshot.h"
+
+enum {
+    FREQUENCY_SAMPLER_PATH_SIZE = 4096,
+    /*Longest accepted content of scaling_cur_freq file*/
+    FREQUENCY_SAMPLER_FILE_SIZE = 32,
+};
+
+/*Architectural performance counters, Intel SDM vol. 4. msr device maps register number to file offset,
+tests emulating the device with regular file move them apart*/
+#ifndef FREQUENCY_SAMPLER_MSR_MPERF
+#define FREQUENCY_SAMPLER_MSR_MPERF 0xE7
+#endif
+
+#ifndef FREQUENCY_SAMPLER_MSR_APERF
+#define FREQUENCY_SAMPLER_MSR_APERF 0xE8
+#endif
+
+typedef struct FrequencySamplerWorker {
+    FrequencySampler* sampler;
+    pthread_t thread;
+    size_t first_cpu;
+    size_t last_cpu;
+} FrequencySamplerWorker;
+
+struct FrequencySampler {
+    EFrequencySource source;
+    size_t number_of_cpus;
+    /*Running threads including the caller of frequency_sampler_sample*/
+    size_t number_of_threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t start_condition;
+    pthread_cond_t done_condition;
+    uint64_t generation;
+    size_t pending_workers;
+    bool stopping;
+    int* fds;
+    uint32_t* values;
+    /*msr source only*/
+    uint32_t* base_khz;
+    uint64_t* previous_aperf;
+    uint64_t* previous_mperf;
+    FrequencySamplerWorker workers[]; /*FAM*/
+};
+
+/**
+ * @brief Read frequency of cpus from [first_cpu, last_cpu) into sampler->values
+ */
+static void range_sample(FrequencySampler* sampler, size_t first_cpu, size_t last_cpu);
+
+/**
+ * @brief Worker loop: wait for next generation, read own range, report completion
+ */
+static void* worker_run(void* worker_arguments);
+
+/**
+ * @brief Split cpus evenly among threads and start all workers but the first one
+ */
+static void workers_start(FrequencySampler* sampler, size_t number_of_threads);
+
+/**
+ * @brief Find highest cpu number below sysfs root
+ * @return highest cpu number + 1, 0 if there is none
+ */
+static size_t cpus_count(const char* sysfs_root);
+
+/**
+ * @brief Open file of every cpu
+ * @return number of cpus with open file
+ */
+static size_t files_open(FrequencySampler* sampler, const char* sysfs_root, const char* dev_root);
+
+static bool fd_read_u32(int fd, uint32_t* value);
+
+static bool file_read_u32(const char* path, uint32_t* value);
+
+static bool entry_number(const char* name, size_t* number);
+
+FrequencySampler* frequency_sampler_new(const char sysfs_root[const static 1], const char dev_root[const static 1],
+                                        const EFrequencySource source, const size_t number_of_threads) {
+    const size_t number_of_cpus = cpus_count(sysfs_root);
+    if (number_of_threads == 0 || number_of_cpus == 0) {
+        return NULL;
+    }
+    const size_t threads = number_of_threads < number_of_cpus ? number_of_threads : number_of_cpus;
+
+    FrequencySampler* result = calloc(1, sizeof(*result) + sizeof(*result->workers) * threads);
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    result->source = source;
+    result->number_of_cpus = number_of_cpus;
+    result->number_of_threads = 1;
+    result->fds = malloc(sizeof(*result->fds) * number_of_cpus);
+    result->values = calloc(number_of_cpus, sizeof(*result->values));
+    result->base_khz = calloc(number_of_cpus, sizeof(*result->base_khz));
+    result->previous_aperf = calloc(number_of_cpus, sizeof(*result->previous_aperf));
+    result->previous_mperf = calloc(number_of_cpus, sizeof(*result->previous_mperf));
+    if (result->fds == NULL || result->values == NULL || result->base_khz == NULL
+        || result->previous_aperf == NULL || result->previous_mperf == NULL) {
+        errno = 0;
+        free(result->fds);
+        free(result->values);
+        free(result->base_khz);
+        free(result->previous_aperf);
+        free(result->previous_mperf);
+        free(result);
+        return NULL;
+    }
+    for (size_t cpu = 0; cpu < number_of_cpus; cpu++) {
+        result->fds[cpu] = -1;
+    }
+    pthread_mutex_init(&result->mutex, NULL);
+    pthread_cond_init(&result->start_condition, NULL);
+    pthread_cond_init(&result->done_condition, NULL);
+
+    if (files_open(result, sysfs_root, dev_root) == 0) {
+        frequency_sampler_delete(result);
+        return NULL;
+    }
+    workers_start(result, threads);
+    /*The first sample of msr source only sets reference values of counters*/
+    if (source == FREQUENCY_SOURCE_MSR) {
+        frequency_sampler_sample(result);
+        memset(result->values, 0, sizeof(*result->values) * number_of_cpus);
+    }
+    return result;
+}
+
+void frequency_sampler_delete(FrequencySampler* const sampler) {
+    if (sampler == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&sampler->mutex);
+    sampler->stopping = true;
+    pthread_cond_broadcast(&sampler->start_condition);
+    pthread_mutex_unlock(&sampler->mutex);
+    for (size_t i = 1; i < sampler->number_of_threads; i++) {
+        pthread_join(sampler->workers[i].thread, NULL);
+    }
+
+    for (size_t cpu = 0; cpu < sampler->number_of_cpus; cpu++) {
+        if (sampler->fds[cpu] != -1) {
+            close(sampler->fds[cpu]);
+        }
+    }
+    pthread_cond_destroy(&sampler->done_condition);
+    pthread_cond_destroy(&sampler->start_condition);
+    pthread_mutex_destroy(&sampler->mutex);
+    free(sampler->fds);
+    free(sampler->values);
+    free(sampler->base_khz);
+    free(sampler->previous_aperf);
+    free(sampler->previous_mperf);
+    free(sampler);
+}
+
+const uint32_t* frequency_sampler_sample(FrequencySampler* const sampler) {
+    if (sampler->number_of_threads > 1) {
+        pthread_mutex_lock(&sampler->mutex);
+        sampler->generation++;
+        sampler->pending_workers = sampler->number_of_threads - 1;
+        pthread_cond_broadcast(&sampler->start_condition);
+        pthread_mutex_unlock(&sampler->mutex);
+    }
+
+    range_sample(sampler, sampler->workers[0].first_cpu, sampler->workers[0].last_cpu);
+
+    if (sampler->number_of_threads > 1) {
+        pthread_mutex_lock(&sampler->mutex);
+        while (sampler->pending_workers > 0) {
+            pthread_cond_wait(&sampler->done_condition, &sampler->mutex);
+        }
+        pthread_mutex_unlock(&sampler->mutex);
+    }
+    return sampler->values;
+}
+
+size_t frequency_sampler_number_of_cpus(const FrequencySampler* const sampler) {
+    return sampler->number_of_cpus;
+}
+
+int frequency_sampler_parse_line(const char buffer[const restrict static 5], size_t* const restrict cpu,
+                                 uint32_t* const restrict khz) {
+    if (strncmp(buffer, "freq ", 5) != 0) {
+        return FREQUENCY_SAMPLER_DISCARD_LINE;
+    }
+    unsigned long cpu_number;
+    unsigned long frequency;
+    int consumed = 0;
+    if (sscanf(buffer, "freq %lu %lu%n", &cpu_number, &frequency, &consumed) != 2
+        || (buffer[consumed] != '\0' && buffer[consumed] != '\n') || frequency > UINT32_MAX) {
+        return FREQUENCY_SAMPLER_FAIL;
+    }
+    *cpu = (size_t) cpu_number;
+    *khz = (uint32_t) frequency;
+    return FREQUENCY_SAMPLER_SUCCESS;
+}
+
+static void range_sample(FrequencySampler* const sampler, const size_t first_cpu, const size_t last_cpu) {
+    for (size_t cpu = first_cpu; cpu < last_cpu; cpu++) {
+        const int fd = sampler->fds[cpu];
+        if (fd == -1) {
+            continue;
+        }
+        if (sampler->source == FREQUENCY_SOURCE_CPUFREQ) {
+            uint32_t khz = 0;
+            sampler->values[cpu] = fd_read_u32(fd, &khz) ? khz : 0;
+            continue;
+        }
+
+        uint64_t aperf;
+        uint64_t mperf;
+        if (pread(fd, &aperf, sizeof(aperf), FREQUENCY_SAMPLER_MSR_APERF) != (ssize_t) sizeof(aperf)
+            || pread(fd, &mperf, sizeof(mperf), FREQUENCY_SAMPLER_MSR_MPERF) != (ssize_t) sizeof(mperf)) {
+            sampler->values[cpu] = 0;
+            continue;
+        }
+        /*Unsigned subtraction is correct across a single wraparound*/
+        const uint64_t aperf_delta = aperf - sampler->previous_aperf[cpu];
+        const uint64_t mperf_delta = mperf - sampler->previous_mperf[cpu];
+        sampler->previous_aperf[cpu] = aperf;
+        sampler->previous_mperf[cpu] = mperf;
+        /*MPERF stands still while cpu idles, keep the last value then*/
+        if (mperf_delta != 0) {
+            sampler->values[cpu] = (uint32_t) ((double) sampler->base_khz[cpu] * (double) aperf_delta / (double) mperf_delta + 0.5);
+        }
+    }
+}
+
+static void* worker_run(void* const worker_arguments) {
+    FrequencySamplerWorker* worker = worker_arguments;
+    FrequencySampler* sampler = worker->sampler;
+    uint64_t seen_generation = 0;
+
+    pthread_mutex_lock(&sampler->mutex);
+    while (true) {
+        while (!sampler->stopping && sampler->generation == seen_generation) {
+            pthread_cond_wait(&sampler->start_condition, &sampler->mutex);
+        }
+        if (sampler->stopping) {
+            break;
+        }
+        seen_generation = sampler->generation;
+        pthread_mutex_unlock(&sampler->mutex);
+
+        range_sample(sampler, worker->first_cpu, worker->last_cpu);
+
+        pthread_mutex_lock(&sampler->mutex);
+        sampler->pending_workers--;
+        if (sampler->pending_workers == 0) {
+            pthread_cond_signal(&sampler->done_condition);
+        }
+    }
+    pthread_mutex_unlock(&sampler->mutex);
+    return NULL;
+}
+
+static void workers_start(FrequencySampler* const sampler, const size_t number_of_threads) {
+    const size_t number_of_cpus = sampler->number_of_cpus;
+    for (size_t i = 0; i < number_of_threads; i++) {
+        sampler->workers[i] = (FrequencySamplerWorker) {
+            .sampler = sampler,
+            .first_cpu = number_of_cpus * i / number_of_threads,
+            .last_cpu = number_of_cpus * (i + 1) / number_of_threads,
+        };
+    }
+    size_t started = 1;
+    for (size_t i = 1; i < number_of_threads; i++) {
+        if (pthread_create(&sampler->workers[started].thread, NULL, worker_run, &sampler->workers[started]) != 0) {
+            break;
+        }
+        started++;
+    }
+    if (started < number_of_threads) {
+        /*Ranges of missing workers are merged into the last started one*/
+        sampler->workers[started - 1].last_cpu = number_of_cpus;
+    }
+    pthread_mutex_lock(&sampler->mutex);
+    sampler->number_of_threads = started;
+    pthread_mutex_unlock(&sampler->mutex);
+}
+
+static size_t cpus_count(const char* const sysfs_root) {
+    char path[FREQUENCY_SAMPLER_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s/devices/system/cpu", sysfs_root);
+    DIR* directory = opendir(path);
+    if (directory == NULL) {
+        return 0;
+    }
+    size_t result = 0;
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL) {
+        size_t cpu;
+        if (entry_number(entry->d_name, &cpu) && cpu < SNAPSHOT_MAX_CORES && cpu + 1 > result) {
+            result = cpu + 1;
+        }
+    }
+    closedir(directory);
+    return result;
+}
+
+static size_t files_open(FrequencySampler* const sampler, const char* const sysfs_root, const char* const dev_root) {
+    char path[FREQUENCY_SAMPLER_PATH_SIZE];
+    size_t result = 0;
+    for (size_t cpu = 0; cpu < sampler->number_of_cpus; cpu++) {
+        if (sampler->source == FREQUENCY_SOURCE_CPUFREQ) {
+            snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%zu/cpufreq/scaling_cur_freq", sysfs_root, cpu);
+        } else {
+            /*Base frequency is the rate of MPERF, older drivers expose only cpuinfo_max_freq*/
+            snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%zu/cpufreq/base_frequency", sysfs_root, cpu);
+            if (!file_read_u32(path, &sampler->base_khz[cpu])) {
+                snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%zu/cpufreq/cpuinfo_max_freq", sysfs_root, cpu);
+                if (!file_read_u32(path, &sampler->base_khz[cpu])) {
+                    continue;
+                }
+            }
+            snprintf(path, sizeof(path), "%s/cpu/%zu/msr", dev_root, cpu);
+        }
+        sampler->fds[cpu] = open(path, O_RDONLY | O_CLOEXEC);
+        if (sampler->fds[cpu] != -1) {
+            result++;
+        }
+    }
+    errno = 0;
+    return result;
+}
+
+static bool fd_read_u32(const int fd, uint32_t* const value) {
+    char content[FREQUENCY_SAMPLER_FILE_SIZE];
+    /*Sysfs attributes are regenerated on every read from offset 0*/
+    const ssize_t length = pread(fd, content, sizeof(content) - 1, 0);
+    if (length <= 0) {
+        return false;
+    }
+    content[length] = '\0';
+    char* end = NULL;
+    const unsigned long result = strtoul(content, &end, 10);
+    if (end == content || result > UINT32_MAX) {
+        return false;
+    }
+    *value = (uint32_t) result;
+    return true;
+}
+
+static bool file_read_u32(const char* const path, uint32_t* const value) {
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    const bool result = fd_read_u32(fd, value);
+    close(fd);
+    return result;
+}
+
+static bool entry_number(const char* const name, size_t* const number) {
+    if (strncmp(name, "cpu", 3) != 0 || name[3] < '0' || name[3] > '9') {
+        return false;
+    }
+    char* end = NULL;
+    const unsigned long result = strtoul(name + 3, &end, 10);
+    if (*end != '\0') {
+        return false;
+    }
+    *number = (size_t) result;
+    return true;
+}
@@ -0,0 +1,391 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "history_codec.h"
+
+enum {
+    HISTORY_CODEC_MAGIC = 0x31424348, /*"HCB1"*/
+    /*Worst case: '1111' + 64 bit timestamp*/
+    TIMESTAMP_MAX_BITS = 4 + 64,
+    /*Worst case: '11' + 5 bit leading zeros + 6 bit length + 64 meaningful bits*/
+    VALUE_MAX_BITS = 2 + 5 + 6 + 64,
+    LEADING_ZEROS_MAX = 31,
+};
+
+/**
+ * @brief State of single series: the last value and the last window of meaningful bits
+ */
+typedef struct CoreState {
+    uint64_t previous;
+    unsigned leading;
+    unsigned trailing;
+} CoreState;
+
+struct HistoryCodecEncoder {
+    uint8_t* block;
+    size_t size_bits;
+    size_t position;
+    size_t number_of_samples;
+    uint64_t previous_timestamp;
+    int64_t previous_delta;
+    size_t number_of_cores;
+    CoreState cores[]; /*FAM*/
+};
+
+struct HistoryCodecDecoder {
+    const uint8_t* block;
+    size_t size_bits;
+    size_t position;
+    size_t number_of_samples;
+    size_t decoded_samples;
+    uint64_t previous_timestamp;
+    int64_t previous_delta;
+    size_t number_of_cores;
+    CoreState cores[]; /*FAM*/
+};
+
+/**
+ * @brief Write count (at most 64) least significant bits of value, most significant first
+ */
+static inline void write_bits(HistoryCodecEncoder* encoder, uint64_t value, unsigned count);
+
+/**
+ * @brief Read count (at most 64) bits. Caller is responsible for checking bounds
+ */
+static inline uint64_t read_bits(HistoryCodecDecoder* decoder, unsigned count);
+
+static inline void encode_timestamp(HistoryCodecEncoder* encoder, uint64_t timestamp_ns);
+
+static inline void encode_value(HistoryCodecEncoder* encoder, CoreState* state, double value);
+
+static inline bool decode_timestamp(HistoryCodecDecoder* decoder, uint64_t* timestamp_ns);
+
+static inline bool decode_value(HistoryCodecDecoder* decoder, CoreState* state, double* value);
+
+static inline void store_u32(uint8_t* destination, uint32_t value);
+
+static inline uint32_t load_u32(const uint8_t* source);
+
+static inline void reset_cores(CoreState* cores, size_t number_of_cores);
+
+HistoryCodecEncoder* history_codec_encoder_new(const size_t number_of_cores, uint8_t* const block, const size_t block_size) {
+    if (number_of_cores == 0 || number_of_cores > UINT32_MAX || block == NULL || block_size <= HISTORY_CODEC_HEADER_SIZE
+        || block_size > UINT32_MAX / 8) {
+        return NULL;
+    }
+
+    HistoryCodecEncoder* result = malloc(sizeof(*result) + sizeof(*result->cores) * number_of_cores);
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    result->number_of_cores = number_of_cores;
+    history_codec_encoder_reset(result, block, block_size);
+
+    return result;
+}
+
+void history_codec_encoder_delete(HistoryCodecEncoder* const encoder) {
+    free(encoder);
+}
+
+bool history_codec_encoder_reset(HistoryCodecEncoder* const restrict encoder, uint8_t* const restrict block, const size_t block_size) {
+    /*Length of the block in bits is stored in 32 bit field*/
+    if (encoder == NULL || block == NULL || block_size <= HISTORY_CODEC_HEADER_SIZE || block_size > UINT32_MAX / 8) {
+        return false;
+    }
+    /*write_bits only sets bits, the block has to be cleared*/
+    memset(block, 0, block_size);
+    encoder->block = block;
+    encoder->size_bits = block_size * 8;
+    encoder->position = HISTORY_CODEC_HEADER_SIZE * 8;
+    encoder->number_of_samples = 0;
+    encoder->previous_timestamp = 0;
+    encoder->previous_delta = 0;
+    reset_cores(encoder->cores, encoder->number_of_cores);
+    return true;
+}
+
+bool history_codec_encode(HistoryCodecEncoder* const restrict encoder, const uint64_t timestamp_ns, const double values[const restrict static 1]) {
+    const size_t sample_max_bits = TIMESTAMP_MAX_BITS + VALUE_MAX_BITS * encoder->number_of_cores;
+    if (encoder->size_bits - encoder->position < sample_max_bits || encoder->number_of_samples == UINT32_MAX) {
+        return false;
+    }
+
+    encode_timestamp(encoder, timestamp_ns);
+    for (size_t i = 0; i < encoder->number_of_cores; i++) {
+        encode_value(encoder, &encoder->cores[i], values[i]);
+    }
+    encoder->number_of_samples++;
+    return true;
+}
+
+size_t history_codec_encoder_finish(HistoryCodecEncoder* const encoder) {
+    store_u32(&encoder->block[0], HISTORY_CODEC_MAGIC);
+    store_u32(&encoder->block[4], (uint32_t) encoder->number_of_cores);
+    store_u32(&encoder->block[8], (uint32_t) encoder->number_of_samples);
+    store_u32(&encoder->block[12], (uint32_t) encoder->position);
+    return (encoder->position + 7) / 8;
+}
+
+size_t history_codec_encoder_number_of_samples(const HistoryCodecEncoder* const encoder) {
+    return encoder->number_of_samples;
+}
+
+size_t history_codec_sample_max_size(const size_t number_of_cores) {
+    return (TIMESTAMP_MAX_BITS + VALUE_MAX_BITS * number_of_cores + 7) / 8;
+}
+
+size_t history_codec_block_number_of_samples(const uint8_t* const block, const size_t block_size) {
+    if (block == NULL || block_size < HISTORY_CODEC_HEADER_SIZE || load_u32(&block[0]) != HISTORY_CODEC_MAGIC) {
+        return 0;
+    }
+    return load_u32(&block[8]);
+}
+
+HistoryCodecDecoder* history_codec_decoder_new(const uint8_t* const block, const size_t block_size) {
+    if (block == NULL || block_size < HISTORY_CODEC_HEADER_SIZE || load_u32(&block[0]) != HISTORY_CODEC_MAGIC) {
+        return NULL;
+    }
+    const size_t number_of_cores = load_u32(&block[4]);
+    const size_t size_bits = load_u32(&block[12]);
+    if (number_of_cores == 0 || size_bits > block_size * 8 || size_bits < HISTORY_CODEC_HEADER_SIZE * 8) {
+        return NULL;
+    }
+
+    HistoryCodecDecoder* result = malloc(sizeof(*result) + sizeof(*result->cores) * number_of_cores);
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    result->block = block;
+    result->size_bits = size_bits;
+    result->position = HISTORY_CODEC_HEADER_SIZE * 8;
+    result->number_of_samples = load_u32(&block[8]);
+    result->decoded_samples = 0;
+    result->previous_timestamp = 0;
+    result->previous_delta = 0;
+    result->number_of_cores = number_of_cores;
+    reset_cores(result->cores, number_of_cores);
+
+    return result;
+}
+
+void history_codec_decoder_delete(HistoryCodecDecoder* const decoder) {
+    free(decoder);
+}
+
+bool history_codec_decode(HistoryCodecDecoder* const restrict decoder, uint64_t* const restrict timestamp_ns, double values[const restrict static 1]) {
+    if (decoder->decoded_samples == decoder->number_of_samples) {
+        return false;
+    }
+    if (!decode_timestamp(decoder, timestamp_ns)) {
+        return false;
+    }
+    for (size_t i = 0; i < decoder->number_of_cores; i++) {
+        if (!decode_value(decoder, &decoder->cores[i], &values[i])) {
+            return false;
+        }
+    }
+    decoder->decoded_samples++;
+    return true;
+}
+
+size_t history_codec_decoder_number_of_cores(const HistoryCodecDecoder* const decoder) {
+    return decoder->number_of_cores;
+}
+
+static inline void encode_timestamp(HistoryCodecEncoder* const encoder, const uint64_t timestamp_ns) {
+    if (encoder->number_of_samples == 0) {
+        write_bits(encoder, timestamp_ns, 64);
+        encoder->previous_timestamp = timestamp_ns;
+        encoder->previous_delta = 0;
+        return;
+    }
+
+    const int64_t delta = (int64_t) (timestamp_ns - encoder->previous_timestamp);
+    const int64_t delta_of_delta = (int64_t) ((uint64_t) delta - (uint64_t) encoder->previous_delta);
+    /*zigzag: small negative and positive numbers map to small unsigned ones*/
+    const uint64_t zigzag = ((uint64_t) delta_of_delta << 1) ^ (uint64_t) (delta_of_delta >> 63);
+
+    if (zigzag == 0) {
+        write_bits(encoder, 0x0, 1);
+    }
+    else if (zigzag < (UINT64_C(1) << 12)) {
+        write_bits(encoder, 0x2, 2);
+        write_bits(encoder, zigzag, 12);
+    }
+    else if (zigzag < (UINT64_C(1) << 20)) {
+        write_bits(encoder, 0x6, 3);
+        write_bits(encoder, zigzag, 20);
+    }
+    else if (zigzag < (UINT64_C(1) << 32)) {
+        write_bits(encoder, 0xE, 4);
+        write_bits(encoder, zigzag, 32);
+    }
+    else {
+        write_bits(encoder, 0xF, 4);
+        write_bits(encoder, zigzag, 64);
+    }
+    encoder->previous_timestamp = timestamp_ns;
+    encoder->previous_delta = delta;
+}
+
+static inline void encode_value(HistoryCodecEncoder* const encoder, CoreState* const state, const double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (encoder->number_of_samples == 0) {
+        write_bits(encoder, bits, 64);
+        state->previous = bits;
+        return;
+    }
+
+    const uint64_t xor_value = bits ^ state->previous;
+    state->previous = bits;
+    if (xor_value == 0) {
+        write_bits(encoder, 0x0, 1);
+        return;
+    }
+
+    unsigned leading = (unsigned) __builtin_clzll(xor_value);
+    const unsigned trailing = (unsigned) __builtin_ctzll(xor_value);
+    leading = leading > LEADING_ZEROS_MAX ? LEADING_ZEROS_MAX : leading;
+
+    if (state->leading <= leading && state->trailing <= trailing) {
+        /*Meaningful bits fit into the previous window*/
+        write_bits(encoder, 0x2, 2);
+        write_bits(encoder, xor_value >> state->trailing, 64 - state->leading - state->trailing);
+        return;
+    }
+
+    const unsigned length = 64 - leading - trailing;
+    write_bits(encoder, 0x3, 2);
+    write_bits(encoder, leading, 5);
+    write_bits(encoder, length - 1, 6);
+    write_bits(encoder, xor_value >> trailing, length);
+    state->leading = leading;
+    state->trailing = trailing;
+}
+
+static inline bool decode_timestamp(HistoryCodecDecoder* const decoder, uint64_t* const timestamp_ns) {
+    if (decoder->size_bits - decoder->position < 1) {
+        return false;
+    }
+    if (decoder->decoded_samples == 0) {
+        if (decoder->size_bits - decoder->position < 64) {
+            return false;
+        }
+        decoder->previous_timestamp = read_bits(decoder, 64);
+        decoder->previous_delta = 0;
+        *timestamp_ns = decoder->previous_timestamp;
+        return true;
+    }
+
+    unsigned prefix_length = 0;
+    while (prefix_length < 4 && decoder->position < decoder->size_bits && read_bits(decoder, 1) == 1) {
+        prefix_length++;
+    }
+    static const unsigned payload_bits[] = {0, 12, 20, 32, 64};
+    const unsigned payload = payload_bits[prefix_length];
+    if (decoder->size_bits - decoder->position < payload) {
+        return false;
+    }
+
+    const uint64_t zigzag = payload == 0 ? 0 : read_bits(decoder, payload);
+    const int64_t delta_of_delta = (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+    const int64_t delta = (int64_t) ((uint64_t) decoder->previous_delta + (uint64_t) delta_of_delta);
+
+    decoder->previous_timestamp += (uint64_t) delta;
+    decoder->previous_delta = delta;
+    *timestamp_ns = decoder->previous_timestamp;
+    return true;
+}
+
+static inline bool decode_value(HistoryCodecDecoder* const decoder, CoreState* const state, double* const value) {
+    const size_t remaining = decoder->size_bits - decoder->position;
+
+    if (decoder->decoded_samples == 0) {
+        if (remaining < 64) {
+            return false;
+        }
+        state->previous = read_bits(decoder, 64);
+    }
+    else if (remaining < 1) {
+        return false;
+    }
+    else if (read_bits(decoder, 1) == 1) {
+        if (remaining < 2) {
+            return false;
+        }
+        if (read_bits(decoder, 1) == 1) {
+            if (remaining < 2 + 5 + 6) {
+                return false;
+            }
+            state->leading = (unsigned) read_bits(decoder, 5);
+            const unsigned length = (unsigned) read_bits(decoder, 6) + 1;
+            if (state->leading + length > 64) {
+                return false;
+            }
+            state->trailing = 64 - state->leading - length;
+        }
+        else if (state->leading + state->trailing >= 64) {
+            /*Reuse of window that has never been set*/
+            return false;
+        }
+        const unsigned length = 64 - state->leading - state->trailing;
+        if (decoder->size_bits - decoder->position < length) {
+            return false;
+        }
+        state->previous ^= read_bits(decoder, length) << state->trailing;
+    }
+
+    memcpy(value, &state->previous, sizeof(*value));
+    return true;
+}
+
+static inline void write_bits(HistoryCodecEncoder* const encoder, const uint64_t value, unsigned count) {
+    while (count > 0) {
+        const size_t byte_index = encoder->position / 8;
+        const unsigned free_bits = 8 - (unsigned) (encoder->position % 8);
+        const unsigned chunk = count < free_bits ? count : free_bits;
+        const uint8_t bits = (uint8_t) ((value >> (count - chunk)) & ((1u << chunk) - 1));
+
+        encoder->block[byte_index] |= (uint8_t) (bits << (free_bits - chunk));
+        encoder->position += chunk;
+        count -= chunk;
+    }
+}
+
+static inline uint64_t read_bits(HistoryCodecDecoder* const decoder, unsigned count) {
+    uint64_t result = 0;
+    while (count > 0) {
+        const size_t byte_index = decoder->position / 8;
+        const unsigned available_bits = 8 - (unsigned) (decoder->position % 8);
+        const unsigned chunk = count < available_bits ? count : available_bits;
+        const uint8_t bits = (uint8_t) ((decoder->block[byte_index] >> (available_bits - chunk)) & ((1u << chunk) - 1));
+
+        result = (result << chunk) | bits;
+        decoder->position += chunk;
+        count -= chunk;
+    }
+    return result;
+}
+
+static inline void store_u32(uint8_t* const destination, const uint32_t value) {
+    destination[0] = (uint8_t) value;
+    destination[1] = (uint8_t) (value >> 8);
+    destination[2] = (uint8_t) (value >> 16);
+    destination[3] = (uint8_t) (value >> 24);
+}
+
+static inline uint32_t load_u32(const uint8_t* const source) {
+    return (uint32_t) source[0] | (uint32_t) source[1] << 8 | (uint32_t) source[2] << 16 | (uint32_t) source[3] << 24;
+}
+
+static inline void reset_cores(CoreState* const cores, const size_t number_of_cores) {
+    for (size_t i = 0; i < number_of_cores; i++) {
+        /*Window that cannot be reused, the first XOR always describes its own window*/
+        cores[i] = (CoreState) {.previous = 0, .leading = 64, .trailing = 64};
+    }
+}
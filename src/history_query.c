@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <inttypes.h>
+#include "history_store.h"
+
+/**
+ * @brief Command line interface for extracting time range of single core from history file.
+ * Usage: history_query <file> <core> [from_seconds [to_seconds]]
+ * Time range bounds are UNIX timestamps, by default the whole history is printed.
+ * In rollup files column of a statistic is core * 4 + (0 min, 1 max, 2 avg, 3 p95).
+ */
+
+static inline bool parse_number(const char* text, uint64_t* result);
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 5) {
+        fprintf(stderr, "Usage: %s <file> <core> [from_seconds [to_seconds]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t core = 0;
+    uint64_t from_s = 0;
+    uint64_t to_s = UINT64_MAX;
+    if (!parse_number(argv[2], &core) || (argc > 3 && !parse_number(argv[3], &from_s))
+        || (argc > 4 && !parse_number(argv[4], &to_s))) {
+        fprintf(stderr, "Invalid number\n");
+        return EXIT_FAILURE;
+    }
+
+    HistoryStore* store = history_store_open_readonly(argv[1]);
+    if (store == NULL) {
+        perror("Cannot open history file");
+        return EXIT_FAILURE;
+    }
+    if (core >= history_store_number_of_cores(store)) {
+        fprintf(stderr, "History contains %zu cores\n", history_store_number_of_cores(store));
+        history_store_delete(store);
+        return EXIT_FAILURE;
+    }
+
+    const size_t count = history_store_count(store);
+    HistoryStoreSample* samples = malloc(sizeof(*samples) * (count > 0 ? count : 1));
+    if (samples == NULL) {
+        history_store_delete(store);
+        return EXIT_FAILURE;
+    }
+
+    const uint64_t seconds_limit = UINT64_MAX / 1000000000u - 1;
+    const uint64_t from_ns = from_s > seconds_limit ? UINT64_MAX : from_s * 1000000000u;
+    const uint64_t to_ns = to_s > seconds_limit ? UINT64_MAX : to_s * 1000000000u + 999999999u;
+    const size_t found = history_store_query(store, (size_t) core, from_ns, to_ns, samples, count);
+    for (size_t i = 0; i < found; i++) {
+        printf("%" PRIu64 ".%09" PRIu64 " %.2F\n", samples[i].timestamp_ns / 1000000000u,
+               samples[i].timestamp_ns % 1000000000u, samples[i].usage);
+    }
+
+    free(samples);
+    history_store_delete(store);
+    return 0;
+}
+
+static inline bool parse_number(const char* const text, uint64_t* const result) {
+    char* end = NULL;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0') {
+        errno = 0;
+        return false;
+    }
+    *result = (uint64_t) value;
+    return true;
+}
@@ -0,0 +1,384 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "history_store.h"
+#include "history_codec.h"
+
+enum {
+    HISTORY_STORE_MAGIC = 0x54484953, /*"THIS"*/
+    HISTORY_STORE_VERSION = 3,
+    /*Blocks start at cache line boundary*/
+    HISTORY_STORE_HEADER_SIZE = 64,
+    /*Bits reserved per record for its worst case, so that a block always takes block_records records:
+    delta-of-delta timestamp and XOR of usage quantized to 1/64 of a point. Quantized values below 128
+    have at least 39 trailing zero bits and no sign bit, their XOR spans at most 24 bits*/
+    HISTORY_STORE_TIMESTAMP_BUDGET_BITS = 4 + 64,
+    HISTORY_STORE_VALUE_BUDGET_BITS = 2 + 5 + 6 + 24,
+};
+
+typedef struct HistoryStoreHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t number_of_cores;
+    /*Records retained, the oldest ones beyond it are hidden until their block is overwritten*/
+    uint64_t capacity;
+    uint64_t block_records;
+    /*Index of the block that is being appended to*/
+    uint64_t write_block;
+    /*Number of blocks holding records, the one being appended to included*/
+    uint64_t blocks;
+    /*Number of records in those blocks*/
+    uint64_t count;
+} HistoryStoreHeader;
+
+struct HistoryStore {
+    int fd;
+    bool writable;
+    size_t map_size;
+    size_t block_size;
+    size_t number_of_blocks;
+    size_t sync_interval;
+    size_t appends_since_sync;
+    HistoryStoreHeader* header;
+    uint8_t* blocks;
+    /*Writable store only*/
+    HistoryCodecEncoder* encoder;
+    double* values;
+};
+
+/**
+ * @brief Map whole file and set pointers in store
+ */
+static inline bool map_file(HistoryStore* store, size_t map_size);
+
+/**
+ * @brief Check whether mapped header describes a file of given size
+ */
+static inline bool header_valid(const HistoryStoreHeader* header, size_t size);
+
+static inline size_t block_size(size_t number_of_cores, size_t block_records);
+
+static inline size_t number_of_blocks(size_t capacity, size_t block_records);
+
+static inline size_t file_size(size_t number_of_cores, size_t capacity, size_t block_records);
+
+static inline uint8_t* block_at(const HistoryStore* store, size_t index);
+
+/**
+ * @brief Set block geometry of store from its mapped header
+ */
+static inline void geometry_load(HistoryStore* store);
+
+/**
+ * @brief Allocate encoder and values of writable store and start a new block
+ */
+static inline bool writer_initialization(HistoryStore* store);
+
+/**
+ * @brief Move write position to the next block, records of the oldest block are dropped if all blocks are used
+ *
+ * @return pointer to the next block
+ */
+static inline uint8_t* block_next(HistoryStore* store);
+
+/**
+ * @brief Close the block being appended to and start encoding into the next one
+ */
+static inline void block_advance(HistoryStore* store);
+
+HistoryStore* history_store_open(const char path[const static 1], const size_t number_of_cores,
+                                 const size_t capacity, const size_t sync_interval) {
+    if (number_of_cores == 0 || capacity == 0) {
+        return NULL;
+    }
+
+    HistoryStore* result = calloc(1, sizeof(*result));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    result->writable = true;
+    result->sync_interval = sync_interval;
+
+    result->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (result->fd == -1) {
+        free(result);
+        return NULL;
+    }
+
+    struct stat status;
+    if (fstat(result->fd, &status) == -1) {
+        close(result->fd);
+        free(result);
+        return NULL;
+    }
+
+    const size_t block_records = capacity < HISTORY_STORE_BLOCK_RECORDS ? capacity : HISTORY_STORE_BLOCK_RECORDS;
+    const size_t map_size = file_size(number_of_cores, capacity, block_records);
+
+    if (status.st_size == 0) {
+        /*New file: reserve disk space up front, so appends never fail with ENOSPC on page fault*/
+        if (posix_fallocate(result->fd, 0, (off_t) map_size) != 0 && ftruncate(result->fd, (off_t) map_size) == -1) {
+            close(result->fd);
+            free(result);
+            return NULL;
+        }
+        if (!map_file(result, map_size)) {
+            close(result->fd);
+            free(result);
+            return NULL;
+        }
+        result->header->number_of_cores = number_of_cores;
+        result->header->capacity = capacity;
+        result->header->block_records = block_records;
+        result->header->write_block = 0;
+        result->header->blocks = 0;
+        result->header->count = 0;
+        result->header->version = HISTORY_STORE_VERSION;
+        result->header->magic = HISTORY_STORE_MAGIC;
+    }
+    else if ((size_t) status.st_size != map_size || !map_file(result, map_size)) {
+        close(result->fd);
+        free(result);
+        return NULL;
+    }
+    else if (!header_valid(result->header, map_size) || result->header->number_of_cores != number_of_cores
+             || result->header->capacity != capacity) {
+        history_store_delete(result);
+        return NULL;
+    }
+    geometry_load(result);
+    if (!writer_initialization(result)) {
+        history_store_delete(result);
+        return NULL;
+    }
+    return result;
+}
+
+HistoryStore* history_store_open_readonly(const char path[const static 1]) {
+    HistoryStore* result = calloc(1, sizeof(*result));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+
+    result->fd = open(path, O_RDONLY);
+    if (result->fd == -1) {
+        free(result);
+        return NULL;
+    }
+
+    struct stat status;
+    if (fstat(result->fd, &status) == -1 || (size_t) status.st_size < HISTORY_STORE_HEADER_SIZE
+        || !map_file(result, (size_t) status.st_size)) {
+        close(result->fd);
+        free(result);
+        return NULL;
+    }
+    if (!header_valid(result->header, result->map_size)) {
+        history_store_delete(result);
+        return NULL;
+    }
+    geometry_load(result);
+    return result;
+}
+
+void history_store_delete(HistoryStore* const store) {
+    if (store == NULL) {
+        return;
+    }
+    if (store->writable) {
+        history_store_sync(store);
+    }
+    munmap(store->header, store->map_size);
+    close(store->fd);
+    history_codec_encoder_delete(store->encoder);
+    free(store->values);
+    free(store);
+}
+
+bool history_store_append(HistoryStore* const restrict store, const Snapshot* const restrict snapshot) {
+    if (snapshot == NULL) {
+        return false;
+    }
+    const uint64_t timestamp_ns = (uint64_t) snapshot->timestamp.tv_sec * 1000000000u + (uint64_t) snapshot->timestamp.tv_nsec;
+    return history_store_append_values(store, timestamp_ns, snapshot->core_usage, snapshot->number_of_cores);
+}
+
+bool history_store_append_values(HistoryStore* const restrict store, const uint64_t timestamp_ns,
+                                 const double values[const restrict static 1], const size_t number_of_values) {
+    if (store == NULL || !store->writable) {
+        return false;
+    }
+    HistoryStoreHeader* header = store->header;
+    const size_t stored_values = number_of_values < header->number_of_cores ? number_of_values : header->number_of_cores;
+
+    /*Quantized values share most of their mantissa bits, hence their XOR is short*/
+    for (size_t i = 0; i < stored_values; i++) {
+        store->values[i] = round(values[i] * HISTORY_STORE_RESOLUTION) / HISTORY_STORE_RESOLUTION;
+    }
+    for (size_t i = stored_values; i < header->number_of_cores; i++) {
+        store->values[i] = NAN;
+    }
+
+    /*Only values out of the budgeted range close the block early*/
+    if (history_codec_encoder_number_of_samples(store->encoder) == header->block_records
+        || !history_codec_encode(store->encoder, timestamp_ns, store->values)) {
+        block_advance(store);
+        /*Empty block always has space for a record*/
+        history_codec_encode(store->encoder, timestamp_ns, store->values);
+    }
+    history_codec_encoder_finish(store->encoder);
+
+    /*Header is updated after the block, stale header only loses the newest record*/
+    header->count++;
+
+    store->appends_since_sync++;
+    if (store->sync_interval != 0 && store->appends_since_sync >= store->sync_interval) {
+        history_store_sync(store);
+    }
+    return true;
+}
+
+bool history_store_sync(HistoryStore* const store) {
+    store->appends_since_sync = 0;
+    return msync(store->header, store->map_size, MS_SYNC) == 0;
+}
+
+size_t history_store_query(const HistoryStore* const restrict store, const size_t core, const uint64_t from_ns,
+                           const uint64_t to_ns, HistoryStoreSample* const restrict dest, const size_t dest_size) {
+    const HistoryStoreHeader* header = store->header;
+    if (core >= header->number_of_cores) {
+        return 0;
+    }
+    double* values = malloc(sizeof(*values) * header->number_of_cores);
+    if (values == NULL) {
+        errno = 0;
+        return 0;
+    }
+
+    size_t stored = 0;
+    /*Records of the oldest block beyond capacity are skipped*/
+    size_t skipped = header->count > header->capacity ? header->count - header->capacity : 0;
+    const size_t oldest = (header->write_block + store->number_of_blocks + 1 - header->blocks) % store->number_of_blocks;
+    for (size_t i = 0; i < header->blocks && stored < dest_size; i++) {
+        HistoryCodecDecoder* decoder = history_codec_decoder_new(block_at(store, (oldest + i) % store->number_of_blocks),
+                                                                 store->block_size);
+        uint64_t timestamp_ns;
+        while (decoder != NULL && stored < dest_size && history_codec_decode(decoder, &timestamp_ns, values)) {
+            if (skipped > 0) {
+                skipped--;
+                continue;
+            }
+            if (timestamp_ns < from_ns || timestamp_ns > to_ns) {
+                continue;
+            }
+            dest[stored].timestamp_ns = timestamp_ns;
+            dest[stored].usage = values[core];
+            stored++;
+        }
+        history_codec_decoder_delete(decoder);
+    }
+    free(values);
+    return stored;
+}
+
+size_t history_store_count(const HistoryStore* const store) {
+    return store->header->count < store->header->capacity ? store->header->count : store->header->capacity;
+}
+
+size_t history_store_number_of_cores(const HistoryStore* const store) {
+    return store->header->number_of_cores;
+}
+
+static inline bool map_file(HistoryStore* const store, const size_t map_size) {
+    const int protection = store->writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* map = mmap(NULL, map_size, protection, MAP_SHARED, store->fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    store->map_size = map_size;
+    store->header = map;
+    store->blocks = (uint8_t*) map + HISTORY_STORE_HEADER_SIZE;
+    return true;
+}
+
+static inline bool header_valid(const HistoryStoreHeader* const header, const size_t size) {
+    if (header->magic != HISTORY_STORE_MAGIC || header->version != HISTORY_STORE_VERSION || header->number_of_cores == 0
+        || header->capacity == 0 || header->block_records == 0 || header->block_records > header->capacity) {
+        return false;
+    }
+    const size_t blocks = number_of_blocks(header->capacity, header->block_records);
+    return size == file_size(header->number_of_cores, header->capacity, header->block_records)
+           && header->write_block < blocks && header->blocks <= blocks;
+}
+
+static inline size_t block_size(const size_t number_of_cores, const size_t block_records) {
+    return HISTORY_CODEC_HEADER_SIZE + history_codec_sample_max_size(number_of_cores)
+           + (block_records * (HISTORY_STORE_TIMESTAMP_BUDGET_BITS + HISTORY_STORE_VALUE_BUDGET_BITS * number_of_cores) + 7) / 8;
+}
+
+static inline size_t number_of_blocks(const size_t capacity, const size_t block_records) {
+    /*Capacity records stay while the oldest block is being overwritten*/
+    return (capacity + block_records - 1) / block_records + 1;
+}
+
+static inline size_t file_size(const size_t number_of_cores, const size_t capacity, const size_t block_records) {
+    return HISTORY_STORE_HEADER_SIZE + block_size(number_of_cores, block_records) * number_of_blocks(capacity, block_records);
+}
+
+static inline uint8_t* block_at(const HistoryStore* const store, const size_t index) {
+    return store->blocks + index * store->block_size;
+}
+
+static inline void geometry_load(HistoryStore* const store) {
+    store->block_size = block_size(store->header->number_of_cores, store->header->block_records);
+    store->number_of_blocks = number_of_blocks(store->header->capacity, store->header->block_records);
+}
+
+static inline bool writer_initialization(HistoryStore* const store) {
+    HistoryStoreHeader* header = store->header;
+    store->values = malloc(sizeof(*store->values) * header->number_of_cores);
+    if (store->values == NULL) {
+        errno = 0;
+        return false;
+    }
+    /*State of the encoder is not persisted, block left by the previous run is closed*/
+    uint8_t* block = block_at(store, header->write_block);
+    if (header->blocks == 0) {
+        header->blocks = 1;
+    }
+    else {
+        block = block_next(store);
+    }
+    store->encoder = history_codec_encoder_new(header->number_of_cores, block, store->block_size);
+    if (store->encoder == NULL) {
+        return false;
+    }
+    history_codec_encoder_finish(store->encoder);
+    return true;
+}
+
+static inline uint8_t* block_next(HistoryStore* const store) {
+    HistoryStoreHeader* header = store->header;
+    const size_t next = (header->write_block + 1) % store->number_of_blocks;
+    uint8_t* block = block_at(store, next);
+    if (header->blocks == store->number_of_blocks) {
+        header->count -= history_codec_block_number_of_samples(block, store->block_size);
+    }
+    else {
+        header->blocks++;
+    }
+    header->write_block = next;
+    return block;
+}
+
+static inline void block_advance(HistoryStore* const store) {
+    history_codec_encoder_reset(store->encoder, block_next(store), store->block_size);
+    history_codec_encoder_finish(store->encoder);
+}
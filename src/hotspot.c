@@ -0,0 +1,240 @@
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+#include "hotspot.h"
+
+struct Hotspot {
+    size_t number_of_cores;
+    size_t top_n;
+    double threshold;
+    size_t consecutive_samples;
+    size_t number_of_busiest;
+    size_t number_of_idlest;
+    HotspotAggregate aggregate;
+    /*Memory belongs to an arena and is not freed by hotspot_delete*/
+    bool arena_owned;
+    /*Scratch for selection, number_of_cores elements, busiest and idlest follow it behind the streaks*/
+    HotspotCore* selection;
+    HotspotCore* busiest;
+    HotspotCore* idlest;
+    size_t streaks[]; /*FAM*/
+};
+
+/**
+ * @brief Reorder cores, so element k is the one that would be there if the array was sorted
+ * in descending order; elements before it are not smaller, elements after it are not greater.
+ */
+static void select_descending(HotspotCore* cores, size_t size, size_t k);
+
+/**
+ * @brief Insertion sort, used only for the selected top_n cores
+ */
+static void sort_descending(HotspotCore* cores, size_t size);
+
+static inline void core_swap(HotspotCore* a, HotspotCore* b);
+
+/**
+ * @brief Lay out and initialize detector in zeroed memory of hotspot_footprint bytes
+ */
+static inline Hotspot* hotspot_initialize(void* memory, size_t number_of_cores, size_t top_n, double threshold,
+                                          size_t consecutive_samples);
+
+Hotspot* hotspot_new(const size_t number_of_cores, const size_t top_n, const double threshold, const size_t consecutive_samples) {
+    if (number_of_cores == 0 || top_n == 0 || consecutive_samples == 0) {
+        return NULL;
+    }
+
+    void* memory = calloc(1, hotspot_footprint(number_of_cores, top_n));
+    if (memory == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    return hotspot_initialize(memory, number_of_cores, top_n, threshold, consecutive_samples);
+}
+
+Hotspot* hotspot_new_in(Arena* const arena, const size_t number_of_cores, const size_t top_n, const double threshold,
+                        const size_t consecutive_samples) {
+    if (number_of_cores == 0 || top_n == 0 || consecutive_samples == 0) {
+        return NULL;
+    }
+
+    void* memory = arena_alloc(arena, hotspot_footprint(number_of_cores, top_n));
+    if (memory == NULL) {
+        return NULL;
+    }
+    Hotspot* result = hotspot_initialize(memory, number_of_cores, top_n, threshold, consecutive_samples);
+    result->arena_owned = true;
+    return result;
+}
+
+size_t hotspot_footprint(const size_t number_of_cores, const size_t top_n) {
+    return sizeof(Hotspot) + sizeof(size_t) * number_of_cores + sizeof(HotspotCore) * (number_of_cores + 2 * top_n);
+}
+
+void hotspot_delete(Hotspot* const hotspot) {
+    if (hotspot != NULL && hotspot->arena_owned) {
+        return;
+    }
+    free(hotspot);
+}
+
+void hotspot_update(Hotspot* const restrict hotspot, const Snapshot* const restrict snapshot) {
+    const size_t number_of_cores = snapshot->number_of_cores < hotspot->number_of_cores ? snapshot->number_of_cores : hotspot->number_of_cores;
+    HotspotAggregate aggregate = {.min = INFINITY, .max = -INFINITY};
+    double sum = 0.0;
+    size_t valid = 0;
+
+    for (size_t core = 0; core < hotspot->number_of_cores; core++) {
+        const double usage = core < number_of_cores ? snapshot->core_usage[core] : NAN;
+        if (isnan(usage)) {
+            hotspot->streaks[core] = 0;
+            continue;
+        }
+        hotspot->selection[valid++] = (HotspotCore) {.core = core, .usage = usage};
+        aggregate.min = usage < aggregate.min ? usage : aggregate.min;
+        aggregate.max = usage > aggregate.max ? usage : aggregate.max;
+        sum += usage;
+
+        hotspot->streaks[core] = usage > hotspot->threshold ? hotspot->streaks[core] + 1 : 0;
+        if (hotspot->streaks[core] >= hotspot->consecutive_samples) {
+            aggregate.number_of_hot++;
+        }
+    }
+
+    aggregate.number_of_cores = valid;
+    if (valid == 0) {
+        aggregate.min = aggregate.max = aggregate.avg = NAN;
+    } else {
+        aggregate.avg = sum / (double) valid;
+    }
+    hotspot->aggregate = aggregate;
+
+    const size_t top_n = valid < hotspot->top_n ? valid : hotspot->top_n;
+    hotspot->number_of_busiest = top_n;
+    hotspot->number_of_idlest = top_n;
+    if (top_n == 0) {
+        return;
+    }
+
+    /*Busiest cores end up in front of the array*/
+    if (top_n < valid) {
+        select_descending(hotspot->selection, valid, top_n - 1);
+    }
+    for (size_t i = 0; i < top_n; i++) {
+        hotspot->busiest[i] = hotspot->selection[i];
+    }
+    sort_descending(hotspot->busiest, top_n);
+
+    /*Idlest cores end up at the back. Unless both sets overlap, the busiest part
+    is already separated and can be skipped*/
+    if (top_n < valid) {
+        const size_t offset = top_n <= valid - top_n ? top_n : 0;
+        select_descending(hotspot->selection + offset, valid - offset, valid - top_n - offset);
+    }
+    for (size_t i = 0; i < top_n; i++) {
+        hotspot->idlest[i] = hotspot->selection[valid - 1 - i];
+    }
+    sort_descending(hotspot->idlest, top_n);
+    /*Idlest first*/
+    for (size_t i = 0; i < top_n / 2; i++) {
+        core_swap(&hotspot->idlest[i], &hotspot->idlest[top_n - 1 - i]);
+    }
+}
+
+const HotspotCore* hotspot_busiest(const Hotspot* const restrict hotspot, size_t* const restrict count) {
+    *count = hotspot->number_of_busiest;
+    return hotspot->busiest;
+}
+
+const HotspotCore* hotspot_idlest(const Hotspot* const restrict hotspot, size_t* const restrict count) {
+    *count = hotspot->number_of_idlest;
+    return hotspot->idlest;
+}
+
+const HotspotAggregate* hotspot_aggregate(const Hotspot* const hotspot) {
+    return &hotspot->aggregate;
+}
+
+bool hotspot_is_hot(const Hotspot* const hotspot, const size_t core) {
+    return core < hotspot->number_of_cores && hotspot->streaks[core] >= hotspot->consecutive_samples;
+}
+
+size_t hotspot_streak(const Hotspot* const hotspot, const size_t core) {
+    return core < hotspot->number_of_cores ? hotspot->streaks[core] : 0;
+}
+
+static void select_descending(HotspotCore* const cores, const size_t size, const size_t k) {
+    size_t left = 0;
+    size_t right = size - 1;
+
+    while (left < right) {
+        /*Median of three keeps already partitioned input (the common case between ticks) linear*/
+        const size_t middle = left + (right - left) / 2;
+        if (cores[middle].usage > cores[left].usage) {
+            core_swap(&cores[middle], &cores[left]);
+        }
+        if (cores[right].usage > cores[left].usage) {
+            core_swap(&cores[right], &cores[left]);
+        }
+        if (cores[right].usage > cores[middle].usage) {
+            core_swap(&cores[right], &cores[middle]);
+        }
+        const double pivot = cores[middle].usage;
+
+        /*Hoare partition: [left, j] >= pivot >= [j + 1, right]*/
+        size_t i = left;
+        size_t j = right;
+        while (true) {
+            while (cores[i].usage > pivot) {
+                i++;
+            }
+            while (cores[j].usage < pivot) {
+                j--;
+            }
+            if (i >= j) {
+                break;
+            }
+            core_swap(&cores[i], &cores[j]);
+            i++;
+            j--;
+        }
+
+        if (k <= j) {
+            right = j;
+        } else {
+            left = j + 1;
+        }
+    }
+}
+
+static void sort_descending(HotspotCore* const cores, const size_t size) {
+    for (size_t i = 1; i < size; i++) {
+        const HotspotCore current = cores[i];
+        size_t j = i;
+        while (j > 0 && cores[j - 1].usage < current.usage) {
+            cores[j] = cores[j - 1];
+            j--;
+        }
+        cores[j] = current;
+    }
+}
+
+static inline void core_swap(HotspotCore* const a, HotspotCore* const b) {
+    const HotspotCore temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+static inline Hotspot* hotspot_initialize(void* const memory, const size_t number_of_cores, const size_t top_n,
+                                          const double threshold, const size_t consecutive_samples) {
+    Hotspot* result = memory;
+    result->selection = (HotspotCore*) &result->streaks[number_of_cores];
+    result->busiest = result->selection + number_of_cores;
+    result->idlest = result->busiest + top_n;
+    result->number_of_cores = number_of_cores;
+    result->top_n = top_n;
+    result->threshold = threshold;
+    result->consecutive_samples = consecutive_samples;
+    result->aggregate = (HotspotAggregate) {.min = NAN, .max = NAN, .avg = NAN};
+    return result;
+}
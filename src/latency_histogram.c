@@ -0,0 +1,62 @@
+#include <math.h>
+#include "latency_histogram.h"
+
+void latency_histogram_clear(LatencyHistogram* const histogram) {
+    histogram->count = 0;
+    histogram->sum_ns = 0;
+    histogram->max_ns = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        histogram->buckets[i] = 0;
+    }
+}
+
+void latency_histogram_add(LatencyHistogram* const histogram, const uint64_t value_ns) {
+    histogram->buckets[latency_histogram_bucket(value_ns)]++;
+    histogram->count++;
+    histogram->sum_ns += value_ns;
+    if (value_ns > histogram->max_ns) {
+        histogram->max_ns = value_ns;
+    }
+}
+
+uint64_t latency_histogram_quantile(const LatencyHistogram* const histogram, const double quantile) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    const double clamped = quantile < 0.0 ? 0.0 : (quantile > 1.0 ? 1.0 : quantile);
+    /*1-based rank of requested sample*/
+    uint64_t rank = (uint64_t) ceil(clamped * (double) histogram->count);
+    rank = rank < 1 ? 1 : rank;
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        cumulative += histogram->buckets[i];
+        if (cumulative >= rank) {
+            const uint64_t value = latency_histogram_bucket_max(i);
+            return value < histogram->max_ns ? value : histogram->max_ns;
+        }
+    }
+    return histogram->max_ns;
+}
+
+size_t latency_histogram_bucket(const uint64_t value_ns) {
+    if (value_ns < 2 * LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return (size_t) value_ns;
+    }
+    if (value_ns >> LATENCY_HISTOGRAM_MAX_EXPONENT != 0) {
+        return LATENCY_HISTOGRAM_BUCKETS - 1;
+    }
+    /*Shift keeps SUB_BITS + 1 most significant bits, the highest one is always set*/
+    const unsigned exponent = 63 - (unsigned) __builtin_clzll(value_ns);
+    const unsigned shift = exponent - LATENCY_HISTOGRAM_SUB_BITS;
+    return (size_t) shift * LATENCY_HISTOGRAM_SUB_BUCKETS + (size_t) (value_ns >> shift);
+}
+
+uint64_t latency_histogram_bucket_max(const size_t bucket) {
+    if (bucket < 2 * LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return (uint64_t) bucket;
+    }
+    const unsigned shift = (unsigned) (bucket / LATENCY_HISTOGRAM_SUB_BUCKETS) - 1;
+    const uint64_t mantissa = (uint64_t) (bucket % LATENCY_HISTOGRAM_SUB_BUCKETS) + LATENCY_HISTOGRAM_SUB_BUCKETS;
+    return ((mantissa + 1) << shift) - 1;
+}
@@ -1,6 +1,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <pthread.h>
 #include "logger_payload.h"
 
 typedef struct LoggerPayload {
@@ -9,30 +12,113 @@ typedef struct LoggerPayload {
     char message[]; /*FAM*/
 } LoggerPayload;
 
+/**
+ * @brief Fixed-size payloads and stack of the free ones, both placed in attached memory
+ */
+typedef struct LoggerPayloadPool {
+    pthread_mutex_t mutex;
+    uint8_t* slots;
+    size_t number_of_payloads;
+    size_t number_of_free;
+    LoggerPayload** free_payloads;
+} LoggerPayloadPool;
+
+static LoggerPayloadPool pool = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * @brief Size of single payload of the pool, every payload stays aligned
+ */
+static inline size_t slot_size(void);
+
+/**
+ * @brief Take payload from the pool
+ * @return payload, NULL if the pool is not attached or exhausted, *attached tells which
+ */
+static inline LoggerPayload* pool_take(bool* attached);
+
 LoggerPayload* logger_payload_new(const ELoggerPayloadType type, const char message[const restrict static 1]) {
     if (strcmp(message, "") == 0) {
         return NULL;
     }
 
-    const size_t message_size = strlen(message);
+    size_t message_size = strlen(message);
 
-    LoggerPayload* result = malloc(sizeof(*result) + sizeof(*result->message) * (message_size + 1));
-    if (result == NULL) {
-        errno = 0;
-        return NULL;
+    bool attached = false;
+    LoggerPayload* result = pool_take(&attached);
+    if (attached) {
+        if (result == NULL) {
+            return NULL;
+        }
+        message_size = message_size < LOGGER_PAYLOAD_POOL_MESSAGE_SIZE - 1 ? message_size : LOGGER_PAYLOAD_POOL_MESSAGE_SIZE - 1;
+    }
+    else {
+        result = malloc(sizeof(*result) + sizeof(*result->message) * (message_size + 1));
+        if (result == NULL) {
+            errno = 0;
+            return NULL;
+        }
     }
 
     result->message_size = message_size;
     result->type = type;
-    strcpy(result->message, message);   
+    memcpy(result->message, message, message_size);
+    result->message[message_size] = '\0';
 
     return result;
 }
 
 void logger_payload_delete(LoggerPayload* const payload) {
+    if (payload == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool.mutex);
+    const uint8_t* address = (const uint8_t*) payload;
+    if (pool.slots != NULL && address >= pool.slots && address < pool.slots + pool.number_of_payloads * slot_size()) {
+        pool.free_payloads[pool.number_of_free] = payload;
+        pool.number_of_free++;
+        pthread_mutex_unlock(&pool.mutex);
+        return;
+    }
+    pthread_mutex_unlock(&pool.mutex);
     free(payload);
 }
 
+size_t logger_payload_pool_footprint(const size_t number_of_payloads) {
+    /*Stack of free payloads precedes the payloads, its size keeps them aligned*/
+    const size_t stack_size = (number_of_payloads * sizeof(LoggerPayload*) + _Alignof(max_align_t) - 1)
+                              / _Alignof(max_align_t) * _Alignof(max_align_t);
+    return stack_size + number_of_payloads * slot_size();
+}
+
+bool logger_payload_pool_attach(void* const memory, const size_t number_of_payloads) {
+    if (number_of_payloads == 0) {
+        return false;
+    }
+    pthread_mutex_lock(&pool.mutex);
+    if (pool.slots != NULL) {
+        pthread_mutex_unlock(&pool.mutex);
+        return false;
+    }
+    pool.free_payloads = memory;
+    pool.slots = (uint8_t*) memory + logger_payload_pool_footprint(number_of_payloads) - number_of_payloads * slot_size();
+    pool.number_of_payloads = number_of_payloads;
+    pool.number_of_free = number_of_payloads;
+    for (size_t i = 0; i < number_of_payloads; i++) {
+        pool.free_payloads[i] = (LoggerPayload*) (pool.slots + i * slot_size());
+    }
+    pthread_mutex_unlock(&pool.mutex);
+    return true;
+}
+
+void logger_payload_pool_detach() {
+    pthread_mutex_lock(&pool.mutex);
+    pool.slots = NULL;
+    pool.free_payloads = NULL;
+    pool.number_of_payloads = 0;
+    pool.number_of_free = 0;
+    pthread_mutex_unlock(&pool.mutex);
+}
+
 const char* logger_payload_get_message(LoggerPayload* const payload) {
     return payload->message;
 }
@@ -42,6 +128,23 @@ ELoggerPayloadType logger_payload_get_type(LoggerPayload* const payload) {
 }
 
 const char* logger_payload_type_to_str(ELoggerPayloadType type) {
-    static const char* message_str[] = {"Warning", "Error"};
+    static const char* message_str[] = {"Warning", "Error", "Info"};
     return message_str[type];
 }
+
+static inline size_t slot_size() {
+    return (sizeof(LoggerPayload) + LOGGER_PAYLOAD_POOL_MESSAGE_SIZE + _Alignof(max_align_t) - 1)
+           / _Alignof(max_align_t) * _Alignof(max_align_t);
+}
+
+static inline LoggerPayload* pool_take(bool* const attached) {
+    LoggerPayload* result = NULL;
+    pthread_mutex_lock(&pool.mutex);
+    *attached = pool.slots != NULL;
+    if (pool.number_of_free > 0) {
+        pool.number_of_free--;
+        result = pool.free_payloads[pool.number_of_free];
+    }
+    pthread_mutex_unlock(&pool.mutex);
+    return result;
+}
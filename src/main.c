@@ -2,46 +2,201 @@
 #include <stdbool.h>
 #include <errno.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <signal.h>
+#include <time.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <string.h>
+#include <stdlib.h>
+#include <malloc.h>
 #include "circular_buffer.h"
+#include "snapshot.h"
+#include "snapshot_shm.h"
+#include "history_store.h"
+#include "rollup.h"
+#include "usage_stats.h"
+#include "hotspot.h"
+#include "alert_rules.h"
+#include "alert_action.h"
+#include "topology.h"
+#include "frequency_sampler.h"
+#include "event_loop.h"
+#include "placement.h"
+#include "self_usage.h"
+#include "stage_overhead.h"
+#include "metrics_endpoint.h"
+#include "snapshot_latency.h"
+#include "stat_recording.h"
+#include "proc_parser.h"
+#include "trace.h"
 #include "thread_reader.h"
 #include "thread_parser.h"
 #include "thread_printer.h"
 #include "thread_watchdog.h"
 #include "thread_logger.h"
+#include "alloc_guard.h"
+#include "arena.h"
 
+/*Period of logging buffer counters when compiled with PIPELINE_STATS*/
+#ifndef PIPELINE_STATS_PERIOD_S
+#define PIPELINE_STATS_PERIOD_S 10
+#endif
 
-static PCPGuard char_buffer_guard = PCP_GUARD_INITIALIZER, double_buffer_guard =  PCP_GUARD_INITIALIZER, logger_buffer_guard = PCP_GUARD_INITIALIZER;
+enum {
+    /*Mirrored buffer occupies whole pages, it is mapped on its own outside the arena*/
+    CHAR_BUFFER_SIZE = 4096,
+    SNAPSHOT_BUFFER_SIZE = 4,
+    WATCHDOG_SIZE = 4,
+    /*Payloads held outside the logger buffer, by producers waiting for space and by the logger while writing*/
+    LOGGER_POOL_SPARE = 8,
+    FILE_BUFFER_SIZE = 4096,
+    /*Upper bound of a cpu line of /proc/stat*/
+    STAT_LINE_SIZE = 256,
+    /*Default interval between the baseline and the first snapshot, usage over it has resolution of 5 points*/
+    PRIMING_JIFFIES = 20,
+    ALERT_RULES_CAPACITY = 64,
+    /*Threads post their setup within milliseconds, one that never does was started with invalid arguments*/
+    THREADS_START_TIMEOUT_S = 5,
+    /*Wakeups of threads stopped during startup, 10 ms apart*/
+    THREADS_STOP_WAKEUPS = 50,
+};
+
+static PCPGuard char_buffer_guard = PCP_GUARD_INITIALIZER, snapshot_buffer_guard =  PCP_GUARD_INITIALIZER, logger_buffer_guard = PCP_GUARD_INITIALIZER;
 static pthread_mutex_t working_mutex = PTHREAD_MUTEX_INITIALIZER;
+/*Posted by every pipeline thread once it has set itself up, allocations are sealed after all of them*/
+static sem_t threads_started;
 static WatchdogControlUnit reader_unit =  WATCHDOG_CONTROL_UNIT_INIT, parser_unit = WATCHDOG_CONTROL_UNIT_INIT,
                                         printer_unit = WATCHDOG_CONTROL_UNIT_INIT, logger_unit = WATCHDOG_CONTROL_UNIT_INIT;
 
 static FILE* proc_file;
+static FILE* pressure_files[PSI_RESOURCE_COUNT];
 static FILE* logger_file;
 static CircularBuffer* char_buffer;
-static CircularBuffer* double_buffer;
+static CircularBuffer* snapshot_buffer;
 static CircularBuffer* logger_buffer;
 static Watchdog* watchdog;
+static SnapshotShm* snapshot_shm;
+static HistoryStore* history_store;
+static Rollup* rollup;
+static HistoryStore* rollup_stores[ROLLUP_TIER_COUNT];
+static UsageStats* usage_stats;
+static Hotspot* hotspot;
+static AlertRules* alert_rules;
+static AlertAction* alert_actions[ALERT_RULES_CAPACITY];
+static Topology* topology;
+static FrequencySampler* frequency_sampler;
+static Placement* placement;
+static SelfUsage* self_usage;
+static StageOverhead* stage_overhead;
+static MetricsEndpoint* metrics_endpoint;
+static Trace* trace;
+/*Opened at initialization, dumps write to it without allocating*/
+static int trace_file = -1;
+static SnapshotLatency* snapshot_latency;
+static StatRecorder* stat_recorder;
+static StatReplay* stat_replay;
+static AdaptivePeriod* adaptive_period;
+/*Carved for the parser thread, the event loop carves its own*/
+static ThreadParserState* parser_state;
+/*Buffers and everything updated per snapshot; FILE objects, history and shared memory mappings, recorder,
+replay, frequency sampler, placement and overhead accounting are set up once and stay outside*/
+static Arena* arena;
 
 static pthread_t watchdog_id = 0;
 static bool working = true;
 static volatile sig_atomic_t stop_condition = 1;
+static volatile sig_atomic_t trace_requested = 0;
+static bool pressure_enabled = false;
+static const char* snapshot_shm_name = NULL;
+static const char* history_path = NULL;
+static size_t history_retention_s = 6 * 60 * 60;
+static bool rollup_enabled = false;
+static uint32_t usage_stats_mask = 0;
+static size_t usage_stats_window = 60;
+static size_t hotspot_top_n = 0;
+static double hotspot_threshold = 90.0;
+static size_t hotspot_samples = 5;
+static const char* alert_rules_path = NULL;
+static const char* alert_default_action = "log";
+static bool topology_enabled = false;
+static bool frequency_enabled = false;
+static bool event_loop_enabled = false;
+static const char* placement_spec = NULL;
+static bool self_usage_enabled = false;
+/*0 disables accounting of the tracker overhead*/
+static size_t stage_overhead_interval = 0;
+static bool stage_overhead_hardware = false;
+static const char* metrics_path = NULL;
+/*0 disables histograms of snapshot age*/
+static size_t snapshot_latency_interval = 0;
+static const char* trace_path = NULL;
+static const char* record_path = NULL;
+static const char* replay_path = NULL;
+static bool replay_fast = false;
+/*Interval between the baseline and the first snapshot, 0 prints usage since boot first, PRIMING_JIFFIES by default*/
+static size_t priming_ms = 0;
+static uint64_t start_ns;
+/*0 keeps the period fixed*/
+static size_t adaptive_min_ms = 0;
+static double adaptive_threshold = 10.0;
+static double adaptive_budget_percent = 1.0;
+static bool arena_lock_enabled = false;
+/*stdout outlives the arena, its buffer is static*/
+static char stdout_buffer[16384];
+/*Roots of input trees, tracker's own usage is always read from /proc/self*/
+static const char* procfs_root = "/proc";
+/*Cores of the first stat record of the input, per-core sinks are sized for them*/
+static size_t input_cores = 0;
+/*Length of /proc/stat read at startup, zero for replay*/
+static size_t input_stat_length = 0;
+static const char* sysfs_root = "/sys";
+static EFrequencySource frequency_source = FREQUENCY_SOURCE_CPUFREQ;
+static size_t frequency_threads = 1;
+/*Coarser tiers are kept longer: 1 day, 1 week and 90 days*/
+static const size_t rollup_retention_s[ROLLUP_TIER_COUNT] = {24 * 60 * 60, 7 * 24 * 60 * 60, 90 * 24 * 60 * 60};
 
 static ThreadReaderArguments reader_args;
 static ThreadParserArguments parser_args;
 static ThreadPrinterArguments printer_args;
 static ThreadWatchdogArguments watchdog_args;
 static ThreadLoggerArguments logger_args;
+static EventLoopArguments event_loop_args;
 
+static inline bool options_parse(int argc, char* argv[]);
+static inline bool frequency_option_parse(const char* option);
+static size_t count_input_cores(void);
+static inline size_t logger_buffer_size(void);
+static inline size_t logger_pool_size(void);
+static inline size_t stat_buffer_size(void);
+static inline bool arena_initialization(void);
+static inline void memory_report(void);
+static inline bool rollup_initialization(void);
+static inline void rollup_release(void);
+static inline bool alerts_initialization(void);
+static inline void alerts_release(void);
 static inline void resources_release(void);
 static inline bool resource_initialization(void);
+static inline void arguments_initialization(void);
 static inline bool threads_initialization(void);
+static inline bool placement_initialization(void);
+static inline void thread_place(EPlacementStage stage, pthread_t thread);
 static inline void threads_join(void);
+
+/**
+ * @brief Stop threads whose peers may never have started and join them
+ */
+static inline void threads_stop(void);
+static inline void pipeline_stats_log(void);
+static inline void trace_write(void);
 static void term_handler(int sigterm);
 
-int main() {
+int main(int argc, char* argv[]) {
+    start_ns = snapshot_latency_now_ns();
+    if (!options_parse(argc, argv)) {
+        return EXIT_FAILURE;
+    }
+
     sigset_t mask;
     sigemptyset(&mask);
     sigaddset(&mask, SIGTERM);
@@ -61,6 +216,22 @@ int main() {
         perror("Sigaction error\n");
         return EXIT_FAILURE;
     }
+    /*Dump of the trace is requested by SIGUSR1, without tracing it keeps its default action*/
+    if (trace_path != NULL) {
+        sigaddset(&mask, SIGUSR1);
+        if (sigaction(SIGUSR1, &action, NULL) == -1) {
+            errno = 0;
+            perror("Sigaction error\n");
+            return EXIT_FAILURE;
+        }
+    }
+    /*Alert actions write to FIFOs whose reader may go away*/
+    action.sa_handler = SIG_IGN;
+    if (sigaction(SIGPIPE, &action, NULL) == -1) {
+        errno = 0;
+        perror("Sigaction error\n");
+        return EXIT_FAILURE;
+    }
     if (pthread_sigmask(SIG_BLOCK, &mask, NULL) != 0) {
         perror("Failed to set mask\n");
         return EXIT_FAILURE;
@@ -70,86 +241,746 @@ int main() {
         perror("Resource initialization failed\n");
         return EXIT_FAILURE;
     }
+    memory_report();
+    if (event_loop_enabled) {
+        /*SIGTERM and SIGINT stay blocked, the loop receives them through signalfd*/
+        arguments_initialization();
+        thread_place(PLACEMENT_STAGE_READER, pthread_self());
+        const bool result = event_loop_run(&event_loop_args);
+        if (!result) {
+            perror("Event loop failed\n");
+        }
+        pipeline_stats_log();
+        trace_write();
+        thread_logger_flush(&logger_buffer_guard, logger_buffer, logger_file);
+        resources_release();
+        return result ? 0 : EXIT_FAILURE;
+    }
     if (!threads_initialization()) {
         perror("Threads setup failed\n");
         resources_release();
         return EXIT_FAILURE;
     }
+    /*Every thread has set itself up, nothing allocates from now on*/
+    alloc_guard_seal();
     if (pthread_sigmask(SIG_UNBLOCK, &mask, NULL) != 0) {
         perror("Failed to set mask\n");
         stop_condition = 0;
     }
     
+#ifdef PIPELINE_STATS
+    const struct timespec stats_period = {.tv_sec = PIPELINE_STATS_PERIOD_S, .tv_nsec = 0};
+#endif
     while (stop_condition > 0) {
+#ifdef PIPELINE_STATS
+        /*Interrupted by the signal that stops the tracker*/
+        if (nanosleep(&stats_period, NULL) == 0) {
+            pipeline_stats_log();
+        }
+#else
         pause();
+#endif
         errno = 0;
+        if (trace_requested) {
+            trace_requested = 0;
+            trace_write();
+        }
     }
     pthread_mutex_lock(&working_mutex);
     working = false;
     pthread_mutex_unlock(&working_mutex);
     threads_join();
+    sem_destroy(&threads_started);
+    /*Logger thread is gone, whatever it left in the buffer is written here together with final counters*/
+    thread_logger_flush(&logger_buffer_guard, logger_buffer, logger_file);
+    pipeline_stats_log();
+    trace_write();
+    thread_logger_flush(&logger_buffer_guard, logger_buffer, logger_file);
     resources_release();
 
     return 0;
 }
 
-static inline bool resource_initialization() {
+static inline bool options_parse(int argc, char* argv[]) {
+    static const char usage[] = "Usage: %s [-p] [-s name] [-H file [-R seconds]] [-A] [-S list [-W samples]] [-T n [-K percent,samples]] [-r file [-a action]] [-N] [-F source[,threads]] [-E] [-P policy] [-O] [-C snapshots[,hw]] [-M socket] [-X file] [-L snapshots] [-w file | -i file[,fast]] [-d dir] [-D dir] [-b ms] [-V ms[,change[,budget]]] [-m]\n"
+                                "  -p          sample /proc/pressure/{cpu,io,memory} in the same tick as /proc/stat\n"
+                                "  -s name     publish the latest snapshot in POSIX shared memory object name\n"
+                                "  -H file     keep per-core usage history in memory-mapped ring file\n"
+                                "  -R seconds  retention of the history (default 21600), with -V the file holds it at the shortest period\n"
+                                "  -A          compute 10s/1m/1h rollups (min/max/avg/p95), with -H they are kept\n"
+                                "              in file.rollup-<tier> for 1 day/1 week/90 days\n"
+                                "  -S list     print comma separated statistics next to usage, any of\n"
+                                "              ewma10s,ewma1m,ewma5m,p50,p95,p99 (with -s all are published)\n"
+                                "  -W samples  sliding window of the quantiles (default 60)\n"
+                                "  -T n        print only n busiest and n idlest cores with aggregate\n"
+                                "  -K percent,samples  flag cores above percent for samples consecutive snapshots (default 90,5)\n"
+                                "  -r file     evaluate alert rules from file on every snapshot, @see alert_rules.h\n"
+                                "  -a action   action of rules without one: log, fifo:<path> or unix:<path> (default log)\n"
+                                "  -N          aggregate usage of sockets and NUMA nodes using sysfs topology\n"
+                                "  -F source[,threads]  sample frequency of every core: cpufreq (scaling_cur_freq) or\n"
+                                "              msr (APERF/MPERF, needs root, falls back to cpufreq), read by threads (default 1)\n"
+                                "  -E          run single-threaded event loop instead of the thread pipeline\n"
+                                "  -P policy   pin threads: none, housekeeping:<cpulist> or siblings[:cpu] (reader on cpu,\n"
+                                "              parser on its SMT sibling)\n"
+                                "  -O          print share of every core used by the tracker's own threads\n"
+                                "  -C snapshots[,hw]  report CPU us per snapshot of every stage and RSS of the tracker\n"
+                                "              every snapshots (printed, logged and published with -s and -M), with hw\n"
+                                "              also cycles, instructions, cache and branch misses (perf_event_open)\n"
+                                "  -M socket   serve metrics in Prometheus text format over unix socket, e.g.\n"
+                                "              curl --unix-socket socket http://localhost/metrics\n"
+                                "  -X file     record begin/end events of pipeline stages (build with PIPELINE_TRACE) and\n"
+                                "              write them as Chrome trace JSON to file on SIGUSR1 and at exit\n"
+                                "  -L snapshots  log p50/p90/p99/max age of snapshots at parse completion and at output\n"
+                                "              every snapshots, with -M quantiles since start are served as well\n"
+                                "  -w file     record /proc/stat of every tick to file\n"
+                                "  -i file[,fast]  replay ticks recorded with -w instead of reading /proc/stat, at recorded\n"
+                                "              pace or with fast as quickly as possible, exit at the end of the recording\n"
+                                "  -d dir      read stat and pressure from dir instead of /proc, e.g. tree of fake_proc\n"
+                                "  -D dir      read topology and frequency from dir instead of /sys\n"
+                                "  -b ms       read a baseline at start and the first snapshot ms later (default 20 jiffies,\n"
+                                "              200 with USER_HZ 100), 0 prints usage since boot first\n"
+                                "  -V ms[,change[,budget]]  adapt the period between ms and 1 s: halve it when p95 of per-core\n"
+                                "              changes beyond tick resolution exceeds change points (default 10), double it\n"
+                                "              when stable, keep the tracker below budget %% of one core (default 1)\n"
+                                "  -m          lock buffers and per-snapshot state in RAM (mlock), stdio, history\n"
+                                "              and shared memory mappings stay unlocked\n";
+    int option;
 
-    char_buffer = circular_buffer_new(400, sizeof(char));
-    if (char_buffer == NULL) {
-        perror("Initialization failed: memory error\n");
+    const long ticks_per_second = sysconf(_SC_CLK_TCK);
+    priming_ms = PRIMING_JIFFIES * 1000 / (size_t) (ticks_per_second > 0 ? ticks_per_second : 100);
+    while ((option = getopt(argc, argv, "ps:H:R:AS:W:T:K:r:a:NF:EP:OC:M:X:L:w:i:d:D:b:V:m")) != -1) {
+        switch (option) {
+            case 'p':
+                pressure_enabled = true;
+                break;
+            case 's':
+                snapshot_shm_name = optarg;
+                break;
+            case 'H':
+                history_path = optarg;
+                break;
+            case 'A':
+                rollup_enabled = true;
+                break;
+            case 'S':
+                if (!usage_stats_mask_parse(optarg, &usage_stats_mask)) {
+                    fprintf(stderr, usage, argv[0]);
+                    return false;
+                }
+                break;
+            case 'W': {
+                char* end = NULL;
+                usage_stats_window = (size_t) strtoul(optarg, &end, 10);
+                if (*end != '\0' || usage_stats_window == 0) {
+                    fprintf(stderr, usage, argv[0]);
+                    return false;
+                }
+                break;
+            }
+            case 'T': {
+                char* end = NULL;
+                hotspot_top_n = (size_t) strtoul(optarg, &end, 10);
+                if (*end != '\0' || hotspot_top_n == 0) {
+                    fprintf(stderr, usage, argv[0]);
+                    return false;
+                }
+                break;
+            }
+            case 'K': {
+                char* end = NULL;
+                hotspot_threshold = strtod(optarg, &end);
+                if (*end != ',') {
+                    fprintf(stderr, usage, argv[0]);
+                    return false;
+                }
+                hotspot_samples = (size_t) strtoul(end + 1, &end, 10);
+                if (*end != '\0' || hotspot_samples == 0) {
+                    fprintf(stderr, usage, argv[0]);
+                    return false;
+                }
+                break;
+            }
+            case 'N':
+                topology_enabled = true;
+                break;
+            case 'E':
+                event_loop_enabled = true;
+                break;
+            case 'P':
+                placement_spec = optarg;
+                break;
+            case 'O':
+                self_usage_enabled = true;
+                break;
+            case 'M':
+                metrics_path = optarg;
+                break;
+            case 'X':
+#ifdef PIPELINE_TRACE
+                trace_path = optarg;
+                break;
+#else
+                fprintf(stderr, "Tracing is not compiled in, build with -DPIPELINE_TRACE=ON\n");
+                return false;
+#endif
+            case 'C': {
+                char* end = NULL;
+                stage_overhead_interval = (size_t) strtoul(optarg, &end, 10);
+                stage_overhead_hardware = strcmp(end, ",hw") == 0;
+                if ((*end != '\0' && !stage_overhead_hardware) || stage_overhead_interval == 0) {
+                    fprintf(stderr, usage, argv[0]);
+                    return false;
+                }
+                break;
+            }
+            case 'L': {
+                char* end = NULL;
+                snapshot_latency_interval = (size_t) strtoul(optarg, &end, 10);
+                if (*end != '\0' || snapshot_latency_interval == 0) {
+                    fprintf(stderr, usage, argv[0]);
+                    return false;
+                }
+                break;
+            }
+            case 'w':
+                record_path = optarg;
+                break;
+            case 'd':
+                procfs_root = optarg;
+                break;
+            case 'D':
+                sysfs_root = optarg;
+                break;
+            case 'b': {
+                char* end = NULL;
+                priming_ms = (size_t) strtoul(optarg, &end, 10);
+                if (*end != '\0' || end == optarg) {
+                    fprintf(stderr, usage, argv[0]);
+                    return false;
+                }
+                break;
+            }
+            case 'i': {
+                const size_t length = strlen(optarg);
+                replay_fast = length > 5 && strcmp(optarg + length - 5, ",fast") == 0;
+                if (replay_fast) {
+                    optarg[length - 5] = '\0';
+                }
+                replay_path = optarg;
+                break;
+            }
+            case 'm':
+                arena_lock_enabled = true;
+                break;
+            case 'V': {
+                char* end = NULL;
+                adaptive_min_ms = (size_t) strtoul(optarg, &end, 10);
+                if (*end == ',') {
+                    adaptive_threshold = strtod(end + 1, &end);
+                }
+                if (*end == ',') {
+                    adaptive_budget_percent = strtod(end + 1, &end);
+                }
+                if (*end != '\0' || adaptive_min_ms == 0 || adaptive_min_ms > 1000 || !(adaptive_budget_percent > 0.0)) {
+                    fprintf(stderr, usage, argv[0]);
+                    return false;
+                }
+                break;
+            }
+            case 'F':
+                if (!frequency_option_parse(optarg)) {
+                    fprintf(stderr, usage, argv[0]);
+                    return false;
+                }
+                break;
+            case 'r':
+                alert_rules_path = optarg;
+                break;
+            case 'a':
+                alert_default_action = optarg;
+                break;
+            case 'R': {
+                char* end = NULL;
+                history_retention_s = (size_t) strtoul(optarg, &end, 10);
+                if (*end != '\0' || history_retention_s == 0) {
+                    fprintf(stderr, usage, argv[0]);
+                    return false;
+                }
+                break;
+            }
+            default:
+                fprintf(stderr, usage, argv[0]);
+                return false;
+        }
+    }
+    /*Replay is recorded already*/
+    if (record_path != NULL && replay_path != NULL) {
+        fprintf(stderr, usage, argv[0]);
         return false;
     }
+    return true;
+}
 
-    double_buffer = circular_buffer_new(128, sizeof(double));
-    if (double_buffer == NULL) {
-        circular_buffer_delete(char_buffer);
+static inline bool frequency_option_parse(const char* const option) {
+    const size_t source_length = strcspn(option, ",");
+    if (source_length == 7 && strncmp(option, "cpufreq", source_length) == 0) {
+        frequency_source = FREQUENCY_SOURCE_CPUFREQ;
+    } else if (source_length == 3 && strncmp(option, "msr", source_length) == 0) {
+        frequency_source = FREQUENCY_SOURCE_MSR;
+    } else {
         return false;
     }
-    
-    logger_buffer = circular_buffer_new(50, sizeof(void*));
-    if (logger_buffer == NULL) {
-        circular_buffer_delete(char_buffer);
-        circular_buffer_delete(double_buffer);
-        return false;
+    if (option[source_length] == ',') {
+        char* end = NULL;
+        frequency_threads = (size_t) strtoul(option + source_length + 1, &end, 10);
+        if (*end != '\0' || frequency_threads == 0) {
+            return false;
+        }
     }
+    frequency_enabled = true;
+    return true;
+}
 
-    watchdog = watchdog_new(4);
-    if (watchdog == NULL) {
-        circular_buffer_delete(char_buffer);
-        circular_buffer_delete(double_buffer);
-        circular_buffer_delete(logger_buffer);
-        return false;
+static inline bool resource_initialization() {
+
+    input_cores = count_input_cores();
+    if (!arena_initialization()) {
+        perror("Initialization failed: memory error\n");
+        goto failure;
     }
 
-    proc_file = fopen("/proc/stat", "rb");
+    char_buffer = circular_buffer_new_mirrored(CHAR_BUFFER_SIZE, sizeof(char));
+    snapshot_buffer = circular_buffer_new_in(arena, SNAPSHOT_BUFFER_SIZE, sizeof(Snapshot));
+    logger_buffer = circular_buffer_new_in(arena, logger_buffer_size(), sizeof(void*));
+    watchdog = watchdog_new_in(arena, WATCHDOG_SIZE);
+    void* payload_pool = arena_alloc(arena, logger_payload_pool_footprint(logger_pool_size()));
+    if (char_buffer == NULL || snapshot_buffer == NULL || logger_buffer == NULL || watchdog == NULL || payload_pool == NULL) {
+        fprintf(stderr, "Initialization failed: arena is too small or mapping failed\n");
+        goto failure;
+    }
+    logger_payload_pool_attach(payload_pool, logger_pool_size());
+
+    char stat_path[4096];
+    snprintf(stat_path, sizeof(stat_path), "%s/stat", procfs_root);
+    proc_file = fopen(stat_path, "rb");
     if (proc_file == NULL) {
         errno = 0;
         perror("IO error\n");
-        circular_buffer_delete(char_buffer);
-        circular_buffer_delete(double_buffer);
-        circular_buffer_delete(logger_buffer);
-        return false;
+        goto failure;
     }
 
     logger_file = fopen("program_log.txt", "w");
     if (logger_file == NULL) {
         errno = 0;
         perror("IO error\n");
-        circular_buffer_delete(char_buffer);
-        circular_buffer_delete(double_buffer);
-        circular_buffer_delete(logger_buffer);
+        goto failure;
+    }
+
+    setvbuf(proc_file, arena_alloc(arena, stat_buffer_size()), _IOFBF, stat_buffer_size());
+    setvbuf(logger_file, arena_alloc(arena, FILE_BUFFER_SIZE), _IOFBF, FILE_BUFFER_SIZE);
+    setvbuf(stdout, stdout_buffer, isatty(STDOUT_FILENO) ? _IOLBF : _IOFBF, sizeof(stdout_buffer));
+    /*Time zone is loaded by the first conversion of time otherwise, i.e. by the first log entry*/
+    tzset();
+
+    if (record_path != NULL) {
+        stat_recorder = stat_recorder_new(record_path);
+        /*Intr line of large machines may be longer than the stat buffer assumes*/
+        if (stat_recorder == NULL || !stat_recorder_reserve(stat_recorder, 2 * stat_buffer_size())) {
+            perror("Recording file error\n");
+            goto failure;
+        }
+    }
+
+    if (replay_path != NULL) {
+        stat_replay = stat_replay_new(replay_path);
+        if (stat_replay != NULL && !stat_replay_reserve(stat_replay, 2 * stat_buffer_size())) {
+            stat_replay_delete(stat_replay);
+            stat_replay = NULL;
+        }
+        if (stat_replay == NULL) {
+            fprintf(stderr, "%s is not a recording\n", replay_path);
+            goto failure;
+        }
+    }
+
+    if (adaptive_min_ms != 0) {
+        adaptive_period = adaptive_period_new_in(arena, (uint64_t) adaptive_min_ms * 1000000u, 1000000000u, adaptive_threshold,
+                                                 adaptive_budget_percent / 100.0, sysconf(_SC_CLK_TCK));
+        if (adaptive_period == NULL) {
+            perror("Initialization failed: memory error\n");
+            goto failure;
+        }
+    }
+
+    if (snapshot_shm_name != NULL) {
+        snapshot_shm = snapshot_shm_create(snapshot_shm_name);
+        if (snapshot_shm == NULL) {
+            perror("Shared memory error\n");
+            goto failure;
+        }
+    }
+
+    if (history_path != NULL) {
+        /*Reader samples at most every period_ms, the ring holds retention at that rate and is synced once a minute*/
+        const size_t period_ms = adaptive_min_ms != 0 ? adaptive_min_ms : 1000;
+        history_store = history_store_open(history_path, input_cores, history_retention_s * 1000 / period_ms,
+                                           60 * 1000 / period_ms);
+        if (history_store == NULL) {
+            perror("History file error\n");
+            goto failure;
+        }
+    }
+
+    if (rollup_enabled && !rollup_initialization()) {
+        perror("Rollup initialization failed\n");
+        goto failure;
+    }
+
+    /*Statistics are computed when they are displayed or exported*/
+    if (usage_stats_mask != 0 || snapshot_shm != NULL) {
+        usage_stats = usage_stats_new_in(arena, input_cores, usage_stats_window);
+        if (usage_stats == NULL) {
+            perror("Initialization failed: memory error\n");
+            goto failure;
+        }
+    }
+
+    if (hotspot_top_n != 0) {
+        hotspot = hotspot_new_in(arena, input_cores, hotspot_top_n, hotspot_threshold, hotspot_samples);
+        if (hotspot == NULL) {
+            perror("Initialization failed: memory error\n");
+            goto failure;
+        }
+    }
+
+    if (alert_rules_path != NULL && !alerts_initialization()) {
+        goto failure;
+    }
+
+    if (topology_enabled) {
+        topology = topology_new_in(arena, sysfs_root);
+        if (topology == NULL) {
+            perror("Topology error\n");
+            goto failure;
+        }
+    }
+
+    if (!event_loop_enabled) {
+        parser_state = thread_parser_state_new_in(arena, topology);
+        if (parser_state == NULL) {
+            fprintf(stderr, "Initialization failed: arena is too small\n");
+            goto failure;
+        }
+    }
+
+    if (placement_spec != NULL && !placement_initialization()) {
+        fprintf(stderr, "Invalid placement policy %s\n", placement_spec);
+        goto failure;
+    }
+
+    if (self_usage_enabled) {
+        self_usage = self_usage_new("/proc");
+        if (self_usage == NULL) {
+            perror("Initialization failed: memory error\n");
+            goto failure;
+        }
+    }
+
+    if (stage_overhead_interval != 0) {
+        stage_overhead = stage_overhead_new("/proc", stage_overhead_interval, stage_overhead_hardware);
+        if (stage_overhead == NULL) {
+            perror("Initialization failed: memory error\n");
+            goto failure;
+        }
+    }
+
+    if (trace_path != NULL) {
+        trace = trace_new_in(arena, TRACE_RING_SIZE);
+        trace_file = trace != NULL ? open(trace_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+        if (trace == NULL || trace_file == -1) {
+            perror(trace == NULL ? "Initialization failed: memory error\n" : "Trace file error\n");
+            goto failure;
+        }
+    }
+
+    if (snapshot_latency_interval != 0) {
+        snapshot_latency = snapshot_latency_new_in(arena, snapshot_latency_interval);
+        if (snapshot_latency == NULL) {
+            perror("Initialization failed: memory error\n");
+            goto failure;
+        }
+    }
+
+    if (metrics_path != NULL) {
+        metrics_endpoint = metrics_endpoint_new_in(arena, metrics_path);
+        if (metrics_endpoint == NULL) {
+            perror("Metrics endpoint error\n");
+            goto failure;
+        }
+        metrics_endpoint_add_queue(metrics_endpoint, "char", char_buffer, &char_buffer_guard);
+        metrics_endpoint_add_queue(metrics_endpoint, "snapshot", snapshot_buffer, &snapshot_buffer_guard);
+        metrics_endpoint_add_queue(metrics_endpoint, "logger", logger_buffer, &logger_buffer_guard);
+        if (snapshot_latency != NULL) {
+            metrics_endpoint_set_latency(metrics_endpoint, snapshot_latency);
+        }
+    }
+
+    /*Like pressure, missing frequency source only disables the feature*/
+    if (frequency_enabled) {
+        frequency_sampler = frequency_sampler_new(sysfs_root, "/dev", frequency_source, frequency_threads);
+        if (frequency_sampler == NULL && frequency_source == FREQUENCY_SOURCE_MSR) {
+            fprintf(stderr, "MSR unavailable (msr module loaded? root?), falling back to cpufreq\n");
+            frequency_sampler = frequency_sampler_new(sysfs_root, "/dev", FREQUENCY_SOURCE_CPUFREQ, frequency_threads);
+        }
+        if (frequency_sampler == NULL) {
+            errno = 0;
+            fprintf(stderr, "Frequency of cores unavailable\n");
+        }
+    }
+
+    /*Kernels without CONFIG_PSI have no /proc/pressure, such resources are skipped*/
+    for (size_t i = 0; pressure_enabled && i < PSI_RESOURCE_COUNT; i++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/pressure/%s", procfs_root, psi_parser_resource_to_str((EPsiResource) i));
+        pressure_files[i] = fopen(path, "rb");
+        if (pressure_files[i] == NULL) {
+            errno = 0;
+            fprintf(stderr, "Pressure stall information unavailable: %s\n", path);
+            continue;
+        }
+        setvbuf(pressure_files[i], arena_alloc(arena, FILE_BUFFER_SIZE), _IOFBF, FILE_BUFFER_SIZE);
+    }
+    return true;
+
+failure:
+    /*Release is NULL-safe, it undoes whatever has been set up so far*/
+    resources_release();
+    return false;
+}
+
+static inline bool placement_initialization() {
+    /*Siblings policy needs topology even without -N*/
+    Topology* placement_topology = topology != NULL ? topology : topology_new(sysfs_root);
+    placement = placement_new(placement_spec, placement_topology);
+    if (placement_topology != topology) {
+        topology_delete(placement_topology);
+    }
+    return placement != NULL;
+}
+
+static inline void thread_place(const EPlacementStage stage, const pthread_t thread) {
+    if (placement != NULL && !placement_apply(placement, stage, thread)) {
+        errno = 0;
+        fprintf(stderr, "Setting affinity of thread failed, it stays unpinned\n");
+    }
+}
+
+static size_t count_input_cores() {
+    size_t result = 0;
+    if (replay_path != NULL) {
+        StatReplay* replay = stat_replay_new(replay_path);
+        if (replay != NULL && stat_replay_next(replay)) {
+            size_t length;
+            const char* data = stat_replay_data(replay, &length);
+            result = proc_parser_count_cores(data, length);
+        }
+        stat_replay_delete(replay);
+    } else {
+        char stat_path[4096];
+        snprintf(stat_path, sizeof(stat_path), "%s/stat", procfs_root);
+        char* content = malloc(STAT_RECORDING_MAX_RECORD);
+        const int file = open(stat_path, O_RDONLY);
+        if (content != NULL && file >= 0) {
+            size_t length = 0;
+            ssize_t count;
+            while (length < STAT_RECORDING_MAX_RECORD
+                   && (count = read(file, &content[length], STAT_RECORDING_MAX_RECORD - length)) > 0) {
+                length += (size_t) count;
+            }
+            result = proc_parser_count_cores(content, length);
+            input_stat_length = length;
+        }
+        if (file >= 0) {
+            close(file);
+        }
+        free(content);
+        /*Offline cpus above the highest online one are missing in /proc/stat of the host*/
+        const long configured = strcmp(procfs_root, "/proc") == 0 ? sysconf(_SC_NPROCESSORS_CONF) : 0;
+        result = configured > 0 && (size_t) configured > result ? (size_t) configured : result;
+    }
+    errno = 0;
+    /*Unknown input gets sinks for the most cores a snapshot can hold*/
+    return result != 0 && result < SNAPSHOT_MAX_CORES ? result : SNAPSHOT_MAX_CORES;
+}
+
+static inline size_t logger_buffer_size() {
+    /*Without logger thread the buffer is flushed after every batch of lines and before every snapshot,
+    hence it has to hold all payloads of one snapshot, alerts included*/
+    return event_loop_enabled ? 512 : 50;
+}
+
+static inline size_t logger_pool_size() {
+    return logger_buffer_size() + LOGGER_POOL_SPARE;
+}
+
+static inline size_t stat_buffer_size() {
+    /*Whole /proc/stat is read by a single read (stdio refills the whole buffer, the event loop preads it),
+    a file rewritten in place (fake_proc) is then torn only by a write racing that one read.
+    Twice the startup length leaves room for growing counters and interrupt lines*/
+    const size_t estimate = FILE_BUFFER_SIZE + input_cores * STAT_LINE_SIZE;
+    return 2 * input_stat_length > estimate ? 2 * input_stat_length : estimate;
+}
+
+static inline bool arena_initialization() {
+    const size_t cores = input_cores;
+    size_t size = arena_footprint(circular_buffer_footprint(SNAPSHOT_BUFFER_SIZE, sizeof(Snapshot)))
+                  + arena_footprint(circular_buffer_footprint(logger_buffer_size(), sizeof(void*)))
+                  + arena_footprint(watchdog_footprint(WATCHDOG_SIZE))
+                  + arena_footprint(logger_payload_pool_footprint(logger_pool_size()))
+                  + arena_footprint(stat_buffer_size())
+                  + arena_footprint(FILE_BUFFER_SIZE) * (1 + PSI_RESOURCE_COUNT);
+    size += event_loop_enabled ? event_loop_footprint(stat_buffer_size()) : arena_footprint(thread_parser_state_footprint());
+    /*Optional state is sized only when its option is given*/
+    if (adaptive_min_ms != 0) {
+        size += arena_footprint(adaptive_period_footprint());
+    }
+    if (rollup_enabled) {
+        size += arena_footprint(rollup_footprint(cores));
+    }
+    if (usage_stats_mask != 0 || snapshot_shm_name != NULL) {
+        size += arena_footprint(usage_stats_footprint(cores, usage_stats_window));
+    }
+    if (hotspot_top_n != 0) {
+        size += arena_footprint(hotspot_footprint(cores, hotspot_top_n));
+    }
+    if (alert_rules_path != NULL) {
+        size += arena_footprint(alert_rules_footprint(cores, ALERT_RULES_CAPACITY))
+                + arena_footprint(alert_action_footprint()) * ALERT_RULES_CAPACITY;
+    }
+    if (topology_enabled) {
+        size += arena_footprint(topology_footprint(sysfs_root));
+    }
+    if (trace_path != NULL) {
+        size += arena_footprint(trace_footprint(TRACE_RING_SIZE));
+    }
+    if (snapshot_latency_interval != 0) {
+        size += arena_footprint(snapshot_latency_footprint());
+    }
+    if (metrics_path != NULL) {
+        size += arena_footprint(metrics_endpoint_footprint());
+    }
+    arena = arena_new(size);
+    if (arena == NULL) {
+        return false;
+    }
+    if (arena_lock_enabled && !arena_lock(arena)) {
+        fprintf(stderr, "Locking memory failed (RLIMIT_MEMLOCK?), buffers stay unlocked\n");
+    }
+    return true;
+}
+
+static inline void memory_report() {
+    const struct mallinfo2 heap = mallinfo2();
+    const AllocGuardStats allocations = alloc_guard_stats();
+    CircularBufferStats char_buffer_stats;
+    circular_buffer_stats(char_buffer, &char_buffer_stats);
+    char message[192];
+    int length = snprintf(message, sizeof(message), "Memory: arena %zu kB (%zu kB carved%s), char ring %zu kB, heap %zu kB",
+                          arena_size(arena) / 1024, arena_used(arena) / 1024, arena_locked(arena) ? ", locked" : "",
+                          char_buffer_stats.capacity / 1024, (heap.uordblks + heap.hblkhd) / 1024);
+    if (allocations.enabled) {
+        length += snprintf(message + length, sizeof(message) - (size_t) length, " in %" PRIu64 " allocations", allocations.allocations);
+    }
+    snprintf(message + length, sizeof(message) - (size_t) length, "\n");
+    fputs(message, stdout);
+    thread_logger_send_log(&logger_buffer_guard, logger_buffer, message, LOGGER_PAYLOAD_TYPE_INFO);
+}
+
+static inline bool rollup_initialization() {
+    rollup = rollup_new_in(arena, input_cores);
+    if (rollup == NULL) {
         return false;
     }
+    for (size_t i = 0; history_path != NULL && i < ROLLUP_TIER_COUNT; i++) {
+        char path[4096];
+        const ERollupTier tier = (ERollupTier) i;
+        const size_t tier_seconds = (size_t) (rollup_tier_length_ns(tier) / 1000000000u);
 
-    setvbuf(proc_file, NULL, _IOFBF, 1);
+        snprintf(path, sizeof(path), "%s.rollup-%s", history_path, rollup_tier_to_str(tier));
+        rollup_stores[i] = history_store_open(path, input_cores * ROLLUP_STATISTICS_COUNT,
+                                              rollup_retention_s[i] / tier_seconds, 1);
+        if (rollup_stores[i] == NULL) {
+            return false;
+        }
+    }
     return true;
 }
 
+static inline void rollup_release() {
+    for (size_t i = 0; i < ROLLUP_TIER_COUNT; i++) {
+        history_store_delete(rollup_stores[i]);
+        rollup_stores[i] = NULL;
+    }
+    rollup_delete(rollup);
+    rollup = NULL;
+}
+
+static inline bool alerts_initialization() {
+    FILE* file = fopen(alert_rules_path, "r");
+    if (file == NULL) {
+        perror("Alert rules file error\n");
+        return false;
+    }
+    alert_rules = alert_rules_new_in(arena, input_cores, ALERT_RULES_CAPACITY);
+    if (alert_rules == NULL) {
+        perror("Initialization failed: memory error\n");
+        fclose(file);
+        return false;
+    }
+
+    char line[512];
+    size_t line_number = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        AlertRule rule;
+        line_number++;
+        /*Comments and blank lines*/
+        const size_t skip = strspn(line, " \t");
+        if (line[skip] == '#' || line[skip] == '\n' || line[skip] == '\0') {
+            continue;
+        }
+        if (!alert_rules_parse_line(line, &rule) || !alert_rules_add(alert_rules, &rule)) {
+            fprintf(stderr, "%s:%zu: invalid rule or too many rules\n", alert_rules_path, line_number);
+            fclose(file);
+            return false;
+        }
+        const size_t index = alert_rules_count(alert_rules) - 1;
+        const char* spec = rule.action[0] != '\0' ? rule.action : alert_default_action;
+        alert_actions[index] = alert_action_new_in(arena, spec);
+        if (alert_actions[index] == NULL) {
+            fprintf(stderr, "%s:%zu: invalid action %s\n", alert_rules_path, line_number, spec);
+            fclose(file);
+            return false;
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static inline void alerts_release() {
+    for (size_t i = 0; i < ALERT_RULES_CAPACITY; i++) {
+        alert_action_delete(alert_actions[i]);
+        alert_actions[i] = NULL;
+    }
+    alert_rules_delete(alert_rules);
+    alert_rules = NULL;
+}
+
 static inline void resources_release() {
 
     circular_buffer_delete(char_buffer);
-    circular_buffer_delete(double_buffer);
+    char_buffer = NULL;
+    circular_buffer_delete(snapshot_buffer);
+    snapshot_buffer = NULL;
 
     LoggerPayload* temp = NULL;
     while (circular_buffer_remove_single(logger_buffer, &temp) > 0) {
@@ -157,13 +988,69 @@ static inline void resources_release() {
     }
     temp = NULL;
     circular_buffer_delete(logger_buffer);
+    logger_buffer = NULL;
     watchdog_delete(watchdog);
     watchdog = NULL;
-    fclose(proc_file);
-    fclose(logger_file);
+    snapshot_shm_delete(snapshot_shm);
+    snapshot_shm = NULL;
+    history_store_delete(history_store);
+    history_store = NULL;
+    rollup_release();
+    usage_stats_delete(usage_stats);
+    usage_stats = NULL;
+    hotspot_delete(hotspot);
+    hotspot = NULL;
+    alerts_release();
+    topology_delete(topology);
+    topology = NULL;
+    frequency_sampler_delete(frequency_sampler);
+    frequency_sampler = NULL;
+    placement_delete(placement);
+    placement = NULL;
+    self_usage_delete(self_usage);
+    self_usage = NULL;
+    stage_overhead_delete(stage_overhead);
+    stage_overhead = NULL;
+    metrics_endpoint_delete(metrics_endpoint);
+    metrics_endpoint = NULL;
+    trace_delete(trace);
+    trace = NULL;
+    if (trace_file != -1) {
+        close(trace_file);
+        trace_file = -1;
+    }
+    snapshot_latency_delete(snapshot_latency);
+    snapshot_latency = NULL;
+    stat_recorder_delete(stat_recorder);
+    stat_recorder = NULL;
+    stat_replay_delete(stat_replay);
+    stat_replay = NULL;
+    adaptive_period_delete(adaptive_period);
+    adaptive_period = NULL;
+    thread_parser_state_delete(parser_state);
+    parser_state = NULL;
+    if (proc_file != NULL) {
+        fclose(proc_file);
+        proc_file = NULL;
+    }
+    if (logger_file != NULL) {
+        fclose(logger_file);
+        logger_file = NULL;
+    }
+    for (size_t i = 0; i < PSI_RESOURCE_COUNT; i++) {
+        if (pressure_files[i] != NULL) {
+            fclose(pressure_files[i]);
+            pressure_files[i] = NULL;
+        }
+    }
+    /*Objects deleted above that were carved from the arena, payloads and stdio buffers of the files
+    go away with it, hence it is unmapped last*/
+    logger_payload_pool_detach();
+    arena_delete(arena);
+    arena = NULL;
 
     pcp_guard_destroy(&char_buffer_guard);
-    pcp_guard_destroy(&double_buffer_guard);
+    pcp_guard_destroy(&snapshot_buffer_guard);
     pcp_guard_destroy(&logger_buffer_guard);
     
     watchdog_unit_destroy(&reader_unit);
@@ -174,12 +1061,25 @@ static inline void resources_release() {
     pthread_mutex_destroy(&working_mutex);
 }
 
-static inline bool threads_initialization() {
+static inline void arguments_initialization() {
 
     reader_args.char_buffer = char_buffer;
     reader_args.char_buffer_guard = &char_buffer_guard;
     reader_args.control_unit = &reader_unit;
     reader_args.input_file = proc_file;
+    for (size_t i = 0; i < PSI_RESOURCE_COUNT; i++) {
+        reader_args.pressure_files[i] = pressure_files[i];
+    }
+    reader_args.frequency_sampler = frequency_sampler;
+    reader_args.stage_overhead = stage_overhead;
+    reader_args.trace = trace;
+    reader_args.recorder = stat_recorder;
+    reader_args.replay = stat_replay;
+    reader_args.replay_fast = replay_fast;
+    reader_args.period = (struct timespec) {.tv_sec = 1, .tv_nsec = 0};
+    reader_args.adaptive_period = adaptive_period;
+    reader_args.started = &threads_started;
+    reader_args.priming = (struct timespec) {.tv_sec = (time_t) (priming_ms / 1000), .tv_nsec = (long) (priming_ms % 1000) * 1000000};
     reader_args.logger_buffer = logger_buffer;
     reader_args.logger_buffer_guard = &logger_buffer_guard;
     reader_args.working = &working;
@@ -188,16 +1088,41 @@ static inline bool threads_initialization() {
     parser_args.char_buffer = char_buffer;
     parser_args.char_buffer_guard = &char_buffer_guard;
     parser_args.control_unit = &parser_unit;
-    parser_args.double_buffer = double_buffer;
-    parser_args.double_buffer_guard = &double_buffer_guard;
+    parser_args.topology = topology;
+    parser_args.stage_overhead = stage_overhead;
+    parser_args.trace = trace;
+    parser_args.adaptive_period = adaptive_period;
+    parser_args.state = parser_state;
+    parser_args.started = &threads_started;
+    parser_args.snapshot_buffer = snapshot_buffer;
+    parser_args.snapshot_buffer_guard = &snapshot_buffer_guard;
     parser_args.is_working = &working;
     parser_args.logger_buffer = logger_buffer;
     parser_args.logger_buffer_guard = &logger_buffer_guard;
     parser_args.working_mutex = &working_mutex;
 
-    printer_args.circular_buffer = double_buffer;
-    printer_args.circular_buffer_guard = &double_buffer_guard;
+    printer_args.circular_buffer = snapshot_buffer;
+    printer_args.circular_buffer_guard = &snapshot_buffer_guard;
     printer_args.control_unit = &printer_unit;
+    printer_args.snapshot_shm = snapshot_shm;
+    printer_args.history_store = history_store;
+    printer_args.rollup = rollup;
+    printer_args.usage_stats = usage_stats;
+    printer_args.usage_stats_mask = usage_stats_mask;
+    printer_args.hotspot = hotspot;
+    printer_args.alert_rules = alert_rules;
+    printer_args.alert_actions = alert_actions;
+    printer_args.self_usage = self_usage;
+    printer_args.stage_overhead = stage_overhead;
+    printer_args.metrics_endpoint = metrics_endpoint;
+    printer_args.trace = trace;
+    printer_args.snapshot_latency = snapshot_latency;
+    printer_args.start_ns = start_ns;
+    printer_args.number_of_cores = input_cores;
+    printer_args.started = &threads_started;
+    for (size_t i = 0; i < ROLLUP_TIER_COUNT; i++) {
+        printer_args.rollup_stores[i] = rollup_stores[i];
+    }
     printer_args.is_working = &working;
     printer_args.logger_buffer = logger_buffer;
     printer_args.logger_buffer_guard = &logger_buffer_guard;
@@ -209,13 +1134,44 @@ static inline bool threads_initialization() {
     logger_args.is_working_mutex = &working_mutex;
     logger_args.logger_output = logger_file;
     logger_args.logger_payload_pointer_buffer = logger_buffer;
+    logger_args.stage_overhead = stage_overhead;
+    logger_args.trace = trace;
+    logger_args.started = &threads_started;
 
     watchdog_args.is_working = &working;
     watchdog_args.mutex = &working_mutex;
     watchdog_args.watchdog = watchdog;
+    watchdog_args.stage_overhead = stage_overhead;
+    watchdog_args.started = &threads_started;
 
-    
+    event_loop_args.input_file = proc_file;
+    for (size_t i = 0; i < PSI_RESOURCE_COUNT; i++) {
+        event_loop_args.pressure_files[i] = pressure_files[i];
+    }
+    event_loop_args.frequency_sampler = frequency_sampler;
+    event_loop_args.recorder = stat_recorder;
+    event_loop_args.replay = stat_replay;
+    event_loop_args.replay_fast = replay_fast;
+    event_loop_args.topology = topology;
+    event_loop_args.period = reader_args.period;
+    event_loop_args.priming = reader_args.priming;
+    event_loop_args.adaptive_period = adaptive_period;
+    event_loop_args.printer_arguments = &printer_args;
+    event_loop_args.logger_output = logger_file;
+    event_loop_args.trace = trace;
+    event_loop_args.trace_file = trace_file;
+    event_loop_args.seal_allocations = true;
+    event_loop_args.read_size = stat_buffer_size();
+    event_loop_args.arena = arena;
+}
+
+static inline bool threads_initialization() {
 
+    arguments_initialization();
+    if (sem_init(&threads_started, 0, 0) != 0) {
+        perror("Semaphore error\n");
+        return false;
+    }
 
     if (pthread_create(&logger_unit.thread_id, NULL, thread_logger, &logger_args) != 0) {
         perror("logger creation error \n");
@@ -224,11 +1180,13 @@ static inline bool threads_initialization() {
         pthread_mutex_unlock(&working_mutex);
         return false;
     }
+    thread_place(PLACEMENT_STAGE_LOGGER, logger_unit.thread_id);
     if (pthread_create(&reader_unit.thread_id, NULL, thread_reader, &reader_args) != 0) {
         perror("Thread reader creation error\n");
         pthread_join(logger_unit.thread_id, NULL);
         return false;
     }
+    thread_place(PLACEMENT_STAGE_READER, reader_unit.thread_id);
     if (pthread_create(&parser_unit.thread_id, NULL, thread_parser, &parser_args) != 0) {
         perror("Thread parser creation error \n");
         pthread_mutex_lock(&working_mutex);
@@ -239,6 +1197,7 @@ static inline bool threads_initialization() {
 
         return false;
     }
+    thread_place(PLACEMENT_STAGE_PARSER, parser_unit.thread_id);
     if (pthread_create(&printer_unit.thread_id, NULL, thread_printer, &printer_args) != 0) {
         perror("Thread printer creation error \n");
         pthread_mutex_lock(&working_mutex);
@@ -249,6 +1208,7 @@ static inline bool threads_initialization() {
         pthread_join(printer_unit.thread_id, NULL);
         return false;
     }
+    thread_place(PLACEMENT_STAGE_PRINTER, printer_unit.thread_id);
     
     watchdog_add_puppy(watchdog, &reader_unit);
     watchdog_add_puppy(watchdog, &parser_unit);
@@ -266,9 +1226,44 @@ static inline bool threads_initialization() {
         pthread_join(logger_unit.thread_id, NULL);
         return false;
     }
+    thread_place(PLACEMENT_STAGE_WATCHDOG, watchdog_id);
+    /*Reader, parser, printer, logger and watchdog*/
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += THREADS_START_TIMEOUT_S;
+    for (size_t i = 0; i < 5; i++) {
+        while (sem_timedwait(&threads_started, &deadline) != 0) {
+            if (errno == ETIMEDOUT) {
+                errno = 0;
+                fprintf(stderr, "Threads did not start in %d s\n", THREADS_START_TIMEOUT_S);
+                threads_stop();
+                return false;
+            }
+            errno = 0;
+        }
+    }
     return true;
 }
 
+static inline void threads_stop() {
+    pthread_mutex_lock(&working_mutex);
+    working = false;
+    pthread_mutex_unlock(&working_mutex);
+    /*Nobody finalizes buffers of a peer that never started, waiting threads are woken until they notice*/
+    PCPGuard* guards[] = {&char_buffer_guard, &snapshot_buffer_guard, &logger_buffer_guard};
+    const struct timespec wakeup_period = {.tv_sec = 0, .tv_nsec = 10000000};
+    for (size_t i = 0; i < THREADS_STOP_WAKEUPS; i++) {
+        for (size_t j = 0; j < sizeof(guards) / sizeof(*guards); j++) {
+            pcp_guard_lock(guards[j]);
+            pcp_guard_notify_producer(guards[j]);
+            pcp_guard_notify_consumer(guards[j]);
+            pcp_guard_unlock(guards[j]);
+        }
+        nanosleep(&wakeup_period, NULL);
+    }
+    threads_join();
+}
+
 static inline void threads_join() {
     pthread_join(reader_unit.thread_id, NULL);
     pthread_join(parser_unit.thread_id, NULL);
@@ -277,8 +1272,45 @@ static inline void threads_join() {
     pthread_join(watchdog_id, NULL);
 }
 
+static inline void pipeline_stats_log() {
+    static const char* names[] = {"char", "snapshot", "logger"};
+    const CircularBuffer* buffers[] = {char_buffer, snapshot_buffer, logger_buffer};
+    const PCPGuard* guards[] = {&char_buffer_guard, &snapshot_buffer_guard, &logger_buffer_guard};
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(*names); i++) {
+        CircularBufferStats buffer_stats;
+        PCPGuardStats guard_stats;
+        if (!circular_buffer_stats(buffers[i], &buffer_stats) || !pcp_guard_stats(guards[i], &guard_stats)) {
+            return;
+        }
+        char message[320];
+        snprintf(message, sizeof(message), "Buffer %s: capacity %zu high-water %zu inserts %" PRIu64 " removals %" PRIu64
+                 " full %" PRIu64 " empty %" PRIu64 ", producer waited %" PRIu64 " times %.3F ms, consumer waited %" PRIu64
+                 " times %.3F ms\n", names[i], buffer_stats.capacity, buffer_stats.high_water_mark, buffer_stats.inserts,
+                 buffer_stats.removals, buffer_stats.full_events, buffer_stats.empty_events, guard_stats.producer_waits,
+                 (double) guard_stats.producer_wait_ns / 1e6, guard_stats.consumer_waits, (double) guard_stats.consumer_wait_ns / 1e6);
+        thread_logger_send_log(&logger_buffer_guard, logger_buffer, message, LOGGER_PAYLOAD_TYPE_INFO);
+    }
+}
+
+static inline void trace_write() {
+    if (trace == NULL || trace_path == NULL) {
+        return;
+    }
+    char message[4200];
+    if (trace_dump_file(trace, trace_file)) {
+        snprintf(message, sizeof(message), "Trace written to %s\n", trace_path);
+        thread_logger_send_log(&logger_buffer_guard, logger_buffer, message, LOGGER_PAYLOAD_TYPE_INFO);
+    } else {
+        snprintf(message, sizeof(message), "Writing trace to %s failed\n", trace_path);
+        thread_logger_send_log(&logger_buffer_guard, logger_buffer, message, LOGGER_PAYLOAD_TYPE_ERROR);
+    }
+}
+
 static void term_handler(int signum) {
     if (signum == SIGTERM || signum == SIGINT) {
         stop_condition = 0;
+    } else if (signum == SIGUSR1) {
+        trace_requested = 1;
     }
 }
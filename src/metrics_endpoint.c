@@ -0,0 +1,485 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "metrics_endpoint.h"
+
+enum {
+    /*1024 cores with usage and frequency take about 100 kB*/
+    METRICS_ENDPOINT_PAGE_SIZE = 256 * 1024,
+    /*Current page, page being sent and page being rendered*/
+    METRICS_ENDPOINT_PAGES = 3,
+    METRICS_ENDPOINT_REQUEST_SIZE = 2048,
+    METRICS_ENDPOINT_HEADER_SIZE = 256,
+    METRICS_ENDPOINT_BACKLOG = 8,
+    /*Slow or stuck client is dropped after this time*/
+    METRICS_ENDPOINT_CLIENT_TIMEOUT_S = 1,
+};
+
+typedef struct MetricsPage {
+    size_t length;
+    bool truncated;
+    char content[METRICS_ENDPOINT_PAGE_SIZE];
+} MetricsPage;
+
+typedef struct MetricsQueue {
+    const char* name;
+    const CircularBuffer* buffer;
+    const PCPGuard* guard;
+} MetricsQueue;
+
+struct MetricsEndpoint {
+    int listen_fd;
+    pthread_t thread;
+    atomic_bool running;
+    /*Published page, NULL before the first publication*/
+    _Atomic(MetricsPage*) current;
+    /*Page the serving thread is sending, the publisher does not render into it*/
+    _Atomic(MetricsPage*) hazard;
+    size_t number_of_queues;
+    MetricsQueue queues[METRICS_ENDPOINT_MAX_QUEUES];
+    const SnapshotLatency* latency;
+    struct sockaddr_un address;
+    /*Memory belongs to an arena and is not freed by metrics_endpoint_delete*/
+    bool arena_owned;
+    MetricsPage pages[METRICS_ENDPOINT_PAGES];
+};
+
+/**
+ * @brief Bind the socket and start the serving thread of zeroed endpoint
+ * @return false if the socket cannot be bound or the thread cannot be started, nothing is left open then
+ */
+static inline bool endpoint_start(MetricsEndpoint* result, const char path[static 2]);
+
+/**
+ * @brief Accept connections and answer them until the endpoint is deleted
+ */
+static void* serve(void* args);
+
+/**
+ * @brief Read single request from client and send the response
+ */
+static void respond(MetricsEndpoint* endpoint, int client);
+
+/**
+ * @brief Send whole buffer, gives up on error or timeout
+ */
+static bool send_all(int client, const char* data, size_t length);
+
+/**
+ * @brief Append formatted text to page, sets truncated if it does not fit
+ */
+static void page_append(MetricsPage* page, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Append "# HELP" and "# TYPE" lines of metric
+ */
+static void page_metric(MetricsPage* page, const char* name, const char* type, const char* help);
+
+static void render_snapshot(MetricsPage* page, const Snapshot* snapshot);
+
+static void render_overhead(MetricsPage* page, const StageOverheadReport* overhead);
+
+static void render_queues(MetricsPage* page, const MetricsQueue* queues, size_t number_of_queues);
+
+static void render_latency(MetricsPage* page, const SnapshotLatency* latency);
+
+MetricsEndpoint* metrics_endpoint_new(const char path[const static 2]) {
+    MetricsEndpoint* result = calloc(1, sizeof(*result));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    if (!endpoint_start(result, path)) {
+        free(result);
+        return NULL;
+    }
+    return result;
+}
+
+MetricsEndpoint* metrics_endpoint_new_in(Arena* const arena, const char path[const static 2]) {
+    MetricsEndpoint* result = arena_alloc(arena, sizeof(*result));
+    if (result == NULL) {
+        return NULL;
+    }
+    result->arena_owned = true;
+    /*Carved space is not returned on failure, the arena is sized for a single endpoint*/
+    return endpoint_start(result, path) ? result : NULL;
+}
+
+size_t metrics_endpoint_footprint() {
+    return sizeof(MetricsEndpoint);
+}
+
+void metrics_endpoint_delete(MetricsEndpoint* const endpoint) {
+    if (endpoint == NULL) {
+        return;
+    }
+    atomic_store(&endpoint->running, false);
+    /*Wakes up the serving thread blocked in accept*/
+    shutdown(endpoint->listen_fd, SHUT_RDWR);
+    pthread_join(endpoint->thread, NULL);
+    close(endpoint->listen_fd);
+    unlink(endpoint->address.sun_path);
+    if (!endpoint->arena_owned) {
+        free(endpoint);
+    }
+}
+
+bool metrics_endpoint_add_queue(MetricsEndpoint* const restrict endpoint, const char name[const restrict static 1],
+                                const CircularBuffer* const restrict buffer, const PCPGuard* const restrict guard) {
+    if (endpoint->number_of_queues == METRICS_ENDPOINT_MAX_QUEUES) {
+        return false;
+    }
+    endpoint->queues[endpoint->number_of_queues] = (MetricsQueue) {.name = name, .buffer = buffer, .guard = guard};
+    endpoint->number_of_queues++;
+    return true;
+}
+
+void metrics_endpoint_set_latency(MetricsEndpoint* const restrict endpoint, const SnapshotLatency* const restrict latency) {
+    endpoint->latency = latency;
+}
+
+bool metrics_endpoint_publish(MetricsEndpoint* const restrict endpoint, const Snapshot* const restrict snapshot,
+                              const StageOverheadReport* const restrict overhead) {
+    const MetricsPage* current = atomic_load(&endpoint->current);
+    const MetricsPage* hazard = atomic_load(&endpoint->hazard);
+    MetricsPage* page = NULL;
+    for (size_t i = 0; i < METRICS_ENDPOINT_PAGES && page == NULL; i++) {
+        if (&endpoint->pages[i] != current && &endpoint->pages[i] != hazard) {
+            page = &endpoint->pages[i];
+        }
+    }
+
+    page->length = 0;
+    page->truncated = false;
+    render_snapshot(page, snapshot);
+    if (overhead != NULL) {
+        render_overhead(page, overhead);
+    }
+    render_queues(page, endpoint->queues, endpoint->number_of_queues);
+    if (endpoint->latency != NULL) {
+        render_latency(page, endpoint->latency);
+    }
+    if (page->truncated) {
+        return false;
+    }
+    atomic_store(&endpoint->current, page);
+    return true;
+}
+
+static void* serve(void* const args) {
+    MetricsEndpoint* endpoint = args;
+    while (atomic_load(&endpoint->running)) {
+        const int client = accept4(endpoint->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client == -1) {
+            errno = 0;
+            continue;
+        }
+        respond(endpoint, client);
+        close(client);
+    }
+    return NULL;
+}
+
+static void respond(MetricsEndpoint* const endpoint, const int client) {
+    const struct timeval timeout = {.tv_sec = METRICS_ENDPOINT_CLIENT_TIMEOUT_S, .tv_usec = 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    /*Only the request line matters, headers are read so the client is not reset while sending them*/
+    char request[METRICS_ENDPOINT_REQUEST_SIZE];
+    size_t length = 0;
+    while (length < sizeof(request) - 1) {
+        const ssize_t received = recv(client, request + length, sizeof(request) - 1 - length, 0);
+        if (received <= 0) {
+            errno = 0;
+            break;
+        }
+        length += (size_t) received;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL) {
+            break;
+        }
+    }
+    request[length] = '\0';
+
+    char header[METRICS_ENDPOINT_HEADER_SIZE];
+    const bool known_path = strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0;
+    if (!known_path) {
+        static const char not_found[] = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\n"
+                                        "Connection: close\r\n\r\nnot found\n";
+        send_all(client, not_found, sizeof(not_found) - 1);
+        return;
+    }
+
+    /*Announce the page before checking it is still current, so the publisher does not reuse it*/
+    MetricsPage* page = NULL;
+    do {
+        page = atomic_load(&endpoint->current);
+        atomic_store(&endpoint->hazard, page);
+    } while (page != atomic_load(&endpoint->current));
+
+    if (page == NULL) {
+        static const char unavailable[] = "HTTP/1.0 503 Service Unavailable\r\nContent-Type: text/plain\r\n"
+                                          "Content-Length: 12\r\nConnection: close\r\n\r\nno snapshot\n";
+        send_all(client, unavailable, sizeof(unavailable) - 1);
+        return;
+    }
+    const int header_length = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\n"
+                                       "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                       "Content-Length: %zu\r\nConnection: close\r\n\r\n", page->length);
+    if (send_all(client, header, (size_t) header_length)) {
+        send_all(client, page->content, page->length);
+    }
+    atomic_store(&endpoint->hazard, NULL);
+}
+
+static bool send_all(const int client, const char* const data, const size_t length) {
+    size_t sent = 0;
+    while (sent < length) {
+        const ssize_t result = send(client, data + sent, length - sent, MSG_NOSIGNAL);
+        if (result <= 0) {
+            errno = 0;
+            return false;
+        }
+        sent += (size_t) result;
+    }
+    return true;
+}
+
+static void page_append(MetricsPage* const page, const char* const format, ...) {
+    if (page->truncated) {
+        return;
+    }
+    const size_t available = sizeof(page->content) - page->length;
+    va_list args;
+    va_start(args, format);
+    const int written = vsnprintf(page->content + page->length, available, format, args);
+    va_end(args);
+    if (written < 0 || (size_t) written >= available) {
+        page->truncated = true;
+        return;
+    }
+    page->length += (size_t) written;
+}
+
+static void page_metric(MetricsPage* const page, const char* const name, const char* const type, const char* const help) {
+    page_append(page, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void render_snapshot(MetricsPage* const page, const Snapshot* const snapshot) {
+    page_metric(page, "tracker_snapshot_sequence", "counter", "Number of snapshots computed by the parser.");
+    page_append(page, "tracker_snapshot_sequence %" PRIu64 "\n", snapshot->sequence);
+    page_metric(page, "tracker_snapshot_timestamp_seconds", "gauge", "Time the latest snapshot was completed.");
+    page_append(page, "tracker_snapshot_timestamp_seconds %lld.%09ld\n",
+                (long long) snapshot->timestamp.tv_sec, (long) snapshot->timestamp.tv_nsec);
+
+    page_metric(page, "tracker_core_usage_percent", "gauge", "Usage of the core since the previous snapshot.");
+    for (size_t i = 0; i < snapshot->number_of_cores; i++) {
+        if (!snapshot->core_invalid[i] && !snapshot->core_stale[i]) {
+            page_append(page, "tracker_core_usage_percent{cpu=\"%" PRIu32 "\"} %.2F\n", snapshot->core_cpu[i], snapshot->core_usage[i]);
+        }
+    }
+    if (snapshot->interval_ns != 0) {
+        page_metric(page, "tracker_sample_interval_seconds", "gauge", "Interval usage of the latest snapshot was computed over.");
+        page_append(page, "tracker_sample_interval_seconds %.6F\n", (double) snapshot->interval_ns / 1e9);
+    }
+    page_metric(page, "tracker_invalid_cores", "gauge", "Cores without usage in the latest snapshot because their counters were reset.");
+    page_append(page, "tracker_invalid_cores %zu\n", snapshot->number_of_invalid_cores);
+    page_metric(page, "tracker_stale_cores", "gauge", "Cores without usage in the latest snapshot because their counters did not advance.");
+    page_append(page, "tracker_stale_cores %zu\n", snapshot->number_of_stale_cores);
+    if (snapshot->has_frequency) {
+        page_metric(page, "tracker_core_frequency_hertz", "gauge", "Frequency of the core sampled in the same tick.");
+        for (size_t i = 0; i < snapshot->number_of_cores; i++) {
+            if (snapshot->core_frequency_khz[i] != 0) {
+                page_append(page, "tracker_core_frequency_hertz{cpu=\"%" PRIu32 "\"} %" PRIu64 "\n",
+                            snapshot->core_cpu[i], (uint64_t) snapshot->core_frequency_khz[i] * 1000);
+            }
+        }
+    }
+    if (snapshot->number_of_packages != 0) {
+        page_metric(page, "tracker_package_usage_percent", "gauge", "Usage of the socket since the previous snapshot.");
+        for (size_t i = 0; i < snapshot->number_of_packages; i++) {
+            page_append(page, "tracker_package_usage_percent{package=\"%" PRIu32 "\"} %.2F\n",
+                        snapshot->package_usage[i].id, snapshot->package_usage[i].usage);
+        }
+    }
+    if (snapshot->number_of_nodes != 0) {
+        page_metric(page, "tracker_node_usage_percent", "gauge", "Usage of the NUMA node since the previous snapshot.");
+        for (size_t i = 0; i < snapshot->number_of_nodes; i++) {
+            page_append(page, "tracker_node_usage_percent{node=\"%" PRIu32 "\"} %.2F\n",
+                        snapshot->node_usage[i].id, snapshot->node_usage[i].usage);
+        }
+    }
+
+    bool any_pressure = false;
+    for (size_t i = 0; i < PSI_RESOURCE_COUNT; i++) {
+        any_pressure = any_pressure || snapshot->pressure[i].available;
+    }
+    if (any_pressure) {
+        page_metric(page, "tracker_pressure_avg10_percent", "gauge", "Pressure stall information, 10 s average.");
+        for (size_t i = 0; i < PSI_RESOURCE_COUNT; i++) {
+            const SnapshotPressure* pressure = &snapshot->pressure[i];
+            if (pressure->available) {
+                const char* resource = psi_parser_resource_to_str((EPsiResource) i);
+                page_append(page, "tracker_pressure_avg10_percent{resource=\"%s\",kind=\"some\"} %.2F\n"
+                            "tracker_pressure_avg10_percent{resource=\"%s\",kind=\"full\"} %.2F\n",
+                            resource, pressure->some_avg10, resource, pressure->full_avg10);
+            }
+        }
+        page_metric(page, "tracker_pressure_stall_seconds_total", "counter", "Total stall time of the resource.");
+        for (size_t i = 0; i < PSI_RESOURCE_COUNT; i++) {
+            const SnapshotPressure* pressure = &snapshot->pressure[i];
+            if (pressure->available) {
+                const char* resource = psi_parser_resource_to_str((EPsiResource) i);
+                page_append(page, "tracker_pressure_stall_seconds_total{resource=\"%s\",kind=\"some\"} %.6F\n"
+                            "tracker_pressure_stall_seconds_total{resource=\"%s\",kind=\"full\"} %.6F\n",
+                            resource, (double) pressure->some_total / 1e6, resource, (double) pressure->full_total / 1e6);
+            }
+        }
+    }
+}
+
+static void render_overhead(MetricsPage* const page, const StageOverheadReport* const overhead) {
+    page_metric(page, "tracker_stage_cpu_seconds_per_snapshot", "gauge",
+                "CPU time of the pipeline stage per snapshot over the latest overhead report.");
+    for (size_t i = 0; i < PLACEMENT_STAGE_COUNT; i++) {
+        page_append(page, "tracker_stage_cpu_seconds_per_snapshot{stage=\"%s\"} %.9F\n",
+                    placement_stage_to_str((EPlacementStage) i), overhead->cpu_us_per_snapshot[i] / 1e6);
+    }
+    page_metric(page, "tracker_stage_messages", "gauge", "Messages processed by the stage over the latest overhead report.");
+    for (size_t i = 0; i < PLACEMENT_STAGE_COUNT; i++) {
+        page_append(page, "tracker_stage_messages{stage=\"%s\"} %" PRIu64 "\n",
+                    placement_stage_to_str((EPlacementStage) i), overhead->messages[i]);
+    }
+    page_metric(page, "tracker_resident_memory_bytes", "gauge", "Resident set size of the tracker.");
+    page_append(page, "tracker_resident_memory_bytes %" PRIu64 "\n", overhead->rss_kb * 1024);
+    page_metric(page, "tracker_resident_memory_peak_bytes", "gauge", "Peak resident set size of the tracker.");
+    page_append(page, "tracker_resident_memory_peak_bytes %" PRIu64 "\n", overhead->peak_rss_kb * 1024);
+
+    bool any_counted = false;
+    for (size_t i = 0; i < PLACEMENT_STAGE_COUNT; i++) {
+        any_counted = any_counted || overhead->hardware_mask[i] != 0;
+    }
+    if (!any_counted) {
+        return;
+    }
+    page_metric(page, "tracker_stage_hardware_events_per_snapshot", "gauge",
+                "Hardware counter of the pipeline stage per snapshot over the latest overhead report.");
+    for (size_t i = 0; i < PLACEMENT_STAGE_COUNT; i++) {
+        for (size_t j = 0; j < PERF_COUNTER_COUNT; j++) {
+            if ((overhead->hardware_mask[i] & (UINT32_C(1) << j)) != 0) {
+                page_append(page, "tracker_stage_hardware_events_per_snapshot{stage=\"%s\",event=\"%s\"} %.0F\n",
+                            placement_stage_to_str((EPlacementStage) i), perf_counter_to_str((EPerfCounter) j),
+                            overhead->hardware_per_snapshot[i][j]);
+            }
+        }
+    }
+}
+
+static void render_queues(MetricsPage* const page, const MetricsQueue* const queues, const size_t number_of_queues) {
+    CircularBufferStats buffer_stats[METRICS_ENDPOINT_MAX_QUEUES];
+    PCPGuardStats guard_stats[METRICS_ENDPOINT_MAX_QUEUES];
+    for (size_t i = 0; i < number_of_queues; i++) {
+        /*Compiled without PIPELINE_STATS*/
+        if (!circular_buffer_stats(queues[i].buffer, &buffer_stats[i]) || !pcp_guard_stats(queues[i].guard, &guard_stats[i])) {
+            return;
+        }
+    }
+    if (number_of_queues == 0) {
+        return;
+    }
+
+    page_metric(page, "tracker_queue_capacity", "gauge", "Capacity of the queue.");
+    for (size_t i = 0; i < number_of_queues; i++) {
+        page_append(page, "tracker_queue_capacity{queue=\"%s\"} %zu\n", queues[i].name, buffer_stats[i].capacity);
+    }
+    page_metric(page, "tracker_queue_high_water_mark", "gauge", "Highest number of elements in the queue.");
+    for (size_t i = 0; i < number_of_queues; i++) {
+        page_append(page, "tracker_queue_high_water_mark{queue=\"%s\"} %zu\n", queues[i].name, buffer_stats[i].high_water_mark);
+    }
+    page_metric(page, "tracker_queue_inserts_total", "counter", "Elements inserted into the queue.");
+    for (size_t i = 0; i < number_of_queues; i++) {
+        page_append(page, "tracker_queue_inserts_total{queue=\"%s\"} %" PRIu64 "\n", queues[i].name, buffer_stats[i].inserts);
+    }
+    page_metric(page, "tracker_queue_removals_total", "counter", "Elements removed from the queue.");
+    for (size_t i = 0; i < number_of_queues; i++) {
+        page_append(page, "tracker_queue_removals_total{queue=\"%s\"} %" PRIu64 "\n", queues[i].name, buffer_stats[i].removals);
+    }
+    page_metric(page, "tracker_queue_full_total", "counter", "Insertions rejected because the queue was full.");
+    for (size_t i = 0; i < number_of_queues; i++) {
+        page_append(page, "tracker_queue_full_total{queue=\"%s\"} %" PRIu64 "\n", queues[i].name, buffer_stats[i].full_events);
+    }
+    page_metric(page, "tracker_queue_empty_total", "counter", "Removals that found the queue empty.");
+    for (size_t i = 0; i < number_of_queues; i++) {
+        page_append(page, "tracker_queue_empty_total{queue=\"%s\"} %" PRIu64 "\n", queues[i].name, buffer_stats[i].empty_events);
+    }
+    page_metric(page, "tracker_queue_waits_total", "counter", "Waits of producer (queue full) and consumer (queue empty).");
+    for (size_t i = 0; i < number_of_queues; i++) {
+        page_append(page, "tracker_queue_waits_total{queue=\"%s\",side=\"producer\"} %" PRIu64 "\n"
+                    "tracker_queue_waits_total{queue=\"%s\",side=\"consumer\"} %" PRIu64 "\n",
+                    queues[i].name, guard_stats[i].producer_waits, queues[i].name, guard_stats[i].consumer_waits);
+    }
+    page_metric(page, "tracker_queue_wait_seconds_total", "counter", "Time producer and consumer spent waiting.");
+    for (size_t i = 0; i < number_of_queues; i++) {
+        page_append(page, "tracker_queue_wait_seconds_total{queue=\"%s\",side=\"producer\"} %.9F\n"
+                    "tracker_queue_wait_seconds_total{queue=\"%s\",side=\"consumer\"} %.9F\n",
+                    queues[i].name, (double) guard_stats[i].producer_wait_ns / 1e9,
+                    queues[i].name, (double) guard_stats[i].consumer_wait_ns / 1e9);
+    }
+}
+
+static void render_latency(MetricsPage* const page, const SnapshotLatency* const latency) {
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+    page_metric(page, "tracker_snapshot_age_seconds", "summary",
+                "Age of the snapshot since the start of its tick, at parse completion and at output.");
+    for (size_t i = 0; i < LATENCY_POINT_COUNT; i++) {
+        const LatencyHistogram* histogram = snapshot_latency_total(latency, (ELatencyPoint) i);
+        const char* point = snapshot_latency_point_to_str((ELatencyPoint) i);
+        for (size_t j = 0; j < sizeof(quantiles) / sizeof(*quantiles); j++) {
+            page_append(page, "tracker_snapshot_age_seconds{point=\"%s\",quantile=\"%g\"} %.9F\n", point, quantiles[j],
+                        (double) latency_histogram_quantile(histogram, quantiles[j]) / 1e9);
+        }
+        page_append(page, "tracker_snapshot_age_seconds_sum{point=\"%s\"} %.9F\n", point, (double) histogram->sum_ns / 1e9);
+        page_append(page, "tracker_snapshot_age_seconds_count{point=\"%s\"} %" PRIu64 "\n", point, histogram->count);
+    }
+}
+
+static inline bool endpoint_start(MetricsEndpoint* const result, const char path[const static 2]) {
+    result->address.sun_family = AF_UNIX;
+    const int path_length = snprintf(result->address.sun_path, sizeof(result->address.sun_path), "%s", path);
+    if (path_length <= 0 || (size_t) path_length >= sizeof(result->address.sun_path)) {
+        return false;
+    }
+    atomic_init(&result->running, true);
+    atomic_init(&result->current, NULL);
+    atomic_init(&result->hazard, NULL);
+
+    result->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (result->listen_fd == -1) {
+        return false;
+    }
+    /*Socket left behind by previous run would make bind fail*/
+    unlink(result->address.sun_path);
+    if (bind(result->listen_fd, (const struct sockaddr*) &result->address, sizeof(result->address)) != 0
+        || listen(result->listen_fd, METRICS_ENDPOINT_BACKLOG) != 0) {
+        close(result->listen_fd);
+        return false;
+    }
+    if (pthread_create(&result->thread, NULL, serve, result) != 0) {
+        close(result->listen_fd);
+        unlink(result->address.sun_path);
+        return false;
+    }
+    return true;
+}
@@ -17,6 +17,12 @@ EPCPStatus pcp_guard_init(PCPGuard* const guard) {
         pthread_cond_destroy(&(guard->consumer));
         return CONSUMER_FAILURE;
     }
+#ifdef PIPELINE_STATS
+    atomic_init(&guard->producer_waits, 0);
+    atomic_init(&guard->producer_wait_ns, 0);
+    atomic_init(&guard->consumer_waits, 0);
+    atomic_init(&guard->consumer_wait_ns, 0);
+#endif
 
     return PCP_SUCCESS;
 }
@@ -34,6 +40,20 @@ EPCPStatus pcp_guard_destroy(PCPGuard* const guard) {
     return PCP_SUCCESS;
 }
 
+bool pcp_guard_stats(const PCPGuard* const restrict guard, PCPGuardStats* const restrict dest) {
+    *dest = (PCPGuardStats) {0};
+#ifdef PIPELINE_STATS
+    dest->producer_waits = atomic_load_explicit(&guard->producer_waits, memory_order_relaxed);
+    dest->producer_wait_ns = atomic_load_explicit(&guard->producer_wait_ns, memory_order_relaxed);
+    dest->consumer_waits = atomic_load_explicit(&guard->consumer_waits, memory_order_relaxed);
+    dest->consumer_wait_ns = atomic_load_explicit(&guard->consumer_wait_ns, memory_order_relaxed);
+    return true;
+#else
+    (void) guard;
+    return false;
+#endif
+}
+
 int pcp_guard_lock(PCPGuard* guard);
 
 int pcp_guard_unlock(PCPGuard* guard);
@@ -47,3 +67,9 @@ int pcp_guard_notify_producer(PCPGuard* guard);
 int pcp_guard_notify_consumer(PCPGuard* guard);
 
 int pcp_guard_timed_wait_for_producer(PCPGuard* restrict guard, const struct timespec *restrict abstime);
+
+#ifdef PIPELINE_STATS
+uint64_t pcp_guard_stats_now_ns(void);
+
+void pcp_guard_stats_wait_end(_Atomic uint64_t* waits, _Atomic uint64_t* wait_ns, uint64_t start_ns);
+#endif
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perf_counters.h"
+
+struct PerfCounters {
+    /*Descriptor of the first opened counter, the group is read through it*/
+    int leader_fd;
+    int fds[PERF_COUNTER_COUNT];
+    uint32_t available;
+    /*Order in which counters joined the group, values of group read come in this order*/
+    size_t number_of_members;
+    EPerfCounter members[PERF_COUNTER_COUNT];
+};
+
+/**
+ * @brief Layout of read(2) with PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+ */
+typedef struct PerfGroupRead {
+    uint64_t number;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t values[PERF_COUNTER_COUNT];
+} PerfGroupRead;
+
+/**
+ * @brief Open single counter of the calling thread, user mode only if kernel mode is denied
+ * @return file descriptor or -1
+ */
+static int counter_open(EPerfCounter counter, int group_fd);
+
+PerfCounters* perf_counters_open() {
+    PerfCounters* result = malloc(sizeof(*result));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    result->leader_fd = -1;
+    result->available = 0;
+    result->number_of_members = 0;
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        result->fds[i] = counter_open((EPerfCounter) i, result->leader_fd);
+        if (result->fds[i] == -1) {
+            continue;
+        }
+        if (result->leader_fd == -1) {
+            result->leader_fd = result->fds[i];
+        }
+        result->available |= UINT32_C(1) << i;
+        result->members[result->number_of_members] = (EPerfCounter) i;
+        result->number_of_members++;
+    }
+    if (result->leader_fd == -1) {
+        free(result);
+        return NULL;
+    }
+    ioctl(result->leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(result->leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return result;
+}
+
+void perf_counters_close(PerfCounters* const counters) {
+    if (counters == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (counters->fds[i] != -1) {
+            close(counters->fds[i]);
+        }
+    }
+    free(counters);
+}
+
+uint32_t perf_counters_available(const PerfCounters* const counters) {
+    return counters->available;
+}
+
+bool perf_counters_read(PerfCounters* const restrict counters, uint64_t values[const restrict static PERF_COUNTER_COUNT]) {
+    PerfGroupRead group;
+    const ssize_t length = read(counters->leader_fd, &group, sizeof(group));
+    if (length < (ssize_t) (3 * sizeof(uint64_t)) || group.number != counters->number_of_members) {
+        errno = 0;
+        return false;
+    }
+    memset(values, 0, sizeof(*values) * PERF_COUNTER_COUNT);
+    /*Multiplexed group was on the PMU only part of the time, the values are extrapolated*/
+    const double scale = group.time_running == 0 || group.time_running >= group.time_enabled
+                         ? 1.0 : (double) group.time_enabled / (double) group.time_running;
+    for (size_t i = 0; i < counters->number_of_members; i++) {
+        values[counters->members[i]] = scale == 1.0 ? group.values[i] : (uint64_t) ((double) group.values[i] * scale);
+    }
+    return true;
+}
+
+const char* perf_counter_to_str(const EPerfCounter counter) {
+    static const char* const names[PERF_COUNTER_COUNT] = {"cycles", "instructions", "cache-misses", "branch-misses"};
+    return (size_t) counter < PERF_COUNTER_COUNT ? names[counter] : "unknown";
+}
+
+static int counter_open(const EPerfCounter counter, const int group_fd) {
+    static const uint64_t configs[PERF_COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[counter];
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    /*The leader starts the whole group*/
+    attr.disabled = group_fd == -1;
+
+    /*pid 0 and cpu -1: the calling thread on any cpu*/
+    long fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+    if (fd == -1 && (errno == EACCES || errno == EPERM)) {
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+    }
+    if (fd == -1) {
+        errno = 0;
+    }
+    return (int) fd;
+}
@@ -0,0 +1,134 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include "placement.h"
+
+enum {
+    /*Longest accepted argument of policy*/
+    PLACEMENT_SPEC_SIZE = 1024,
+};
+
+struct Placement {
+    EPlacementPolicy policy;
+    bool stage_cpus[PLACEMENT_STAGE_COUNT][SNAPSHOT_MAX_CORES];
+};
+
+/**
+ * @brief Pin reader to cpu, parser to its sibling and the rest to both
+ */
+static bool siblings_resolve(Placement* placement, const Topology* topology, size_t cpu);
+
+Placement* placement_new(const char spec[const static 1], const Topology* const topology) {
+    Placement* result = calloc(1, sizeof(*result));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+
+    const size_t policy_length = strcspn(spec, ":");
+    const bool has_argument = spec[policy_length] == ':';
+    if (policy_length == 4 && strncmp(spec, "none", policy_length) == 0 && !has_argument) {
+        result->policy = PLACEMENT_POLICY_NONE;
+        return result;
+    }
+    if (policy_length == 12 && strncmp(spec, "housekeeping", policy_length) == 0 && has_argument) {
+        result->policy = PLACEMENT_POLICY_HOUSEKEEPING;
+        char list[PLACEMENT_SPEC_SIZE];
+        snprintf(list, sizeof(list), "%s", strchr(spec, ':') + 1);
+        bool any = false;
+        if (list[0] != '\0' && topology_cpulist_parse(list, result->stage_cpus[0], SNAPSHOT_MAX_CORES)) {
+            for (size_t cpu = 0; cpu < SNAPSHOT_MAX_CORES; cpu++) {
+                any = any || result->stage_cpus[0][cpu];
+            }
+        }
+        if (!any) {
+            free(result);
+            return NULL;
+        }
+        for (size_t stage = 1; stage < PLACEMENT_STAGE_COUNT; stage++) {
+            memcpy(result->stage_cpus[stage], result->stage_cpus[0], sizeof(result->stage_cpus[0]));
+        }
+        return result;
+    }
+    if (policy_length == 8 && strncmp(spec, "siblings", policy_length) == 0 && topology != NULL) {
+        result->policy = PLACEMENT_POLICY_SIBLINGS;
+        size_t cpu = 0;
+        if (has_argument) {
+            char number[PLACEMENT_SPEC_SIZE];
+            snprintf(number, sizeof(number), "%s", strchr(spec, ':') + 1);
+            char* end = NULL;
+            cpu = (size_t) strtoul(number, &end, 10);
+            if (end == number || *end != '\0') {
+                free(result);
+                return NULL;
+            }
+        }
+        if (!siblings_resolve(result, topology, cpu)) {
+            free(result);
+            return NULL;
+        }
+        return result;
+    }
+    free(result);
+    return NULL;
+}
+
+void placement_delete(Placement* const placement) {
+    free(placement);
+}
+
+bool placement_apply(const Placement* const placement, const EPlacementStage stage, const pthread_t thread) {
+    if (placement->policy == PLACEMENT_POLICY_NONE) {
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t cpu = 0; cpu < SNAPSHOT_MAX_CORES && cpu < CPU_SETSIZE; cpu++) {
+        if (placement->stage_cpus[stage][cpu]) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+EPlacementPolicy placement_policy(const Placement* const placement) {
+    return placement->policy;
+}
+
+bool placement_stage_has_cpu(const Placement* const placement, const EPlacementStage stage, const size_t cpu) {
+    if (placement->policy == PLACEMENT_POLICY_NONE) {
+        return true;
+    }
+    return cpu < SNAPSHOT_MAX_CORES && placement->stage_cpus[stage][cpu];
+}
+
+const char* placement_stage_to_str(const EPlacementStage stage) {
+    static const char* stage_str[PLACEMENT_STAGE_COUNT] = {"reader", "parser", "printer", "logger", "watchdog"};
+    return stage_str[stage];
+}
+
+static bool siblings_resolve(Placement* const placement, const Topology* const topology, const size_t cpu) {
+    const TopologyCpu* reader_cpu = topology_cpu(topology, cpu);
+    if (reader_cpu == NULL) {
+        return false;
+    }
+    /*The first other online thread of the same core*/
+    size_t sibling = cpu;
+    for (size_t candidate = 0; candidate < SNAPSHOT_MAX_CORES && sibling == cpu; candidate++) {
+        const TopologyCpu* candidate_cpu = topology_cpu(topology, candidate);
+        if (candidate != cpu && candidate_cpu != NULL && candidate_cpu->first_sibling == reader_cpu->first_sibling
+            && candidate_cpu->package == reader_cpu->package) {
+            sibling = candidate;
+        }
+    }
+    placement->stage_cpus[PLACEMENT_STAGE_READER][cpu] = true;
+    placement->stage_cpus[PLACEMENT_STAGE_PARSER][sibling] = true;
+    for (size_t stage = PLACEMENT_STAGE_PRINTER; stage < PLACEMENT_STAGE_COUNT; stage++) {
+        placement->stage_cpus[stage][cpu] = true;
+        placement->stage_cpus[stage][sibling] = true;
+    }
+    return true;
+}
@@ -1,6 +1,8 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 #include "proc_parser.h"
 
 
@@ -24,6 +26,32 @@ int proc_parser_parse_line(const char buffer[const restrict static 5], uint64_t
     return symbols_read;
 }
 
+long proc_parser_cpu_number(const char buffer[const static 5]) {
+    if (strncmp(buffer, "cpu", 3) != 0 || isdigit(buffer[3]) == 0) {
+        return -1;
+    }
+    return strtol(&buffer[3], NULL, 10);
+}
+
+size_t proc_parser_count_cores(const char content[const], const size_t length) {
+    size_t result = 0;
+    size_t line = 0;
+    while (line < length) {
+        const char* end = memchr(&content[line], '\n', length - line);
+        const size_t line_end = end == NULL ? length : (size_t) (end - content);
+        /*Content is not null-terminated, the number is parsed within the line*/
+        if (line_end - line > 3 && strncmp(&content[line], "cpu", 3) == 0 && isdigit(content[line + 3]) != 0) {
+            size_t number = 0;
+            for (size_t i = line + 3; i < line_end && isdigit(content[i]) != 0 && number < SIZE_MAX / 10 - 1; i++) {
+                number = number * 10 + (size_t) (content[i] - '0');
+            }
+            result = number + 1 > result ? number + 1 : result;
+        }
+        line = line_end + 1;
+    }
+    return result;
+}
+
 ProcParserCpuTime proc_parser_compute_core_time(const uint64_t core_line[const static 10]) {
     uint64_t idle = core_line[3] + core_line[4];
     uint64_t non_idle = core_line[0] + core_line[1] + core_line[2] + core_line[5] + core_line[6] + core_line[7];
@@ -33,10 +61,23 @@ ProcParserCpuTime proc_parser_compute_core_time(const uint64_t core_line[const s
     return (ProcParserCpuTime) {.total = total, .idle = idle};
 }
 
+bool proc_parser_counters_monotonic(const uint64_t previous[const static 10], const uint64_t current[const static 10]) {
+    for (size_t i = 0; i < 10; i++) {
+        if (current[i] < previous[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 double proc_parser_cpu_time_compute_usage(const ProcParserCpuTime* const previous, const ProcParserCpuTime* const current) {
-    double total_delta = (double)(current->total - previous->total);
-    double idle_delta = (double)(current->idle - previous->idle);
-    total_delta = total_delta > 0.0 ? total_delta : idle_delta;
+    /*Unsigned differences of decreased counters would wrap into huge deltas*/
+    if (current->total <= previous->total || current->idle < previous->idle) {
+        return NAN;
+    }
+    const uint64_t total_delta = current->total - previous->total;
+    uint64_t idle_delta = current->idle - previous->idle;
+    idle_delta = idle_delta < total_delta ? idle_delta : total_delta;
 
-    return (total_delta - idle_delta) / total_delta; 
+    return (double) (total_delta - idle_delta) / (double) total_delta;
 }
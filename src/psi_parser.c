@@ -0,0 +1,125 @@
+#include <string.h>
+#include <stddef.h>
+#include "psi_parser.h"
+
+static const char* resource_str[PSI_RESOURCE_COUNT] = {"cpu", "io", "memory"};
+
+/**
+ * @brief Convert decimal digits pointed by *cursor and move cursor past them
+ * @return true iff at least one digit was consumed
+ */
+static inline bool parse_u64(const char** cursor, uint64_t* result);
+
+/**
+ * @brief Convert fixed point number ("12.34") pointed by *cursor and move cursor past it
+ * @return true iff integer part was present
+ */
+static inline bool parse_fixed_point(const char** cursor, double* result);
+
+/**
+ * @brief Check whether *cursor starts with key and move cursor past it
+ */
+static inline bool consume(const char** cursor, const char* key);
+
+int psi_parser_parse_line(const char buffer[const restrict static 5], PsiParserLine* const restrict result) {
+    const char* cursor = buffer;
+
+    if (!consume(&cursor, "psi ")) {
+        return PSI_PARSER_DISCARD_LINE;
+    }
+
+    PsiParserLine line = {0};
+    bool resource_found = false;
+    for (size_t i = 0; i < PSI_RESOURCE_COUNT; i++) {
+        const size_t length = strlen(resource_str[i]);
+        if (strncmp(cursor, resource_str[i], length) == 0 && cursor[length] == ' ') {
+            line.resource = (EPsiResource) i;
+            cursor += length + 1;
+            resource_found = true;
+            break;
+        }
+    }
+    if (!resource_found) {
+        return PSI_PARSER_FAIL;
+    }
+
+    if (consume(&cursor, "some ")) {
+        line.kind = PSI_KIND_SOME;
+    }
+    else if (consume(&cursor, "full ")) {
+        line.kind = PSI_KIND_FULL;
+    }
+    else {
+        return PSI_PARSER_FAIL;
+    }
+
+    if (!consume(&cursor, "avg10=") || !parse_fixed_point(&cursor, &line.avg10)
+        || !consume(&cursor, " avg60=") || !parse_fixed_point(&cursor, &line.avg60)
+        || !consume(&cursor, " avg300=") || !parse_fixed_point(&cursor, &line.avg300)
+        || !consume(&cursor, " total=") || !parse_u64(&cursor, &line.total)) {
+        return PSI_PARSER_FAIL;
+    }
+
+    *result = line;
+    return PSI_PARSER_SUCCESS;
+}
+
+uint64_t psi_parser_stall_delta(const uint64_t previous, const uint64_t current) {
+    return current >= previous ? current - previous : 0;
+}
+
+const char* psi_parser_resource_to_str(const EPsiResource resource) {
+    if ((size_t) resource >= PSI_RESOURCE_COUNT) {
+        return NULL;
+    }
+    return resource_str[resource];
+}
+
+static inline bool parse_u64(const char** const cursor, uint64_t* const result) {
+    const char* temp = *cursor;
+    uint64_t value = 0;
+
+    while (*temp >= '0' && *temp <= '9') {
+        value = value * 10 + (uint64_t)(*temp - '0');
+        temp++;
+    }
+    if (temp == *cursor) {
+        return false;
+    }
+    *cursor = temp;
+    *result = value;
+    return true;
+}
+
+static inline bool parse_fixed_point(const char** const cursor, double* const result) {
+    uint64_t integer_part = 0;
+    if (!parse_u64(cursor, &integer_part)) {
+        return false;
+    }
+    double value = (double) integer_part;
+
+    if (**cursor == '.') {
+        (*cursor)++;
+        double scale = 0.1;
+        while (**cursor >= '0' && **cursor <= '9') {
+            value += scale * (double)(**cursor - '0');
+            scale /= 10.0;
+            (*cursor)++;
+        }
+    }
+    *result = value;
+    return true;
+}
+
+static inline bool consume(const char** const cursor, const char* key) {
+    const char* temp = *cursor;
+    while (*key != '\0') {
+        if (*temp != *key) {
+            return false;
+        }
+        temp++;
+        key++;
+    }
+    *cursor = temp;
+    return true;
+}
@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+#include "rollup.h"
+#include "usage_histogram.h"
+
+typedef struct CoreAccumulator {
+    double min;
+    double max;
+    /*Usage weighted by interval of the snapshot in seconds*/
+    double sum;
+    double weight;
+    uint32_t count;
+    UsageHistogram histogram;
+} CoreAccumulator;
+
+typedef struct RollupTierState {
+    bool started;
+    bool completed;
+    uint64_t start_ns;
+    size_t number_of_samples;
+    RollupWindow window;
+    CoreAccumulator* accumulators;
+    RollupCoreStats* stats;
+} RollupTierState;
+
+struct Rollup {
+    size_t number_of_cores;
+    RollupTierState tiers[ROLLUP_TIER_COUNT];
+    /*Memory belongs to an arena and is not freed by rollup_delete*/
+    bool arena_owned;
+    /*Follows the accumulators in the same block*/
+    RollupCoreStats* stats;
+    CoreAccumulator accumulators[]; /*FAM*/
+};
+
+static const uint64_t tier_length_ns[ROLLUP_TIER_COUNT] = {
+    (uint64_t) 10 * 1000000000u,
+    (uint64_t) 60 * 1000000000u,
+    (uint64_t) 3600 * 1000000000u,
+};
+
+/**
+ * @brief Compute statistics of the current window, store them in tier->window and clear accumulators
+ */
+static inline void complete_window(RollupTierState* tier, ERollupTier tier_id, size_t number_of_cores);
+
+static inline void clear_accumulators(CoreAccumulator* accumulators, size_t number_of_cores);
+
+/**
+ * @brief Lay out and initialize aggregator in zeroed memory of rollup_footprint bytes
+ */
+static inline Rollup* rollup_initialize(void* memory, size_t number_of_cores);
+
+Rollup* rollup_new(const size_t number_of_cores) {
+    if (number_of_cores == 0) {
+        return NULL;
+    }
+
+    void* memory = calloc(1, rollup_footprint(number_of_cores));
+    if (memory == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    return rollup_initialize(memory, number_of_cores);
+}
+
+Rollup* rollup_new_in(Arena* const arena, const size_t number_of_cores) {
+    if (number_of_cores == 0) {
+        return NULL;
+    }
+
+    void* memory = arena_alloc(arena, rollup_footprint(number_of_cores));
+    if (memory == NULL) {
+        return NULL;
+    }
+    Rollup* result = rollup_initialize(memory, number_of_cores);
+    result->arena_owned = true;
+    return result;
+}
+
+size_t rollup_footprint(const size_t number_of_cores) {
+    return sizeof(Rollup) + (sizeof(CoreAccumulator) + sizeof(RollupCoreStats)) * number_of_cores * ROLLUP_TIER_COUNT;
+}
+
+void rollup_delete(Rollup* const rollup) {
+    if (rollup != NULL && rollup->arena_owned) {
+        return;
+    }
+    free(rollup);
+}
+
+bool rollup_add(Rollup* const restrict rollup, const Snapshot* const restrict snapshot) {
+    const uint64_t timestamp_ns = (uint64_t) snapshot->timestamp.tv_sec * 1000000000u + (uint64_t) snapshot->timestamp.tv_nsec;
+    const size_t number_of_cores = snapshot->number_of_cores < rollup->number_of_cores ? snapshot->number_of_cores : rollup->number_of_cores;
+    /*Snapshots of unknown interval count as 1 s, the default period*/
+    const double weight = snapshot->interval_ns != 0 ? (double) snapshot->interval_ns / 1e9 : 1.0;
+    bool any_completed = false;
+
+    for (size_t i = 0; i < ROLLUP_TIER_COUNT; i++) {
+        RollupTierState* tier = &rollup->tiers[i];
+        const uint64_t aligned_start = timestamp_ns - timestamp_ns % tier_length_ns[i];
+        tier->completed = false;
+
+        /*Clock stepping backwards keeps the sample in the current window*/
+        if (tier->started && aligned_start > tier->start_ns) {
+            complete_window(tier, (ERollupTier) i, rollup->number_of_cores);
+            any_completed = true;
+        }
+        if (!tier->started || tier->completed) {
+            tier->started = true;
+            tier->start_ns = aligned_start;
+        }
+
+        for (size_t core = 0; core < number_of_cores; core++) {
+            const double usage = snapshot->core_usage[core];
+            if (isnan(usage)) {
+                continue;
+            }
+            CoreAccumulator* accumulator = &tier->accumulators[core];
+            accumulator->min = usage < accumulator->min ? usage : accumulator->min;
+            accumulator->max = usage > accumulator->max ? usage : accumulator->max;
+            accumulator->sum += usage * weight;
+            accumulator->weight += weight;
+            accumulator->count++;
+            usage_histogram_add(&accumulator->histogram, usage);
+        }
+        tier->number_of_samples++;
+    }
+    return any_completed;
+}
+
+const RollupWindow* rollup_completed(const Rollup* const rollup, const ERollupTier tier) {
+    if ((size_t) tier >= ROLLUP_TIER_COUNT || !rollup->tiers[tier].completed) {
+        return NULL;
+    }
+    return &rollup->tiers[tier].window;
+}
+
+uint64_t rollup_tier_length_ns(const ERollupTier tier) {
+    return tier_length_ns[tier];
+}
+
+const char* rollup_tier_to_str(const ERollupTier tier) {
+    static const char* tier_str[ROLLUP_TIER_COUNT] = {"10s", "1m", "1h"};
+    return tier_str[tier];
+}
+
+static inline void complete_window(RollupTierState* const tier, const ERollupTier tier_id, const size_t number_of_cores) {
+    for (size_t core = 0; core < number_of_cores; core++) {
+        const CoreAccumulator* accumulator = &tier->accumulators[core];
+        RollupCoreStats* stats = &tier->stats[core];
+
+        if (accumulator->count == 0) {
+            *stats = (RollupCoreStats) {.min = NAN, .max = NAN, .avg = NAN, .p95 = NAN};
+            continue;
+        }
+        double p95 = usage_histogram_quantile(&accumulator->histogram, 0.95);
+        /*Histogram has 1% resolution, estimate cannot leave observed range*/
+        p95 = p95 < accumulator->min ? accumulator->min : (p95 > accumulator->max ? accumulator->max : p95);
+        stats->min = accumulator->min;
+        stats->max = accumulator->max;
+        stats->avg = accumulator->sum / accumulator->weight;
+        stats->p95 = p95;
+    }
+
+    tier->window = (RollupWindow) {
+        .tier = tier_id,
+        .start_ns = tier->start_ns,
+        .number_of_samples = tier->number_of_samples,
+        .number_of_cores = number_of_cores,
+        .cores = tier->stats,
+    };
+    tier->completed = true;
+    tier->number_of_samples = 0;
+    clear_accumulators(tier->accumulators, number_of_cores);
+}
+
+static inline void clear_accumulators(CoreAccumulator* const accumulators, const size_t number_of_cores) {
+    for (size_t core = 0; core < number_of_cores; core++) {
+        accumulators[core].min = INFINITY;
+        accumulators[core].max = -INFINITY;
+        accumulators[core].sum = 0.0;
+        accumulators[core].weight = 0.0;
+        accumulators[core].count = 0;
+        usage_histogram_clear(&accumulators[core].histogram);
+    }
+}
+
+static inline Rollup* rollup_initialize(void* const memory, const size_t number_of_cores) {
+    Rollup* result = memory;
+    result->stats = (RollupCoreStats*) &result->accumulators[number_of_cores * ROLLUP_TIER_COUNT];
+    result->number_of_cores = number_of_cores;
+    for (size_t i = 0; i < ROLLUP_TIER_COUNT; i++) {
+        RollupTierState* tier = &result->tiers[i];
+        tier->accumulators = &result->accumulators[i * number_of_cores];
+        tier->stats = &result->stats[i * number_of_cores];
+        clear_accumulators(tier->accumulators, number_of_cores);
+    }
+    return result;
+}
@@ -0,0 +1,245 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "self_usage.h"
+
+enum {
+    SELF_USAGE_PATH_SIZE = 4096,
+    SELF_USAGE_FILE_SIZE = 1024,
+    SELF_USAGE_DIRECTORY_SIZE = 4096,
+    /*Threads of the tracker: pipeline, watchdog and optional frequency workers*/
+    SELF_USAGE_MAX_THREADS = 256,
+    /*Positions of fields after the command name, @see man proc(5), field 3 has index 0*/
+    SELF_USAGE_FIELD_UTIME = 11,
+    SELF_USAGE_FIELD_STIME = 12,
+    SELF_USAGE_FIELD_PROCESSOR = 36,
+};
+
+/*Entry returned by getdents64, @see man getdents(2)*/
+typedef struct SelfUsageDirent {
+    uint64_t inode;
+    int64_t offset;
+    unsigned short length;
+    unsigned char type;
+    char name[];
+} SelfUsageDirent;
+
+typedef struct SelfUsageThread {
+    unsigned long tid;
+    uint64_t ticks;
+} SelfUsageThread;
+
+struct SelfUsage {
+    bool primed;
+    size_t number_of_threads;
+    size_t number_of_cores;
+    SelfUsageThread threads[SELF_USAGE_MAX_THREADS];
+    /*Indexed by cpu number: time of own threads accumulated since start and at the previous update*/
+    uint64_t own_ticks[SNAPSHOT_MAX_CORES];
+    uint64_t previous_own_ticks[SNAPSHOT_MAX_CORES];
+    /*Indexed by position in snapshot*/
+    ProcParserCpuTime previous_time[SNAPSHOT_MAX_CORES];
+    uint32_t previous_cpu[SNAPSHOT_MAX_CORES];
+    double usage[SNAPSHOT_MAX_CORES];
+    char task_path[]; /*FAM*/
+};
+
+/**
+ * @brief Read stat of every thread and add time elapsed since the previous update to own_ticks
+ */
+static bool threads_read(SelfUsage* self_usage);
+
+/**
+ * @brief Read stat of thread named name in the task directory and account its time
+ */
+static void thread_read(SelfUsage* self_usage, const char* name, SelfUsageThread threads[], size_t* number_of_threads);
+
+/**
+ * @brief Find thread in table of the previous update
+ * @return ticks of the thread at the previous update, or 0 if it has not been seen yet
+ */
+static uint64_t thread_previous_ticks(const SelfUsage* self_usage, unsigned long tid, bool* found);
+
+SelfUsage* self_usage_new(const char proc_root[const static 1]) {
+    char path[SELF_USAGE_PATH_SIZE];
+    const int path_length = snprintf(path, sizeof(path), "%s/self/task", proc_root);
+    if (path_length < 0 || (size_t) path_length >= sizeof(path)) {
+        return NULL;
+    }
+    SelfUsage* result = calloc(1, sizeof(*result) + sizeof(*result->task_path) * ((size_t) path_length + 1));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    memcpy(result->task_path, path, (size_t) path_length + 1);
+    for (size_t i = 0; i < SNAPSHOT_MAX_CORES; i++) {
+        result->usage[i] = NAN;
+    }
+    return result;
+}
+
+void self_usage_delete(SelfUsage* const self_usage) {
+    free(self_usage);
+}
+
+bool self_usage_update(SelfUsage* const restrict self_usage, const Snapshot* const restrict snapshot) {
+    if (!threads_read(self_usage)) {
+        return false;
+    }
+
+    const size_t number_of_cores = snapshot->number_of_cores < SNAPSHOT_MAX_CORES ? snapshot->number_of_cores : SNAPSHOT_MAX_CORES;
+    for (size_t i = 0; i < number_of_cores; i++) {
+        const uint32_t cpu = snapshot->core_cpu[i];
+        const ProcParserCpuTime* current = &snapshot->core_time[i];
+        const bool comparable = self_usage->primed && i < self_usage->number_of_cores
+                                && self_usage->previous_cpu[i] == cpu && cpu < SNAPSHOT_MAX_CORES
+                                && current->total > self_usage->previous_time[i].total;
+        if (comparable) {
+            const uint64_t own = self_usage->own_ticks[cpu] - self_usage->previous_own_ticks[cpu];
+            const uint64_t total = current->total - self_usage->previous_time[i].total;
+            /*Ticks of threads and of /proc/stat are sampled at slightly different moments*/
+            self_usage->usage[i] = own >= total ? 100.0 : (double) own / (double) total * 100.0;
+        } else {
+            self_usage->usage[i] = NAN;
+        }
+        self_usage->previous_time[i] = *current;
+        self_usage->previous_cpu[i] = cpu;
+    }
+    for (size_t i = number_of_cores; i < self_usage->number_of_cores; i++) {
+        self_usage->usage[i] = NAN;
+    }
+    self_usage->number_of_cores = number_of_cores;
+    memcpy(self_usage->previous_own_ticks, self_usage->own_ticks, sizeof(self_usage->own_ticks));
+    self_usage->primed = true;
+    return true;
+}
+
+double self_usage_get(const SelfUsage* const self_usage, const size_t index) {
+    if (index >= self_usage->number_of_cores) {
+        return NAN;
+    }
+    return self_usage->usage[index];
+}
+
+bool self_usage_parse_stat(const char buffer[const restrict static 1], uint64_t* const restrict ticks,
+                           size_t* const restrict cpu) {
+    char content[SELF_USAGE_FILE_SIZE];
+    snprintf(content, sizeof(content), "%s", buffer);
+    /*Command name may contain spaces and parentheses, fields start after the last ')'*/
+    const char* cursor = strrchr(content, ')');
+    if (cursor == NULL || cursor[1] != ' ') {
+        return false;
+    }
+    cursor += 2;
+    uint64_t utime = 0;
+    uint64_t stime = 0;
+    for (size_t field = 0; field <= SELF_USAGE_FIELD_PROCESSOR; field++) {
+        /*The state field is a letter, the rest are numbers*/
+        if (field == 0) {
+            if (*cursor == '\0' || cursor[1] != ' ') {
+                return false;
+            }
+            cursor += 2;
+            continue;
+        }
+        /*Negative fields (priority, nice) wrap around, they are not used*/
+        char* end = NULL;
+        const unsigned long long value = strtoull(cursor, &end, 10);
+        if (end == cursor) {
+            return false;
+        }
+        if (field == SELF_USAGE_FIELD_UTIME) {
+            utime = value;
+        } else if (field == SELF_USAGE_FIELD_STIME) {
+            stime = value;
+        } else if (field == SELF_USAGE_FIELD_PROCESSOR) {
+            *cpu = (size_t) value;
+        }
+        cursor = end;
+    }
+    *ticks = utime + stime;
+    return true;
+}
+
+static bool threads_read(SelfUsage* const self_usage) {
+    /*Directory is listed by getdents64 into a buffer on the stack, opendir would allocate on every update*/
+    const int directory = open(self_usage->task_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory < 0) {
+        errno = 0;
+        return false;
+    }
+    SelfUsageThread threads[SELF_USAGE_MAX_THREADS];
+    size_t number_of_threads = 0;
+    _Alignas(SelfUsageDirent) char entries[SELF_USAGE_DIRECTORY_SIZE];
+    long length;
+
+    while (number_of_threads < SELF_USAGE_MAX_THREADS
+           && (length = syscall(SYS_getdents64, directory, entries, sizeof(entries))) > 0) {
+        for (long position = 0; position < length && number_of_threads < SELF_USAGE_MAX_THREADS;) {
+            const SelfUsageDirent* entry = (const SelfUsageDirent*) (entries + position);
+            thread_read(self_usage, entry->name, threads, &number_of_threads);
+            position += entry->length;
+        }
+    }
+    close(directory);
+
+    memcpy(self_usage->threads, threads, sizeof(*threads) * number_of_threads);
+    self_usage->number_of_threads = number_of_threads;
+    errno = 0;
+    return true;
+}
+
+static void thread_read(SelfUsage* const self_usage, const char* const name, SelfUsageThread threads[],
+                        size_t* const number_of_threads) {
+    char* end = NULL;
+    const unsigned long tid = strtoul(name, &end, 10);
+    if (end == name || *end != '\0') {
+        return;
+    }
+    char path[SELF_USAGE_PATH_SIZE];
+    char content[SELF_USAGE_FILE_SIZE];
+    snprintf(path, sizeof(path), "%s/%s/stat", self_usage->task_path, name);
+    const int file = open(path, O_RDONLY | O_CLOEXEC);
+    if (file < 0) {
+        /*Thread has exited in the meantime*/
+        errno = 0;
+        return;
+    }
+    const ssize_t length = read(file, content, sizeof(content) - 1);
+    close(file);
+    if (length <= 0) {
+        errno = 0;
+        return;
+    }
+    content[length] = '\0';
+
+    uint64_t ticks;
+    size_t cpu;
+    if (!self_usage_parse_stat(content, &ticks, &cpu)) {
+        return;
+    }
+    bool found = false;
+    const uint64_t previous_ticks = thread_previous_ticks(self_usage, tid, &found);
+    /*Time of threads present at the first update was spent before the measurement started*/
+    if ((found || self_usage->primed) && cpu < SNAPSHOT_MAX_CORES && ticks >= previous_ticks) {
+        self_usage->own_ticks[cpu] += ticks - previous_ticks;
+    }
+    threads[*number_of_threads] = (SelfUsageThread) {.tid = tid, .ticks = ticks};
+    (*number_of_threads)++;
+}
+
+static uint64_t thread_previous_ticks(const SelfUsage* const self_usage, const unsigned long tid, bool* const found) {
+    for (size_t i = 0; i < self_usage->number_of_threads; i++) {
+        if (self_usage->threads[i].tid == tid) {
+            *found = true;
+            return self_usage->threads[i].ticks;
+        }
+    }
+    *found = false;
+    return 0;
+}
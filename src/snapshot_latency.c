@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "snapshot_latency.h"
+
+struct SnapshotLatency {
+    size_t interval;
+    /*Snapshots recorded in the current interval*/
+    size_t number_of_snapshots;
+    /*Memory belongs to an arena and is not freed by snapshot_latency_delete*/
+    bool arena_owned;
+    LatencyHistogram total[LATENCY_POINT_COUNT];
+    /*Cleared by the first record after the report*/
+    LatencyHistogram window[LATENCY_POINT_COUNT];
+};
+
+/**
+ * @brief Set interval and clear histograms
+ */
+static inline SnapshotLatency* latency_initialize(SnapshotLatency* latency, size_t interval);
+
+SnapshotLatency* snapshot_latency_new(const size_t interval) {
+    if (interval == 0) {
+        return NULL;
+    }
+    SnapshotLatency* result = malloc(sizeof(*result));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    result->arena_owned = false;
+    return latency_initialize(result, interval);
+}
+
+SnapshotLatency* snapshot_latency_new_in(Arena* const arena, const size_t interval) {
+    if (interval == 0) {
+        return NULL;
+    }
+    SnapshotLatency* result = arena_alloc(arena, sizeof(*result));
+    if (result == NULL) {
+        return NULL;
+    }
+    result->arena_owned = true;
+    return latency_initialize(result, interval);
+}
+
+size_t snapshot_latency_footprint() {
+    return sizeof(SnapshotLatency);
+}
+
+void snapshot_latency_delete(SnapshotLatency* const latency) {
+    if (latency != NULL && latency->arena_owned) {
+        return;
+    }
+    free(latency);
+}
+
+uint64_t snapshot_latency_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+bool snapshot_latency_record(SnapshotLatency* const restrict latency, const Snapshot* const restrict snapshot, const uint64_t now_ns) {
+    if (snapshot->capture_ns == 0) {
+        return false;
+    }
+    if (latency->number_of_snapshots == latency->interval) {
+        latency->number_of_snapshots = 0;
+        for (size_t i = 0; i < LATENCY_POINT_COUNT; i++) {
+            latency_histogram_clear(&latency->window[i]);
+        }
+    }
+    /*Stamps come from the same monotonic clock, but a malformed line must not wrap the age*/
+    const uint64_t ages[LATENCY_POINT_COUNT] = {
+        snapshot->parsed_ns > snapshot->capture_ns ? snapshot->parsed_ns - snapshot->capture_ns : 0,
+        now_ns > snapshot->capture_ns ? now_ns - snapshot->capture_ns : 0,
+    };
+    for (size_t i = 0; i < LATENCY_POINT_COUNT; i++) {
+        latency_histogram_add(&latency->total[i], ages[i]);
+        latency_histogram_add(&latency->window[i], ages[i]);
+    }
+    latency->number_of_snapshots++;
+    return latency->number_of_snapshots == latency->interval;
+}
+
+const LatencyHistogram* snapshot_latency_total(const SnapshotLatency* const latency, const ELatencyPoint point) {
+    return &latency->total[point];
+}
+
+int snapshot_latency_format(const SnapshotLatency* const restrict latency, char* const restrict buffer, const size_t size) {
+    int length = snprintf(buffer, size, "Latency over %zu snapshots:", latency->number_of_snapshots);
+    for (size_t i = 0; i < LATENCY_POINT_COUNT && length >= 0 && (size_t) length < size; i++) {
+        const LatencyHistogram* histogram = &latency->window[i];
+        const int written = snprintf(buffer + length, size - (size_t) length, "%s %s p50 %.2Fus p90 %.2Fus p99 %.2Fus max %.2Fus",
+                                     i == 0 ? "" : ",", snapshot_latency_point_to_str((ELatencyPoint) i),
+                                     (double) latency_histogram_quantile(histogram, 0.5) / 1e3,
+                                     (double) latency_histogram_quantile(histogram, 0.9) / 1e3,
+                                     (double) latency_histogram_quantile(histogram, 0.99) / 1e3,
+                                     (double) histogram->max_ns / 1e3);
+        length = written < 0 ? written : length + written;
+    }
+    if (length >= 0 && (size_t) length < size) {
+        const int written = snprintf(buffer + length, size - (size_t) length, "\n");
+        length = written < 0 ? written : length + written;
+    }
+    return length;
+}
+
+int snapshot_latency_format_line(const uint64_t capture_ns, char* const buffer, const size_t size) {
+    return snprintf(buffer, size, "tick %" PRIu64 "\n", capture_ns);
+}
+
+int snapshot_latency_parse_line(const char buffer[const restrict static 5], uint64_t* const restrict capture_ns) {
+    if (strncmp(buffer, "tick ", 5) != 0) {
+        return SNAPSHOT_LATENCY_DISCARD_LINE;
+    }
+    /*strtoull would accept sign and leading spaces*/
+    const char* digits = strchr(buffer, ' ') + 1;
+    if (*digits < '0' || *digits > '9') {
+        return SNAPSHOT_LATENCY_FAIL;
+    }
+    char* end = NULL;
+    errno = 0;
+    const unsigned long long value = strtoull(digits, &end, 10);
+    if ((*end != '\0' && *end != '\n') || errno != 0) {
+        errno = 0;
+        return SNAPSHOT_LATENCY_FAIL;
+    }
+    *capture_ns = (uint64_t) value;
+    return SNAPSHOT_LATENCY_SUCCESS;
+}
+
+const char* snapshot_latency_point_to_str(const ELatencyPoint point) {
+    static const char* const names[LATENCY_POINT_COUNT] = {"parse", "output"};
+    return (size_t) point < LATENCY_POINT_COUNT ? names[point] : "unknown";
+}
+
+static inline SnapshotLatency* latency_initialize(SnapshotLatency* const latency, const size_t interval) {
+    latency->interval = interval;
+    latency->number_of_snapshots = 0;
+    for (size_t i = 0; i < LATENCY_POINT_COUNT; i++) {
+        latency_histogram_clear(&latency->total[i]);
+        latency_histogram_clear(&latency->window[i]);
+    }
+    return latency;
+}
@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot_shm.h"
+
+enum {
+    SNAPSHOT_SHM_MAGIC = 0x54534e50, /*"TSNP"*/
+    SNAPSHOT_SHM_VERSION = 4,
+    /*Upper bound of read attempts, reader gives up instead of spinning forever*/
+    SNAPSHOT_SHM_MAX_ATTEMPTS = 1000,
+};
+
+/**
+ * @brief Layout of the segment. seqlock is odd while the writer is modifying the record,
+ * each publication increments it by 2.
+ */
+typedef struct SnapshotShmSegment {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t max_cores;
+    _Atomic uint64_t seqlock;
+    SnapshotShmRecord record;
+} SnapshotShmSegment;
+
+struct SnapshotShm {
+    SnapshotShmSegment* segment;
+    bool writable;
+    char name[]; /*FAM*/
+};
+
+/**
+ * @brief Allocate handle and copy name into it
+ */
+static inline SnapshotShm* handle_new(const char* name, SnapshotShmSegment* segment, bool writable);
+
+SnapshotShm* snapshot_shm_create(const char name[const static 2]) {
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd == -1) {
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(SnapshotShmSegment)) == -1) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    SnapshotShmSegment* segment = mmap(NULL, sizeof(*segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    atomic_store_explicit(&segment->seqlock, 0, memory_order_relaxed);
+    segment->max_cores = SNAPSHOT_MAX_CORES;
+    segment->version = SNAPSHOT_SHM_VERSION;
+    segment->magic = SNAPSHOT_SHM_MAGIC;
+
+    SnapshotShm* result = handle_new(name, segment, true);
+    if (result == NULL) {
+        munmap(segment, sizeof(*segment));
+        shm_unlink(name);
+    }
+    return result;
+}
+
+SnapshotShm* snapshot_shm_open(const char name[const static 2]) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) {
+        return NULL;
+    }
+    struct stat status;
+    if (fstat(fd, &status) == -1 || (size_t) status.st_size < sizeof(SnapshotShmSegment)) {
+        close(fd);
+        return NULL;
+    }
+    SnapshotShmSegment* segment = mmap(NULL, sizeof(*segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        return NULL;
+    }
+    if (segment->magic != SNAPSHOT_SHM_MAGIC || segment->version != SNAPSHOT_SHM_VERSION
+        || segment->max_cores != SNAPSHOT_MAX_CORES) {
+        munmap(segment, sizeof(*segment));
+        return NULL;
+    }
+
+    SnapshotShm* result = handle_new(name, segment, false);
+    if (result == NULL) {
+        munmap(segment, sizeof(*segment));
+    }
+    return result;
+}
+
+void snapshot_shm_delete(SnapshotShm* const shm) {
+    if (shm == NULL) {
+        return;
+    }
+    munmap(shm->segment, sizeof(*shm->segment));
+    if (shm->writable) {
+        shm_unlink(shm->name);
+    }
+    free(shm);
+}
+
+void snapshot_shm_publish(SnapshotShm* const restrict shm, const Snapshot* const restrict snapshot,
+                          const double* const restrict statistics, const size_t statistics_cores,
+                          const StageOverheadReport* const restrict overhead) {
+    SnapshotShmSegment* segment = shm->segment;
+    SnapshotShmRecord* record = &segment->record;
+    const uint64_t sequence = atomic_load_explicit(&segment->seqlock, memory_order_relaxed);
+    const size_t number_of_cores = snapshot->number_of_cores < SNAPSHOT_MAX_CORES ? snapshot->number_of_cores : SNAPSHOT_MAX_CORES;
+
+    /*Odd value tells readers that the record is being modified*/
+    atomic_store_explicit(&segment->seqlock, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    record->sequence = snapshot->sequence;
+    record->timestamp_ns = (uint64_t) snapshot->timestamp.tv_sec * 1000000000u + (uint64_t) snapshot->timestamp.tv_nsec;
+    record->interval_ns = snapshot->interval_ns;
+    record->number_of_cores = number_of_cores;
+    memcpy(record->core_usage, snapshot->core_usage, sizeof(*record->core_usage) * number_of_cores);
+    memcpy(record->core_time, snapshot->core_time, sizeof(*record->core_time) * number_of_cores);
+    record->has_statistics = statistics != NULL;
+    if (statistics != NULL) {
+        const size_t copied_cores = statistics_cores < number_of_cores ? statistics_cores : number_of_cores;
+        memcpy(record->core_statistics, statistics, sizeof(*record->core_statistics) * copied_cores * USAGE_STATISTIC_COUNT);
+        for (size_t i = copied_cores * USAGE_STATISTIC_COUNT; i < number_of_cores * USAGE_STATISTIC_COUNT; i++) {
+            record->core_statistics[i] = NAN;
+        }
+    }
+    record->has_overhead = overhead != NULL;
+    if (overhead != NULL) {
+        memcpy(record->stage_cpu_us_per_snapshot, overhead->cpu_us_per_snapshot, sizeof(record->stage_cpu_us_per_snapshot));
+        record->rss_kb = overhead->rss_kb;
+        record->peak_rss_kb = overhead->peak_rss_kb;
+    }
+
+    atomic_store_explicit(&segment->seqlock, sequence + 2, memory_order_release);
+}
+
+ESnapshotShmStatus snapshot_shm_read(const SnapshotShm* const restrict shm, SnapshotShmRecord* const restrict dest) {
+    if (shm == NULL || dest == NULL) {
+        return SNAPSHOT_SHM_NULL_ARGUMENT;
+    }
+    SnapshotShmSegment* segment = shm->segment;
+    const SnapshotShmRecord* record = &segment->record;
+
+    for (size_t attempt = 0; attempt < SNAPSHOT_SHM_MAX_ATTEMPTS; attempt++) {
+        const uint64_t begin = atomic_load_explicit(&segment->seqlock, memory_order_acquire);
+        if (begin == 0) {
+            return SNAPSHOT_SHM_EMPTY;
+        }
+        if (begin & 1u) {
+            continue;
+        }
+
+        dest->sequence = record->sequence;
+        dest->timestamp_ns = record->timestamp_ns;
+        dest->interval_ns = record->interval_ns;
+        /*Torn value is possible here, it will be discarded after comparing seqlock*/
+        uint64_t number_of_cores = record->number_of_cores;
+        number_of_cores = number_of_cores < SNAPSHOT_MAX_CORES ? number_of_cores : SNAPSHOT_MAX_CORES;
+        dest->number_of_cores = number_of_cores;
+        memcpy(dest->core_usage, record->core_usage, sizeof(*dest->core_usage) * number_of_cores);
+        memcpy(dest->core_time, record->core_time, sizeof(*dest->core_time) * number_of_cores);
+        dest->has_statistics = record->has_statistics;
+        if (dest->has_statistics) {
+            memcpy(dest->core_statistics, record->core_statistics,
+                   sizeof(*dest->core_statistics) * number_of_cores * USAGE_STATISTIC_COUNT);
+        }
+        dest->has_overhead = record->has_overhead;
+        if (dest->has_overhead) {
+            memcpy(dest->stage_cpu_us_per_snapshot, record->stage_cpu_us_per_snapshot, sizeof(dest->stage_cpu_us_per_snapshot));
+            dest->rss_kb = record->rss_kb;
+            dest->peak_rss_kb = record->peak_rss_kb;
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&segment->seqlock, memory_order_relaxed) == begin) {
+            return SNAPSHOT_SHM_SUCCESS;
+        }
+    }
+    return SNAPSHOT_SHM_BUSY;
+}
+
+static inline SnapshotShm* handle_new(const char* const name, SnapshotShmSegment* const segment, const bool writable) {
+    const size_t name_size = strlen(name);
+    SnapshotShm* result = malloc(sizeof(*result) + sizeof(*result->name) * (name_size + 1));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    result->segment = segment;
+    result->writable = writable;
+    strcpy(result->name, name);
+    return result;
+}
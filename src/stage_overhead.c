@@ -0,0 +1,311 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "stage_overhead.h"
+
+enum {
+    STAGE_OVERHEAD_PATH_SIZE = 4096,
+    /*status of a process has about 1.5 kB*/
+    STAGE_OVERHEAD_FILE_SIZE = 4096,
+};
+
+/**
+ * @brief Hardware counters of single thread, owned by the thread through thread_counters_key
+ */
+typedef struct ThreadCounters {
+    /*NULL if opening failed, the thread is not retried*/
+    PerfCounters* counters;
+    uint64_t mark[PERF_COUNTER_COUNT];
+} ThreadCounters;
+
+struct StageOverhead {
+    /*Accumulated since the previous report, exchanged with 0 when the report is closed*/
+    _Atomic uint64_t cpu_ns[PLACEMENT_STAGE_COUNT];
+    _Atomic uint64_t messages[PLACEMENT_STAGE_COUNT];
+    _Atomic uint64_t hardware[PLACEMENT_STAGE_COUNT][PERF_COUNTER_COUNT];
+    _Atomic uint32_t hardware_mask[PLACEMENT_STAGE_COUNT];
+    bool hardware_enabled;
+    size_t interval;
+    uint64_t number_of_snapshots;
+    StageOverheadReport report;
+    char status_path[]; /*FAM*/
+};
+
+/**
+ * @brief Read VmRSS and VmHWM of the process into report, zeroes on failure
+ */
+static void memory_read(const StageOverhead* stage_overhead, StageOverheadReport* report);
+
+/**
+ * @brief Add deltas of counters of the calling thread to stage, opens the counters on the first call
+ */
+static void hardware_account(StageOverhead* stage_overhead, EPlacementStage stage);
+
+/**
+ * @brief Open counters of the calling thread and mark their current values
+ */
+static void thread_counters_open(void);
+
+/**
+ * @brief Destructor of thread_counters_key, closes counters of exiting thread
+ */
+static void thread_counters_release(void* thread_counters);
+
+static void thread_counters_key_create(void);
+
+static pthread_key_t thread_counters_key;
+static pthread_once_t thread_counters_once = PTHREAD_ONCE_INIT;
+
+StageOverhead* stage_overhead_new(const char proc_root[const static 1], const size_t interval, const bool hardware) {
+    if (interval == 0) {
+        return NULL;
+    }
+    char path[STAGE_OVERHEAD_PATH_SIZE];
+    const int path_length = snprintf(path, sizeof(path), "%s/self/status", proc_root);
+    if (path_length < 0 || (size_t) path_length >= sizeof(path)) {
+        return NULL;
+    }
+    StageOverhead* result = calloc(1, sizeof(*result) + sizeof(*result->status_path) * ((size_t) path_length + 1));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    for (size_t i = 0; i < PLACEMENT_STAGE_COUNT; i++) {
+        atomic_init(&result->cpu_ns[i], 0);
+        atomic_init(&result->messages[i], 0);
+        atomic_init(&result->hardware_mask[i], 0);
+        for (size_t j = 0; j < PERF_COUNTER_COUNT; j++) {
+            atomic_init(&result->hardware[i][j], 0);
+        }
+    }
+    if (hardware && pthread_once(&thread_counters_once, thread_counters_key_create) != 0) {
+        free(result);
+        return NULL;
+    }
+    result->hardware_enabled = hardware;
+    result->interval = interval;
+    memcpy(result->status_path, path, (size_t) path_length + 1);
+    return result;
+}
+
+void stage_overhead_delete(StageOverhead* const stage_overhead) {
+    free(stage_overhead);
+}
+
+uint64_t stage_overhead_thread_cpu_ns(void) {
+    struct timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) {
+        errno = 0;
+        return 0;
+    }
+    return (uint64_t) now.tv_sec * UINT64_C(1000000000) + (uint64_t) now.tv_nsec;
+}
+
+void stage_overhead_thread_attach(StageOverhead* const stage_overhead) {
+    if (stage_overhead != NULL && stage_overhead->hardware_enabled && pthread_getspecific(thread_counters_key) == NULL) {
+        thread_counters_open();
+    }
+}
+
+uint64_t stage_overhead_account(StageOverhead* const stage_overhead, const EPlacementStage stage, const uint64_t mark_ns,
+                                const uint64_t messages) {
+    const uint64_t now_ns = stage_overhead_thread_cpu_ns();
+    if (stage_overhead == NULL) {
+        return now_ns;
+    }
+    if (now_ns > mark_ns) {
+        atomic_fetch_add_explicit(&stage_overhead->cpu_ns[stage], now_ns - mark_ns, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&stage_overhead->messages[stage], messages, memory_order_relaxed);
+    if (stage_overhead->hardware_enabled) {
+        hardware_account(stage_overhead, stage);
+    }
+    return now_ns;
+}
+
+const StageOverheadReport* stage_overhead_snapshot(StageOverhead* const stage_overhead) {
+    stage_overhead->number_of_snapshots++;
+    if (stage_overhead->number_of_snapshots < stage_overhead->interval) {
+        return NULL;
+    }
+
+    StageOverheadReport* report = &stage_overhead->report;
+    const uint64_t number_of_snapshots = stage_overhead->number_of_snapshots;
+    report->sequence++;
+    report->number_of_snapshots = number_of_snapshots;
+    for (size_t i = 0; i < PLACEMENT_STAGE_COUNT; i++) {
+        const uint64_t cpu_ns = atomic_exchange_explicit(&stage_overhead->cpu_ns[i], 0, memory_order_relaxed);
+        report->cpu_us[i] = cpu_ns / 1000;
+        report->messages[i] = atomic_exchange_explicit(&stage_overhead->messages[i], 0, memory_order_relaxed);
+        report->cpu_us_per_snapshot[i] = (double) cpu_ns / 1000.0 / (double) number_of_snapshots;
+        report->hardware_mask[i] = atomic_exchange_explicit(&stage_overhead->hardware_mask[i], 0, memory_order_relaxed);
+        for (size_t j = 0; j < PERF_COUNTER_COUNT; j++) {
+            const uint64_t value = atomic_exchange_explicit(&stage_overhead->hardware[i][j], 0, memory_order_relaxed);
+            report->hardware_per_snapshot[i][j] = (double) value / (double) number_of_snapshots;
+        }
+    }
+    report->hardware = stage_overhead->hardware_enabled;
+    memory_read(stage_overhead, report);
+    stage_overhead->number_of_snapshots = 0;
+    return report;
+}
+
+const StageOverheadReport* stage_overhead_latest(const StageOverhead* const stage_overhead) {
+    return stage_overhead->report.sequence == 0 ? NULL : &stage_overhead->report;
+}
+
+int stage_overhead_format(const StageOverheadReport* const restrict report, char* const restrict buffer, const size_t size) {
+    int length = snprintf(buffer, size, "Overhead per snapshot:");
+    for (size_t i = 0; i < PLACEMENT_STAGE_COUNT && length >= 0 && (size_t) length < size; i++) {
+        const int written = snprintf(buffer + length, size - (size_t) length, " %s %.2Fus",
+                                     placement_stage_to_str((EPlacementStage) i), report->cpu_us_per_snapshot[i]);
+        length = written < 0 ? written : length + written;
+    }
+    if (length >= 0 && (size_t) length < size) {
+        const int written = snprintf(buffer + length, size - (size_t) length, " rss %" PRIu64 " kB peak %" PRIu64 " kB\n",
+                                     report->rss_kb, report->peak_rss_kb);
+        length = written < 0 ? written : length + written;
+    }
+    return length;
+}
+
+int stage_overhead_format_hardware(const StageOverheadReport* const restrict report, char* const restrict buffer,
+                                   const size_t size) {
+    bool any_counted = false;
+    for (size_t i = 0; i < PLACEMENT_STAGE_COUNT; i++) {
+        any_counted = any_counted || report->hardware_mask[i] != 0;
+    }
+    if (!any_counted) {
+        return snprintf(buffer, size, "Hardware counters unavailable\n");
+    }
+
+    int length = snprintf(buffer, size, "Hardware per snapshot:");
+    for (size_t i = 0; i < PLACEMENT_STAGE_COUNT && length >= 0 && (size_t) length < size; i++) {
+        int written = snprintf(buffer + length, size - (size_t) length, "%s %s", i == 0 ? "" : ",",
+                               placement_stage_to_str((EPlacementStage) i));
+        length = written < 0 ? written : length + written;
+        if (report->hardware_mask[i] == 0 && length >= 0 && (size_t) length < size) {
+            written = snprintf(buffer + length, size - (size_t) length, " n/a");
+            length = written < 0 ? written : length + written;
+        }
+        for (size_t j = 0; j < PERF_COUNTER_COUNT && length >= 0 && (size_t) length < size; j++) {
+            if ((report->hardware_mask[i] & (UINT32_C(1) << j)) != 0) {
+                written = snprintf(buffer + length, size - (size_t) length, " %s %.0F",
+                                   perf_counter_to_str((EPerfCounter) j), report->hardware_per_snapshot[i][j]);
+                length = written < 0 ? written : length + written;
+            }
+        }
+    }
+    if (length >= 0 && (size_t) length < size) {
+        const int written = snprintf(buffer + length, size - (size_t) length, "\n");
+        length = written < 0 ? written : length + written;
+    }
+    return length;
+}
+
+bool stage_overhead_parse_status(const char buffer[const restrict static 1], uint64_t* const restrict rss_kb,
+                                 uint64_t* const restrict peak_rss_kb) {
+    char content[STAGE_OVERHEAD_FILE_SIZE];
+    snprintf(content, sizeof(content), "%s", buffer);
+    bool rss_found = false;
+    bool peak_found = false;
+
+    char* line = content;
+    while (line != NULL) {
+        char* next = strchr(line, '\n');
+        if (next != NULL) {
+            *next = '\0';
+            next++;
+        }
+        uint64_t value;
+        if (sscanf(line, "VmRSS: %" SCNu64, &value) == 1) {
+            *rss_kb = value;
+            rss_found = true;
+        } else if (sscanf(line, "VmHWM: %" SCNu64, &value) == 1) {
+            *peak_rss_kb = value;
+            peak_found = true;
+        }
+        line = next;
+    }
+    return rss_found && peak_found;
+}
+
+static void memory_read(const StageOverhead* const stage_overhead, StageOverheadReport* const report) {
+    report->rss_kb = 0;
+    report->peak_rss_kb = 0;
+    /*Plain read, fopen would allocate a FILE on every report*/
+    const int file = open(stage_overhead->status_path, O_RDONLY | O_CLOEXEC);
+    if (file < 0) {
+        errno = 0;
+        return;
+    }
+    char content[STAGE_OVERHEAD_FILE_SIZE];
+    const ssize_t length = read(file, content, sizeof(content) - 1);
+    close(file);
+    if (length <= 0) {
+        errno = 0;
+        return;
+    }
+    content[length] = '\0';
+    if (!stage_overhead_parse_status(content, &report->rss_kb, &report->peak_rss_kb)) {
+        report->rss_kb = 0;
+        report->peak_rss_kb = 0;
+    }
+}
+
+static void hardware_account(StageOverhead* const stage_overhead, const EPlacementStage stage) {
+    ThreadCounters* thread_counters = pthread_getspecific(thread_counters_key);
+    if (thread_counters == NULL) {
+        /*Counting starts now, there is nothing to account yet*/
+        thread_counters_open();
+        return;
+    }
+    if (thread_counters->counters == NULL) {
+        return;
+    }
+
+    uint64_t values[PERF_COUNTER_COUNT];
+    if (!perf_counters_read(thread_counters->counters, values)) {
+        return;
+    }
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (values[i] > thread_counters->mark[i]) {
+            atomic_fetch_add_explicit(&stage_overhead->hardware[stage][i], values[i] - thread_counters->mark[i], memory_order_relaxed);
+        }
+        thread_counters->mark[i] = values[i];
+    }
+    atomic_fetch_or_explicit(&stage_overhead->hardware_mask[stage], perf_counters_available(thread_counters->counters),
+                             memory_order_relaxed);
+}
+
+static void thread_counters_open() {
+    ThreadCounters* thread_counters = calloc(1, sizeof(*thread_counters));
+    if (thread_counters == NULL) {
+        errno = 0;
+        return;
+    }
+    thread_counters->counters = perf_counters_open();
+    if (thread_counters->counters != NULL && !perf_counters_read(thread_counters->counters, thread_counters->mark)) {
+        perf_counters_close(thread_counters->counters);
+        thread_counters->counters = NULL;
+    }
+    if (pthread_setspecific(thread_counters_key, thread_counters) != 0) {
+        thread_counters_release(thread_counters);
+    }
+}
+
+static void thread_counters_release(void* const thread_counters) {
+    ThreadCounters* released = thread_counters;
+    perf_counters_close(released->counters);
+    free(released);
+}
+
+static void thread_counters_key_create() {
+    pthread_key_create(&thread_counters_key, thread_counters_release);
+}
@@ -0,0 +1,387 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "stat_recording.h"
+
+enum {
+    STAT_RECORDING_MAGIC_SIZE = 8,
+    /*Stands for a number in the text of content, content containing it is stored raw*/
+    STAT_RECORDING_NUMBER_MARK = 1,
+    /*Longer runs of digits may not fit into uint64_t*/
+    STAT_RECORDING_MAX_DIGITS = 19,
+    STAT_RECORDING_MAX_VARINT = 10,
+};
+
+static const char magic[STAT_RECORDING_MAGIC_SIZE] = {'S', 'T', 'A', 'T', 'R', 'E', 'C', '1'};
+
+/**
+ * @brief Content split into text, where every number is replaced by STAT_RECORDING_NUMBER_MARK,
+ * and the numbers in order of appearance
+ */
+typedef struct StatShape {
+    bool valid;
+    char* text;
+    size_t text_length;
+    size_t text_capacity;
+    uint64_t* numbers;
+    size_t number_of_numbers;
+    size_t numbers_capacity;
+} StatShape;
+
+struct StatRecorder {
+    FILE* file;
+    char* pending;
+    size_t pending_length;
+    size_t pending_capacity;
+    /*Adding to the pending record failed, it is dropped by commit*/
+    bool pending_failed;
+    bool has_previous;
+    uint64_t previous_timestamp_ns;
+    StatShape previous;
+    StatShape current;
+    uint8_t* encoded;
+    size_t encoded_capacity;
+};
+
+struct StatReplay {
+    FILE* file;
+    uint64_t delay_ns;
+    StatShape shape;
+    char* data;
+    size_t length;
+    size_t capacity;
+};
+
+/**
+ * @brief Grow buffer to hold at least needed elements
+ * @return false on memory error, buffer is left untouched then
+ */
+static bool reserve(void** buffer, size_t* capacity, size_t needed, size_t element_size);
+
+/**
+ * @brief Grow buffers of shape to split content of length bytes
+ */
+static bool shape_reserve(StatShape* shape, size_t length);
+
+/**
+ * @brief Split content into shape
+ * @return false on memory error or if the content cannot be split losslessly, shape is invalid then
+ */
+static bool shape_split(StatShape* restrict shape, const char* restrict data, size_t length);
+
+/**
+ * @brief Format content of shape into data of replay
+ * @return false on memory error or if the content exceeds STAT_RECORDING_MAX_RECORD
+ */
+static bool shape_join(StatReplay* replay);
+
+static void shape_free(StatShape* shape);
+
+static inline size_t varint_store(uint8_t* destination, uint64_t value);
+
+/**
+ * @return false at the end of file or if the varint is longer than STAT_RECORDING_MAX_VARINT bytes
+ */
+static inline bool varint_read(FILE* file, uint64_t* value);
+
+StatRecorder* stat_recorder_new(const char path[const static 1]) {
+    StatRecorder* result = calloc(1, sizeof(*result));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    result->file = fopen(path, "wb");
+    if (result->file == NULL || fwrite(magic, 1, sizeof(magic), result->file) != sizeof(magic) || fflush(result->file) != 0) {
+        errno = 0;
+        if (result->file != NULL) {
+            fclose(result->file);
+        }
+        free(result);
+        return NULL;
+    }
+    return result;
+}
+
+void stat_recorder_delete(StatRecorder* const recorder) {
+    if (recorder == NULL) {
+        return;
+    }
+    fclose(recorder->file);
+    shape_free(&recorder->previous);
+    shape_free(&recorder->current);
+    free(recorder->pending);
+    free(recorder->encoded);
+    free(recorder);
+}
+
+bool stat_recorder_add(StatRecorder* const restrict recorder, const char* const restrict data, const size_t length) {
+    if (recorder->pending_failed) {
+        return false;
+    }
+    if (length > STAT_RECORDING_MAX_RECORD - recorder->pending_length
+        || !reserve((void**) &recorder->pending, &recorder->pending_capacity, recorder->pending_length + length, 1)) {
+        recorder->pending_failed = true;
+        return false;
+    }
+    memcpy(recorder->pending + recorder->pending_length, data, length);
+    recorder->pending_length += length;
+    return true;
+}
+
+bool stat_recorder_commit(StatRecorder* const recorder, const uint64_t timestamp_ns) {
+    const size_t length = recorder->pending_length;
+    const bool failed = recorder->pending_failed;
+    recorder->pending_length = 0;
+    recorder->pending_failed = false;
+    if (failed) {
+        return false;
+    }
+
+    StatShape* previous = &recorder->previous;
+    StatShape* current = &recorder->current;
+    shape_split(current, recorder->pending, length);
+    const bool delta = current->valid && previous->valid && current->number_of_numbers == previous->number_of_numbers
+                       && current->text_length == previous->text_length
+                       && memcmp(current->text, previous->text, current->text_length) == 0;
+    const size_t payload_size = delta ? current->number_of_numbers * STAT_RECORDING_MAX_VARINT : length;
+    if (!reserve((void**) &recorder->encoded, &recorder->encoded_capacity, 2 * STAT_RECORDING_MAX_VARINT + 1 + payload_size, 1)) {
+        return false;
+    }
+
+    uint8_t* encoded = recorder->encoded;
+    size_t size = varint_store(encoded, recorder->has_previous ? timestamp_ns - recorder->previous_timestamp_ns : 0);
+    if (delta) {
+        encoded[size++] = STAT_RECORDING_DELTA;
+        size += varint_store(encoded + size, current->number_of_numbers);
+        for (size_t i = 0; i < current->number_of_numbers; i++) {
+            /*Zigzag keeps small decrements small, wrapping subtraction keeps it lossless*/
+            const uint64_t difference = current->numbers[i] - previous->numbers[i];
+            size += varint_store(encoded + size, (difference << 1) ^ (uint64_t) -(int64_t) (difference >> 63));
+        }
+    } else {
+        encoded[size++] = STAT_RECORDING_RAW;
+        size += varint_store(encoded + size, length);
+        memcpy(encoded + size, recorder->pending, length);
+        size += length;
+    }
+    if (fwrite(encoded, 1, size, recorder->file) != size || fflush(recorder->file) != 0) {
+        errno = 0;
+        return false;
+    }
+
+    /*The current record is the base of the next one*/
+    const StatShape temporary = *previous;
+    *previous = *current;
+    *current = temporary;
+    recorder->has_previous = true;
+    recorder->previous_timestamp_ns = timestamp_ns;
+    return true;
+}
+
+bool stat_recorder_reserve(StatRecorder* const recorder, const size_t record_size) {
+    /*Delta of a record has at most one varint per number*/
+    return reserve((void**) &recorder->pending, &recorder->pending_capacity, record_size, 1)
+           && reserve((void**) &recorder->encoded, &recorder->encoded_capacity,
+                      2 * STAT_RECORDING_MAX_VARINT + 1 + (record_size / 2 + 1) * STAT_RECORDING_MAX_VARINT, 1)
+           && shape_reserve(&recorder->previous, record_size) && shape_reserve(&recorder->current, record_size);
+}
+
+StatReplay* stat_replay_new(const char path[const static 1]) {
+    StatReplay* result = calloc(1, sizeof(*result));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    char header[STAT_RECORDING_MAGIC_SIZE];
+    result->file = fopen(path, "rb");
+    if (result->file == NULL || fread(header, 1, sizeof(header), result->file) != sizeof(header)
+        || memcmp(header, magic, sizeof(magic)) != 0) {
+        errno = 0;
+        if (result->file != NULL) {
+            fclose(result->file);
+        }
+        free(result);
+        return NULL;
+    }
+    return result;
+}
+
+void stat_replay_delete(StatReplay* const replay) {
+    if (replay == NULL) {
+        return;
+    }
+    fclose(replay->file);
+    shape_free(&replay->shape);
+    free(replay->data);
+    free(replay);
+}
+
+bool stat_replay_next(StatReplay* const replay) {
+    uint64_t delay_ns;
+    const int kind = varint_read(replay->file, &delay_ns) ? getc(replay->file) : EOF;
+    uint64_t count;
+    if (kind == EOF || !varint_read(replay->file, &count)) {
+        return false;
+    }
+
+    if (kind == STAT_RECORDING_RAW) {
+        if (count > STAT_RECORDING_MAX_RECORD || !reserve((void**) &replay->data, &replay->capacity, count, 1)
+            || fread(replay->data, 1, count, replay->file) != count) {
+            return false;
+        }
+        replay->length = count;
+        shape_split(&replay->shape, replay->data, replay->length);
+    } else if (kind == STAT_RECORDING_DELTA) {
+        StatShape* shape = &replay->shape;
+        if (!shape->valid || count != shape->number_of_numbers) {
+            return false;
+        }
+        for (size_t i = 0; i < shape->number_of_numbers; i++) {
+            uint64_t zigzag;
+            if (!varint_read(replay->file, &zigzag)) {
+                return false;
+            }
+            shape->numbers[i] += (zigzag >> 1) ^ (uint64_t) -(int64_t) (zigzag & 1);
+        }
+        if (!shape_join(replay)) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    replay->delay_ns = delay_ns;
+    return true;
+}
+
+bool stat_replay_reserve(StatReplay* const replay, const size_t record_size) {
+    /*Joining reserves room for the longest number past the end of content*/
+    return reserve((void**) &replay->data, &replay->capacity, record_size + 20, 1) && shape_reserve(&replay->shape, record_size);
+}
+
+const char* stat_replay_data(const StatReplay* const restrict replay, size_t* const restrict length) {
+    *length = replay->length;
+    return replay->data;
+}
+
+uint64_t stat_replay_delay_ns(const StatReplay* const replay) {
+    return replay->delay_ns;
+}
+
+static bool reserve(void** const buffer, size_t* const capacity, const size_t needed, const size_t element_size) {
+    if (needed <= *capacity) {
+        return true;
+    }
+    size_t new_capacity = *capacity == 0 ? 4096 : *capacity;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    void* new_buffer = realloc(*buffer, new_capacity * element_size);
+    if (new_buffer == NULL) {
+        errno = 0;
+        return false;
+    }
+    *buffer = new_buffer;
+    *capacity = new_capacity;
+    return true;
+}
+
+static bool shape_split(StatShape* const restrict shape, const char* const restrict data, const size_t length) {
+    shape->valid = false;
+    shape->text_length = 0;
+    shape->number_of_numbers = 0;
+    if (!shape_reserve(shape, length)) {
+        return false;
+    }
+    for (size_t i = 0; i < length;) {
+        if (data[i] == STAT_RECORDING_NUMBER_MARK) {
+            return false;
+        }
+        if (data[i] < '0' || data[i] > '9') {
+            shape->text[shape->text_length++] = data[i++];
+            continue;
+        }
+        size_t end = i;
+        uint64_t value = 0;
+        while (end < length && data[end] >= '0' && data[end] <= '9') {
+            value = value * 10 + (uint64_t) (data[end] - '0');
+            end++;
+        }
+        if (end - i > STAT_RECORDING_MAX_DIGITS || (end - i > 1 && data[i] == '0')) {
+            return false;
+        }
+        shape->numbers[shape->number_of_numbers++] = value;
+        shape->text[shape->text_length++] = STAT_RECORDING_NUMBER_MARK;
+        i = end;
+    }
+    shape->valid = true;
+    return true;
+}
+
+static bool shape_reserve(StatShape* const shape, const size_t length) {
+    /*Every number takes at least one character*/
+    return reserve((void**) &shape->text, &shape->text_capacity, length, 1)
+           && reserve((void**) &shape->numbers, &shape->numbers_capacity, length / 2 + 1, sizeof(*shape->numbers));
+}
+
+static bool shape_join(StatReplay* const replay) {
+    const StatShape* shape = &replay->shape;
+    size_t length = 0;
+    size_t number = 0;
+    for (size_t i = 0; i < shape->text_length; i++) {
+        /*The longest number has 20 digits*/
+        if (!reserve((void**) &replay->data, &replay->capacity, length + 20, 1)) {
+            return false;
+        }
+        if (shape->text[i] != STAT_RECORDING_NUMBER_MARK) {
+            replay->data[length++] = shape->text[i];
+            continue;
+        }
+        char digits[20];
+        size_t count = 0;
+        uint64_t value = shape->numbers[number++];
+        do {
+            digits[count++] = (char) ('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (count > 0) {
+            replay->data[length++] = digits[--count];
+        }
+    }
+    if (length > STAT_RECORDING_MAX_RECORD) {
+        return false;
+    }
+    replay->length = length;
+    return true;
+}
+
+static void shape_free(StatShape* const shape) {
+    free(shape->text);
+    free(shape->numbers);
+}
+
+static inline size_t varint_store(uint8_t* const destination, uint64_t value) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        destination[size++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    destination[size++] = (uint8_t) value;
+    return size;
+}
+
+static inline bool varint_read(FILE* const file, uint64_t* const value) {
+    uint64_t result = 0;
+    for (unsigned i = 0; i < STAT_RECORDING_MAX_VARINT; i++) {
+        const int byte = getc(file);
+        if (byte == EOF) {
+            return false;
+        }
+        result |= (uint64_t) (byte & 0x7f) << (7 * i);
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
@@ -22,7 +22,11 @@ void* thread_logger(void* args) {
     bool* working = NULL;
     FILE* logger_file = NULL;
     WatchdogControlUnit* control_unit = NULL;
-    const struct timespec cond_wait_time = {.tv_nsec = 0, .tv_sec = 1};
+    StageOverhead* stage_overhead = NULL;
+    Trace* trace = NULL;
+    sem_t* started = NULL;
+    /*Timed wait takes absolute time, relative one would expire immediately and the thread would spin*/
+    struct timespec cond_wait_time = {.tv_nsec = 0, .tv_sec = 1};
 
     {
         ThreadLoggerArguments* temp = args;
@@ -33,13 +37,26 @@ void* thread_logger(void* args) {
         working = temp->is_working;
         logger_file = temp->logger_output;
         control_unit = temp->control_unit;
+        stage_overhead = temp->stage_overhead;
+        trace = temp->trace;
+        started = temp->started;
     }
 
     if (payload_buffer == NULL || buffer_guard == NULL || working_mutex == NULL || working == NULL || logger_file == NULL || control_unit == NULL) {
         perror ("Logger: one of args argument equal to NULL\n");
+        /*Whoever waits for the setup is not left hanging*/
+        if (started != NULL) {
+            sem_post(started);
+        }
         return NULL;
     }
 
+    trace_thread_attach(trace, "logger");
+    stage_overhead_thread_attach(stage_overhead);
+    if (started != NULL) {
+        sem_post(started);
+    }
+    uint64_t cpu_mark_ns = stage_overhead_thread_cpu_ns();
     while (true) {
         watchdog_unit_atomic_ping(control_unit);
         pthread_mutex_lock(working_mutex);
@@ -52,21 +69,50 @@ void* thread_logger(void* args) {
         LoggerPayload* payload = NULL;
         pcp_guard_lock(buffer_guard);
         if (circular_buffer_remove_single(payload_buffer, &payload) == 0) {
+            clock_gettime(CLOCK_REALTIME, &cond_wait_time);
+            cond_wait_time.tv_sec += 1;
+            TRACE_BEGIN(TRACE_EVENT_DEQUEUE_WAIT);
             pcp_guard_timed_wait_for_producer(buffer_guard, &cond_wait_time);
+            TRACE_END(TRACE_EVENT_DEQUEUE_WAIT);
             pcp_guard_notify_producer(buffer_guard);   
             pcp_guard_unlock(buffer_guard);
+            if (stage_overhead != NULL) {
+                cpu_mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_LOGGER, cpu_mark_ns, 0);
+            }
             continue;         
         }
         pcp_guard_unlock(buffer_guard);
+        TRACE_BEGIN(TRACE_EVENT_LOG);
         persist_to_file(logger_file, payload);
         
         logger_payload_delete(payload);
         payload = NULL;
+        TRACE_END(TRACE_EVENT_LOG);
+        if (stage_overhead != NULL) {
+            cpu_mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_LOGGER, cpu_mark_ns, 1);
+        }
     }
 
     return NULL;
 }
 
+size_t thread_logger_flush(PCPGuard* const restrict payload_buffer_guard, CircularBuffer* const restrict payload_ptr_buffer,
+                           FILE* const restrict logger_output) {
+    size_t result = 0;
+    LoggerPayload* payload = NULL;
+
+    pcp_guard_lock(payload_buffer_guard);
+    while (circular_buffer_remove_single(payload_ptr_buffer, &payload) > 0) {
+        persist_to_file(logger_output, payload);
+        logger_payload_delete(payload);
+        payload = NULL;
+        result++;
+    }
+    pcp_guard_notify_producer(payload_buffer_guard);
+    pcp_guard_unlock(payload_buffer_guard);
+    return result;
+}
+
 static inline void persist_to_file(FILE* restrict logger_file, LoggerPayload* restrict payload) {
     char time_buffer[26];
     time_t time_now;
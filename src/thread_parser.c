@@ -1,6 +1,14 @@
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <stdio.h>
 #include "thread_parser.h"
 #include "proc_parser.h"
+#include "psi_parser.h"
+#include "frequency_sampler.h"
+#include "snapshot_latency.h"
 #include "pcp_guard.h"
 #include "thread_logger.h"
 
@@ -16,7 +24,7 @@
  * Writer -> checks is_working and leaves
  * Reader -> waits for bytes to read
  */
-static inline void finalize_write(CircularBuffer* char_buffer, PCPGuard* guard);
+static inline void finalize_write(CircularBuffer* snapshot_buffer, PCPGuard* guard);
 
 /**
  * @brief Clean up before leaving 
@@ -24,142 +32,536 @@ static inline void finalize_write(CircularBuffer* char_buffer, PCPGuard* guard);
  */
 static inline void finalize_read(CircularBuffer* char_buffer, PCPGuard* guard);
 
+/**
+ * @brief Total stall counters retrieved during previous tick, indexed by EPsiKind
+ */
+typedef struct PressureHistory {
+    bool known[2];
+    uint64_t total[2];
+} PressureHistory;
+
+/**
+ * @brief Send snapshot through snapshot_buffer, wait if the buffer is full
+ */
+static inline void send_snapshot(CircularBuffer* snapshot_buffer, PCPGuard* guard, const Snapshot* snapshot);
+
+/**
+ * @brief Store parsed pressure line in snapshot and compute stall time since previous tick
+ */
+static inline void store_pressure(Snapshot* restrict snapshot, PressureHistory history[restrict static PSI_RESOURCE_COUNT],
+                                  const PsiParserLine* restrict line);
+
+/**
+ * @brief Add time elapsed on single cpu since previous tick to group accumulator
+ */
+static inline void group_time_add(ProcParserCpuTime* group, const ProcParserCpuTime* previous, const ProcParserCpuTime* current);
+
+/**
+ * @brief Compute usage of sockets and nodes from accumulators, store it in snapshot and clear accumulators
+ */
+static inline void store_groups(Snapshot* restrict snapshot, const Topology* restrict topology,
+                                ProcParserCpuTime package_time[restrict static SNAPSHOT_MAX_PACKAGES],
+                                ProcParserCpuTime node_time[restrict static SNAPSHOT_MAX_NODES]);
+
+enum {
+    temporary_buffer_size = 800,
+    previous_usage_size = SNAPSHOT_MAX_CORES,
+};
+
+struct ThreadParserState {
+    Topology* topology;
+    size_t index;
+    size_t computed_core;
+    /*Cores of the current tick flagged invalid*/
+    size_t invalid_cores;
+    /*Cores of the current tick flagged stale*/
+    size_t stale_cores;
+    /*Lines above previous_usage_size were skipped in the current tick and it was logged*/
+    bool cores_skipped;
+    /*Snapshot was returned by the previous call, per-tick flags are cleared before the next line*/
+    bool snapshot_emitted;
+    /*Current tick only establishes previous counters and is not emitted*/
+    bool baseline;
+    /*Snapshot with usage of every core has been emitted*/
+    bool complete_emitted;
+    /*capture_ns of the previous tick*/
+    uint64_t previous_capture_ns;
+    bool frequency_received;
+    /*Memory belongs to an arena and is not freed by thread_parser_state_delete*/
+    bool arena_owned;
+    char temporary_buffer[temporary_buffer_size];
+    uint64_t parsed_data[10];
+    ProcParserCpuTime previous_usage[previous_usage_size];
+    /*Fields of every core line from the previous tick, checked for counters going backwards*/
+    uint64_t previous_line[previous_usage_size][10];
+    PressureHistory pressure_history[PSI_RESOURCE_COUNT];
+    ProcParserCpuTime package_time[SNAPSHOT_MAX_PACKAGES];
+    ProcParserCpuTime node_time[SNAPSHOT_MAX_NODES];
+    /*Frequencies arrive indexed by cpu number, snapshot stores them by position in /proc/stat*/
+    uint32_t cpu_frequency_khz[SNAPSHOT_MAX_CORES];
+    Snapshot snapshot;
+};
+
+/**
+ * @brief Process single complete line without its newline
+ * @return pointer to completed snapshot or NULL
+ */
+static const Snapshot* line_process(ThreadParserState* restrict state, const char* line,
+                                    PCPGuard* restrict logger_guard, CircularBuffer* restrict logger_buffer);
+
+/**
+ * @brief Parse every complete line of span in place, its newlines are overwritten by terminating nulls.
+ * Completed snapshots are sent through snapshot_buffer.
+ * @param pending bytes at the start of span known to hold no newline
+ * @return number of bytes of complete lines
+ */
+static inline size_t span_parse(ThreadParserState* state, char* span, size_t count, size_t pending,
+                                const ThreadParserArguments* arguments, uint64_t* cpu_mark_ns);
+
+ThreadParserState* thread_parser_state_new(Topology* const topology) {
+    ThreadParserState* result = calloc(1, sizeof(*result));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    result->topology = topology;
+    return result;
+}
+
+ThreadParserState* thread_parser_state_new_in(Arena* const arena, Topology* const topology) {
+    ThreadParserState* result = arena_alloc(arena, sizeof(*result));
+    if (result == NULL) {
+        return NULL;
+    }
+    result->topology = topology;
+    result->arena_owned = true;
+    return result;
+}
+
+size_t thread_parser_state_footprint() {
+    return sizeof(ThreadParserState);
+}
+
+void thread_parser_state_delete(ThreadParserState* const state) {
+    if (state != NULL && state->arena_owned) {
+        return;
+    }
+    free(state);
+}
+
+const Snapshot* thread_parser_state_feed(ThreadParserState* const restrict state, const char input_char,
+                                         PCPGuard* const restrict logger_guard, CircularBuffer* const restrict logger_buffer) {
+    if (input_char == '\n') {
+        state->temporary_buffer[state->index] = '\0';
+        state->index = 0;
+        return thread_parser_state_feed_line(state, state->temporary_buffer, logger_guard, logger_buffer);
+    }
+
+    state->temporary_buffer[state->index] = input_char;
+    state->index++;
+    if (state->index == temporary_buffer_size) {
+        if (strncmp(state->temporary_buffer, "cpu", 3) == 0) {
+            thread_logger_send_log(logger_guard, logger_buffer,
+            "Parser: Buffer size is too small to accumulate data sent by reader\n", LOGGER_PAYLOAD_TYPE_WARNING);
+        }
+        state->temporary_buffer[temporary_buffer_size - 1] = '\0';
+        state->temporary_buffer[0] = input_char;
+        state->index = 0;
+    }
+    return NULL;
+}
+
+const Snapshot* thread_parser_state_feed_line(ThreadParserState* const state, const char line[const static 1],
+                                              PCPGuard* const restrict logger_guard, CircularBuffer* const restrict logger_buffer) {
+    if (state->snapshot_emitted) {
+        for (size_t i = 0; i < PSI_RESOURCE_COUNT; i++) {
+            state->snapshot.pressure[i].available = false;
+        }
+        state->frequency_received = false;
+        state->snapshot.capture_ns = 0;
+        state->snapshot_emitted = false;
+    }
+
+    TRACE_BEGIN(TRACE_EVENT_PARSE);
+    const Snapshot* snapshot = line_process(state, line, logger_guard, logger_buffer);
+    TRACE_END(TRACE_EVENT_PARSE);
+    return snapshot;
+}
+
 void* thread_parser(void* args) {
     if (args == NULL) {
         perror("Parser: null argument was given\n");
         return NULL;
     }
 
-    enum {
-        temporary_buffer_size = 800,
-        previous_usage_size = 100,
-    };
-
     CircularBuffer* char_buffer = NULL;
-    CircularBuffer* double_buffer = NULL;
+    CircularBuffer* snapshot_buffer = NULL;
     CircularBuffer* logger_buffer = NULL;
     PCPGuard* logger_guard = NULL;
     PCPGuard* char_buffer_guard = NULL;
-    PCPGuard* double_buffer_guard = NULL;
+    PCPGuard* snapshot_buffer_guard = NULL;
     WatchdogControlUnit* control_unit = NULL;
+    Topology* topology = NULL;
+    StageOverhead* stage_overhead = NULL;
+    Trace* trace = NULL;
+    ThreadParserState* state = NULL;
+    sem_t* started = NULL;
     bool* is_working = NULL;
     pthread_mutex_t* working_mtx = NULL;
 
-    size_t index = 0;
-    size_t computed_core = 0;
-    char temporary_buffer[temporary_buffer_size];
-    uint64_t parsed_data[10] = {0};
-    ProcParserCpuTime previous_usage[previous_usage_size] = {0};
-
     {
         ThreadParserArguments* temp = args;
 
         char_buffer = temp->char_buffer;
-        double_buffer = temp->double_buffer;
+        snapshot_buffer = temp->snapshot_buffer;
         logger_buffer = temp->logger_buffer;
         char_buffer_guard = temp->char_buffer_guard;
-        double_buffer_guard = temp->double_buffer_guard;
+        snapshot_buffer_guard = temp->snapshot_buffer_guard;
         logger_guard = temp->logger_buffer_guard;
         is_working = temp->is_working;
         working_mtx = temp->working_mutex;
         control_unit = temp->control_unit;
+        topology = temp->topology;
+        stage_overhead = temp->stage_overhead;
+        trace = temp->trace;
+        state = temp->state;
+        started = temp->started;
     }
 
     /*sanity check*/
-    if (char_buffer == NULL || double_buffer == NULL || logger_buffer == NULL || char_buffer_guard == NULL 
-        || double_buffer_guard == NULL || logger_guard == NULL || is_working == NULL || working_mtx == NULL 
+    if (char_buffer == NULL || snapshot_buffer == NULL || logger_buffer == NULL || char_buffer_guard == NULL 
+        || snapshot_buffer_guard == NULL || logger_guard == NULL || is_working == NULL || working_mtx == NULL 
         || control_unit == NULL) {
         
         perror("Parser: One of arguments equal to NULL\n");
+        /*Whoever waits for the setup is not left hanging*/
+        if (started != NULL) {
+            sem_post(started);
+        }
+        return NULL;
+    }
+    if (!circular_buffer_mirrored(char_buffer)) {
+        perror("Parser: char_buffer is not mirrored\n");
+        if (started != NULL) {
+            sem_post(started);
+        }
+        return NULL;
+    }
+    CircularBufferStats char_buffer_stats;
+    circular_buffer_stats(char_buffer, &char_buffer_stats);
+
+    if (state == NULL) {
+        state = thread_parser_state_new(topology);
+    }
+    if (state == NULL) {
+        perror("Parser: memory error\n");
+        /*Whoever waits for the setup is not left hanging*/
+        if (started != NULL) {
+            sem_post(started);
+        }
         return NULL;
     }
 
+    trace_thread_attach(trace, "parser");
+    stage_overhead_thread_attach(stage_overhead);
+    if (started != NULL) {
+        sem_post(started);
+    }
+    uint64_t cpu_mark_ns = stage_overhead_thread_cpu_ns();
+    /*Bytes at the start of the readable span known to hold no newline*/
+    size_t pending = 0;
     while (true) {
         pthread_mutex_lock(working_mtx);
         if (!*is_working) {
             pthread_mutex_unlock(working_mtx);
             finalize_read(char_buffer, char_buffer_guard);
-            finalize_write(double_buffer, double_buffer_guard);
+            finalize_write(snapshot_buffer, snapshot_buffer_guard);
             watchdog_unit_atomic_finish(control_unit);
             break;
         }
         pthread_mutex_unlock(working_mtx);
         pcp_guard_lock(char_buffer_guard);
 
-        char input_char;
-        if (circular_buffer_remove_single(char_buffer, &input_char) == 0) {
+        size_t count;
+        char* span = circular_buffer_peek_span(char_buffer, &count);
+        if (count <= pending) {
+            TRACE_BEGIN(TRACE_EVENT_DEQUEUE_WAIT);
             pcp_guard_wait_for_producer(char_buffer_guard);
-            circular_buffer_remove_single(char_buffer, &input_char);   
+            TRACE_END(TRACE_EVENT_DEQUEUE_WAIT);
+            span = circular_buffer_peek_span(char_buffer, &count);
         }
-        pcp_guard_notify_producer(char_buffer_guard);
         pcp_guard_unlock(char_buffer_guard);
 
-        if (input_char == '\n') {
-            
-            temporary_buffer[index] = '\0';
-            index = 0;
-            int res = proc_parser_parse_line(temporary_buffer, parsed_data);
+        /*Reader writes only free space, the span is parsed without the guard*/
+        size_t consumed = span_parse(state, span, count, pending, args, &cpu_mark_ns);
+        pending = count - consumed;
+        if (pending == char_buffer_stats.capacity) {
+            thread_logger_send_log(logger_guard, logger_buffer,
+            "Parser: Buffer size is too small to accumulate data sent by reader\n", LOGGER_PAYLOAD_TYPE_WARNING);
+            consumed = count;
+            pending = 0;
+        }
+        if (consumed != 0) {
+            pcp_guard_lock(char_buffer_guard);
+            circular_buffer_consume(char_buffer, consumed);
+            pcp_guard_notify_producer(char_buffer_guard);
+            pcp_guard_unlock(char_buffer_guard);
+        }
+        watchdog_unit_atomic_ping(control_unit);
+    }
+    thread_parser_state_delete(state);
+    return NULL;
+}
 
-            if (res == PROC_PARSER_TOTAL_USAGE_LINE) {
-                continue;
-            }
-            if (res == PROC_PARSER_SUCCESS) {
-                ProcParserCpuTime current_usage = proc_parser_compute_core_time(parsed_data);
-                double usage = proc_parser_cpu_time_compute_usage(
-                                &previous_usage[computed_core], &current_usage) * 100;
-                previous_usage[computed_core] = current_usage;
-                computed_core++;
-
-                pcp_guard_lock(double_buffer_guard);
-                int c_b_result = circular_buffer_insert_single(double_buffer, &usage);
-                if (c_b_result == 0) {
-                    pcp_guard_wait_for_consumer(double_buffer_guard);
-                    circular_buffer_insert_single(double_buffer, &usage);
-                }
-                pcp_guard_notify_consumer(double_buffer_guard);
-                pcp_guard_unlock(double_buffer_guard);
-            }
-            else if (res == PROC_PARSER_DISCARD_LINE) {
-                /*If compute_core == 0, then we are still receiving lines with data unrelated to threads*/
-                if (computed_core == 0) {
-                    continue;
-                }
-                computed_core = 0;
-                double usage = THREAD_PARSER_END;
-                pcp_guard_lock(double_buffer_guard);
-                int c_b_result = circular_buffer_insert_single(double_buffer, &usage);
-
-                if (c_b_result == 0) {
-                    pcp_guard_wait_for_consumer(double_buffer_guard);
-                    circular_buffer_insert_single(double_buffer, &usage);
-                    pcp_guard_notify_consumer(double_buffer_guard);
-                    
-                }
-                pcp_guard_unlock(double_buffer_guard);
-            }
-            else {
+static const Snapshot* line_process(ThreadParserState* const restrict state, const char* const line,
+                                    PCPGuard* const restrict logger_guard, CircularBuffer* const restrict logger_buffer) {
+    Snapshot* snapshot = &state->snapshot;
+    Topology* topology = state->topology;
+
+    uint64_t capture_ns;
+    int tick_res = snapshot_latency_parse_line(line, &capture_ns);
+    if (tick_res == SNAPSHOT_LATENCY_SUCCESS) {
+        snapshot->capture_ns = capture_ns;
+        return NULL;
+    }
+    if (tick_res == SNAPSHOT_LATENCY_FAIL) {
+        thread_logger_send_log(logger_guard, logger_buffer,
+        "Parser: Malformed tick line\n", LOGGER_PAYLOAD_TYPE_WARNING);
+        return NULL;
+    }
+    if (strcmp(line, THREAD_PARSER_BASELINE_LINE) == 0) {
+        state->baseline = true;
+        return NULL;
+    }
+
+    PsiParserLine pressure_line;
+    int psi_res = psi_parser_parse_line(line, &pressure_line);
+    if (psi_res == PSI_PARSER_SUCCESS) {
+        store_pressure(snapshot, state->pressure_history, &pressure_line);
+        return NULL;
+    }
+    if (psi_res == PSI_PARSER_FAIL) {
+        thread_logger_send_log(logger_guard, logger_buffer,
+        "Parser: Malformed pressure line\n", LOGGER_PAYLOAD_TYPE_WARNING);
+        return NULL;
+    }
+
+    size_t frequency_cpu;
+    uint32_t frequency_khz;
+    int frequency_res = frequency_sampler_parse_line(line, &frequency_cpu, &frequency_khz);
+    if (frequency_res == FREQUENCY_SAMPLER_SUCCESS) {
+        if (frequency_cpu < SNAPSHOT_MAX_CORES) {
+            state->cpu_frequency_khz[frequency_cpu] = frequency_khz;
+            state->frequency_received = true;
+        }
+        return NULL;
+    }
+    if (frequency_res == FREQUENCY_SAMPLER_FAIL) {
+        thread_logger_send_log(logger_guard, logger_buffer,
+        "Parser: Malformed frequency line\n", LOGGER_PAYLOAD_TYPE_WARNING);
+        return NULL;
+    }
+
+    int res = proc_parser_parse_line(line, state->parsed_data);
+
+    if (res == PROC_PARSER_TOTAL_USAGE_LINE) {
+        return NULL;
+    }
+    if (res == PROC_PARSER_SUCCESS) {
+        const size_t computed_core = state->computed_core;
+        if (computed_core == previous_usage_size) {
+            /*Once per tick, a line per skipped core would flood the logger buffer and stall the parser*/
+            if (!state->cores_skipped) {
                 thread_logger_send_log(logger_guard, logger_buffer,
-                "Parser: Buffer is too small to accumulate parsed results\n", LOGGER_PAYLOAD_TYPE_WARNING);
+                "Parser: Too many cores, the rest is skipped\n", LOGGER_PAYLOAD_TYPE_WARNING);
+                state->cores_skipped = true;
+            }
+            return NULL;
+        }
+        TRACE_BEGIN(TRACE_EVENT_COMPUTE);
+        ProcParserCpuTime current_usage = proc_parser_compute_core_time(state->parsed_data);
+        const long cpu_number = proc_parser_cpu_number(line);
+        const uint32_t cpu_id = cpu_number >= 0 ? (uint32_t) cpu_number : (uint32_t) computed_core;
+        /*Positions seen in the previous tick have a baseline, usage of new ones is computed since boot*/
+        const bool invalid = computed_core < snapshot->number_of_cores
+                             && (snapshot->core_cpu[computed_core] != cpu_id
+                                 || !proc_parser_counters_monotonic(state->previous_line[computed_core], state->parsed_data));
+        memcpy(state->previous_line[computed_core], state->parsed_data, sizeof(state->parsed_data));
+        if (state->frequency_received) {
+            snapshot->core_frequency_khz[computed_core] = cpu_number >= 0 && cpu_number < SNAPSHOT_MAX_CORES
+                                                          ? state->cpu_frequency_khz[cpu_number] : 0;
+        }
+        if (topology != NULL && !invalid) {
+            const TopologyCpu* cpu = cpu_number < 0 ? NULL : topology_cpu(topology, (size_t) cpu_number);
+            if (cpu != NULL) {
+                group_time_add(&state->package_time[cpu->package], &state->previous_usage[computed_core], &current_usage);
+                group_time_add(&state->node_time[cpu->node], &state->previous_usage[computed_core], &current_usage);
             }
         }
-        else {
-            temporary_buffer[index] = input_char;
-            index++;
-            if (index == temporary_buffer_size) {
-                if (strncmp(temporary_buffer, "cpu", 3) == 0) {
+        /*Counters not updated since the previous tick keep it as the baseline*/
+        const bool stale = !invalid && current_usage.total == state->previous_usage[computed_core].total;
+        snapshot->core_usage[computed_core] = invalid || stale ? NAN : proc_parser_cpu_time_compute_usage(
+                        &state->previous_usage[computed_core], &current_usage) * 100;
+        snapshot->core_invalid[computed_core] = invalid;
+        snapshot->core_stale[computed_core] = stale;
+        state->invalid_cores += invalid;
+        state->stale_cores += stale;
+        if (!stale) {
+            state->previous_usage[computed_core] = current_usage;
+        }
+        snapshot->core_time[computed_core] = current_usage;
+        snapshot->core_cpu[computed_core] = cpu_id;
+        state->computed_core++;
+        TRACE_END(TRACE_EVENT_COMPUTE);
+    }
+    else if (res == PROC_PARSER_DISCARD_LINE) {
+        /*If compute_core == 0, then we are still receiving lines with data unrelated to threads*/
+        if (state->computed_core == 0) {
+            return NULL;
+        }
+        TRACE_BEGIN(TRACE_EVENT_COMPUTE);
+        if (state->baseline) {
+            /*Usage since boot is dropped, counters and positions stay as the baseline of the next tick*/
+            memset(state->package_time, 0, sizeof(state->package_time));
+            memset(state->node_time, 0, sizeof(state->node_time));
+            snapshot->number_of_cores = state->computed_core;
+            state->previous_capture_ns = snapshot->capture_ns;
+            state->invalid_cores = 0;
+            state->stale_cores = 0;
+            state->computed_core = 0;
+            state->cores_skipped = false;
+            state->baseline = false;
+            state->snapshot_emitted = true;
+            TRACE_END(TRACE_EVENT_COMPUTE);
+            return NULL;
+        }
+        if (topology != NULL) {
+            store_groups(snapshot, topology, state->package_time, state->node_time);
+            /*Offline cpus disappear from /proc/stat, it is the only moment topology can change*/
+            if (snapshot->number_of_cores != 0 && snapshot->number_of_cores != state->computed_core) {
+                if (!topology_rescan(topology)) {
                     thread_logger_send_log(logger_guard, logger_buffer,
-                    "Parser: Buffer size is too small to accumulate data sent by reader\n", LOGGER_PAYLOAD_TYPE_WARNING);
+                    "Parser: Topology rescan after cpu hotplug failed\n", LOGGER_PAYLOAD_TYPE_WARNING);
                 }
-                temporary_buffer[temporary_buffer_size - 1] = '\0';
-                temporary_buffer[0] = input_char;
-                index = 0;
             }
         }
-        watchdog_unit_atomic_ping(control_unit);
+        snapshot->number_of_cores = state->computed_core;
+        snapshot->number_of_invalid_cores = state->invalid_cores;
+        if (state->invalid_cores != 0) {
+            char message[128];
+            snprintf(message, sizeof(message), "Parser: Counters of %zu cores went backwards or changed cpu, baseline re-established\n",
+                     state->invalid_cores);
+            thread_logger_send_log(logger_guard, logger_buffer, message, LOGGER_PAYLOAD_TYPE_WARNING);
+        }
+        state->invalid_cores = 0;
+        snapshot->number_of_stale_cores = state->stale_cores;
+        snapshot->first_complete = !state->complete_emitted && snapshot->number_of_invalid_cores == 0 && state->stale_cores == 0;
+        state->complete_emitted |= snapshot->first_complete;
+        state->stale_cores = 0;
+        snapshot->has_frequency = state->frequency_received;
+        snapshot->interval_ns = state->previous_capture_ns != 0 && snapshot->capture_ns > state->previous_capture_ns
+                                ? snapshot->capture_ns - state->previous_capture_ns : 0;
+        state->previous_capture_ns = snapshot->capture_ns;
+        snapshot->sequence++;
+        clock_gettime(CLOCK_REALTIME, &snapshot->timestamp);
+        snapshot->parsed_ns = snapshot_latency_now_ns();
+        state->computed_core = 0;
+        state->cores_skipped = false;
+        state->snapshot_emitted = true;
+        TRACE_END(TRACE_EVENT_COMPUTE);
+        return snapshot;
+    }
+    else {
+        thread_logger_send_log(logger_guard, logger_buffer,
+        "Parser: Buffer is too small to accumulate parsed results\n", LOGGER_PAYLOAD_TYPE_WARNING);
     }
     return NULL;
 }
 
+static inline void send_snapshot(CircularBuffer* snapshot_buffer, PCPGuard* guard, const Snapshot* snapshot) {
+    pcp_guard_lock(guard);
+    if (circular_buffer_insert_single(snapshot_buffer, snapshot) == 0) {
+        TRACE_BEGIN(TRACE_EVENT_ENQUEUE_WAIT);
+        pcp_guard_wait_for_consumer(guard);
+        TRACE_END(TRACE_EVENT_ENQUEUE_WAIT);
+        circular_buffer_insert_single(snapshot_buffer, snapshot);
+    }
+    pcp_guard_notify_consumer(guard);
+    pcp_guard_unlock(guard);
+}
+
+static inline void store_pressure(Snapshot* const restrict snapshot, PressureHistory history[const restrict static PSI_RESOURCE_COUNT],
+                                  const PsiParserLine* const restrict line) {
+    SnapshotPressure* current = &snapshot->pressure[line->resource];
+    PressureHistory* last = &history[line->resource];
+
+    if (!current->available) {
+        *current = (SnapshotPressure) {.available = true};
+    }
+    /*Stall time of the first tick is unknown, the counter has been growing since boot*/
+    const uint64_t stall_us = last->known[line->kind] ? psi_parser_stall_delta(last->total[line->kind], line->total) : 0;
+    last->known[line->kind] = true;
+    last->total[line->kind] = line->total;
+
+    if (line->kind == PSI_KIND_SOME) {
+        current->some_avg10 = line->avg10;
+        current->some_total = line->total;
+        current->some_stall_us = stall_us;
+    }
+    else {
+        current->full_avg10 = line->avg10;
+        current->full_total = line->total;
+        current->full_stall_us = stall_us;
+    }
+}
+
+static inline void group_time_add(ProcParserCpuTime* const group, const ProcParserCpuTime* const previous,
+                                  const ProcParserCpuTime* const current) {
+    group->total += current->total - previous->total;
+    group->idle += current->idle - previous->idle;
+}
+
+static inline void store_groups(Snapshot* const restrict snapshot, const Topology* const restrict topology,
+                                ProcParserCpuTime package_time[const restrict static SNAPSHOT_MAX_PACKAGES],
+                                ProcParserCpuTime node_time[const restrict static SNAPSHOT_MAX_NODES]) {
+    static const ProcParserCpuTime zero = {0};
+
+    snapshot->number_of_packages = topology_number_of_packages(topology);
+    for (size_t i = 0; i < snapshot->number_of_packages; i++) {
+        snapshot->package_usage[i].id = topology_package_id(topology, i);
+        snapshot->package_usage[i].usage = proc_parser_cpu_time_compute_usage(&zero, &package_time[i]) * 100;
+        package_time[i] = zero;
+    }
+    snapshot->number_of_nodes = topology_number_of_nodes(topology);
+    for (size_t i = 0; i < snapshot->number_of_nodes; i++) {
+        snapshot->node_usage[i].id = topology_node_id(topology, i);
+        snapshot->node_usage[i].usage = proc_parser_cpu_time_compute_usage(&zero, &node_time[i]) * 100;
+        node_time[i] = zero;
+    }
+}
+
+static inline size_t span_parse(ThreadParserState* const state, char* const span, const size_t count, const size_t pending,
+                                const ThreadParserArguments* const arguments, uint64_t* const cpu_mark_ns) {
+    size_t consumed = 0;
+    char* line_end;
+    for (size_t scanned = pending; (line_end = memchr(span + scanned, '\n', count - scanned)) != NULL; scanned = consumed) {
+        *line_end = '\0';
+        const Snapshot* snapshot = thread_parser_state_feed_line(state, span + consumed, arguments->logger_buffer_guard,
+                                                                 arguments->logger_buffer);
+        consumed = (size_t) (line_end - span) + 1;
+        if (snapshot == NULL) {
+            continue;
+        }
+        send_snapshot(arguments->snapshot_buffer, arguments->snapshot_buffer_guard, snapshot);
+        if (arguments->adaptive_period != NULL) {
+            adaptive_period_update(arguments->adaptive_period, snapshot, adaptive_period_process_cpu_ns());
+        }
+        if (arguments->stage_overhead != NULL) {
+            *cpu_mark_ns = stage_overhead_account(arguments->stage_overhead, PLACEMENT_STAGE_PARSER, *cpu_mark_ns, 1);
+        }
+    }
+    return consumed;
+}
 
 static inline void finalize_read(CircularBuffer* char_buffer, PCPGuard* guard) {
     /*lock on buffer */
@@ -175,13 +577,13 @@ static inline void finalize_read(CircularBuffer* char_buffer, PCPGuard* guard) {
 }
 
 
-static inline void finalize_write(CircularBuffer* char_buffer, PCPGuard* guard) {
+static inline void finalize_write(CircularBuffer* snapshot_buffer, PCPGuard* guard) {
+    static const Snapshot empty_snapshot = {0};
     /*lock on buffer */
     pcp_guard_lock(guard);
     /*Insert some garbage that will be discarded anyway, 
     NOTE: if buffer is full, nothing will happen*/
-    double d = 1.0;
-    circular_buffer_insert_single(char_buffer, &d);
+    circular_buffer_insert_single(snapshot_buffer, &empty_snapshot);
     /*Notify reader. It will lock either lock on is_working or on buffer */
     pcp_guard_notify_consumer(guard);
     /*Release buffer */
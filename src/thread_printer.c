@@ -1,23 +1,47 @@
 #include <pthread.h>
 #include <unistd.h>
+#include <math.h>
 #include "thread_printer.h"
 #include "thread_parser.h"
+#include "snapshot.h"
 #include "thread_logger.h"
 
 /**
  * @brief Clean up before leaving:
  * Let us consider the following interleaving
  * 
- * double_buffer has 0 bytes for write, working = true
+ * snapshot buffer has no space for write, working = true
  * 
  * writer -> checks working and continues the job
  * Program finishes -> working is set to false
  * Writer -> checks working and leaves
  * Reader -> waits for bytes to read
  */
-static inline void finalize(PCPGuard* double_buffer_guard, CircularBuffer* double_buffer);
+static inline void finalize(PCPGuard* snapshot_buffer_guard, CircularBuffer* snapshot_buffer, Snapshot* scratch);
 
-static void print_usage(double array[static 1]);
+static void print_usage(const Snapshot* snapshot, const UsageStats* usage_stats, uint32_t usage_stats_mask,
+                        const SelfUsage* self_usage);
+
+static void print_core(const Snapshot* snapshot, size_t index, const UsageStats* usage_stats, uint32_t usage_stats_mask,
+                       const SelfUsage* self_usage);
+
+static void print_hotspot(const Snapshot* snapshot, const Hotspot* hotspot, const UsageStats* usage_stats, uint32_t usage_stats_mask,
+                          const SelfUsage* self_usage);
+
+static void print_pressure(const Snapshot* snapshot);
+
+static void print_groups(const Snapshot* snapshot);
+
+static void print_rollup(const RollupWindow* window);
+
+/**
+ * @brief Evaluate alert rules and deliver transitions to their actions
+ */
+static void alerts_dispatch(AlertRules* alert_rules, AlertAction* const* alert_actions, const Snapshot* snapshot,
+                            PCPGuard* logger_guard, CircularBuffer* logger_buffer);
+
+/*Largest core count beyond the sinks the calling thread has logged, every pipeline handles snapshots on one thread*/
+static _Thread_local size_t reported_cores = 0;
 
 void* thread_printer(void* printer_arguments) {
     if (printer_arguments == NULL) {
@@ -25,91 +49,296 @@ void* thread_printer(void* printer_arguments) {
         return NULL;
     }
 
-    enum {
-        temp_buffer_size = 200,
-    };
-
-    CircularBuffer* double_buffer = NULL;
+    CircularBuffer* snapshot_buffer = NULL;
     CircularBuffer* logger_buffer = NULL;
-    PCPGuard* double_buffer_guard = NULL;
+    PCPGuard* snapshot_buffer_guard = NULL;
     PCPGuard* logger_guard = NULL;
     WatchdogControlUnit* control_unit = NULL;
     bool* working = NULL;
     pthread_mutex_t* working_mutex = NULL;
-    double temp_buffer[temp_buffer_size] = {0};
-    size_t index = 0;
+    StageOverhead* stage_overhead = NULL;
+    Trace* trace = NULL;
+    sem_t* started = NULL;
+    Snapshot snapshot;
 
     {
         ThreadPrinterArguments* temp = printer_arguments;
 
-        double_buffer = temp->circular_buffer;
+        snapshot_buffer = temp->circular_buffer;
         logger_buffer = temp->logger_buffer;
-        double_buffer_guard = temp->circular_buffer_guard;
+        snapshot_buffer_guard = temp->circular_buffer_guard;
         logger_guard = temp->logger_buffer_guard;
         control_unit = temp->control_unit;
         working = temp->is_working;
         working_mutex = temp->working_mutex;
-
+        stage_overhead = temp->stage_overhead;
+        trace = temp->trace;
+        started = temp->started;
     }
 
-    if (double_buffer == NULL || logger_buffer == NULL || double_buffer_guard == NULL 
+    if (snapshot_buffer == NULL || logger_buffer == NULL || snapshot_buffer_guard == NULL 
         || logger_guard == NULL || working == NULL || working_mutex == NULL || control_unit == NULL) {
         perror("Printer: one of arguments equal to NULL\n");
+        /*Whoever waits for the setup is not left hanging*/
+        if (started != NULL) {
+            sem_post(started);
+        }
         return NULL;
     }
 
+    trace_thread_attach(trace, "printer");
+    stage_overhead_thread_attach(stage_overhead);
+    if (started != NULL) {
+        sem_post(started);
+    }
+    uint64_t cpu_mark_ns = stage_overhead_thread_cpu_ns();
     while(true) {
         pthread_mutex_lock(working_mutex); 
         if (!*working) {
-            finalize(double_buffer_guard, double_buffer);
+            finalize(snapshot_buffer_guard, snapshot_buffer, &snapshot);
             pthread_mutex_unlock(working_mutex);
             watchdog_unit_atomic_finish(control_unit);
             break;
         }
         pthread_mutex_unlock(working_mutex);
 
-        double temp_double;
-        pcp_guard_lock(double_buffer_guard);
-        if (circular_buffer_remove_single(double_buffer, &temp_double) == 0) {
-            pcp_guard_wait_for_producer(double_buffer_guard);
-            circular_buffer_remove_single(double_buffer, &temp_double);
+        pcp_guard_lock(snapshot_buffer_guard);
+        if (circular_buffer_remove_single(snapshot_buffer, &snapshot) == 0) {
+            TRACE_BEGIN(TRACE_EVENT_DEQUEUE_WAIT);
+            pcp_guard_wait_for_producer(snapshot_buffer_guard);
+            TRACE_END(TRACE_EVENT_DEQUEUE_WAIT);
+            /*Woken up by finalize, there is nothing to print*/
+            if (circular_buffer_remove_single(snapshot_buffer, &snapshot) == 0) {
+                pcp_guard_unlock(snapshot_buffer_guard);
+                continue;
+            }
         }
-        pcp_guard_notify_producer(double_buffer_guard);
-        pcp_guard_unlock(double_buffer_guard);
-        temp_buffer[index++] = temp_double;
-        if (temp_double < 0.0) {
-            puts("________________\n");
-            print_usage(temp_buffer);
-            puts("________________\n");
-            fflush(stdout);
-            index = 0;
-        }
-        if (index == temp_buffer_size) {
-            thread_logger_send_log(logger_guard, logger_buffer,
-            "Buffer size is too small\n", LOGGER_PAYLOAD_TYPE_WARNING);
+        pcp_guard_notify_producer(snapshot_buffer_guard);
+        pcp_guard_unlock(snapshot_buffer_guard);
+        TRACE_BEGIN(TRACE_EVENT_PRINT);
+        thread_printer_handle_snapshot(printer_arguments, &snapshot);
+        TRACE_END(TRACE_EVENT_PRINT);
+        if (stage_overhead != NULL) {
+            cpu_mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_PRINTER, cpu_mark_ns, 1);
         }
         watchdog_unit_atomic_ping(control_unit);
     }
     return NULL;
 }
 
-static void print_usage(double array[static 1]) {
-    size_t index = 0;
-    while (array[index] >= 0.0) {
-        printf("Core #%zu usage: %.2F%%\n", index, array[index]);
-        index++;
+void thread_printer_handle_snapshot(const ThreadPrinterArguments* const restrict printer_arguments,
+                                    const Snapshot* const restrict snapshot) {
+    if (snapshot->number_of_cores == 0) {
+        return;
+    }
+    PCPGuard* logger_guard = printer_arguments->logger_buffer_guard;
+    CircularBuffer* logger_buffer = printer_arguments->logger_buffer;
+    UsageStats* usage_stats = printer_arguments->usage_stats;
+    const uint32_t usage_stats_mask = printer_arguments->usage_stats_mask;
+    Hotspot* hotspot = printer_arguments->hotspot;
+    Rollup* rollup = printer_arguments->rollup;
+    SelfUsage* self_usage = printer_arguments->self_usage;
+    StageOverhead* stage_overhead = printer_arguments->stage_overhead;
+    const StageOverheadReport* overhead_report = NULL;
+
+    const size_t sink_cores = printer_arguments->number_of_cores;
+    if (sink_cores != 0 && snapshot->number_of_cores > sink_cores && snapshot->number_of_cores > reported_cores) {
+        reported_cores = snapshot->number_of_cores;
+        char message[128];
+        snprintf(message, sizeof(message), "Printer: Input has %zu cores, per-core statistics cover only the first %zu\n",
+                 snapshot->number_of_cores, sink_cores);
+        thread_logger_send_log(logger_guard, logger_buffer, message, LOGGER_PAYLOAD_TYPE_WARNING);
+    }
+    if (printer_arguments->alert_rules != NULL) {
+        alerts_dispatch(printer_arguments->alert_rules, printer_arguments->alert_actions, snapshot, logger_guard, logger_buffer);
+    }
+    if (usage_stats != NULL) {
+        usage_stats_update(usage_stats, snapshot);
+    }
+    if (self_usage != NULL && !self_usage_update(self_usage, snapshot)) {
+        thread_logger_send_log(logger_guard, logger_buffer,
+        "Printer: Reading own threads failed\n", LOGGER_PAYLOAD_TYPE_WARNING);
+    }
+    if (stage_overhead != NULL) {
+        overhead_report = stage_overhead_snapshot(stage_overhead);
+    }
+    if (printer_arguments->snapshot_shm != NULL) {
+        snapshot_shm_publish(printer_arguments->snapshot_shm, snapshot, usage_stats == NULL ? NULL : usage_stats_values(usage_stats),
+                             usage_stats == NULL ? 0 : usage_stats_number_of_cores(usage_stats),
+                             stage_overhead == NULL ? NULL : stage_overhead_latest(stage_overhead));
+    }
+    if (printer_arguments->metrics_endpoint != NULL
+        && !metrics_endpoint_publish(printer_arguments->metrics_endpoint, snapshot,
+                                     stage_overhead == NULL ? NULL : stage_overhead_latest(stage_overhead))) {
+        thread_logger_send_log(logger_guard, logger_buffer,
+        "Printer: Metrics page does not fit into its buffer\n", LOGGER_PAYLOAD_TYPE_WARNING);
+    }
+    if (printer_arguments->history_store != NULL && !history_store_append(printer_arguments->history_store, snapshot)) {
+        thread_logger_send_log(logger_guard, logger_buffer,
+        "Printer: Appending to history failed\n", LOGGER_PAYLOAD_TYPE_WARNING);
+    }
+    puts("________________\n");
+    if (hotspot != NULL) {
+        hotspot_update(hotspot, snapshot);
+        print_hotspot(snapshot, hotspot, usage_stats, usage_stats_mask, self_usage);
+    } else {
+        print_usage(snapshot, usage_stats, usage_stats_mask, self_usage);
+    }
+    print_groups(snapshot);
+    print_pressure(snapshot);
+    if (overhead_report != NULL) {
+        char message[STAGE_OVERHEAD_MESSAGE_SIZE];
+        stage_overhead_format(overhead_report, message, sizeof(message));
+        fputs(message, stdout);
+        thread_logger_send_log(logger_guard, logger_buffer, message, LOGGER_PAYLOAD_TYPE_INFO);
+        if (overhead_report->hardware) {
+            stage_overhead_format_hardware(overhead_report, message, sizeof(message));
+            fputs(message, stdout);
+            thread_logger_send_log(logger_guard, logger_buffer, message, LOGGER_PAYLOAD_TYPE_INFO);
+        }
+    }
+    if (rollup != NULL && rollup_add(rollup, snapshot)) {
+        for (size_t i = 0; i < ROLLUP_TIER_COUNT; i++) {
+            const RollupWindow* window = rollup_completed(rollup, (ERollupTier) i);
+            if (window == NULL) {
+                continue;
+            }
+            print_rollup(window);
+            if (printer_arguments->rollup_stores[i] != NULL) {
+                history_store_append_values(printer_arguments->rollup_stores[i], window->start_ns, (const double*) window->cores,
+                                            window->number_of_cores * ROLLUP_STATISTICS_COUNT);
+            }
+        }
+    }
+    puts("________________\n");
+    fflush(stdout);
+    SnapshotLatency* latency = printer_arguments->snapshot_latency;
+    if (latency != NULL && snapshot_latency_record(latency, snapshot, snapshot_latency_now_ns())) {
+        char message[SNAPSHOT_LATENCY_MESSAGE_SIZE];
+        snapshot_latency_format(latency, message, sizeof(message));
+        thread_logger_send_log(logger_guard, logger_buffer, message, LOGGER_PAYLOAD_TYPE_INFO);
+    }
+    if (printer_arguments->start_ns != 0 && snapshot->first_complete) {
+        char message[128];
+        snprintf(message, sizeof(message), "Printer: First snapshot with usage of every core %.1f ms after start (sequence %" PRIu64 ")\n",
+                 (double) (snapshot_latency_now_ns() - printer_arguments->start_ns) / 1e6, snapshot->sequence);
+        thread_logger_send_log(logger_guard, logger_buffer, message, LOGGER_PAYLOAD_TYPE_INFO);
+    }
+}
+
+static void print_usage(const Snapshot* const snapshot, const UsageStats* const usage_stats, const uint32_t usage_stats_mask,
+                        const SelfUsage* const self_usage) {
+    for (size_t index = 0; index < snapshot->number_of_cores; index++) {
+        print_core(snapshot, index, usage_stats, usage_stats_mask, self_usage);
+    }
+}
+
+static void print_core(const Snapshot* const snapshot, const size_t index, const UsageStats* const usage_stats,
+                       const uint32_t usage_stats_mask, const SelfUsage* const self_usage) {
+    if (snapshot->core_invalid[index]) {
+        printf("Core #%zu usage: invalid (counter reset)", index);
+    } else if (snapshot->core_stale[index]) {
+        printf("Core #%zu usage: no data (counters did not advance)", index);
+    } else {
+        printf("Core #%zu usage: %.2F%%", index, snapshot->core_usage[index]);
+    }
+    if (snapshot->has_frequency && snapshot->core_frequency_khz[index] != 0) {
+        printf(" freq: %" PRIu32 " MHz", snapshot->core_frequency_khz[index] / 1000);
+    }
+    for (size_t i = 0; usage_stats != NULL && i < USAGE_STATISTIC_COUNT; i++) {
+        if (usage_stats_mask & (UINT32_C(1) << i)) {
+            printf(" %s: %.2F%%", usage_stats_statistic_to_str((EUsageStatistic) i),
+                   usage_stats_get(usage_stats, index, (EUsageStatistic) i));
+        }
+    }
+    if (self_usage != NULL && !isnan(self_usage_get(self_usage, index))) {
+        printf(" own: %.2F%%", self_usage_get(self_usage, index));
+    }
+    putchar('\n');
+}
+
+static void print_hotspot(const Snapshot* const snapshot, const Hotspot* const hotspot, const UsageStats* const usage_stats,
+                          const uint32_t usage_stats_mask, const SelfUsage* const self_usage) {
+    const HotspotAggregate* aggregate = hotspot_aggregate(hotspot);
+    size_t count = 0;
+
+    printf("Cores: %zu min: %.2F%% max: %.2F%% avg: %.2F%% hot: %zu\n", aggregate->number_of_cores,
+           aggregate->min, aggregate->max, aggregate->avg, aggregate->number_of_hot);
+
+    const HotspotCore* busiest = hotspot_busiest(hotspot, &count);
+    puts("Busiest:");
+    for (size_t i = 0; i < count; i++) {
+        if (hotspot_is_hot(hotspot, busiest[i].core)) {
+            printf("[HOT %zu] ", hotspot_streak(hotspot, busiest[i].core));
+        }
+        print_core(snapshot, busiest[i].core, usage_stats, usage_stats_mask, self_usage);
+    }
+
+    const HotspotCore* idlest = hotspot_idlest(hotspot, &count);
+    puts("Idlest:");
+    for (size_t i = 0; i < count; i++) {
+        print_core(snapshot, idlest[i].core, usage_stats, usage_stats_mask, self_usage);
+    }
+}
+
+static void print_pressure(const Snapshot* const snapshot) {
+    for (size_t i = 0; i < PSI_RESOURCE_COUNT; i++) {
+        const SnapshotPressure* pressure = &snapshot->pressure[i];
+        if (!pressure->available) {
+            continue;
+        }
+        printf("Pressure %s: some avg10 %.2F%% stall %" PRIu64 "us, full avg10 %.2F%% stall %" PRIu64 "us\n",
+               psi_parser_resource_to_str((EPsiResource) i), pressure->some_avg10, pressure->some_stall_us,
+               pressure->full_avg10, pressure->full_stall_us);
+    }
+}
+
+static void print_groups(const Snapshot* const snapshot) {
+    for (size_t i = 0; i < snapshot->number_of_packages; i++) {
+        printf("Socket #%" PRIu32 " usage: %.2F%%\n", snapshot->package_usage[i].id, snapshot->package_usage[i].usage);
+    }
+    for (size_t i = 0; i < snapshot->number_of_nodes; i++) {
+        printf("Node #%" PRIu32 " usage: %.2F%%\n", snapshot->node_usage[i].id, snapshot->node_usage[i].usage);
+    }
+}
+
+static void print_rollup(const RollupWindow* const window) {
+    printf("Rollup %s (%zu samples):\n", rollup_tier_to_str(window->tier), window->number_of_samples);
+    for (size_t index = 0; index < window->number_of_cores; index++) {
+        const RollupCoreStats* stats = &window->cores[index];
+        printf("Core #%zu min: %.2F%% max: %.2F%% avg: %.2F%% p95: %.2F%%\n",
+               index, stats->min, stats->max, stats->avg, stats->p95);
+    }
+}
+
+static void alerts_dispatch(AlertRules* const alert_rules, AlertAction* const* const alert_actions, const Snapshot* const snapshot,
+                            PCPGuard* const logger_guard, CircularBuffer* const logger_buffer) {
+    /*Transitions above the limit are applied but not delivered, it bounds the time spent here*/
+    static AlertEvent events[256];
+    const size_t number_of_events = alert_rules_evaluate(alert_rules, snapshot, events, sizeof(events) / sizeof(*events));
+
+    for (size_t i = 0; i < number_of_events; i++) {
+        char message[ALERT_EVENT_MESSAGE_SIZE];
+        const int length = alert_rules_format_event(alert_rules, &events[i], message, sizeof(message));
+        AlertAction* action = alert_actions[events[i].rule];
+
+        if (alert_action_type(action) == ALERT_ACTION_LOG) {
+            thread_logger_send_log(logger_guard, logger_buffer, message, LOGGER_PAYLOAD_TYPE_WARNING);
+        } else if (length > 0) {
+            const size_t message_length = (size_t) length < sizeof(message) ? (size_t) length : sizeof(message) - 1;
+            alert_action_send(action, message, message_length);
+        }
     }
 }
 
-static inline void finalize(PCPGuard* double_buffer_guard, CircularBuffer* double_buffer) {
+static inline void finalize(PCPGuard* snapshot_buffer_guard, CircularBuffer* snapshot_buffer, Snapshot* scratch) {
     /*The lock on buffer guard*/
-    pcp_guard_lock(double_buffer_guard);
-    double temp;
+    pcp_guard_lock(snapshot_buffer_guard);
     /*Removing single element 
     NOTE: nothing will happen if buffer is empty*/
-    circular_buffer_remove_single(double_buffer, &temp);
+    circular_buffer_remove_single(snapshot_buffer, scratch);
     /*Set parser free if he is currently locked*/
-    pcp_guard_notify_producer(double_buffer_guard);
+    pcp_guard_notify_producer(snapshot_buffer_guard);
     /*unlock buffer guard*/
-    pcp_guard_unlock(double_buffer_guard);
+    pcp_guard_unlock(snapshot_buffer_guard);
 }
@@ -3,10 +3,15 @@
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
+#include <stdio.h>
+#include <signal.h>
+#include <string.h>
 #include "thread_reader.h"
 #include "circular_buffer.h"
 #include "pcp_guard.h"
 #include "thread_logger.h"
+#include "snapshot_latency.h"
+#include "thread_parser.h"
 
 
 /*
@@ -21,6 +26,57 @@
  */
 static inline void finalize(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard);
 
+/**
+ * @brief Reserve free space of char_buffer, wait once if the buffer is full. Shall be called with the guard locked.
+ * @return start of the free space, count is 0 if the wait ended without free space
+ */
+static inline char* space_reserve(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard, size_t* count);
+
+/**
+ * @brief Send length bytes of data through char_buffer, wait whenever the buffer is full.
+ * The rest is dropped if a wait ends without free space, i.e. on shutdown.
+ */
+static inline void send_bytes(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard, const char* data, size_t length);
+
+/**
+ * @brief Read from input_file straight into free space of char_buffer, wait if the buffer is full.
+ * Bytes read are added to recorder before the parser can see them.
+ * @return number of bytes read, 0 at the end of file, on error or if the wait ended without free space
+ */
+static inline size_t send_file(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard, FILE* input_file,
+                               StatRecorder* recorder);
+
+/**
+ * @brief Send stamp of the tick start through char_buffer as line "tick <ns>"
+ * @return the stamp
+ */
+static inline uint64_t send_tick(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard);
+
+/**
+ * @brief Send line marking the current tick as the baseline, @see thread_parser.h
+ */
+static inline void send_baseline(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard);
+
+/**
+ * @brief Send content of the next recorded tick through char_buffer, after the recorded delay unless fast,
+ * marked as the baseline if baseline is true
+ * @return false at the end of the recording
+ */
+static inline bool send_replay(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard, StatReplay* replay, bool fast,
+                               bool baseline);
+
+/**
+ * @brief Send content of every open pressure file through char_buffer.
+ * Each line is prefixed with "psi <resource> " so parser can tell it apart from /proc/stat
+ */
+static inline void send_pressure(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard,
+                                 FILE* pressure_files[static PSI_RESOURCE_COUNT]);
+
+/**
+ * @brief Sample frequency of every cpu and send it through char_buffer as lines "freq <cpu> <kHz>"
+ */
+static inline void send_frequency(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard, FrequencySampler* frequency_sampler);
+
 void* thread_reader(void* reader_arguments) {
     /*Sanity check*/
     if (reader_arguments == NULL) {
@@ -28,7 +84,8 @@ void* thread_reader(void* reader_arguments) {
         return NULL;
     }
 
-    const struct timespec sleep_time = {.tv_nsec = 0, .tv_sec = 1};
+    struct timespec sleep_time = {.tv_nsec = 0, .tv_sec = 1};
+    struct timespec priming = {.tv_nsec = 0, .tv_sec = 0};
     PCPGuard* char_buffer_guard = NULL;
     PCPGuard* logger_buffer_guard = NULL;
     CircularBuffer* logger_buffer = NULL;
@@ -37,6 +94,19 @@ void* thread_reader(void* reader_arguments) {
     bool* is_working = NULL;
     pthread_mutex_t* working_mtx = NULL;
     FILE* input_file = NULL;
+    FILE* pressure_files[PSI_RESOURCE_COUNT] = {NULL};
+    FrequencySampler* frequency_sampler = NULL;
+    StageOverhead* stage_overhead = NULL;
+    Trace* trace = NULL;
+    StatRecorder* recorder = NULL;
+    StatReplay* replay = NULL;
+    AdaptivePeriod* adaptive_period = NULL;
+    sem_t* started = NULL;
+    bool replay_fast = false;
+    bool replay_finished = false;
+    bool tick_start = true;
+    bool baseline = false;
+    uint64_t tick_ns = 0;
 
     {
         ThreadReaderArguments* temp = reader_arguments;
@@ -49,17 +119,43 @@ void* thread_reader(void* reader_arguments) {
         is_working = temp->working;
         working_mtx = temp->working_mutex;
         input_file = temp->input_file;
+        for (size_t i = 0; i < PSI_RESOURCE_COUNT; i++) {
+            pressure_files[i] = temp->pressure_files[i];
+        }
+        frequency_sampler = temp->frequency_sampler;
+        stage_overhead = temp->stage_overhead;
+        trace = temp->trace;
+        recorder = temp->recorder;
+        replay = temp->replay;
+        replay_fast = temp->replay_fast;
+        if (temp->period.tv_sec != 0 || temp->period.tv_nsec != 0) {
+            sleep_time = temp->period;
+        }
+        priming = temp->priming;
+        adaptive_period = temp->adaptive_period;
+        started = temp->started;
+        baseline = priming.tv_sec != 0 || priming.tv_nsec != 0;
 
         temp = NULL;
     }
 
     /*Sanity check*/
     if (char_buffer == NULL || char_buffer_guard == NULL || logger_buffer == NULL || logger_buffer_guard == NULL
-        || is_working == NULL || working_mtx == NULL || input_file == NULL || control_unit == NULL) {
+        || is_working == NULL || working_mtx == NULL || (input_file == NULL && replay == NULL) || control_unit == NULL) {
         perror("One of arguments was NULL");
+        /*Whoever waits for the setup is not left hanging*/
+        if (started != NULL) {
+            sem_post(started);
+        }
         return NULL;
     }
 
+    trace_thread_attach(trace, "reader");
+    stage_overhead_thread_attach(stage_overhead);
+    if (started != NULL) {
+        sem_post(started);
+    }
+    uint64_t cpu_mark_ns = stage_overhead_thread_cpu_ns();
     while (true) {
         pthread_mutex_lock(working_mtx);
         if (!*is_working) {
@@ -69,30 +165,67 @@ void* thread_reader(void* reader_arguments) {
             break;
         }
         pthread_mutex_unlock(working_mtx);
-        
-        int input_char_int = fgetc(input_file);
-        
-        if (input_char_int != EOF) {
-            char input_char = (char) input_char_int;
-            pcp_guard_lock(char_buffer_guard);
 
-            if (circular_buffer_insert_single(char_buffer, &input_char) == 0) {
-                pcp_guard_wait_for_consumer(char_buffer_guard);
-                circular_buffer_insert_single(char_buffer, &input_char);
+        if (replay != NULL) {
+            if (!replay_finished && !send_replay(char_buffer, char_buffer_guard, replay, replay_fast, baseline)) {
+                /*Main thread stops the pipeline as on user request*/
+                replay_finished = true;
+                thread_logger_send_log(logger_buffer_guard, logger_buffer, "Replay finished\n", LOGGER_PAYLOAD_TYPE_INFO);
+                kill(getpid(), SIGTERM);
             }
-            pcp_guard_notify_consumer(char_buffer_guard);
-            pcp_guard_unlock(char_buffer_guard);
+            if (replay_finished) {
+                nanosleep(&sleep_time, NULL);
+                errno = 0;
+            }
+            baseline = false;
+            watchdog_unit_atomic_ping(control_unit);
+            if (stage_overhead != NULL) {
+                cpu_mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_READER, cpu_mark_ns, 1);
+            }
+            continue;
         }
-        else if (feof(input_file)) {
+
+        if (tick_start) {
+            TRACE_BEGIN(TRACE_EVENT_READ);
+            tick_ns = send_tick(char_buffer, char_buffer_guard);
+            if (baseline) {
+                send_baseline(char_buffer, char_buffer_guard);
+            }
+            send_pressure(char_buffer, char_buffer_guard, pressure_files);
+            if (frequency_sampler != NULL) {
+                send_frequency(char_buffer, char_buffer_guard, frequency_sampler);
+            }
+            tick_start = false;
+        }
+        
+        if (send_file(char_buffer, char_buffer_guard, input_file, recorder) != 0) {
+            continue;
+        }
+        if (feof(input_file)) {
+            TRACE_END(TRACE_EVENT_READ);
+            if (recorder != NULL && !stat_recorder_commit(recorder, tick_ns)) {
+                thread_logger_send_log(logger_buffer_guard, logger_buffer,
+                                       "Recording of tick failed\n", LOGGER_PAYLOAD_TYPE_WARNING);
+            }
             watchdog_unit_atomic_ping(control_unit);
+            if (stage_overhead != NULL) {
+                cpu_mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_READER, cpu_mark_ns, 1);
+            }
             
-            if (nanosleep(&sleep_time, NULL) != 0) {
+            if (adaptive_period != NULL) {
+                const uint64_t period_ns = adaptive_period_current_ns(adaptive_period);
+                sleep_time = (struct timespec) {.tv_sec = (time_t) (period_ns / 1000000000u), .tv_nsec = (long) (period_ns % 1000000000u)};
+            }
+            /*The first interval is shortened, so the first snapshot arrives soon after start*/
+            if (nanosleep(baseline ? &priming : &sleep_time, NULL) != 0) {
                 errno = 0;
                 thread_logger_send_log(logger_buffer_guard, logger_buffer,
                                        "Sleep error\n", LOGGER_PAYLOAD_TYPE_ERROR);
             }
             fflush(input_file);
             rewind(input_file);
+            tick_start = true;
+            baseline = false;
         }
         else if (ferror(input_file)) {
             clearerr(input_file);
@@ -115,3 +248,135 @@ static inline void finalize(CircularBuffer* char_buffer, PCPGuard* char_buffer_g
     /*Release buffer guard*/
     pcp_guard_unlock(char_buffer_guard);
 }
+
+static inline char* space_reserve(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard, size_t* count) {
+    char* span = circular_buffer_reserve_span(char_buffer, count);
+    if (*count == 0) {
+        TRACE_BEGIN(TRACE_EVENT_ENQUEUE_WAIT);
+        pcp_guard_wait_for_consumer(char_buffer_guard);
+        TRACE_END(TRACE_EVENT_ENQUEUE_WAIT);
+        span = circular_buffer_reserve_span(char_buffer, count);
+    }
+    return span;
+}
+
+static inline void send_bytes(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard, const char* data, size_t length) {
+    while (length != 0) {
+        pcp_guard_lock(char_buffer_guard);
+        size_t count;
+        char* span = space_reserve(char_buffer, char_buffer_guard, &count);
+        if (count == 0) {
+            pcp_guard_unlock(char_buffer_guard);
+            return;
+        }
+        count = count < length ? count : length;
+        memcpy(span, data, count);
+        circular_buffer_commit(char_buffer, count);
+        pcp_guard_notify_consumer(char_buffer_guard);
+        pcp_guard_unlock(char_buffer_guard);
+        data += count;
+        length -= count;
+    }
+}
+
+static inline size_t send_file(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard, FILE* input_file,
+                               StatRecorder* recorder) {
+    pcp_guard_lock(char_buffer_guard);
+    size_t count;
+    char* span = space_reserve(char_buffer, char_buffer_guard, &count);
+    pcp_guard_unlock(char_buffer_guard);
+    if (count == 0) {
+        return 0;
+    }
+
+    /*Parser reads only committed bytes, the span is filled without the guard*/
+    const size_t length = fread(span, 1, count, input_file);
+    if (length == 0) {
+        return 0;
+    }
+    if (recorder != NULL) {
+        stat_recorder_add(recorder, span, length);
+    }
+    pcp_guard_lock(char_buffer_guard);
+    circular_buffer_commit(char_buffer, length);
+    pcp_guard_notify_consumer(char_buffer_guard);
+    pcp_guard_unlock(char_buffer_guard);
+    return length;
+}
+
+static inline uint64_t send_tick(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard) {
+    char line[32];
+    const uint64_t now_ns = snapshot_latency_now_ns();
+    snapshot_latency_format_line(now_ns, line, sizeof(line));
+    send_bytes(char_buffer, char_buffer_guard, line, strlen(line));
+    return now_ns;
+}
+
+static inline void send_baseline(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard) {
+    static const char line[] = THREAD_PARSER_BASELINE_LINE "\n";
+    send_bytes(char_buffer, char_buffer_guard, line, sizeof(line) - 1);
+}
+
+static inline bool send_replay(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard, StatReplay* replay, const bool fast,
+                               const bool baseline) {
+    if (!stat_replay_next(replay)) {
+        return false;
+    }
+    const uint64_t delay_ns = stat_replay_delay_ns(replay);
+    if (!fast && delay_ns != 0) {
+        const struct timespec delay = {.tv_sec = (time_t) (delay_ns / 1000000000u), .tv_nsec = (long) (delay_ns % 1000000000u)};
+        nanosleep(&delay, NULL);
+        errno = 0;
+    }
+    size_t length = 0;
+    const char* content = stat_replay_data(replay, &length);
+    TRACE_BEGIN(TRACE_EVENT_READ);
+    send_tick(char_buffer, char_buffer_guard);
+    if (baseline) {
+        send_baseline(char_buffer, char_buffer_guard);
+    }
+    send_bytes(char_buffer, char_buffer_guard, content, length);
+    TRACE_END(TRACE_EVENT_READ);
+    return true;
+}
+
+static inline void send_pressure(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard,
+                                 FILE* pressure_files[const static PSI_RESOURCE_COUNT]) {
+    for (size_t i = 0; i < PSI_RESOURCE_COUNT; i++) {
+        FILE* pressure_file = pressure_files[i];
+        if (pressure_file == NULL) {
+            continue;
+        }
+        /*seq_file regenerates the content after seeking to the beginning*/
+        rewind(pressure_file);
+        char prefix[16];
+        const int prefix_length = snprintf(prefix, sizeof(prefix), "psi %s ", psi_parser_resource_to_str((EPsiResource) i));
+        bool line_start = true;
+        char line[128];
+
+        while (fgets(line, sizeof(line), pressure_file) != NULL) {
+            if (line_start) {
+                send_bytes(char_buffer, char_buffer_guard, prefix, (size_t) prefix_length);
+            }
+            const size_t length = strlen(line);
+            send_bytes(char_buffer, char_buffer_guard, line, length);
+            line_start = length != 0 && line[length - 1] == '\n';
+        }
+        clearerr(pressure_file);
+    }
+}
+
+static inline void send_frequency(CircularBuffer* char_buffer, PCPGuard* char_buffer_guard, FrequencySampler* frequency_sampler) {
+    /*All files are read before anything is sent, so the samples are as close in time as possible*/
+    const uint32_t* frequency_khz = frequency_sampler_sample(frequency_sampler);
+    const size_t number_of_cpus = frequency_sampler_number_of_cpus(frequency_sampler);
+    char line[48];
+
+    for (size_t cpu = 0; cpu < number_of_cpus; cpu++) {
+        if (frequency_khz[cpu] == 0) {
+            continue;
+        }
+        const int length = snprintf(line, sizeof(line), "freq %zu %" PRIu32 "\n", cpu, frequency_khz[cpu]);
+        send_bytes(char_buffer, char_buffer_guard, line, (size_t) length);
+    }
+}
@@ -13,6 +13,8 @@ void* thread_watchdog(void* args) {
     Watchdog* watchdog = NULL;
     bool* is_working = NULL;
     pthread_mutex_t* mutex = NULL;
+    StageOverhead* stage_overhead = NULL;
+    sem_t* started = NULL;
     const struct timespec sleep_time = {.tv_nsec = 0, .tv_sec = 2};
 
     {
@@ -21,12 +23,24 @@ void* thread_watchdog(void* args) {
         watchdog = temp->watchdog;
         is_working = temp->is_working;
         mutex = temp->mutex;
+        stage_overhead = temp->stage_overhead;
+        started = temp->started;
     }
 
     if (watchdog == NULL || is_working == NULL || mutex == NULL) {
         perror("Watchdog: one of arguments was NULL\n");
+        /*Whoever waits for the setup is not left hanging*/
+        if (started != NULL) {
+            sem_post(started);
+        }
+        return NULL;
     }
 
+    stage_overhead_thread_attach(stage_overhead);
+    if (started != NULL) {
+        sem_post(started);
+    }
+    uint64_t cpu_mark_ns = stage_overhead_thread_cpu_ns();
     while(true) {
         pthread_mutex_lock(mutex);
         if (!*is_working) {
@@ -39,6 +53,9 @@ void* thread_watchdog(void* args) {
             puts("Watchdog: One of the threads is not responding. Aborting...\n");
             abort();
         }
+        if (stage_overhead != NULL) {
+            cpu_mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_WATCHDOG, cpu_mark_ns, 1);
+        }
         if (nanosleep(&sleep_time, NULL) != 0) {
             errno = 0;
             perror("Sleep error\n");
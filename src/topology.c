@@ -0,0 +1,355 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "topology.h"
+
+enum {
+    TOPOLOGY_PATH_SIZE = 4096,
+    /*Longest accepted content of cpulist file*/
+    TOPOLOGY_FILE_SIZE = 4096,
+    TOPOLOGY_DIRECTORY_SIZE = 4096,
+};
+
+/**
+ * @brief Entry returned by getdents64
+ */
+typedef struct TopologyDirent {
+    uint64_t inode;
+    int64_t offset;
+    unsigned short length;
+    unsigned char type;
+    char name[];
+} TopologyDirent;
+
+/**
+ * @brief Result of one scan, swapped into Topology only when complete
+ */
+typedef struct TopologyScan {
+    size_t number_of_packages;
+    size_t number_of_nodes;
+    uint32_t package_ids[SNAPSHOT_MAX_PACKAGES];
+    uint32_t node_ids[SNAPSHOT_MAX_NODES];
+    TopologyCpu cpus[SNAPSHOT_MAX_CORES];
+} TopologyScan;
+
+struct Topology {
+    TopologyScan scan;
+    /*Rescan is read here, rescan runs in the parser and must not allocate*/
+    TopologyScan spare;
+    /*Memory belongs to an arena and is not freed by topology_delete*/
+    bool arena_owned;
+    char root[]; /*FAM*/
+};
+
+/**
+ * @brief Fill scan from sysfs below root
+ */
+static bool scan_read(const char* root, TopologyScan* scan);
+
+/**
+ * @brief Mark numbers of entries of directory named prefix followed by number below size, e.g. "cpu12".
+ * Directory is listed by getdents64 into a buffer on the stack, opendir would allocate.
+ * @return false if the directory cannot be opened
+ */
+static bool directory_numbers(const char* path, const char* prefix, bool numbers[], size_t size);
+
+/**
+ * @brief Read whole (small) file into dest as null-terminated string, plain read as fopen would allocate
+ */
+static bool file_read(const char* path, char* dest, size_t dest_size);
+
+static bool file_read_u32(const char* path, uint32_t* value);
+
+/**
+ * @brief Find id in sorted ids or insert it, keeping the order
+ * @return false if there is no space left
+ */
+static bool id_insert(uint32_t* ids, size_t* count, size_t capacity, uint32_t id);
+
+static size_t id_index(const uint32_t* ids, size_t count, uint32_t id);
+
+/**
+ * @brief Parse number from directory name with given prefix, e.g. "cpu12"
+ */
+static bool entry_number(const char* name, const char* prefix, size_t* number);
+
+Topology* topology_new(const char root[const static 1]) {
+    Topology* result = malloc(topology_footprint(root));
+    if (result == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    result->arena_owned = false;
+    strcpy(result->root, root);
+    if (!scan_read(result->root, &result->scan)) {
+        free(result);
+        return NULL;
+    }
+    return result;
+}
+
+Topology* topology_new_in(Arena* const arena, const char root[const static 1]) {
+    Topology* result = arena_alloc(arena, topology_footprint(root));
+    if (result == NULL) {
+        return NULL;
+    }
+    result->arena_owned = true;
+    strcpy(result->root, root);
+    /*Carved space is not returned on failure, the arena is sized for a single topology*/
+    return scan_read(result->root, &result->scan) ? result : NULL;
+}
+
+size_t topology_footprint(const char root[const static 1]) {
+    return sizeof(Topology) + sizeof(char) * (strlen(root) + 1);
+}
+
+void topology_delete(Topology* const topology) {
+    if (topology != NULL && topology->arena_owned) {
+        return;
+    }
+    free(topology);
+}
+
+bool topology_rescan(Topology* const topology) {
+    const bool result = scan_read(topology->root, &topology->spare);
+    if (result) {
+        topology->scan = topology->spare;
+    }
+    return result;
+}
+
+const TopologyCpu* topology_cpu(const Topology* const topology, const size_t cpu) {
+    if (cpu >= SNAPSHOT_MAX_CORES || !topology->scan.cpus[cpu].online) {
+        return NULL;
+    }
+    return &topology->scan.cpus[cpu];
+}
+
+size_t topology_number_of_packages(const Topology* const topology) {
+    return topology->scan.number_of_packages;
+}
+
+size_t topology_number_of_nodes(const Topology* const topology) {
+    return topology->scan.number_of_nodes;
+}
+
+uint32_t topology_package_id(const Topology* const topology, const size_t package) {
+    return topology->scan.package_ids[package];
+}
+
+uint32_t topology_node_id(const Topology* const topology, const size_t node) {
+    return topology->scan.node_ids[node];
+}
+
+static bool scan_read(const char* const root, TopologyScan* const scan) {
+    char path[TOPOLOGY_PATH_SIZE];
+    char content[TOPOLOGY_FILE_SIZE];
+    /*Sysfs ids of package and node of every cpu, converted to dense indices at the end*/
+    uint32_t package_of[SNAPSHOT_MAX_CORES];
+    uint32_t node_of[SNAPSHOT_MAX_CORES] = {0};
+    bool listed[SNAPSHOT_MAX_CORES];
+    bool entries[SNAPSHOT_MAX_CORES];
+    size_t online = 0;
+
+    memset(scan, 0, sizeof(*scan));
+
+    snprintf(path, sizeof(path), "%s/devices/system/cpu", root);
+    if (!directory_numbers(path, "cpu", entries, SNAPSHOT_MAX_CORES)) {
+        return false;
+    }
+    for (size_t cpu = 0; cpu < SNAPSHOT_MAX_CORES; cpu++) {
+        if (!entries[cpu]) {
+            continue;
+        }
+        TopologyCpu* current = &scan->cpus[cpu];
+        uint32_t value = 1;
+
+        /*cpu0 usually cannot be taken offline and has no online file*/
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%zu/online", root, cpu);
+        if (file_read_u32(path, &value) && value == 0) {
+            continue;
+        }
+        /*Offline cpus have no topology directory*/
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%zu/topology/physical_package_id", root, cpu);
+        if (!file_read_u32(path, &package_of[cpu])) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%zu/topology/core_id", root, cpu);
+        if (!file_read_u32(path, &current->core_id)) {
+            continue;
+        }
+        current->first_sibling = (uint32_t) cpu;
+        current->thread = 0;
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%zu/topology/thread_siblings_list", root, cpu);
+        if (file_read(path, content, sizeof(content)) && topology_cpulist_parse(content, listed, SNAPSHOT_MAX_CORES)) {
+            bool first = true;
+            for (size_t sibling = 0; sibling < cpu; sibling++) {
+                if (listed[sibling]) {
+                    current->first_sibling = first ? (uint32_t) sibling : current->first_sibling;
+                    current->thread++;
+                    first = false;
+                }
+            }
+        }
+        if (!id_insert(scan->package_ids, &scan->number_of_packages, SNAPSHOT_MAX_PACKAGES, package_of[cpu])) {
+            return false;
+        }
+        current->online = true;
+        online++;
+    }
+    if (online == 0) {
+        return false;
+    }
+
+    /*Kernels without NUMA have no node directory, all cpus are in node 0. Nodes are numbered below cpus*/
+    snprintf(path, sizeof(path), "%s/devices/system/node", root);
+    if (!directory_numbers(path, "node", entries, SNAPSHOT_MAX_CORES)) {
+        memset(entries, 0, sizeof(entries));
+    }
+    for (size_t node = 0; node < SNAPSHOT_MAX_CORES; node++) {
+        if (!entries[node]) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/devices/system/node/node%zu/cpulist", root, node);
+        if (!file_read(path, content, sizeof(content)) || !topology_cpulist_parse(content, listed, SNAPSHOT_MAX_CORES)) {
+            continue;
+        }
+        for (size_t cpu = 0; cpu < SNAPSHOT_MAX_CORES; cpu++) {
+            if (listed[cpu]) {
+                node_of[cpu] = (uint32_t) node;
+            }
+        }
+    }
+
+    for (size_t cpu = 0; cpu < SNAPSHOT_MAX_CORES; cpu++) {
+        if (scan->cpus[cpu].online && !id_insert(scan->node_ids, &scan->number_of_nodes, SNAPSHOT_MAX_NODES, node_of[cpu])) {
+            return false;
+        }
+    }
+    for (size_t cpu = 0; cpu < SNAPSHOT_MAX_CORES; cpu++) {
+        TopologyCpu* current = &scan->cpus[cpu];
+        if (current->online) {
+            current->package = (uint32_t) id_index(scan->package_ids, scan->number_of_packages, package_of[cpu]);
+            current->node = (uint32_t) id_index(scan->node_ids, scan->number_of_nodes, node_of[cpu]);
+        }
+    }
+    return true;
+}
+
+static bool directory_numbers(const char* const path, const char* const prefix, bool numbers[const], const size_t size) {
+    const int directory = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory < 0) {
+        errno = 0;
+        return false;
+    }
+    memset(numbers, 0, sizeof(*numbers) * size);
+    _Alignas(TopologyDirent) char entries[TOPOLOGY_DIRECTORY_SIZE];
+    long length;
+    while ((length = syscall(SYS_getdents64, directory, entries, sizeof(entries))) > 0) {
+        for (long position = 0; position < length;) {
+            const TopologyDirent* entry = (const TopologyDirent*) (entries + position);
+            size_t number = 0;
+            if (entry_number(entry->name, prefix, &number) && number < size) {
+                numbers[number] = true;
+            }
+            position += entry->length;
+        }
+    }
+    close(directory);
+    errno = 0;
+    return true;
+}
+
+static bool file_read(const char* const path, char* const dest, const size_t dest_size) {
+    const int file = open(path, O_RDONLY | O_CLOEXEC);
+    if (file < 0) {
+        errno = 0;
+        return false;
+    }
+    const ssize_t length = read(file, dest, dest_size - 1);
+    close(file);
+    if (length <= 0) {
+        errno = 0;
+        return false;
+    }
+    dest[length] = '\0';
+    return true;
+}
+
+static bool file_read_u32(const char* const path, uint32_t* const value) {
+    char content[32];
+    char* end = NULL;
+    if (!file_read(path, content, sizeof(content))) {
+        return false;
+    }
+    const unsigned long result = strtoul(content, &end, 10);
+    if (end == content || (*end != '\n' && *end != '\0') || result > UINT32_MAX) {
+        return false;
+    }
+    *value = (uint32_t) result;
+    return true;
+}
+
+bool topology_cpulist_parse(const char list[const static 1], bool set[const static 1], const size_t set_size) {
+    memset(set, 0, sizeof(*set) * set_size);
+    const char* cursor = list;
+    while (*cursor != '\0' && *cursor != '\n') {
+        char* end = NULL;
+        const unsigned long first = strtoul(cursor, &end, 10);
+        unsigned long last = first;
+        if (end == cursor) {
+            return false;
+        }
+        if (*end == '-') {
+            cursor = end + 1;
+            last = strtoul(cursor, &end, 10);
+            if (end == cursor || last < first) {
+                return false;
+            }
+        }
+        for (unsigned long cpu = first; cpu <= last && cpu < set_size; cpu++) {
+            set[cpu] = true;
+        }
+        cursor = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+static bool id_insert(uint32_t* const ids, size_t* const count, const size_t capacity, const uint32_t id) {
+    size_t position = 0;
+    while (position < *count && ids[position] < id) {
+        position++;
+    }
+    if (position < *count && ids[position] == id) {
+        return true;
+    }
+    if (*count == capacity) {
+        return false;
+    }
+    memmove(&ids[position + 1], &ids[position], sizeof(*ids) * (*count - position));
+    ids[position] = id;
+    (*count)++;
+    return true;
+}
+
+static size_t id_index(const uint32_t* const ids, const size_t count, const uint32_t id) {
+    size_t position = 0;
+    while (position < count && ids[position] != id) {
+        position++;
+    }
+    return position;
+}
+
+static bool entry_number(const char* const name, const char* const prefix, size_t* const number) {
+    const size_t prefix_length = strlen(prefix);
+    char* end = NULL;
+    if (strncmp(name, prefix, prefix_length) != 0 || name[prefix_length] < '0' || name[prefix_length] > '9') {
+        return false;
+    }
+    *number = (size_t) strtoul(name + prefix_length, &end, 10);
+    return *end == '\0';
+}
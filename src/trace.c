@@ -0,0 +1,275 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "trace.h"
+
+enum {
+    TRACE_NAME_SIZE = 16,
+};
+
+typedef struct TraceRecord {
+    _Atomic uint64_t timestamp_ns;
+    /*ETraceEvent shifted left by one, the lowest bit is set for the beginning*/
+    _Atomic uint32_t event;
+} TraceRecord;
+
+struct TraceRing {
+    /*Number of records ever written, stored by the owner after the record*/
+    _Atomic uint64_t head;
+    uint64_t mask;
+    TraceRecord* records;
+    /*Set after name, the dump skips rings nobody attached to*/
+    atomic_bool attached;
+    char name[TRACE_NAME_SIZE];
+};
+
+struct Trace {
+    uint64_t start_ns;
+    size_t ring_size;
+    _Atomic size_t number_of_rings;
+    TraceRing rings[TRACE_MAX_THREADS];
+    /*Ring being dumped, follows the rings in records*/
+    TraceRecord* copy;
+    size_t output_length;
+    /*Memory belongs to an arena and is not freed by trace_delete*/
+    bool arena_owned;
+    char output[TRACE_OUTPUT_SIZE];
+    TraceRecord records[]; /*FAM*/
+};
+
+_Thread_local TraceRing* trace_thread_ring = NULL;
+
+/**
+ * @brief CLOCK_MONOTONIC in nanoseconds
+ */
+static uint64_t now_ns(void);
+
+/**
+ * @brief Copy records of ring that were not overwritten during the copy
+ * @return number of copied records, they start at index first_index of the ring
+ */
+static size_t ring_copy(const TraceRing* restrict ring, TraceRecord* restrict copy, uint64_t* restrict first_index);
+
+/**
+ * @brief Format into the output buffer, the buffer is written to output first if the text does not fit
+ * @return false on write error or if the text is longer than the whole buffer
+ */
+static bool output_append(Trace* trace, int output, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Write the output buffer to output and empty it
+ */
+static bool output_flush(Trace* trace, int output);
+
+/**
+ * @brief Lay out rings in zeroed memory of trace_footprint bytes
+ */
+static Trace* trace_initialize(void* memory, size_t ring_size);
+
+Trace* trace_new(const size_t ring_size) {
+    if (ring_size == 0 || (ring_size & (ring_size - 1)) != 0) {
+        return NULL;
+    }
+    void* memory = calloc(1, trace_footprint(ring_size));
+    if (memory == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    return trace_initialize(memory, ring_size);
+}
+
+Trace* trace_new_in(Arena* const arena, const size_t ring_size) {
+    if (ring_size == 0 || (ring_size & (ring_size - 1)) != 0) {
+        return NULL;
+    }
+    void* memory = arena_alloc(arena, trace_footprint(ring_size));
+    if (memory == NULL) {
+        return NULL;
+    }
+    Trace* result = trace_initialize(memory, ring_size);
+    result->arena_owned = true;
+    return result;
+}
+
+size_t trace_footprint(const size_t ring_size) {
+    return sizeof(Trace) + sizeof(TraceRecord) * ring_size * (TRACE_MAX_THREADS + 1);
+}
+
+void trace_delete(Trace* const trace) {
+    if (trace != NULL && trace->arena_owned) {
+        return;
+    }
+    free(trace);
+}
+
+bool trace_thread_attach(Trace* const restrict trace, const char name[const restrict static 1]) {
+    trace_thread_ring = NULL;
+    if (trace == NULL) {
+        return false;
+    }
+    const size_t index = atomic_fetch_add(&trace->number_of_rings, 1);
+    if (index >= TRACE_MAX_THREADS) {
+        return false;
+    }
+    TraceRing* ring = &trace->rings[index];
+    snprintf(ring->name, sizeof(ring->name), "%s", name);
+    atomic_store_explicit(&ring->attached, true, memory_order_release);
+    trace_thread_ring = ring;
+    return true;
+}
+
+void trace_record(TraceRing* const ring, const ETraceEvent event, const bool begin) {
+    const uint64_t timestamp_ns = now_ns();
+    const uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    TraceRecord* record = &ring->records[head & ring->mask];
+    /*A dump that sees the new content of the record also sees the head that marks it as being overwritten*/
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&record->timestamp_ns, timestamp_ns, memory_order_relaxed);
+    atomic_store_explicit(&record->event, ((uint32_t) event << 1) | (begin ? 1u : 0u), memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+bool trace_dump(Trace* const trace, const int output) {
+    TraceRecord* copy = trace->copy;
+    const long pid = (long) getpid();
+    bool first = true;
+    trace->output_length = 0;
+    bool result = output_append(trace, output, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    for (size_t i = 0; i < TRACE_MAX_THREADS && result; i++) {
+        const TraceRing* ring = &trace->rings[i];
+        if (!atomic_load_explicit(&ring->attached, memory_order_acquire)) {
+            continue;
+        }
+        const size_t tid = i + 1;
+        result = output_append(trace, output, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+                               first ? "" : ",", pid, tid, ring->name);
+        first = false;
+
+        uint64_t first_index;
+        const size_t count = ring_copy(ring, copy, &first_index);
+        size_t depth = 0;
+        for (size_t j = 0; j < count && result; j++) {
+            const TraceRecord* record = &copy[(first_index + j) & ring->mask];
+            const uint32_t event = atomic_load_explicit(&record->event, memory_order_relaxed);
+            const bool begin = (event & 1u) != 0;
+            if (!begin && depth == 0) {
+                continue;
+            }
+            depth = begin ? depth + 1 : depth - 1;
+            const uint64_t timestamp_ns = atomic_load_explicit(&record->timestamp_ns, memory_order_relaxed);
+            const uint64_t relative_ns = timestamp_ns > trace->start_ns ? timestamp_ns - trace->start_ns : 0;
+            result = output_append(trace, output, ",\n{\"name\":\"%s\",\"cat\":\"pipeline\",\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03" PRIu64
+                                   ",\"pid\":%ld,\"tid\":%zu}", trace_event_to_str((ETraceEvent) (event >> 1)), begin ? 'B' : 'E',
+                                   relative_ns / 1000, relative_ns % 1000, pid, tid);
+        }
+    }
+    result = result && output_append(trace, output, "\n]}\n");
+    return output_flush(trace, output) && result;
+}
+
+bool trace_dump_file(Trace* const trace, const int file) {
+    if (lseek(file, 0, SEEK_SET) == -1 || ftruncate(file, 0) != 0) {
+        errno = 0;
+        return false;
+    }
+    return trace_dump(trace, file);
+}
+
+const char* trace_event_to_str(const ETraceEvent event) {
+    static const char* const names[TRACE_EVENT_COUNT] = {
+        "read", "parse", "compute", "enqueue_wait", "dequeue_wait", "print", "log",
+    };
+    return (size_t) event < TRACE_EVENT_COUNT ? names[event] : "unknown";
+}
+
+static uint64_t now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * UINT64_C(1000000000) + (uint64_t) now.tv_nsec;
+}
+
+static size_t ring_copy(const TraceRing* const restrict ring, TraceRecord* const restrict copy, uint64_t* const restrict first_index) {
+    const uint64_t size = ring->mask + 1;
+    const uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    const uint64_t start = head > size ? head - size : 0;
+    for (uint64_t i = start; i < head; i++) {
+        const TraceRecord* record = &ring->records[i & ring->mask];
+        TraceRecord* destination = &copy[i & ring->mask];
+        atomic_store_explicit(&destination->timestamp_ns,
+                              atomic_load_explicit(&record->timestamp_ns, memory_order_relaxed), memory_order_relaxed);
+        atomic_store_explicit(&destination->event,
+                              atomic_load_explicit(&record->event, memory_order_relaxed), memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_acquire);
+    /*Record i is being overwritten once the head reaches i + size*/
+    const uint64_t new_head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    const uint64_t valid_start = new_head >= size ? new_head - size + 1 : 0;
+    *first_index = start > valid_start ? start : valid_start;
+    return *first_index < head ? (size_t) (head - *first_index) : 0;
+}
+
+static bool output_append(Trace* const trace, const int output, const char* const format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(trace->output + trace->output_length, sizeof(trace->output) - trace->output_length, format, arguments);
+    va_end(arguments);
+    if (length >= 0 && (size_t) length >= sizeof(trace->output) - trace->output_length) {
+        /*Truncated text is formatted again into the emptied buffer*/
+        if (!output_flush(trace, output)) {
+            return false;
+        }
+        va_start(arguments, format);
+        length = vsnprintf(trace->output, sizeof(trace->output), format, arguments);
+        va_end(arguments);
+        if (length >= 0 && (size_t) length >= sizeof(trace->output)) {
+            return false;
+        }
+    }
+    if (length < 0) {
+        return false;
+    }
+    trace->output_length += (size_t) length;
+    return true;
+}
+
+static bool output_flush(Trace* const trace, const int output) {
+    size_t written = 0;
+    while (written < trace->output_length) {
+        const ssize_t result = write(output, trace->output + written, trace->output_length - written);
+        if (result < 0 && errno == EINTR) {
+            errno = 0;
+            continue;
+        }
+        if (result <= 0) {
+            errno = 0;
+            trace->output_length = 0;
+            return false;
+        }
+        written += (size_t) result;
+    }
+    trace->output_length = 0;
+    return true;
+}
+
+static Trace* trace_initialize(void* const memory, const size_t ring_size) {
+    Trace* result = memory;
+    result->start_ns = now_ns();
+    result->ring_size = ring_size;
+    result->copy = &result->records[TRACE_MAX_THREADS * ring_size];
+    atomic_init(&result->number_of_rings, 0);
+    for (size_t i = 0; i < TRACE_MAX_THREADS; i++) {
+        TraceRing* ring = &result->rings[i];
+        atomic_init(&ring->head, 0);
+        atomic_init(&ring->attached, false);
+        ring->mask = ring_size - 1;
+        ring->records = &result->records[i * ring_size];
+    }
+    return result;
+}
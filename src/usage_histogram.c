@@ -0,0 +1,66 @@
+#include <math.h>
+#include <stddef.h>
+#include "usage_histogram.h"
+
+static inline uint32_t bucket_index(double value);
+
+void usage_histogram_clear(UsageHistogram* const histogram) {
+    histogram->count = 0;
+    for (size_t i = 0; i < USAGE_HISTOGRAM_BUCKETS; i++) {
+        histogram->buckets[i] = 0;
+    }
+}
+
+void usage_histogram_add(UsageHistogram* const histogram, const double value) {
+    if (isnan(value)) {
+        return;
+    }
+    histogram->buckets[bucket_index(value)]++;
+    histogram->count++;
+}
+
+void usage_histogram_remove(UsageHistogram* const histogram, const double value) {
+    if (isnan(value)) {
+        return;
+    }
+    const uint32_t index = bucket_index(value);
+    if (histogram->buckets[index] > 0) {
+        histogram->buckets[index]--;
+        histogram->count--;
+    }
+}
+
+double usage_histogram_quantile(const UsageHistogram* const histogram, const double quantile) {
+    if (histogram->count == 0) {
+        return NAN;
+    }
+    const double clamped = quantile < 0.0 ? 0.0 : (quantile > 1.0 ? 1.0 : quantile);
+    /*1-based rank of requested sample*/
+    double rank = ceil(clamped * (double) histogram->count);
+    rank = rank < 1.0 ? 1.0 : rank;
+
+    uint32_t cumulative = 0;
+    for (uint32_t i = 0; i < USAGE_HISTOGRAM_BUCKETS; i++) {
+        const uint32_t in_bucket = histogram->buckets[i];
+        if ((double) (cumulative + in_bucket) >= rank) {
+            /*The last bucket holds values clamped to 100*/
+            if (i == USAGE_HISTOGRAM_BUCKETS - 1) {
+                return (double) i;
+            }
+            /*Samples are assumed to be spread evenly inside the bucket*/
+            return (double) i + (rank - (double) cumulative - 0.5) / (double) in_bucket;
+        }
+        cumulative += in_bucket;
+    }
+    return (double) (USAGE_HISTOGRAM_BUCKETS - 1);
+}
+
+static inline uint32_t bucket_index(const double value) {
+    if (value <= 0.0) {
+        return 0;
+    }
+    if (value >= (double) (USAGE_HISTOGRAM_BUCKETS - 1)) {
+        return USAGE_HISTOGRAM_BUCKETS - 1;
+    }
+    return (uint32_t) value;
+}
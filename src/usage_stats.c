@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "usage_stats.h"
+#include "usage_histogram.h"
+
+enum {
+    USAGE_STATS_EWMA_COUNT = USAGE_STATISTIC_P50,
+};
+
+struct UsageStats {
+    size_t number_of_cores;
+    size_t window_size;
+    /*Position in window where the next snapshot is stored*/
+    size_t window_index;
+    size_t window_count;
+    bool started;
+    uint64_t last_timestamp_ns;
+    /*Memory belongs to an arena and is not freed by usage_stats_delete*/
+    bool arena_owned;
+    /*number_of_cores * window_size usages, core-major, all arrays follow the histograms in the same block*/
+    double* window;
+    double* values;
+    /*Minimum and maximum usage in the window of every core, NaN while the window holds no usage*/
+    double* extremes;
+    UsageHistogram histograms[]; /*FAM*/
+};
+
+static const double half_life_s[USAGE_STATS_EWMA_COUNT] = {10.0, 60.0, 300.0};
+
+static const double quantiles[USAGE_STATISTIC_COUNT - USAGE_STATS_EWMA_COUNT] = {0.50, 0.95, 0.99};
+
+/**
+ * @brief Size of the structure with its histograms, rounded up so that the doubles behind it are aligned
+ */
+static inline size_t head_size(size_t number_of_cores);
+
+/**
+ * @brief Lay out and initialize statistics in memory of usage_stats_footprint bytes
+ */
+static inline UsageStats* stats_initialize(void* memory, size_t number_of_cores, size_t window_size);
+
+/**
+ * @brief Find minimum and maximum usage in the full window of the core
+ */
+static inline void window_extremes(const UsageStats* stats, size_t core, double extremes[static 2]);
+
+UsageStats* usage_stats_new(const size_t number_of_cores, const size_t window_size) {
+    if (number_of_cores == 0 || window_size == 0) {
+        return NULL;
+    }
+
+    void* memory = malloc(usage_stats_footprint(number_of_cores, window_size));
+    if (memory == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    return stats_initialize(memory, number_of_cores, window_size);
+}
+
+UsageStats* usage_stats_new_in(Arena* const arena, const size_t number_of_cores, const size_t window_size) {
+    if (number_of_cores == 0 || window_size == 0) {
+        return NULL;
+    }
+
+    void* memory = arena_alloc(arena, usage_stats_footprint(number_of_cores, window_size));
+    if (memory == NULL) {
+        return NULL;
+    }
+    UsageStats* result = stats_initialize(memory, number_of_cores, window_size);
+    result->arena_owned = true;
+    return result;
+}
+
+size_t usage_stats_footprint(const size_t number_of_cores, const size_t window_size) {
+    return head_size(number_of_cores) + sizeof(double) * number_of_cores * (window_size + USAGE_STATISTIC_COUNT + 2);
+}
+
+void usage_stats_delete(UsageStats* const stats) {
+    if (stats != NULL && stats->arena_owned) {
+        return;
+    }
+    free(stats);
+}
+
+void usage_stats_update(UsageStats* const restrict stats, const Snapshot* const restrict snapshot) {
+    const uint64_t timestamp_ns = (uint64_t) snapshot->timestamp.tv_sec * 1000000000u + (uint64_t) snapshot->timestamp.tv_nsec;
+    const size_t number_of_cores = snapshot->number_of_cores < stats->number_of_cores ? snapshot->number_of_cores : stats->number_of_cores;
+    double alpha[USAGE_STATS_EWMA_COUNT];
+
+    /*Weight of the new sample depends on time elapsed since the previous one,
+    a clock stepping backwards is treated as no time elapsed*/
+    const double elapsed_s = stats->started && timestamp_ns > stats->last_timestamp_ns
+                             ? (double) (timestamp_ns - stats->last_timestamp_ns) / 1e9 : 0.0;
+    for (size_t i = 0; i < USAGE_STATS_EWMA_COUNT; i++) {
+        alpha[i] = 1.0 - exp2(-elapsed_s / half_life_s[i]);
+    }
+    stats->started = true;
+    stats->last_timestamp_ns = timestamp_ns;
+
+    for (size_t core = 0; core < stats->number_of_cores; core++) {
+        const double usage = core < number_of_cores ? snapshot->core_usage[core] : NAN;
+        double* values = &stats->values[core * USAGE_STATISTIC_COUNT];
+        double* slot = &stats->window[core * stats->window_size + stats->window_index];
+        UsageHistogram* histogram = &stats->histograms[core];
+        double* extremes = &stats->extremes[2 * core];
+
+        double removed = NAN;
+        if (stats->window_count == stats->window_size) {
+            removed = *slot;
+            usage_histogram_remove(histogram, removed);
+        }
+        *slot = usage;
+        usage_histogram_add(histogram, usage);
+        /*The window is rescanned only when an extreme leaves it*/
+        if (removed == extremes[0] || removed == extremes[1]) {
+            window_extremes(stats, core, extremes);
+        } else if (!isnan(usage)) {
+            extremes[0] = isnan(extremes[0]) || usage < extremes[0] ? usage : extremes[0];
+            extremes[1] = isnan(extremes[1]) || usage > extremes[1] ? usage : extremes[1];
+        }
+
+        if (!isnan(usage)) {
+            for (size_t i = 0; i < USAGE_STATS_EWMA_COUNT; i++) {
+                /*The first sample of the core initializes its averages*/
+                values[i] = isnan(values[i]) ? usage : values[i] + alpha[i] * (usage - values[i]);
+            }
+        }
+        /*Interpolation inside a bucket assumes samples spread over it, without clamping to the extremes
+        a core steady at 37 % would report p99 near 38 %*/
+        for (size_t i = USAGE_STATS_EWMA_COUNT; i < USAGE_STATISTIC_COUNT; i++) {
+            const double quantile = usage_histogram_quantile(histogram, quantiles[i - USAGE_STATS_EWMA_COUNT]);
+            values[i] = quantile < extremes[0] ? extremes[0] : (quantile > extremes[1] ? extremes[1] : quantile);
+        }
+    }
+
+    stats->window_index = (stats->window_index + 1) % stats->window_size;
+    if (stats->window_count < stats->window_size) {
+        stats->window_count++;
+    }
+}
+
+double usage_stats_get(const UsageStats* const stats, const size_t core, const EUsageStatistic statistic) {
+    if (core >= stats->number_of_cores || (size_t) statistic >= USAGE_STATISTIC_COUNT) {
+        return NAN;
+    }
+    return stats->values[core * USAGE_STATISTIC_COUNT + statistic];
+}
+
+const double* usage_stats_values(const UsageStats* const stats) {
+    return stats->values;
+}
+
+size_t usage_stats_number_of_cores(const UsageStats* const stats) {
+    return stats->number_of_cores;
+}
+
+bool usage_stats_mask_parse(const char list[const restrict static 1], uint32_t* const restrict mask) {
+    uint32_t result = 0;
+    const char* begin = list;
+
+    while (true) {
+        const char* end = strchr(begin, ',');
+        const size_t length = end == NULL ? strlen(begin) : (size_t) (end - begin);
+        bool known = false;
+
+        for (size_t i = 0; i < USAGE_STATISTIC_COUNT; i++) {
+            const char* name = usage_stats_statistic_to_str((EUsageStatistic) i);
+            if (strlen(name) == length && strncmp(name, begin, length) == 0) {
+                result |= UINT32_C(1) << i;
+                known = true;
+            }
+        }
+        if (!known) {
+            return false;
+        }
+        if (end == NULL) {
+            break;
+        }
+        begin = end + 1;
+    }
+    *mask = result;
+    return true;
+}
+
+const char* usage_stats_statistic_to_str(const EUsageStatistic statistic) {
+    static const char* statistic_str[USAGE_STATISTIC_COUNT] = {"ewma10s", "ewma1m", "ewma5m", "p50", "p95", "p99"};
+    return statistic_str[statistic];
+}
+
+static inline size_t head_size(const size_t number_of_cores) {
+    const size_t size = sizeof(UsageStats) + sizeof(UsageHistogram) * number_of_cores;
+    return (size + _Alignof(double) - 1) / _Alignof(double) * _Alignof(double);
+}
+
+static inline UsageStats* stats_initialize(void* const memory, const size_t number_of_cores, const size_t window_size) {
+    UsageStats* result = memory;
+    result->window = (double*) ((char*) memory + head_size(number_of_cores));
+    result->values = result->window + number_of_cores * window_size;
+    result->extremes = result->values + number_of_cores * USAGE_STATISTIC_COUNT;
+    result->arena_owned = false;
+    result->number_of_cores = number_of_cores;
+    result->window_size = window_size;
+    result->window_index = 0;
+    result->window_count = 0;
+    result->started = false;
+    result->last_timestamp_ns = 0;
+    for (size_t i = 0; i < number_of_cores * USAGE_STATISTIC_COUNT; i++) {
+        result->values[i] = NAN;
+    }
+    for (size_t i = 0; i < 2 * number_of_cores; i++) {
+        result->extremes[i] = NAN;
+    }
+    for (size_t core = 0; core < number_of_cores; core++) {
+        usage_histogram_clear(&result->histograms[core]);
+    }
+    return result;
+}
+
+static inline void window_extremes(const UsageStats* const stats, const size_t core, double extremes[static 2]) {
+    const double* window = &stats->window[core * stats->window_size];
+    extremes[0] = NAN;
+    extremes[1] = NAN;
+    for (size_t i = 0; i < stats->window_size; i++) {
+        if (!isnan(window[i])) {
+            extremes[0] = isnan(extremes[0]) || window[i] < extremes[0] ? window[i] : extremes[0];
+            extremes[1] = isnan(extremes[1]) || window[i] > extremes[1] ? window[i] : extremes[1];
+        }
+    }
+}
@@ -7,6 +7,8 @@ typedef struct Watchdog {
 
     size_t max_number_of_units;
     size_t number_of_units;
+    /*Memory belongs to an arena and is not freed by watchdog_delete*/
+    bool arena_owned;
     WatchdogControlUnit* control_units[]; /*FAM*/
 
 } Watchdog;
@@ -35,7 +37,30 @@ Watchdog* watchdog_new(const size_t size) {
     return result;
 }
 
+Watchdog* watchdog_new_in(Arena* const arena, const size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+
+    Watchdog* result = arena_alloc(arena, watchdog_footprint(size));
+    if (result == NULL) {
+        return NULL;
+    }
+
+    result->max_number_of_units = size;
+    result->arena_owned = true;
+
+    return result;
+}
+
+size_t watchdog_footprint(const size_t size) {
+    return sizeof(Watchdog) + sizeof(WatchdogControlUnit*) * size;
+}
+
 void watchdog_delete(Watchdog* const restrict watchdog) {
+    if (watchdog != NULL && watchdog->arena_owned) {
+        return;
+    }
     free(watchdog);
 }
 
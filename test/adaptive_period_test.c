@@ -0,0 +1,152 @@
+#include <assert.h>
+#include <math.h>
+#include "adaptive_period.h"
+
+static void new_delete_test(void);
+static void volatility_test(void);
+static void budget_test(void);
+static void quantization_test(void);
+static void hysteresis_test(void);
+
+enum {
+    MS = 1000000,
+    HZ = 100,
+};
+
+static Snapshot snapshot;
+
+/**
+ * @brief Set usage of both cores and interval of the snapshot
+ */
+static void snapshot_set(double usage0, double usage1, uint64_t interval_ns) {
+    snapshot.number_of_cores = 2;
+    snapshot.core_usage[0] = usage0;
+    snapshot.core_usage[1] = usage1;
+    snapshot.interval_ns = interval_ns;
+}
+
+static void new_delete_test() {
+    assert(adaptive_period_new(0, 1000 * MS, 10.0, 0.01, HZ) == NULL);
+    assert(adaptive_period_new(100 * MS, 10 * MS, 10.0, 0.01, HZ) == NULL);
+    assert(adaptive_period_new(10 * MS, 1000 * MS, 10.0, 0.0, HZ) == NULL);
+    assert(adaptive_period_new(10 * MS, 1000 * MS, 10.0, 0.01, 0) == NULL);
+    AdaptivePeriod* adaptive_period = adaptive_period_new(10 * MS, 1000 * MS, 10.0, 0.01, HZ);
+    assert(adaptive_period != NULL);
+    assert(adaptive_period_current_ns(adaptive_period) == 1000 * MS);
+    adaptive_period_delete(adaptive_period);
+    adaptive_period_delete(NULL);
+    assert(adaptive_period_process_cpu_ns() > 0);
+}
+
+static void volatility_test() {
+    AdaptivePeriod* adaptive_period = adaptive_period_new(100 * MS, 800 * MS, 10.0, 0.5, HZ);
+    assert(adaptive_period != NULL);
+    uint64_t cpu_ns = 0;
+
+    /*Nothing to compare the first snapshot with*/
+    snapshot_set(10.0, 10.0, 0);
+    assert(adaptive_period_update(adaptive_period, &snapshot, cpu_ns) == 800 * MS);
+    /*Burst on a single core halves the period down to the floor*/
+    snapshot_set(10.0, 50.0, 800 * MS);
+    assert(adaptive_period_update(adaptive_period, &snapshot, cpu_ns) == 400 * MS);
+    snapshot_set(10.0, 10.0, 400 * MS);
+    assert(adaptive_period_update(adaptive_period, &snapshot, cpu_ns) == 200 * MS);
+    snapshot_set(60.0, 10.0, 200 * MS);
+    assert(adaptive_period_update(adaptive_period, &snapshot, cpu_ns) == 100 * MS);
+    snapshot_set(10.0, 10.0, 100 * MS);
+    assert(adaptive_period_update(adaptive_period, &snapshot, cpu_ns) == 100 * MS);
+
+    /*NaN usage and changes within quantization are stable, the period doubles after enough of them*/
+    for (size_t i = 1; i < ADAPTIVE_PERIOD_STABLE_SNAPSHOTS; i++) {
+        snapshot_set(i % 2 == 0 ? 10.0 : NAN, 20.0 - (i % 2) * 10.0, 100 * MS);
+        assert(adaptive_period_update(adaptive_period, &snapshot, cpu_ns) == 100 * MS);
+    }
+    assert(adaptive_period_update(adaptive_period, &snapshot, cpu_ns) == 200 * MS);
+    for (size_t i = 0; i < 4 * ADAPTIVE_PERIOD_STABLE_SNAPSHOTS; i++) {
+        adaptive_period_update(adaptive_period, &snapshot, cpu_ns);
+    }
+    assert(adaptive_period_current_ns(adaptive_period) == 800 * MS);
+    adaptive_period_delete(adaptive_period);
+}
+
+static void budget_test() {
+    AdaptivePeriod* adaptive_period = adaptive_period_new(10 * MS, 160 * MS, 10.0, 0.01, HZ);
+    assert(adaptive_period != NULL);
+    uint64_t cpu_ns = 1000 * MS;
+
+    snapshot_set(0.0, 0.0, 0);
+    adaptive_period_update(adaptive_period, &snapshot, cpu_ns);
+    /*0.4 % of a core, the period may be halved*/
+    snapshot_set(100.0, 0.0, 160 * MS);
+    cpu_ns += 640000;
+    assert(adaptive_period_update(adaptive_period, &snapshot, cpu_ns) == 80 * MS);
+    /*0.8 % of a core, halving would exceed the budget*/
+    snapshot_set(0.0, 0.0, 80 * MS);
+    cpu_ns += 640000;
+    assert(adaptive_period_update(adaptive_period, &snapshot, cpu_ns) == 80 * MS);
+    /*2 % of a core, the period is doubled although usage keeps changing*/
+    snapshot_set(100.0, 0.0, 80 * MS);
+    cpu_ns += 1600000;
+    assert(adaptive_period_update(adaptive_period, &snapshot, cpu_ns) == 160 * MS);
+    adaptive_period_delete(adaptive_period);
+}
+
+static void quantization_test() {
+    enum { cores = 384 };
+    AdaptivePeriod* adaptive_period = adaptive_period_new(100 * MS, 800 * MS, 10.0, 0.5, HZ);
+    assert(adaptive_period != NULL);
+    snapshot.number_of_cores = cores;
+    snapshot.interval_ns = 100 * MS;
+
+    /*At 10 ticks per interval steady cores jump by up to 2 ticks, i.e. 20 points*/
+    for (size_t i = 0; i < 10; i++) {
+        for (size_t core = 0; core < cores; core++) {
+            snapshot.core_usage[core] = (i + core) % 2 == 0 ? 30.0 : 10.0 + (double) (core % 3) * 10.0;
+        }
+        assert(adaptive_period_update(adaptive_period, &snapshot, 0) == 800 * MS);
+    }
+    /*Burst of a few cores is an outlier*/
+    for (size_t core = 0; core < cores / 50; core++) {
+        snapshot.core_usage[core] = 100.0;
+    }
+    assert(adaptive_period_update(adaptive_period, &snapshot, 0) == 800 * MS);
+    /*Burst of a tenth of cores is not*/
+    for (size_t core = 0; core < cores / 10; core++) {
+        snapshot.core_usage[core] = core < cores / 50 ? 0.0 : 100.0;
+    }
+    assert(adaptive_period_update(adaptive_period, &snapshot, 0) == 400 * MS);
+    adaptive_period_delete(adaptive_period);
+}
+
+static void hysteresis_test() {
+    AdaptivePeriod* adaptive_period = adaptive_period_new(100 * MS, 800 * MS, 10.0, 0.5, HZ);
+    assert(adaptive_period != NULL);
+    double usage = 10.0;
+
+    /*Quantization over 400 ms is 5 points*/
+    snapshot_set(usage, usage, 400 * MS);
+    adaptive_period_update(adaptive_period, &snapshot, 0);
+    usage += 20.0;
+    snapshot_set(usage, usage, 400 * MS);
+    assert(adaptive_period_update(adaptive_period, &snapshot, 0) == 400 * MS);
+    /*Changes between half of the threshold and the threshold keep the period however long they last*/
+    for (size_t i = 0; i < 2 * ADAPTIVE_PERIOD_STABLE_SNAPSHOTS; i++) {
+        usage += i % 2 == 0 ? -13.0 : 13.0;
+        snapshot_set(usage, usage, 400 * MS);
+        assert(adaptive_period_update(adaptive_period, &snapshot, 0) == 400 * MS);
+    }
+    for (size_t i = 1; i < ADAPTIVE_PERIOD_STABLE_SNAPSHOTS; i++) {
+        assert(adaptive_period_update(adaptive_period, &snapshot, 0) == 400 * MS);
+    }
+    assert(adaptive_period_update(adaptive_period, &snapshot, 0) == 800 * MS);
+    adaptive_period_delete(adaptive_period);
+}
+
+int main() {
+    new_delete_test();
+    volatility_test();
+    budget_test();
+    quantization_test();
+    hysteresis_test();
+    return 0;
+}
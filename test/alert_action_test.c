@@ -0,0 +1,88 @@
+#include <assert.h>
+#include <stdio.h>
+#include <signal.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "alert_action.h"
+
+static void new_test(void);
+static void unix_test(void);
+static void fifo_test(void);
+
+static char path[64];
+
+static void new_test() {
+    AlertAction* action = alert_action_new("log");
+    assert(action != NULL);
+    assert(alert_action_type(action) == ALERT_ACTION_LOG);
+    assert(!alert_action_send(action, "message", 7));
+    alert_action_delete(action);
+    alert_action_delete(NULL);
+
+    assert(alert_action_new("") == NULL);
+    assert(alert_action_new("fifo:") == NULL);
+    assert(alert_action_new("mail:root") == NULL);
+}
+
+static void unix_test() {
+    char spec[80];
+    char received[64] = {0};
+    snprintf(spec, sizeof(spec), "unix:%s", path);
+
+    AlertAction* action = alert_action_new(spec);
+    assert(action != NULL && alert_action_type(action) == ALERT_ACTION_UNIX);
+    /*Nobody listens yet*/
+    assert(!alert_action_send(action, "lost\n", 5));
+
+    int receiver = socket(AF_UNIX, SOCK_DGRAM, 0);
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    strcpy(address.sun_path, path);
+    assert(bind(receiver, (struct sockaddr*) &address, sizeof(address)) == 0);
+
+    assert(alert_action_send(action, "alert\n", 6));
+    assert(recv(receiver, received, sizeof(received), 0) == 6);
+    assert(strcmp(received, "alert\n") == 0);
+
+    close(receiver);
+    unlink(path);
+    alert_action_delete(action);
+}
+
+static void fifo_test() {
+    char spec[80];
+    char received[64] = {0};
+    snprintf(spec, sizeof(spec), "fifo:%s", path);
+    assert(mkfifo(path, 0600) == 0);
+
+    AlertAction* action = alert_action_new(spec);
+    assert(action != NULL && alert_action_type(action) == ALERT_ACTION_FIFO);
+    /*Without reader the message is dropped instead of blocking*/
+    assert(!alert_action_send(action, "lost\n", 5));
+
+    int reader = open(path, O_RDONLY | O_NONBLOCK);
+    assert(reader != -1);
+    assert(alert_action_send(action, "alert\n", 6));
+    assert(read(reader, received, sizeof(received)) == 6);
+    assert(strcmp(received, "alert\n") == 0);
+
+    /*Reader has gone, message is dropped without SIGPIPE killing the caller*/
+    close(reader);
+    assert(!alert_action_send(action, "lost\n", 5));
+
+    unlink(path);
+    alert_action_delete(action);
+}
+
+int main() {
+    snprintf(path, sizeof(path), "/tmp/alert_action_test_%ld", (long) getpid());
+    signal(SIGPIPE, SIG_IGN);
+
+    new_test();
+    unix_test();
+    fifo_test();
+    return 0;
+}
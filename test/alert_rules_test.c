@@ -0,0 +1,182 @@
+#include <assert.h>
+#include <string.h>
+#include <tgmath.h>
+#include "alert_rules.h"
+
+static void parse_test(void);
+static void parse_invalid_test(void);
+static void hysteresis_test(void);
+static void below_machine_test(void);
+static void events_size_test(void);
+static void format_test(void);
+static void socket_test(void);
+
+static Snapshot snapshot;
+
+static void parse_test() {
+    AlertRule rule;
+
+    assert(alert_rules_parse_line("saturated core above 95 for 5 clear 80 action unix:/run/alerts.sock\n", &rule));
+    assert(strcmp(rule.name, "saturated") == 0);
+    assert(rule.scope == ALERT_SCOPE_CORE);
+    assert(rule.comparison == ALERT_COMPARISON_ABOVE);
+    assert(rule.threshold == 95.0);
+    assert(rule.clear_threshold == 80.0);
+    assert(rule.duration == 5);
+    assert(strcmp(rule.action, "unix:/run/alerts.sock") == 0);
+
+    assert(alert_rules_parse_line("idle machine below 5.5", &rule));
+    assert(rule.scope == ALERT_SCOPE_MACHINE);
+    assert(rule.comparison == ALERT_COMPARISON_BELOW);
+    assert(rule.threshold == 5.5 && rule.clear_threshold == 5.5);
+    assert(rule.duration == 1);
+    assert(rule.action[0] == '\0');
+}
+
+static void parse_invalid_test() {
+    AlertRule rule;
+
+    assert(!alert_rules_parse_line("", &rule));
+    assert(!alert_rules_parse_line("\n", &rule));
+    assert(!alert_rules_parse_line("name core above", &rule));
+    assert(!alert_rules_parse_line("name die above 90", &rule));
+    assert(!alert_rules_parse_line("name core over 90", &rule));
+    assert(!alert_rules_parse_line("name core above 90x", &rule));
+    assert(!alert_rules_parse_line("name core above 90 for 0", &rule));
+    assert(!alert_rules_parse_line("name core above 90 for", &rule));
+    assert(!alert_rules_parse_line("name core above 90 during 5", &rule));
+    /*Inverted hysteresis*/
+    assert(!alert_rules_parse_line("name core above 90 clear 95", &rule));
+    assert(!alert_rules_parse_line("name core below 10 clear 5", &rule));
+    assert(!alert_rules_parse_line("name_that_is_way_too_long_to_fit_in_the_rule core above 90", &rule));
+}
+
+static void hysteresis_test() {
+    AlertRules* rules = alert_rules_new(2, 1);
+    AlertRule rule;
+    AlertEvent events[4];
+    assert(rules != NULL);
+    assert(alert_rules_parse_line("hot core above 90 for 2 clear 70", &rule));
+    assert(alert_rules_add(rules, &rule));
+    assert(!alert_rules_add(rules, &rule));
+    assert(alert_rules_count(rules) == 1);
+
+    static const double usage[] = {95.0, 85.0, 95.0, 95.0, 80.0, 95.0, 60.0, NAN, 95.0};
+    static const size_t expected_events[] = {0, 0, 0, 1, 0, 0, 1, 0, 0};
+    static const bool expected_fired[] = {false, false, false, true, false, false, false, false, false};
+
+    snapshot.number_of_cores = 2;
+    for (size_t i = 0; i < sizeof(usage) / sizeof(*usage); i++) {
+        snapshot.core_usage[0] = usage[i];
+        snapshot.core_usage[1] = 50.0;
+        const size_t count = alert_rules_evaluate(rules, &snapshot, events, 4);
+        assert(count == expected_events[i]);
+        if (count == 1) {
+            assert(events[0].rule == 0);
+            assert(events[0].instance == 0);
+            assert(events[0].value == usage[i]);
+            assert(events[0].fired == expected_fired[i]);
+        }
+    }
+    alert_rules_delete(rules);
+    alert_rules_delete(NULL);
+}
+
+static void below_machine_test() {
+    AlertRules* rules = alert_rules_new(4, 2);
+    AlertRule rule;
+    AlertEvent events[4];
+    assert(alert_rules_parse_line("idle machine below 10 clear 20", &rule));
+    alert_rules_add(rules, &rule);
+
+    snapshot.number_of_cores = 4;
+    for (size_t core = 0; core < 4; core++) {
+        snapshot.core_usage[core] = 2.0;
+    }
+    /*NaN core is excluded from the average*/
+    snapshot.core_usage[3] = NAN;
+    assert(alert_rules_evaluate(rules, &snapshot, events, 4) == 1);
+    assert(events[0].instance == SIZE_MAX && events[0].fired && events[0].value == 2.0);
+
+    /*Average 18 is still inside hysteresis band*/
+    snapshot.core_usage[0] = 50.0;
+    assert(alert_rules_evaluate(rules, &snapshot, events, 4) == 0);
+    snapshot.core_usage[0] = 80.0;
+    assert(alert_rules_evaluate(rules, &snapshot, events, 4) == 1);
+    assert(!events[0].fired);
+    alert_rules_delete(rules);
+}
+
+static void events_size_test() {
+    AlertRules* rules = alert_rules_new(8, 1);
+    AlertRule rule;
+    AlertEvent events[2];
+    assert(alert_rules_parse_line("hot core above 50", &rule));
+    alert_rules_add(rules, &rule);
+
+    snapshot.number_of_cores = 8;
+    for (size_t core = 0; core < 8; core++) {
+        snapshot.core_usage[core] = 100.0;
+    }
+    assert(alert_rules_evaluate(rules, &snapshot, events, 2) == 2);
+    /*Transitions above the limit are applied anyway*/
+    assert(alert_rules_evaluate(rules, &snapshot, events, 2) == 0);
+    alert_rules_delete(rules);
+}
+
+static void socket_test() {
+    AlertRules* rules = alert_rules_new(2, 2);
+    AlertRule rule;
+    AlertEvent events[4];
+    char message[ALERT_EVENT_MESSAGE_SIZE];
+    assert(alert_rules_parse_line("socket_hot socket above 80", &rule));
+    alert_rules_add(rules, &rule);
+    assert(alert_rules_parse_line("node_idle node below 5", &rule));
+    alert_rules_add(rules, &rule);
+
+    snapshot.number_of_cores = 2;
+    snapshot.core_usage[0] = snapshot.core_usage[1] = 50.0;
+    snapshot.number_of_packages = 2;
+    snapshot.package_usage[0] = (SnapshotGroupUsage) {.id = 0, .usage = 50.0};
+    snapshot.package_usage[1] = (SnapshotGroupUsage) {.id = 3, .usage = 90.0};
+    snapshot.number_of_nodes = 1;
+    snapshot.node_usage[0] = (SnapshotGroupUsage) {.id = 0, .usage = 1.0};
+
+    assert(alert_rules_evaluate(rules, &snapshot, events, 4) == 2);
+    assert(events[0].rule == 0 && events[0].instance == 3 && events[0].fired);
+    assert(events[1].rule == 1 && events[1].instance == 0 && events[1].value == 1.0);
+    alert_rules_format_event(rules, &events[0], message, sizeof(message));
+    assert(strcmp(message, "alert socket_hot fired socket 3 value 90.00\n") == 0);
+
+    snapshot.number_of_packages = 0;
+    snapshot.number_of_nodes = 0;
+    alert_rules_delete(rules);
+}
+
+static void format_test() {
+    AlertRules* rules = alert_rules_new(1, 1);
+    AlertRule rule;
+    char message[ALERT_EVENT_MESSAGE_SIZE];
+    assert(alert_rules_parse_line("hot core above 50", &rule));
+    alert_rules_add(rules, &rule);
+
+    AlertEvent event = {.rule = 0, .instance = 3, .value = 97.5, .fired = true};
+    alert_rules_format_event(rules, &event, message, sizeof(message));
+    assert(strcmp(message, "alert hot fired core 3 value 97.50\n") == 0);
+    event = (AlertEvent) {.rule = 0, .instance = SIZE_MAX, .value = 1.0, .fired = false};
+    alert_rules_format_event(rules, &event, message, sizeof(message));
+    assert(strcmp(message, "alert hot cleared machine value 1.00\n") == 0);
+    assert(alert_rules_get(rules, 1) == NULL);
+    alert_rules_delete(rules);
+}
+
+int main() {
+    parse_test();
+    parse_invalid_test();
+    hysteresis_test();
+    below_machine_test();
+    events_size_test();
+    format_test();
+    socket_test();
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <tgmath.h>
+#include "arena.h"
+#include "circular_buffer.h"
+#include "watchdog.h"
+#include "usage_stats.h"
+#include "hotspot.h"
+#include "rollup.h"
+#include "alert_rules.h"
+#include "alert_action.h"
+#include "trace.h"
+#include "adaptive_period.h"
+#include "snapshot_latency.h"
+
+static void new_delete_test(void);
+static void alloc_test(void);
+static void objects_test(void);
+static void working_state_test(void);
+
+static Snapshot snapshot;
+
+static void new_delete_test() {
+    assert(arena_new(0) == NULL);
+    Arena* arena = arena_new(1000);
+    assert(arena != NULL);
+    assert(arena_size(arena) >= 1000);
+    assert(!arena_locked(arena));
+    arena_delete(arena);
+    arena_delete(NULL);
+
+    assert(arena_footprint(1) == ARENA_ALIGNMENT);
+    assert(arena_footprint(ARENA_ALIGNMENT) == ARENA_ALIGNMENT);
+    assert(arena_footprint(ARENA_ALIGNMENT + 1) == 2 * ARENA_ALIGNMENT);
+}
+
+static void alloc_test() {
+    Arena* arena = arena_new(arena_footprint(100) + arena_footprint(10));
+    assert(arena != NULL);
+    const size_t used = arena_used(arena);
+
+    assert(arena_alloc(arena, 0) == NULL);
+    unsigned char* first = arena_alloc(arena, 100);
+    unsigned char* second = arena_alloc(arena, 10);
+    assert(first != NULL && second != NULL);
+    assert((uintptr_t) first % ARENA_ALIGNMENT == 0 && (uintptr_t) second % ARENA_ALIGNMENT == 0);
+    assert(second >= first + 100);
+    for (size_t i = 0; i < 100; i++) {
+        assert(first[i] == 0);
+    }
+    assert(arena_used(arena) == used + arena_footprint(100) + arena_footprint(10));
+
+    /*Exhausted arena keeps its objects*/
+    assert(arena_alloc(arena, 1) == NULL);
+    first[99] = 1;
+    second[9] = 1;
+    arena_delete(arena);
+}
+
+static void objects_test() {
+    Arena* arena = arena_new(arena_footprint(circular_buffer_footprint(8, sizeof(int)))
+                             + arena_footprint(watchdog_footprint(2)));
+    assert(arena != NULL);
+
+    assert(circular_buffer_new_in(arena, 0, sizeof(int)) == NULL);
+    CircularBuffer* buffer = circular_buffer_new_in(arena, 8, sizeof(int));
+    Watchdog* watchdog = watchdog_new_in(arena, 2);
+    assert(buffer != NULL && watchdog != NULL);
+    assert(circular_buffer_new_in(arena, 1, sizeof(int)) == NULL);
+
+    for (int i = 0; i < 8; i++) {
+        assert(circular_buffer_insert_single(buffer, &i) == 1);
+    }
+    assert(circular_buffer_write_available(buffer) == 0);
+    int element;
+    assert(circular_buffer_remove_single(buffer, &element) == 1 && element == 0);
+
+    WatchdogControlUnit unit = WATCHDOG_CONTROL_UNIT_INIT;
+    assert(watchdog_add_puppy(watchdog, &unit));
+    assert(watchdog_number_of_units(watchdog) == 1);
+
+    /*Objects carved from the arena are released with it*/
+    circular_buffer_delete(buffer);
+    watchdog_delete(watchdog);
+    arena_delete(arena);
+}
+
+static void working_state_test() {
+    const size_t footprint = arena_footprint(usage_stats_footprint(4, 3)) + arena_footprint(hotspot_footprint(4, 2))
+                             + arena_footprint(rollup_footprint(4)) + arena_footprint(alert_rules_footprint(4, 2))
+                             + arena_footprint(alert_action_footprint()) + arena_footprint(trace_footprint(16))
+                             + arena_footprint(adaptive_period_footprint()) + arena_footprint(snapshot_latency_footprint());
+    Arena* arena = arena_new(footprint);
+    assert(arena != NULL);
+    const size_t used = arena_used(arena);
+
+    /*Invalid specification leaves the arena untouched*/
+    assert(alert_action_new_in(arena, "mail:root") == NULL);
+    assert(arena_used(arena) == used);
+
+    UsageStats* stats = usage_stats_new_in(arena, 4, 3);
+    Hotspot* hotspot = hotspot_new_in(arena, 4, 2, 50.0, 1);
+    Rollup* rollup = rollup_new_in(arena, 4);
+    AlertRules* rules = alert_rules_new_in(arena, 4, 2);
+    AlertAction* action = alert_action_new_in(arena, "log");
+    Trace* trace = trace_new_in(arena, 16);
+    AdaptivePeriod* adaptive_period = adaptive_period_new_in(arena, 100000000u, 1000000000u, 10.0, 0.01, 100);
+    SnapshotLatency* latency = snapshot_latency_new_in(arena, 2);
+    assert(stats != NULL && hotspot != NULL && rollup != NULL && rules != NULL && action != NULL && trace != NULL
+           && adaptive_period != NULL && latency != NULL);
+    assert(arena_used(arena) - used == footprint);
+    assert(usage_stats_new_in(arena, 1, 1) == NULL);
+
+    /*Arrays laid out behind each structure do not overlap*/
+    snapshot.timestamp.tv_sec = 1000;
+    snapshot.number_of_cores = 4;
+    for (size_t core = 0; core < 4; core++) {
+        snapshot.core_usage[core] = 20.0 * (double) core;
+    }
+    for (size_t i = 0; i < 3; i++) {
+        snapshot.timestamp.tv_sec++;
+        usage_stats_update(stats, &snapshot);
+        hotspot_update(hotspot, &snapshot);
+    }
+    for (size_t core = 0; core < 4; core++) {
+        assert(usage_stats_get(stats, core, USAGE_STATISTIC_EWMA_10S) == snapshot.core_usage[core]);
+        assert(fabs(usage_stats_get(stats, core, USAGE_STATISTIC_P50) - snapshot.core_usage[core]) <= 1.0);
+    }
+    size_t count;
+    const HotspotCore* busiest = hotspot_busiest(hotspot, &count);
+    assert(count == 2 && busiest[0].core == 3 && busiest[1].core == 2);
+    const HotspotCore* idlest = hotspot_idlest(hotspot, &count);
+    assert(count == 2 && idlest[0].core == 0 && idlest[1].core == 1);
+    assert(hotspot_is_hot(hotspot, 3) && !hotspot_is_hot(hotspot, 2));
+
+    AlertRule rule;
+    assert(alert_rules_parse_line("busy core above 50 for 1", &rule));
+    assert(alert_rules_add(rules, &rule));
+    assert(alert_rules_add(rules, &rule));
+    assert(!alert_rules_add(rules, &rule));
+    assert(alert_action_type(action) == ALERT_ACTION_LOG);
+
+    /*Objects carved from the arena are released with it*/
+    usage_stats_delete(stats);
+    hotspot_delete(hotspot);
+    rollup_delete(rollup);
+    alert_rules_delete(rules);
+    alert_action_delete(action);
+    trace_delete(trace);
+    adaptive_period_delete(adaptive_period);
+    snapshot_latency_delete(latency);
+    arena_delete(arena);
+}
+
+int main() {
+    new_delete_test();
+    alloc_test();
+    objects_test();
+    working_state_test();
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <tgmath.h> 
+#include <string.h>
+#include <unistd.h>
 #include "circular_buffer.h"
 
 typedef enum ECircularBufferTestConstants {
@@ -11,6 +13,9 @@ static void insert_test(void);
 static void remove_test(void);
 static void new_test(void);
 static void insert_remove_test(void);
+static void stats_test(void);
+static void span_test(void);
+static void mirrored_test(void);
 
 static void new_test() {
     CircularBuffer* buffer = circular_buffer_new(0, 10);
@@ -106,12 +111,123 @@ static void insert_remove_test() {
     circular_buffer_delete(buffer);
 }
 
+static void stats_test() {
+    CircularBuffer* buffer = circular_buffer_new(4, sizeof(uint32_t));
+    CircularBufferStats stats;
+    uint32_t value = 7;
+
+    for (size_t i = 0; i < 5; i++) {
+        circular_buffer_insert_single(buffer, &value);
+    }
+    for (size_t i = 0; i < 6; i++) {
+        circular_buffer_remove_single(buffer, &value);
+    }
+    circular_buffer_insert_single(buffer, &value);
+
+#ifdef PIPELINE_STATS
+    assert(circular_buffer_stats(buffer, &stats));
+    assert(stats.capacity == 4 && stats.high_water_mark == 4);
+    assert(stats.inserts == 5 && stats.removals == 4);
+    assert(stats.full_events == 1 && stats.empty_events == 2);
+#else
+    assert(!circular_buffer_stats(buffer, &stats));
+    assert(stats.capacity == 4 && stats.inserts == 0 && stats.high_water_mark == 0);
+#endif
+
+    circular_buffer_delete(buffer);
+}
+
+static void span_test() {
+    CircularBuffer* buffer = circular_buffer_new(8, sizeof(char));
+    size_t count;
+
+    char* span = circular_buffer_reserve_span(buffer, &count);
+    assert(count == 8);
+    memcpy(span, "abcdef", 6);
+    circular_buffer_commit(buffer, 6);
+    span = circular_buffer_peek_span(buffer, &count);
+    assert(count == 6 && memcmp(span, "abcdef", 6) == 0);
+    circular_buffer_consume(buffer, 5);
+
+    /*Spans of an ordinary buffer end where its memory ends*/
+    span = circular_buffer_reserve_span(buffer, &count);
+    assert(count == 2);
+    memcpy(span, "gh", 2);
+    circular_buffer_commit(buffer, 2);
+    span = circular_buffer_reserve_span(buffer, &count);
+    assert(count == 5);
+    memcpy(span, "ij", 2);
+    circular_buffer_commit(buffer, 2);
+    span = circular_buffer_peek_span(buffer, &count);
+    assert(count == 3 && memcmp(span, "fgh", 3) == 0);
+    circular_buffer_consume(buffer, 3);
+    span = circular_buffer_peek_span(buffer, &count);
+    assert(count == 2 && memcmp(span, "ij", 2) == 0);
+    assert(!circular_buffer_mirrored(buffer));
+
+    /*Spans and single elements mix*/
+    char value;
+    assert(circular_buffer_remove_single(buffer, &value) == 1 && value == 'i');
+    circular_buffer_consume(buffer, 1);
+    circular_buffer_peek_span(buffer, &count);
+    assert(count == 0 && circular_buffer_read_available(buffer) == 0);
+    circular_buffer_delete(buffer);
+}
+
+static void mirrored_test() {
+    const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    assert(circular_buffer_new_mirrored(0, 1) == NULL);
+    assert(circular_buffer_new_mirrored(1, 0) == NULL);
+    /*Element of 3 bytes does not divide a page*/
+    assert(circular_buffer_new_mirrored(1, 3) == NULL);
+
+    CircularBuffer* buffer = circular_buffer_new_mirrored(100, sizeof(char));
+    assert(buffer != NULL && circular_buffer_mirrored(buffer));
+    assert(circular_buffer_write_available(buffer) == page);
+
+    /*Move indexes close to the end of the memory*/
+    size_t count;
+    circular_buffer_reserve_span(buffer, &count);
+    circular_buffer_commit(buffer, page - 3);
+    circular_buffer_consume(buffer, page - 3);
+
+    /*Every free and readable range is a single span across the end*/
+    char* span = circular_buffer_reserve_span(buffer, &count);
+    assert(count == page);
+    memcpy(span, "line\nnext", 9);
+    circular_buffer_commit(buffer, 9);
+    span = circular_buffer_peek_span(buffer, &count);
+    assert(count == 9 && memcmp(span, "line\nnext", 9) == 0);
+    span[4] = '\0';
+    assert(strcmp(span, "line") == 0);
+    circular_buffer_consume(buffer, 5);
+
+    /*Both views share memory, wrapped bytes are at the start as well*/
+    assert(circular_buffer_remove_single(buffer, &span[0]) == 1 && span[0] == 'n');
+    span = circular_buffer_peek_span(buffer, &count);
+    assert(count == 3 && memcmp(span, "ext", 3) == 0);
+    assert(memcmp(span + page, "ext", 3) == 0);
+
+    CircularBufferStats stats;
+    circular_buffer_stats(buffer, &stats);
+    assert(stats.capacity == page);
+    circular_buffer_delete(buffer);
+
+    CircularBuffer* wide = circular_buffer_new_mirrored(3, sizeof(uint64_t));
+    assert(wide != NULL && circular_buffer_write_available(wide) == page / sizeof(uint64_t));
+    circular_buffer_delete(wide);
+    circular_buffer_delete(NULL);
+}
+
 int main() {
 
     insert_test();
     remove_test();
     new_test();
     insert_remove_test();
+    stats_test();
+    span_test();
+    mirrored_test();
 
     return 0;
 }
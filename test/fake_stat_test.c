@@ -0,0 +1,165 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fake_stat.h"
+#include "proc_parser.h"
+
+static void new_delete_test(void);
+static void pattern_parse_test(void);
+static void format_test(void);
+static void usage_test(void);
+static void patterns_test(void);
+
+static char content[16384];
+
+/**
+ * @brief Parse every core line of content and compute usage since previous in percent
+ */
+static void usage_compute(const char* text, ProcParserCpuTime previous[], double usage[], size_t number_of_cores) {
+    char* copy = strdup(text);
+    assert(copy != NULL);
+    size_t core = 0;
+    for (char* line = strtok(copy, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+        uint64_t values[10];
+        if (proc_parser_parse_line(line, values) != PROC_PARSER_SUCCESS) {
+            continue;
+        }
+        assert(proc_parser_cpu_number(line) == (long) core);
+        const ProcParserCpuTime current = proc_parser_compute_core_time(values);
+        usage[core] = proc_parser_cpu_time_compute_usage(&previous[core], &current) * 100.0;
+        previous[core] = current;
+        core++;
+    }
+    assert(core == number_of_cores);
+    free(copy);
+}
+
+static void new_delete_test() {
+    assert(fake_stat_new(0, FAKE_STAT_PATTERN_FLAT, 50) == NULL);
+    assert(fake_stat_new(1, FAKE_STAT_PATTERN_COUNT, 0) == NULL);
+    FakeStat* fake_stat = fake_stat_new(4, FAKE_STAT_PATTERN_FLAT, 50);
+    assert(fake_stat != NULL);
+    assert(fake_stat_load(fake_stat, 0) == 0);
+    fake_stat_delete(fake_stat);
+    fake_stat_delete(NULL);
+}
+
+static void pattern_parse_test() {
+    EFakeStatPattern pattern;
+    uint64_t parameter;
+
+    assert(fake_stat_pattern_parse("flat", &pattern, &parameter));
+    assert(pattern == FAKE_STAT_PATTERN_FLAT && parameter == 50);
+    assert(fake_stat_pattern_parse("flat:75", &pattern, &parameter) && parameter == 75);
+    assert(fake_stat_pattern_parse("ramp", &pattern, &parameter) && pattern == FAKE_STAT_PATTERN_RAMP);
+    assert(fake_stat_pattern_parse("sine", &pattern, &parameter) && parameter == 60);
+    assert(fake_stat_pattern_parse("random:42", &pattern, &parameter));
+    assert(pattern == FAKE_STAT_PATTERN_RANDOM && parameter == 42);
+
+    assert(!fake_stat_pattern_parse("flat:101", &pattern, &parameter));
+    assert(!fake_stat_pattern_parse("flat:", &pattern, &parameter));
+    assert(!fake_stat_pattern_parse("flat:-1", &pattern, &parameter));
+    assert(!fake_stat_pattern_parse("sine:0", &pattern, &parameter));
+    assert(!fake_stat_pattern_parse("ramp:3", &pattern, &parameter));
+    assert(!fake_stat_pattern_parse("flatter", &pattern, &parameter));
+    assert(!fake_stat_pattern_parse("", &pattern, &parameter));
+    assert(pattern == FAKE_STAT_PATTERN_RANDOM && parameter == 42);
+
+    assert(strcmp(fake_stat_pattern_to_str(FAKE_STAT_PATTERN_SINE), "sine") == 0);
+    assert(strcmp(fake_stat_pattern_to_str(FAKE_STAT_PATTERN_COUNT), "unknown") == 0);
+}
+
+static void format_test() {
+    FakeStat* fake_stat = fake_stat_new(2, FAKE_STAT_PATTERN_FLAT, 50);
+    assert(fake_stat != NULL);
+    fake_stat_advance(fake_stat);
+
+    const int length = fake_stat_format(fake_stat, content, sizeof(content));
+    assert(strcmp(content, "cpu  70 0 30 100 0 0 0 0 0 0\n"
+                           "cpu0 35 0 15 50 0 0 0 0 0 0\n"
+                           "cpu1 35 0 15 50 0 0 0 0 0 0\n"
+                           "intr 100 0 0\nctxt 1000\nbtime 1700000000\nprocesses 2\n") == 0);
+    assert(length == (int) strlen(content));
+
+    /*Length is reported even if the content does not fit, truncated content stays terminated*/
+    char small[16];
+    assert(fake_stat_format(fake_stat, NULL, 0) == length);
+    assert(fake_stat_format(fake_stat, small, sizeof(small)) == length);
+    assert(strlen(small) == sizeof(small) - 1);
+    fake_stat_delete(fake_stat);
+}
+
+static void usage_test() {
+    enum { cores = 5 };
+    ProcParserCpuTime previous[cores] = {{0}};
+    double usage[cores];
+    FakeStat* fake_stat = fake_stat_new(cores, FAKE_STAT_PATTERN_RAMP, 0);
+    assert(fake_stat != NULL);
+
+    for (size_t tick = 0; tick < 3; tick++) {
+        fake_stat_advance(fake_stat);
+        fake_stat_format(fake_stat, content, sizeof(content));
+        usage_compute(content, previous, usage, cores);
+        for (size_t core = 0; core < cores; core++) {
+            assert(fake_stat_load(fake_stat, core) == core * 25);
+            assert(fabs(usage[core] - (double) (core * 25)) < 1e-9);
+        }
+    }
+    fake_stat_delete(fake_stat);
+}
+
+static void patterns_test() {
+    enum { cores = 8, period = 16 };
+    FakeStat* sine = fake_stat_new(cores, FAKE_STAT_PATTERN_SINE, period);
+    FakeStat* random = fake_stat_new(cores, FAKE_STAT_PATTERN_RANDOM, 7);
+    FakeStat* random_again = fake_stat_new(cores, FAKE_STAT_PATTERN_RANDOM, 7);
+    ProcParserCpuTime previous[cores] = {{0}};
+    double usage[cores];
+    unsigned first_tick[cores];
+    bool random_varies = false;
+    assert(sine != NULL && random != NULL && random_again != NULL);
+
+    for (size_t tick = 0; tick <= period; tick++) {
+        fake_stat_advance(sine);
+        fake_stat_advance(random);
+        fake_stat_advance(random_again);
+        fake_stat_format(sine, content, sizeof(content));
+        usage_compute(content, previous, usage, cores);
+        for (size_t core = 0; core < cores; core++) {
+            const unsigned load = fake_stat_load(sine, core);
+            assert(load <= 100 && fabs(usage[core] - (double) load) < 1e-9);
+            /*Same seed gives the same sequence*/
+            assert(fake_stat_load(random, core) <= 100);
+            assert(fake_stat_load(random, core) == fake_stat_load(random_again, core));
+            random_varies |= fake_stat_load(random, core) != fake_stat_load(random, 0);
+            if (tick == 0) {
+                first_tick[core] = load;
+            }
+        }
+        /*Phase is shifted by core*/
+        bool shifted = false;
+        for (size_t core = 1; core < cores; core++) {
+            shifted |= fake_stat_load(sine, core) != fake_stat_load(sine, 0);
+        }
+        assert(shifted);
+    }
+    /*Sine repeats after its period*/
+    for (size_t core = 0; core < cores; core++) {
+        assert(fake_stat_load(sine, core) == first_tick[core]);
+    }
+    assert(random_varies);
+    fake_stat_delete(sine);
+    fake_stat_delete(random);
+    fake_stat_delete(random_again);
+}
+
+int main() {
+    new_delete_test();
+    pattern_parse_test();
+    format_test();
+    usage_test();
+    patterns_test();
+    return 0;
+}
@@ -0,0 +1,67 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include "fake_tree.h"
+
+enum {
+    /*Descriptors nftw may keep open, trees are a few levels deep*/
+    FAKE_TREE_OPEN_DIRECTORIES = 16,
+};
+
+/**
+ * @brief Remove single entry, nftw visits directories after their content
+ */
+static int entry_remove(const char* path, const struct stat* status, int type, struct FTW* position);
+
+void fake_tree_write_bytes(const char root[const static 1], const char relative_path[const static 1], const void* const content,
+                           const size_t size) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", root, relative_path);
+    mkdir(root, 0755);
+    for (char* slash = strchr(path + strlen(root) + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(path, 0755);
+        *slash = '/';
+    }
+    FILE* file = fopen(path, "w");
+    assert(file != NULL);
+    assert(fwrite(content, 1, size, file) == size);
+    fclose(file);
+}
+
+void fake_tree_write(const char root[const static 1], const char relative_path[const static 1], const char content[const static 1]) {
+    fake_tree_write_bytes(root, relative_path, content, strlen(content));
+}
+
+void fake_tree_cpu_write(const char root[const static 1], const size_t cpu, const uint32_t package, const uint32_t core,
+                         const char siblings[const static 1]) {
+    char path[128];
+    char content[32];
+    snprintf(path, sizeof(path), "devices/system/cpu/cpu%zu/topology/physical_package_id", cpu);
+    snprintf(content, sizeof(content), "%" PRIu32 "\n", package);
+    fake_tree_write(root, path, content);
+    snprintf(path, sizeof(path), "devices/system/cpu/cpu%zu/topology/core_id", cpu);
+    snprintf(content, sizeof(content), "%" PRIu32 "\n", core);
+    fake_tree_write(root, path, content);
+    snprintf(path, sizeof(path), "devices/system/cpu/cpu%zu/topology/thread_siblings_list", cpu);
+    snprintf(content, sizeof(content), "%s\n", siblings);
+    fake_tree_write(root, path, content);
+}
+
+void fake_tree_remove(const char root[const static 1]) {
+    /*Symbolic links are removed, not followed*/
+    const int result = nftw(root, entry_remove, FAKE_TREE_OPEN_DIRECTORIES, FTW_DEPTH | FTW_PHYS);
+    assert(result == 0 || errno == ENOENT);
+    errno = 0;
+}
+
+static int entry_remove(const char* const path, const struct stat* const status, const int type, struct FTW* const position) {
+    (void) status;
+    (void) type;
+    (void) position;
+    return remove(path);
+}
@@ -0,0 +1,49 @@
+/**
+ * @file fake_tree.h
+ * @brief Test fixture: temporary directory tree standing in for sysfs, procfs or dev.
+ *
+ */
+#ifndef FAKE_TREE_H
+#define FAKE_TREE_H
+
+#include <stddef.h>
+#include <inttypes.h>
+
+/**
+ * @brief Create file below root together with all missing directories, root included
+ *
+ * @param root path of the tree
+ * @param relative_path path of the file relative to root
+ * @param content bytes of the file
+ * @param size number of bytes of content
+ */
+void fake_tree_write_bytes(const char root[static 1], const char relative_path[static 1], const void* content, size_t size);
+
+/**
+ * @brief Create text file below root, @see fake_tree_write_bytes
+ *
+ * @param root path of the tree
+ * @param relative_path path of the file relative to root
+ * @param content null-terminated content of the file
+ */
+void fake_tree_write(const char root[static 1], const char relative_path[static 1], const char content[static 1]);
+
+/**
+ * @brief Create topology of cpu below root as sysfs has it in devices/system/cpu/cpu<cpu>/topology
+ *
+ * @param root path of the tree
+ * @param cpu number of the cpu
+ * @param package physical package id
+ * @param core core id
+ * @param siblings thread siblings list, e.g. "0,4"
+ */
+void fake_tree_cpu_write(const char root[static 1], size_t cpu, uint32_t package, uint32_t core, const char siblings[static 1]);
+
+/**
+ * @brief Remove the tree with everything below it, missing root is not an error
+ *
+ * @param root path of the tree
+ */
+void fake_tree_remove(const char root[static 1]);
+
+#endif
@@ -0,0 +1,147 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "frequency_sampler.h"
+#include "fake_tree.h"
+
+static void frequency_write(size_t cpu, uint32_t khz);
+static void msr_write(size_t cpu, uint64_t aperf, uint64_t mperf);
+static void missing_root_test(void);
+static void cpufreq_test(void);
+static void threads_test(void);
+static void msr_test(void);
+static void parse_line_test(void);
+
+static char root[64];
+
+static void frequency_write(const size_t cpu, const uint32_t khz) {
+    char path[128];
+    char content[32];
+    snprintf(path, sizeof(path), "sys/devices/system/cpu/cpu%zu/cpufreq/scaling_cur_freq", cpu);
+    snprintf(content, sizeof(content), "%" PRIu32 "\n", khz);
+    fake_tree_write(root, path, content);
+}
+
+/**
+ * @brief msr device is emulated by regular file, registers are moved apart by compile definitions
+ */
+static void msr_write(const size_t cpu, const uint64_t aperf, const uint64_t mperf) {
+    char path[128];
+    char content[0x100] = {0};
+    memcpy(content + FREQUENCY_SAMPLER_MSR_MPERF, &mperf, sizeof(mperf));
+    memcpy(content + FREQUENCY_SAMPLER_MSR_APERF, &aperf, sizeof(aperf));
+    snprintf(path, sizeof(path), "dev/cpu/%zu/msr", cpu);
+    fake_tree_write_bytes(root, path, content, sizeof(content));
+}
+
+static void missing_root_test() {
+    assert(frequency_sampler_new("/nonexistent/sysfs", "/nonexistent/dev", FREQUENCY_SOURCE_CPUFREQ, 1) == NULL);
+    frequency_sampler_delete(NULL);
+}
+
+static void cpufreq_test() {
+    char sysfs[128];
+    char dev[128];
+    snprintf(sysfs, sizeof(sysfs), "%s/sys", root);
+    snprintf(dev, sizeof(dev), "%s/dev", root);
+    frequency_write(0, 3500000);
+    frequency_write(1, 800000);
+    /*cpu2 has no cpufreq driver*/
+    fake_tree_write(root, "sys/devices/system/cpu/cpu2/online", "1\n");
+    frequency_write(3, 1200000);
+
+    assert(frequency_sampler_new(sysfs, dev, FREQUENCY_SOURCE_CPUFREQ, 0) == NULL);
+    FrequencySampler* sampler = frequency_sampler_new(sysfs, dev, FREQUENCY_SOURCE_CPUFREQ, 1);
+    assert(sampler != NULL);
+    assert(frequency_sampler_number_of_cpus(sampler) == 4);
+
+    const uint32_t* values = frequency_sampler_sample(sampler);
+    assert(values[0] == 3500000 && values[1] == 800000 && values[2] == 0 && values[3] == 1200000);
+
+    /*Open file is re-read from the beginning*/
+    frequency_write(1, 2400000);
+    values = frequency_sampler_sample(sampler);
+    assert(values[1] == 2400000);
+
+    /*msr source is unavailable without the device*/
+    assert(frequency_sampler_new(sysfs, dev, FREQUENCY_SOURCE_MSR, 1) == NULL);
+    frequency_sampler_delete(sampler);
+}
+
+static void threads_test() {
+    /*Continues with the tree of cpufreq_test*/
+    char sysfs[128];
+    snprintf(sysfs, sizeof(sysfs), "%s/sys", root);
+    for (size_t cpu = 4; cpu < 64; cpu++) {
+        frequency_write(cpu, (uint32_t) (1000000 + cpu * 1000));
+    }
+
+    /*More threads than cpus are limited to number of cpus*/
+    const size_t threads[] = {2, 3, 7, 100};
+    for (size_t i = 0; i < sizeof(threads) / sizeof(*threads); i++) {
+        FrequencySampler* sampler = frequency_sampler_new(sysfs, root, FREQUENCY_SOURCE_CPUFREQ, threads[i]);
+        assert(sampler != NULL);
+        for (size_t round = 0; round < 3; round++) {
+            const uint32_t* values = frequency_sampler_sample(sampler);
+            assert(values[0] == 3500000 && values[2] == 0);
+            for (size_t cpu = 4; cpu < 64; cpu++) {
+                assert(values[cpu] == 1000000 + cpu * 1000);
+            }
+        }
+        frequency_sampler_delete(sampler);
+    }
+}
+
+static void msr_test() {
+    fake_tree_remove(root);
+    char sysfs[128];
+    char dev[128];
+    snprintf(sysfs, sizeof(sysfs), "%s/sys", root);
+    snprintf(dev, sizeof(dev), "%s/dev", root);
+    fake_tree_write(root, "sys/devices/system/cpu/cpu0/cpufreq/base_frequency", "2000000\n");
+    /*Base frequency falls back to cpuinfo_max_freq*/
+    fake_tree_write(root, "sys/devices/system/cpu/cpu1/cpufreq/cpuinfo_max_freq", "3000000\n");
+    msr_write(0, 1000, 1000);
+    msr_write(1, UINT64_MAX - 99, 500);
+
+    FrequencySampler* sampler = frequency_sampler_new(sysfs, dev, FREQUENCY_SOURCE_MSR, 2);
+    assert(sampler != NULL);
+
+    /*cpu0 ran 1.5x faster than base, cpu1 at half of base across wraparound of APERF*/
+    msr_write(0, 2500, 2000);
+    msr_write(1, 100, 900);
+    const uint32_t* values = frequency_sampler_sample(sampler);
+    assert(values[0] == 3000000);
+    assert(values[1] == 1500000);
+
+    /*Idle cpu does not advance MPERF, the last value is kept*/
+    values = frequency_sampler_sample(sampler);
+    assert(values[0] == 3000000);
+    frequency_sampler_delete(sampler);
+}
+
+static void parse_line_test() {
+    size_t cpu = 0;
+    uint32_t khz = 0;
+    assert(frequency_sampler_parse_line("freq 12 3500000", &cpu, &khz) == FREQUENCY_SAMPLER_SUCCESS);
+    assert(cpu == 12 && khz == 3500000);
+    assert(frequency_sampler_parse_line("freq 1 800000\n", &cpu, &khz) == FREQUENCY_SAMPLER_SUCCESS);
+    assert(cpu == 1 && khz == 800000);
+    assert(frequency_sampler_parse_line("cpu0 1 2 3 4 5 6 7 8 9 10", &cpu, &khz) == FREQUENCY_SAMPLER_DISCARD_LINE);
+    assert(frequency_sampler_parse_line("freq 1", &cpu, &khz) == FREQUENCY_SAMPLER_FAIL);
+    assert(frequency_sampler_parse_line("freq 1 2x", &cpu, &khz) == FREQUENCY_SAMPLER_FAIL);
+    assert(frequency_sampler_parse_line("freq 1 99999999999", &cpu, &khz) == FREQUENCY_SAMPLER_FAIL);
+}
+
+int main() {
+    snprintf(root, sizeof(root), "/tmp/frequency_sampler_test_%ld", (long) getpid());
+
+    missing_root_test();
+    cpufreq_test();
+    threads_test();
+    msr_test();
+    parse_line_test();
+    fake_tree_remove(root);
+    return 0;
+}
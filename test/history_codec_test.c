@@ -0,0 +1,188 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tgmath.h>
+#include "history_codec.h"
+
+enum {
+    number_of_cores = 16,
+    number_of_samples = 500,
+    block_size = 1 << 16,
+};
+
+static void new_invalid_test(void);
+static void round_trip_test(void);
+static void special_values_test(void);
+static void block_full_test(void);
+static void malformed_block_test(void);
+
+static uint64_t timestamps[number_of_samples];
+static double values[number_of_samples][number_of_cores];
+
+/*Bit-exact comparison, NaN == NaN and -0.0 != 0.0*/
+static bool same_double(double first, double second);
+
+static bool same_double(double first, double second) {
+    return memcmp(&first, &second, sizeof(first)) == 0;
+}
+
+static void new_invalid_test() {
+    uint8_t block[HISTORY_CODEC_HEADER_SIZE + 1];
+
+    assert(history_codec_encoder_new(0, block, sizeof(block)) == NULL);
+    assert(history_codec_encoder_new(1, NULL, sizeof(block)) == NULL);
+    assert(history_codec_encoder_new(1, block, HISTORY_CODEC_HEADER_SIZE) == NULL);
+    assert(history_codec_decoder_new(NULL, sizeof(block)) == NULL);
+}
+
+static void round_trip_test() {
+    uint8_t* block = malloc(block_size);
+    assert(block != NULL);
+    srand(7);
+
+    uint64_t timestamp = 1700000000000000000u;
+    for (size_t i = 0; i < number_of_samples; i++) {
+        /*100 ms period with jitter, occasionally the clock goes backwards*/
+        timestamp += 100000000u + (uint64_t) (rand() % 50000);
+        timestamp -= i % 97 == 0 ? 300000000u : 0;
+        timestamps[i] = timestamp;
+        for (size_t core = 0; core < number_of_cores; core++) {
+            const double busy = (double) (rand() % 101);
+            values[i][core] = core % 4 == 0 ? 0.0 : busy * 100.0 / (100.0 + (double) (rand() % 3));
+        }
+    }
+
+    HistoryCodecEncoder* encoder = history_codec_encoder_new(number_of_cores, block, block_size);
+    assert(encoder != NULL);
+    for (size_t i = 0; i < number_of_samples; i++) {
+        assert(history_codec_encode(encoder, timestamps[i], values[i]));
+    }
+    assert(history_codec_encoder_number_of_samples(encoder) == number_of_samples);
+    const size_t size = history_codec_encoder_finish(encoder);
+    /*Constant series shall cost almost nothing, compressed block is smaller than raw data*/
+    assert(size < number_of_samples * (number_of_cores + 1) * sizeof(double));
+    assert(history_codec_block_number_of_samples(block, size) == number_of_samples);
+    assert(history_codec_block_number_of_samples(block, HISTORY_CODEC_HEADER_SIZE - 1) == 0);
+
+    HistoryCodecDecoder* decoder = history_codec_decoder_new(block, size);
+    assert(decoder != NULL);
+    assert(history_codec_decoder_number_of_cores(decoder) == number_of_cores);
+
+    uint64_t decoded_timestamp;
+    double decoded[number_of_cores];
+    for (size_t i = 0; i < number_of_samples; i++) {
+        assert(history_codec_decode(decoder, &decoded_timestamp, decoded));
+        assert(decoded_timestamp == timestamps[i]);
+        for (size_t core = 0; core < number_of_cores; core++) {
+            assert(same_double(decoded[core], values[i][core]));
+        }
+    }
+    /*Block exhausted*/
+    assert(!history_codec_decode(decoder, &decoded_timestamp, decoded));
+
+    history_codec_decoder_delete(decoder);
+    history_codec_encoder_delete(encoder);
+    free(block);
+}
+
+static void special_values_test() {
+    uint8_t block[1024];
+    const double samples[][3] = {
+        {0.0, -0.0, 100.0},
+        {NAN, INFINITY, -INFINITY},
+        {1e-300, 12.5, 100.0},
+        {0.0, 12.5, 99.999999},
+    };
+    const size_t count = sizeof(samples) / sizeof(samples[0]);
+
+    HistoryCodecEncoder* encoder = history_codec_encoder_new(3, block, sizeof(block));
+    for (size_t i = 0; i < count; i++) {
+        /*Timestamps with large and zero deltas*/
+        assert(history_codec_encode(encoder, i == 3 ? UINT64_MAX : i, samples[i]));
+    }
+    const size_t size = history_codec_encoder_finish(encoder);
+
+    HistoryCodecDecoder* decoder = history_codec_decoder_new(block, size);
+    uint64_t timestamp;
+    double decoded[3];
+    for (size_t i = 0; i < count; i++) {
+        assert(history_codec_decode(decoder, &timestamp, decoded));
+        assert(timestamp == (i == 3 ? UINT64_MAX : i));
+        for (size_t core = 0; core < 3; core++) {
+            assert(same_double(decoded[core], samples[i][core]));
+        }
+    }
+
+    history_codec_decoder_delete(decoder);
+    history_codec_encoder_delete(encoder);
+}
+
+static void block_full_test() {
+    uint8_t first_block[256];
+    uint8_t second_block[256];
+    const double sample[2] = {1.0, 2.0};
+    size_t appended = 0;
+
+    HistoryCodecEncoder* encoder = history_codec_encoder_new(2, first_block, sizeof(first_block));
+    while (history_codec_encode(encoder, appended, sample)) {
+        appended++;
+    }
+    assert(appended > 0);
+    const size_t first_size = history_codec_encoder_finish(encoder);
+    assert(first_size <= sizeof(first_block));
+
+    /*Second block is independent from the first one*/
+    assert(history_codec_encoder_reset(encoder, second_block, sizeof(second_block)));
+    assert(history_codec_encoder_number_of_samples(encoder) == 0);
+    assert(history_codec_encode(encoder, 1000, sample));
+    const size_t second_size = history_codec_encoder_finish(encoder);
+
+    uint64_t timestamp;
+    double decoded[2];
+    HistoryCodecDecoder* decoder = history_codec_decoder_new(first_block, first_size);
+    size_t decoded_samples = 0;
+    while (history_codec_decode(decoder, &timestamp, decoded)) {
+        assert(timestamp == decoded_samples);
+        decoded_samples++;
+    }
+    assert(decoded_samples == appended);
+    history_codec_decoder_delete(decoder);
+
+    decoder = history_codec_decoder_new(second_block, second_size);
+    assert(history_codec_decode(decoder, &timestamp, decoded));
+    assert(timestamp == 1000);
+    assert(same_double(decoded[1], 2.0));
+    history_codec_decoder_delete(decoder);
+
+    history_codec_encoder_delete(encoder);
+}
+
+static void malformed_block_test() {
+    uint8_t block[128];
+    const double sample[1] = {5.0};
+
+    HistoryCodecEncoder* encoder = history_codec_encoder_new(1, block, sizeof(block));
+    history_codec_encode(encoder, 1, sample);
+    history_codec_encode(encoder, 2, sample);
+    const size_t size = history_codec_encoder_finish(encoder);
+    history_codec_encoder_delete(encoder);
+
+    /*Truncated block*/
+    assert(history_codec_decoder_new(block, size - 1) == NULL);
+    assert(history_codec_decoder_new(block, HISTORY_CODEC_HEADER_SIZE - 1) == NULL);
+
+    /*Wrong magic*/
+    block[0] ^= 0xFF;
+    assert(history_codec_decoder_new(block, size) == NULL);
+}
+
+int main() {
+
+    new_invalid_test();
+    round_trip_test();
+    special_values_test();
+    block_full_test();
+    malformed_block_test();
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <tgmath.h>
+#include "history_store.h"
+
+enum {
+    number_of_cores = 4,
+    capacity = 8,
+};
+
+static char history_path[64];
+
+static void open_invalid_test(void);
+static void append_query_test(void);
+static void wrap_around_test(void);
+static void restart_recovery_test(void);
+static void readonly_test(void);
+static void compression_test(void);
+
+static void fill_snapshot(Snapshot* snapshot, uint64_t second, size_t cores);
+
+static void fill_snapshot(Snapshot* snapshot, uint64_t second, size_t cores) {
+    snapshot->timestamp.tv_sec = (time_t) second;
+    snapshot->timestamp.tv_nsec = 0;
+    snapshot->number_of_cores = cores;
+    for (size_t i = 0; i < cores; i++) {
+        snapshot->core_usage[i] = (double) (second * 10 + i);
+    }
+}
+
+static void open_invalid_test() {
+    assert(history_store_open(history_path, 0, capacity, 0) == NULL);
+    assert(history_store_open(history_path, number_of_cores, 0, 0) == NULL);
+    assert(history_store_open_readonly("/nonexistent/history") == NULL);
+}
+
+static void append_query_test() {
+    unlink(history_path);
+    HistoryStore* store = history_store_open(history_path, number_of_cores, capacity, 2);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    HistoryStoreSample samples[capacity];
+    assert(store != NULL && snapshot != NULL);
+
+    assert(history_store_count(store) == 0);
+    assert(history_store_query(store, 0, 0, UINT64_MAX, samples, capacity) == 0);
+
+    for (uint64_t second = 1; second <= 3; second++) {
+        fill_snapshot(snapshot, second, number_of_cores);
+        assert(history_store_append(store, snapshot));
+    }
+    /*Snapshot with fewer cores is padded with NaN*/
+    fill_snapshot(snapshot, 4, 2);
+    assert(history_store_append(store, snapshot));
+    assert(history_store_count(store) == 4);
+
+    size_t found = history_store_query(store, 1, 2000000000u, 3000000000u, samples, capacity);
+    assert(found == 2);
+    assert(samples[0].timestamp_ns == 2000000000u);
+    assert(fabs(samples[0].usage - 21.0) < 0.001);
+    assert(fabs(samples[1].usage - 31.0) < 0.001);
+
+    found = history_store_query(store, 3, 0, UINT64_MAX, samples, capacity);
+    assert(found == 4);
+    assert(isnan(samples[3].usage));
+
+    /*Out of range core and too small destination*/
+    assert(history_store_query(store, number_of_cores, 0, UINT64_MAX, samples, capacity) == 0);
+    assert(history_store_query(store, 0, 0, UINT64_MAX, samples, 1) == 1);
+
+    free(snapshot);
+    history_store_delete(store);
+}
+
+static void wrap_around_test() {
+    unlink(history_path);
+    HistoryStore* store = history_store_open(history_path, number_of_cores, capacity, 0);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    HistoryStoreSample samples[capacity];
+    assert(store != NULL && snapshot != NULL);
+
+    for (uint64_t second = 1; second <= capacity + 3; second++) {
+        fill_snapshot(snapshot, second, number_of_cores);
+        history_store_append(store, snapshot);
+    }
+    assert(history_store_count(store) == capacity);
+
+    /*The oldest records have been overwritten, the rest is returned oldest first*/
+    size_t found = history_store_query(store, 0, 0, UINT64_MAX, samples, capacity);
+    assert(found == capacity);
+    for (size_t i = 0; i < capacity; i++) {
+        assert(samples[i].timestamp_ns == (4 + i) * 1000000000u);
+    }
+
+    free(snapshot);
+    history_store_delete(store);
+}
+
+static void restart_recovery_test() {
+    unlink(history_path);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    HistoryStoreSample samples[capacity];
+    assert(snapshot != NULL);
+
+    HistoryStore* store = history_store_open(history_path, number_of_cores, capacity, 0);
+    assert(store != NULL);
+    for (uint64_t second = 1; second <= 5; second++) {
+        fill_snapshot(snapshot, second, number_of_cores);
+        history_store_append(store, snapshot);
+    }
+    history_store_delete(store);
+
+    /*Geometry of existing file shall match*/
+    assert(history_store_open(history_path, number_of_cores + 1, capacity, 0) == NULL);
+    assert(history_store_open(history_path, number_of_cores, capacity + 1, 0) == NULL);
+
+    store = history_store_open(history_path, number_of_cores, capacity, 0);
+    assert(store != NULL);
+    assert(history_store_count(store) == 5);
+    for (uint64_t second = 6; second <= 10; second++) {
+        fill_snapshot(snapshot, second, number_of_cores);
+        history_store_append(store, snapshot);
+    }
+
+    size_t found = history_store_query(store, 2, 0, UINT64_MAX, samples, capacity);
+    assert(found == capacity);
+    assert(samples[0].timestamp_ns == 3000000000u);
+    assert(samples[capacity - 1].timestamp_ns == 10000000000u);
+
+    free(snapshot);
+    history_store_delete(store);
+}
+
+static void readonly_test() {
+    HistoryStore* store = history_store_open_readonly(history_path);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    HistoryStoreSample samples[capacity];
+    assert(store != NULL && snapshot != NULL);
+
+    assert(history_store_number_of_cores(store) == number_of_cores);
+    assert(history_store_count(store) == capacity);
+    assert(!history_store_append(store, snapshot));
+    assert(history_store_query(store, 1, 9000000000u, UINT64_MAX, samples, capacity) == 2);
+
+    free(snapshot);
+    history_store_delete(store);
+}
+
+static void compression_test() {
+    enum { cores = 64, records = 600 };
+    unlink(history_path);
+    HistoryStore* store = history_store_open(history_path, cores, records, 0);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    HistoryStoreSample* samples = calloc(records, sizeof(*samples));
+    struct stat status;
+    assert(store != NULL && snapshot != NULL && samples != NULL);
+
+    /*Preallocated file budgeted for the worst case is still smaller than raw records*/
+    assert(stat(history_path, &status) == 0);
+    assert((size_t) status.st_size < records * (cores + 1) * sizeof(double));
+
+    /*Several blocks wrap around, usage is rounded to the resolution*/
+    snapshot->number_of_cores = cores;
+    for (uint64_t second = 1; second <= records + 100; second++) {
+        snapshot->timestamp.tv_sec = (time_t) second;
+        for (size_t i = 0; i < cores; i++) {
+            snapshot->core_usage[i] = i % 2 == 0 ? 0.0 : (double) ((second * 7 + i) % 100) * 100.0 / 101.0;
+        }
+        assert(history_store_append(store, snapshot));
+    }
+    assert(history_store_count(store) == records);
+    assert(history_store_query(store, 5, 0, UINT64_MAX, samples, records) == records);
+    assert(samples[0].timestamp_ns == 101000000000u);
+    assert(samples[records - 1].timestamp_ns == (uint64_t) (records + 100) * 1000000000u);
+    assert(fabs(samples[records - 1].usage - snapshot->core_usage[5]) <= 0.5 / HISTORY_STORE_RESOLUTION);
+
+    /*Values that do not compress fit into the budget, retention does not shrink*/
+    srand(3);
+    for (uint64_t second = records + 101; second <= 2 * records; second++) {
+        snapshot->timestamp.tv_sec = (time_t) second;
+        for (size_t i = 0; i < cores; i++) {
+            snapshot->core_usage[i] = (double) rand() / RAND_MAX * 100.0;
+        }
+        assert(history_store_append(store, snapshot));
+    }
+    assert(history_store_count(store) == records);
+    assert(history_store_query(store, 0, 0, UINT64_MAX, samples, records) == records);
+    assert(samples[0].timestamp_ns == (uint64_t) (records + 1) * 1000000000u);
+    assert(samples[records - 1].timestamp_ns == (uint64_t) 2 * records * 1000000000u);
+
+    free(samples);
+    free(snapshot);
+    history_store_delete(store);
+}
+
+int main() {
+    snprintf(history_path, sizeof(history_path), "/tmp/history_store_test_%ld", (long) getpid());
+
+    open_invalid_test();
+    append_query_test();
+    wrap_around_test();
+    restart_recovery_test();
+    readonly_test();
+    compression_test();
+
+    unlink(history_path);
+    return 0;
+}
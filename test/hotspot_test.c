@@ -0,0 +1,117 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <tgmath.h>
+#include "hotspot.h"
+
+static int usage_compare_descending(const void* a, const void* b);
+static void new_test(void);
+static void selection_test(size_t number_of_cores, size_t top_n, int value_range);
+static void aggregate_test(void);
+static void streak_test(void);
+
+static Snapshot snapshot;
+
+static int usage_compare_descending(const void* a, const void* b) {
+    const double left = *(const double*) a;
+    const double right = *(const double*) b;
+    return (left < right) - (left > right);
+}
+
+static void new_test() {
+    assert(hotspot_new(0, 1, 90.0, 1) == NULL);
+    assert(hotspot_new(1, 0, 90.0, 1) == NULL);
+    assert(hotspot_new(1, 1, 90.0, 0) == NULL);
+    hotspot_delete(NULL);
+}
+
+static void selection_test(const size_t number_of_cores, const size_t top_n, const int value_range) {
+    Hotspot* hotspot = hotspot_new(number_of_cores, top_n, 90.0, 1);
+    double* sorted = malloc(sizeof(*sorted) * number_of_cores);
+    assert(hotspot != NULL && sorted != NULL);
+
+    for (size_t round = 0; round < 20; round++) {
+        snapshot.number_of_cores = number_of_cores;
+        for (size_t core = 0; core < number_of_cores; core++) {
+            /*Small range produces many duplicates*/
+            snapshot.core_usage[core] = (double) (rand() % value_range);
+            sorted[core] = snapshot.core_usage[core];
+        }
+        qsort(sorted, number_of_cores, sizeof(*sorted), usage_compare_descending);
+        hotspot_update(hotspot, &snapshot);
+
+        size_t busiest_count = 0;
+        size_t idlest_count = 0;
+        const HotspotCore* busiest = hotspot_busiest(hotspot, &busiest_count);
+        const HotspotCore* idlest = hotspot_idlest(hotspot, &idlest_count);
+        const size_t expected = top_n < number_of_cores ? top_n : number_of_cores;
+        assert(busiest_count == expected && idlest_count == expected);
+        for (size_t i = 0; i < expected; i++) {
+            assert(busiest[i].usage == sorted[i]);
+            assert(snapshot.core_usage[busiest[i].core] == busiest[i].usage);
+            assert(idlest[i].usage == sorted[number_of_cores - 1 - i]);
+            assert(snapshot.core_usage[idlest[i].core] == idlest[i].usage);
+        }
+    }
+    free(sorted);
+    hotspot_delete(hotspot);
+}
+
+static void aggregate_test() {
+    Hotspot* hotspot = hotspot_new(4, 2, 90.0, 1);
+
+    snapshot.number_of_cores = 3;
+    snapshot.core_usage[0] = 10.0;
+    snapshot.core_usage[1] = NAN;
+    snapshot.core_usage[2] = 30.0;
+    hotspot_update(hotspot, &snapshot);
+
+    const HotspotAggregate* aggregate = hotspot_aggregate(hotspot);
+    assert(aggregate->number_of_cores == 2);
+    assert(aggregate->min == 10.0);
+    assert(aggregate->max == 30.0);
+    assert(aggregate->avg == 20.0);
+    assert(aggregate->number_of_hot == 0);
+
+    size_t count = 0;
+    const HotspotCore* busiest = hotspot_busiest(hotspot, &count);
+    assert(count == 2 && busiest[0].core == 2 && busiest[1].core == 0);
+
+    snapshot.number_of_cores = 0;
+    hotspot_update(hotspot, &snapshot);
+    assert(isnan(hotspot_aggregate(hotspot)->avg));
+    hotspot_busiest(hotspot, &count);
+    assert(count == 0);
+    hotspot_delete(hotspot);
+}
+
+static void streak_test() {
+    Hotspot* hotspot = hotspot_new(2, 1, 90.0, 3);
+    static const double usage[] = {95.0, 99.0, 91.0, 50.0, 95.0, 95.0, 95.0, NAN};
+    static const bool hot[] = {false, false, true, false, false, false, true, false};
+
+    snapshot.number_of_cores = 2;
+    for (size_t i = 0; i < sizeof(usage) / sizeof(*usage); i++) {
+        snapshot.core_usage[0] = usage[i];
+        snapshot.core_usage[1] = 90.0;
+        hotspot_update(hotspot, &snapshot);
+        assert(hotspot_is_hot(hotspot, 0) == hot[i]);
+        assert(hotspot_aggregate(hotspot)->number_of_hot == (hot[i] ? 1u : 0u));
+        /*Threshold itself is not above threshold*/
+        assert(hotspot_streak(hotspot, 1) == 0);
+    }
+    assert(!hotspot_is_hot(hotspot, 2));
+    hotspot_delete(hotspot);
+}
+
+int main() {
+    srand(7);
+    new_test();
+    selection_test(1, 1, 100);
+    selection_test(5, 3, 100);
+    selection_test(64, 5, 3);
+    selection_test(384, 10, 101);
+    selection_test(1024, 16, 1000);
+    aggregate_test();
+    streak_test();
+    return 0;
+}
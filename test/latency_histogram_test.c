@@ -0,0 +1,79 @@
+#include <assert.h>
+#include <stddef.h>
+#include "latency_histogram.h"
+
+static void empty_test(void);
+static void bucket_test(void);
+static void quantile_test(void);
+static void out_of_range_test(void);
+
+static void empty_test() {
+    LatencyHistogram histogram;
+    latency_histogram_clear(&histogram);
+
+    assert(histogram.count == 0 && histogram.sum_ns == 0 && histogram.max_ns == 0);
+    assert(latency_histogram_quantile(&histogram, 0.5) == 0);
+}
+
+static void bucket_test() {
+    /*Small values are exact*/
+    for (uint64_t value = 0; value < 2 * LATENCY_HISTOGRAM_SUB_BUCKETS; value++) {
+        assert(latency_histogram_bucket(value) == value);
+        assert(latency_histogram_bucket_max(value) == value);
+    }
+    /*Buckets are contiguous, every value is in the bucket whose maximum is the first one not below it*/
+    uint64_t previous_max = 2 * LATENCY_HISTOGRAM_SUB_BUCKETS - 1;
+    for (size_t bucket = 2 * LATENCY_HISTOGRAM_SUB_BUCKETS; bucket < LATENCY_HISTOGRAM_BUCKETS; bucket++) {
+        const uint64_t max = latency_histogram_bucket_max(bucket);
+        assert(max > previous_max);
+        assert(latency_histogram_bucket(previous_max + 1) == bucket);
+        assert(latency_histogram_bucket(max) == bucket);
+        /*Width relative to the lowest value stays below 1 / SUB_BUCKETS*/
+        assert((max - previous_max) * LATENCY_HISTOGRAM_SUB_BUCKETS <= previous_max + 1);
+        previous_max = max;
+    }
+    assert(previous_max == (UINT64_C(1) << LATENCY_HISTOGRAM_MAX_EXPONENT) - 1);
+}
+
+static void quantile_test() {
+    LatencyHistogram histogram;
+    latency_histogram_clear(&histogram);
+
+    /*1 us .. 1000 us*/
+    for (uint64_t i = 1; i <= 1000; i++) {
+        latency_histogram_add(&histogram, i * 1000);
+    }
+    assert(histogram.count == 1000);
+    assert(histogram.max_ns == 1000000);
+    assert(histogram.sum_ns == 500500000);
+
+    const double quantiles[] = {0.5, 0.9, 0.99};
+    const uint64_t expected[] = {500000, 900000, 990000};
+    for (size_t i = 0; i < sizeof(quantiles) / sizeof(*quantiles); i++) {
+        const uint64_t value = latency_histogram_quantile(&histogram, quantiles[i]);
+        assert(value >= expected[i]);
+        assert((value - expected[i]) * LATENCY_HISTOGRAM_SUB_BUCKETS <= expected[i]);
+    }
+    /*Never above the largest sample*/
+    assert(latency_histogram_quantile(&histogram, 1.0) == 1000000);
+    assert(latency_histogram_quantile(&histogram, 0.0) <= 1000 + 1000 / LATENCY_HISTOGRAM_SUB_BUCKETS);
+}
+
+static void out_of_range_test() {
+    LatencyHistogram histogram;
+    latency_histogram_clear(&histogram);
+
+    latency_histogram_add(&histogram, UINT64_C(1) << 50);
+    assert(histogram.buckets[LATENCY_HISTOGRAM_BUCKETS - 1] == 1);
+    /*Clamped sample is reported by its exact maximum*/
+    assert(latency_histogram_quantile(&histogram, 0.5) == latency_histogram_bucket_max(LATENCY_HISTOGRAM_BUCKETS - 1));
+    assert(histogram.max_ns == UINT64_C(1) << 50);
+}
+
+int main() {
+    empty_test();
+    bucket_test();
+    quantile_test();
+    out_of_range_test();
+    return 0;
+}
@@ -1,11 +1,13 @@
 #include <assert.h>
 #include <string.h>
+#include <stdlib.h>
 #include "logger_payload.h"
 
 static void logger_new_delete_test(void);
 static void logger_get_message_test(void);
 static void logger_get_type_test(void);
 static void logger_type_to_string_test(void);
+static void logger_pool_test(void);
 
 static void logger_new_delete_test() {
     {
@@ -36,6 +38,38 @@ static void logger_get_type_test(void) {
 static void logger_type_to_string_test(void) {
     logger_payload_type_to_str(LOGGER_PAYLOAD_TYPE_ERROR);
     logger_payload_type_to_str(LOGGER_PAYLOAD_TYPE_ERROR);
+    assert(strcmp(logger_payload_type_to_str(LOGGER_PAYLOAD_TYPE_INFO), "Info") == 0);
+}
+
+static void logger_pool_test(void) {
+    enum { payloads = 2 };
+    void* memory = malloc(logger_payload_pool_footprint(payloads));
+    assert(memory != NULL);
+    LoggerPayload* heap_payload = logger_payload_new(LOGGER_PAYLOAD_TYPE_INFO, "HEAP");
+    assert(!logger_payload_pool_attach(memory, 0));
+    assert(logger_payload_pool_attach(memory, payloads));
+    assert(!logger_payload_pool_attach(memory, payloads));
+
+    char long_message[2 * LOGGER_PAYLOAD_POOL_MESSAGE_SIZE];
+    memset(long_message, 'x', sizeof(long_message) - 1);
+    long_message[sizeof(long_message) - 1] = '\0';
+    LoggerPayload* first = logger_payload_new(LOGGER_PAYLOAD_TYPE_WARNING, "TEST");
+    LoggerPayload* second = logger_payload_new(LOGGER_PAYLOAD_TYPE_INFO, long_message);
+    assert(first != NULL && second != NULL);
+    assert(strcmp(logger_payload_get_message(first), "TEST") == 0);
+    assert(strlen(logger_payload_get_message(second)) == LOGGER_PAYLOAD_POOL_MESSAGE_SIZE - 1);
+    /*Exhausted pool does not fall back to the heap*/
+    assert(logger_payload_new(LOGGER_PAYLOAD_TYPE_INFO, "TEST") == NULL);
+
+    logger_payload_delete(first);
+    first = logger_payload_new(LOGGER_PAYLOAD_TYPE_ERROR, "AGAIN");
+    assert(first != NULL && logger_payload_get_type(first) == LOGGER_PAYLOAD_TYPE_ERROR);
+    /*Payload allocated before attaching goes back to the heap*/
+    logger_payload_delete(heap_payload);
+    logger_payload_delete(first);
+    logger_payload_delete(second);
+    logger_payload_pool_detach();
+    free(memory);
 }
 
 int main() {
@@ -43,5 +77,6 @@ int main() {
     logger_get_message_test();
     logger_get_type_test();
     logger_type_to_string_test();
+    logger_pool_test();
     return 0;
 }
@@ -0,0 +1,326 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "metrics_endpoint.h"
+
+enum {
+    response_size = 512 * 1024,
+    number_of_publications = 2000,
+};
+
+static void new_delete_test(void);
+static void not_found_test(void);
+static void unavailable_test(void);
+static void publish_test(void);
+static void overhead_test(void);
+static void queues_test(void);
+static void latency_test(void);
+static void concurrent_scrape_test(void);
+
+static size_t scrape(const char* request, char* response);
+static const char* body_of(const char* response);
+static void fill_snapshot(Snapshot* snapshot, uint64_t sequence);
+static void* scraper(void* args);
+
+static char socket_path[64];
+static atomic_bool publisher_done;
+
+/**
+ * @brief Send request over new connection and read response until the server closes it
+ * @return length of response
+ */
+static size_t scrape(const char* const request, char* const response) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd != -1);
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", socket_path);
+    assert(connect(fd, (const struct sockaddr*) &address, sizeof(address)) == 0);
+    assert(send(fd, request, strlen(request), 0) == (ssize_t) strlen(request));
+
+    size_t length = 0;
+    ssize_t received;
+    while ((received = recv(fd, response + length, response_size - 1 - length, 0)) > 0) {
+        length += (size_t) received;
+    }
+    response[length] = '\0';
+    close(fd);
+    return length;
+}
+
+static const char* body_of(const char* const response) {
+    const char* separator = strstr(response, "\r\n\r\n");
+    assert(separator != NULL);
+    return separator + 4;
+}
+
+static void fill_snapshot(Snapshot* const snapshot, const uint64_t sequence) {
+    snapshot->sequence = sequence;
+    snapshot->timestamp = (struct timespec) {.tv_sec = 1700000000, .tv_nsec = 5};
+    snapshot->number_of_cores = 4;
+    for (size_t i = 0; i < snapshot->number_of_cores; i++) {
+        snapshot->core_cpu[i] = (uint32_t) i * 2;
+        snapshot->core_usage[i] = 12.5 * (double) i;
+    }
+}
+
+static void new_delete_test() {
+    assert(metrics_endpoint_new("/nonexistent/dir/metrics.sock") == NULL);
+
+    MetricsEndpoint* endpoint = metrics_endpoint_new(socket_path);
+    assert(endpoint != NULL);
+    assert(access(socket_path, F_OK) == 0);
+    metrics_endpoint_delete(endpoint);
+    assert(access(socket_path, F_OK) != 0);
+    metrics_endpoint_delete(NULL);
+
+    /*Socket file left behind is replaced*/
+    endpoint = metrics_endpoint_new(socket_path);
+    assert(endpoint != NULL);
+    MetricsEndpoint* second = metrics_endpoint_new(socket_path);
+    assert(second != NULL);
+    metrics_endpoint_delete(second);
+    metrics_endpoint_delete(endpoint);
+}
+
+static void not_found_test() {
+    MetricsEndpoint* endpoint = metrics_endpoint_new(socket_path);
+    char* response = malloc(response_size);
+    assert(endpoint != NULL && response != NULL);
+
+    scrape("GET /other HTTP/1.1\r\nHost: localhost\r\n\r\n", response);
+    assert(strncmp(response, "HTTP/1.0 404 ", 13) == 0);
+    scrape("POST /metrics HTTP/1.1\r\n\r\n", response);
+    assert(strncmp(response, "HTTP/1.0 404 ", 13) == 0);
+
+    free(response);
+    metrics_endpoint_delete(endpoint);
+}
+
+static void unavailable_test() {
+    MetricsEndpoint* endpoint = metrics_endpoint_new(socket_path);
+    char* response = malloc(response_size);
+    assert(endpoint != NULL && response != NULL);
+
+    scrape("GET /metrics HTTP/1.1\r\n\r\n", response);
+    assert(strncmp(response, "HTTP/1.0 503 ", 13) == 0);
+
+    free(response);
+    metrics_endpoint_delete(endpoint);
+}
+
+static void publish_test() {
+    MetricsEndpoint* endpoint = metrics_endpoint_new(socket_path);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    char* response = malloc(response_size);
+    assert(endpoint != NULL && snapshot != NULL && response != NULL);
+
+    fill_snapshot(snapshot, 42);
+    snapshot->has_frequency = true;
+    snapshot->core_frequency_khz[1] = 2400000;
+    snapshot->number_of_packages = 1;
+    snapshot->package_usage[0] = (SnapshotGroupUsage) {.id = 0, .usage = 25.0};
+    snapshot->pressure[PSI_RESOURCE_CPU] = (SnapshotPressure) {.available = true, .some_avg10 = 1.5, .some_total = 2500000};
+    snapshot->core_stale[2] = true;
+    snapshot->core_usage[2] = NAN;
+    snapshot->number_of_stale_cores = 1;
+    assert(metrics_endpoint_publish(endpoint, snapshot, NULL));
+
+    const size_t length = scrape("GET /metrics HTTP/1.1\r\nHost: localhost\r\nAccept: */*\r\n\r\n", response);
+    assert(strncmp(response, "HTTP/1.0 200 OK\r\n", 17) == 0);
+    assert(strstr(response, "Content-Type: text/plain; version=0.0.4") != NULL);
+    const char* body = body_of(response);
+    size_t content_length = 0;
+    assert(sscanf(strstr(response, "Content-Length: "), "Content-Length: %zu", &content_length) == 1);
+    assert(content_length == length - (size_t) (body - response));
+
+    assert(strstr(body, "# TYPE tracker_core_usage_percent gauge\n") != NULL);
+    assert(strstr(body, "tracker_snapshot_sequence 42\n") != NULL);
+    assert(strstr(body, "tracker_snapshot_timestamp_seconds 1700000000.000000005\n") != NULL);
+    assert(strstr(body, "tracker_core_usage_percent{cpu=\"6\"} 37.50\n") != NULL);
+    /*Stale core has no sample*/
+    assert(strstr(body, "tracker_core_usage_percent{cpu=\"4\"}") == NULL);
+    assert(strstr(body, "tracker_stale_cores 1\n") != NULL);
+    /*Unknown frequencies are omitted*/
+    assert(strstr(body, "tracker_core_frequency_hertz{cpu=\"2\"} 2400000000\n") != NULL);
+    assert(strstr(body, "tracker_core_frequency_hertz{cpu=\"0\"}") == NULL);
+    assert(strstr(body, "tracker_package_usage_percent{package=\"0\"} 25.00\n") != NULL);
+    assert(strstr(body, "tracker_node_usage_percent") == NULL);
+    assert(strstr(body, "tracker_pressure_avg10_percent{resource=\"cpu\",kind=\"some\"} 1.50\n") != NULL);
+    assert(strstr(body, "tracker_pressure_stall_seconds_total{resource=\"cpu\",kind=\"some\"} 2.500000\n") != NULL);
+    assert(strstr(body, "resource=\"io\"") == NULL);
+    assert(strstr(body, "tracker_stage_") == NULL);
+
+    /*The latest page is served, "/" is an alias*/
+    fill_snapshot(snapshot, 43);
+    snapshot->has_frequency = false;
+    assert(metrics_endpoint_publish(endpoint, snapshot, NULL));
+    scrape("GET / HTTP/1.0\r\n\r\n", response);
+    body = body_of(response);
+    assert(strstr(body, "tracker_snapshot_sequence 43\n") != NULL);
+    assert(strstr(body, "tracker_core_frequency_hertz") == NULL);
+
+    free(response);
+    free(snapshot);
+    metrics_endpoint_delete(endpoint);
+}
+
+static void overhead_test() {
+    MetricsEndpoint* endpoint = metrics_endpoint_new(socket_path);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    char* response = malloc(response_size);
+    assert(endpoint != NULL && snapshot != NULL && response != NULL);
+
+    StageOverheadReport overhead = {.sequence = 1, .number_of_snapshots = 10, .rss_kb = 2000, .peak_rss_kb = 3000};
+    overhead.cpu_us_per_snapshot[PLACEMENT_STAGE_PARSER] = 40.0;
+    overhead.messages[PLACEMENT_STAGE_PARSER] = 10;
+    overhead.hardware = true;
+    overhead.hardware_mask[PLACEMENT_STAGE_READER] = UINT32_C(1) << PERF_COUNTER_INSTRUCTIONS;
+    overhead.hardware_per_snapshot[PLACEMENT_STAGE_READER][PERF_COUNTER_INSTRUCTIONS] = 123456.0;
+    fill_snapshot(snapshot, 1);
+    assert(metrics_endpoint_publish(endpoint, snapshot, &overhead));
+
+    scrape("GET /metrics HTTP/1.1\r\n\r\n", response);
+    const char* body = body_of(response);
+    assert(strstr(body, "tracker_stage_cpu_seconds_per_snapshot{stage=\"parser\"} 0.000040000\n") != NULL);
+    assert(strstr(body, "tracker_stage_cpu_seconds_per_snapshot{stage=\"watchdog\"} 0.000000000\n") != NULL);
+    assert(strstr(body, "tracker_stage_messages{stage=\"parser\"} 10\n") != NULL);
+    assert(strstr(body, "tracker_resident_memory_bytes 2048000\n") != NULL);
+    assert(strstr(body, "tracker_resident_memory_peak_bytes 3072000\n") != NULL);
+    assert(strstr(body, "tracker_stage_hardware_events_per_snapshot{stage=\"reader\",event=\"instructions\"} 123456\n") != NULL);
+    assert(strstr(body, "event=\"cycles\"") == NULL);
+
+    free(response);
+    free(snapshot);
+    metrics_endpoint_delete(endpoint);
+}
+
+static void queues_test() {
+    MetricsEndpoint* endpoint = metrics_endpoint_new(socket_path);
+    CircularBuffer* buffer = circular_buffer_new(4, sizeof(char));
+    PCPGuard guard = PCP_GUARD_INITIALIZER;
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    char* response = malloc(response_size);
+    assert(endpoint != NULL && buffer != NULL && snapshot != NULL && response != NULL);
+
+    for (size_t i = 0; i < METRICS_ENDPOINT_MAX_QUEUES; i++) {
+        assert(metrics_endpoint_add_queue(endpoint, "char", buffer, &guard));
+    }
+    assert(!metrics_endpoint_add_queue(endpoint, "char", buffer, &guard));
+    const char element = 'x';
+    circular_buffer_insert_single(buffer, &element);
+    fill_snapshot(snapshot, 1);
+    assert(metrics_endpoint_publish(endpoint, snapshot, NULL));
+
+    scrape("GET /metrics HTTP/1.1\r\n\r\n", response);
+    const char* body = body_of(response);
+    CircularBufferStats stats;
+    if (circular_buffer_stats(buffer, &stats)) {
+        assert(strstr(body, "tracker_queue_capacity{queue=\"char\"} 4\n") != NULL);
+        assert(strstr(body, "tracker_queue_inserts_total{queue=\"char\"} 1\n") != NULL);
+        assert(strstr(body, "tracker_queue_wait_seconds_total{queue=\"char\",side=\"producer\"}") != NULL);
+    } else {
+        assert(strstr(body, "tracker_queue_") == NULL);
+    }
+
+    free(response);
+    free(snapshot);
+    circular_buffer_delete(buffer);
+    metrics_endpoint_delete(endpoint);
+}
+
+static void latency_test() {
+    MetricsEndpoint* endpoint = metrics_endpoint_new(socket_path);
+    SnapshotLatency* latency = snapshot_latency_new(10);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    char* response = malloc(response_size);
+    assert(endpoint != NULL && latency != NULL && snapshot != NULL && response != NULL);
+
+    metrics_endpoint_set_latency(endpoint, latency);
+    fill_snapshot(snapshot, 1);
+    snapshot->capture_ns = 1000;
+    snapshot->parsed_ns = 1000 + 40;
+    snapshot_latency_record(latency, snapshot, 1000 + 50);
+    assert(metrics_endpoint_publish(endpoint, snapshot, NULL));
+
+    scrape("GET /metrics HTTP/1.1\r\n\r\n", response);
+    const char* body = body_of(response);
+    assert(strstr(body, "# TYPE tracker_snapshot_age_seconds summary\n") != NULL);
+    assert(strstr(body, "tracker_snapshot_age_seconds{point=\"parse\",quantile=\"0.5\"} 0.000000040\n") != NULL);
+    assert(strstr(body, "tracker_snapshot_age_seconds{point=\"output\",quantile=\"0.999\"} 0.000000050\n") != NULL);
+    assert(strstr(body, "tracker_snapshot_age_seconds_sum{point=\"output\"} 0.000000050\n") != NULL);
+    assert(strstr(body, "tracker_snapshot_age_seconds_count{point=\"parse\"} 1\n") != NULL);
+
+    free(response);
+    free(snapshot);
+    snapshot_latency_delete(latency);
+    metrics_endpoint_delete(endpoint);
+}
+
+static void* scraper(void* const args) {
+    char* response = malloc(response_size);
+    size_t* consistent_scrapes = args;
+    assert(response != NULL);
+
+    do {
+        const size_t length = scrape("GET /metrics HTTP/1.1\r\n\r\n", response);
+        const char* body = body_of(response);
+        size_t content_length = 0;
+        assert(sscanf(strstr(response, "Content-Length: "), "Content-Length: %zu", &content_length) == 1);
+        assert(content_length == length - (size_t) (body - response));
+
+        /*Every page is rendered from single snapshot, sequence and usage of core 2 match*/
+        uint64_t sequence = 0;
+        double usage = 0.0;
+        assert(sscanf(strstr(body, "\ntracker_snapshot_sequence "), "\ntracker_snapshot_sequence %" SCNu64, &sequence) == 1);
+        assert(sscanf(strstr(body, "{cpu=\"2\"} "), "{cpu=\"2\"} %lf", &usage) == 1);
+        assert(usage == (double) (sequence % 100));
+        (*consistent_scrapes)++;
+    } while (!atomic_load(&publisher_done));
+    free(response);
+    return NULL;
+}
+
+static void concurrent_scrape_test() {
+    MetricsEndpoint* endpoint = metrics_endpoint_new(socket_path);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    pthread_t thread;
+    size_t consistent_scrapes = 0;
+    assert(endpoint != NULL && snapshot != NULL);
+
+    for (uint64_t sequence = 0; sequence < number_of_publications; sequence++) {
+        fill_snapshot(snapshot, sequence);
+        snapshot->core_usage[1] = (double) (sequence % 100);
+        assert(metrics_endpoint_publish(endpoint, snapshot, NULL));
+        if (sequence == 0) {
+            atomic_store(&publisher_done, false);
+            assert(pthread_create(&thread, NULL, scraper, &consistent_scrapes) == 0);
+        }
+    }
+    atomic_store(&publisher_done, true);
+    pthread_join(thread, NULL);
+    assert(consistent_scrapes > 0);
+
+    free(snapshot);
+    metrics_endpoint_delete(endpoint);
+}
+
+int main() {
+    snprintf(socket_path, sizeof(socket_path), "/tmp/metrics_endpoint_%d.sock", (int) getpid());
+    new_delete_test();
+    not_found_test();
+    unavailable_test();
+    publish_test();
+    overhead_test();
+    queues_test();
+    latency_test();
+    concurrent_scrape_test();
+    return 0;
+}
@@ -19,6 +19,7 @@ static void notify_consumer(void);
 static void wait_for_producer(void);
 static void wait_for_consumer(void);
 static void timed_wait(void);
+static void stats(void);
 
 static void* consumer_wait(void* args);
 static void* producer_wait(void* args);
@@ -155,6 +156,50 @@ static void timed_wait() {
     pcp_guard_timed_wait_for_producer(&guard, &time_temp);
 }
 
+static void stats() {
+    PCPGuard guard;
+    PCPGuardStats guard_stats;
+    pcp_guard_init(&guard);
+    bool var = true;
+    TestArgs args = {.guard = &guard, .var = &var};
+    pthread_t consumer;
+
+    /*Producer waits for consumer_wait that clears var and waits for producer*/
+    pcp_guard_lock(&guard);
+    if (pthread_create(&consumer, NULL, consumer_wait, &args) != 0) {
+        perror("Warning: thread creation failed\n");
+        pcp_guard_unlock(&guard);
+        return;
+    }
+    while (var) {
+        pcp_guard_wait_for_consumer(&guard);
+    }
+    pcp_guard_notify_consumer(&guard);
+    pcp_guard_unlock(&guard);
+    pthread_join(consumer, NULL);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pcp_guard_lock(&guard);
+    pcp_guard_timed_wait_for_producer(&guard, &deadline);
+    pcp_guard_unlock(&guard);
+
+#ifdef PIPELINE_STATS
+    assert(pcp_guard_stats(&guard, &guard_stats));
+    assert(guard_stats.producer_waits >= 1);
+    assert(guard_stats.consumer_waits == 2 && guard_stats.consumer_wait_ns >= 500000);
+#else
+    assert(!pcp_guard_stats(&guard, &guard_stats));
+    assert(guard_stats.producer_waits == 0 && guard_stats.consumer_wait_ns == 0);
+#endif
+    pcp_guard_destroy(&guard);
+}
+
 int main() {
     lock();
     notify_producer();
@@ -162,4 +207,5 @@ int main() {
     wait_for_producer();
     wait_for_consumer();
     timed_wait();
+    stats();
 }
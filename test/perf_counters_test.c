@@ -0,0 +1,119 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "perf_counters.h"
+
+static void open_close_test(void);
+static void read_test(void);
+static void thread_test(void);
+static void counter_to_str_test(void);
+
+static void* count_in_thread(void* args);
+
+/**
+ * @brief Busy loop with known number of iterations
+ */
+static void spin(void);
+
+static void spin() {
+    volatile uint64_t sink = 0;
+    for (uint64_t i = 0; i < 10000000; i++) {
+        sink += i;
+    }
+}
+
+static void open_close_test() {
+    PerfCounters* counters = perf_counters_open();
+    /*Containers and VMs commonly deny perf_event_open, that is not a failure*/
+    if (counters == NULL) {
+        fprintf(stderr, "perf_event_open unavailable, counting is not tested\n");
+        return;
+    }
+    const uint32_t available = perf_counters_available(counters);
+    assert(available != 0 && available < (UINT32_C(1) << PERF_COUNTER_COUNT));
+    perf_counters_close(counters);
+    perf_counters_close(NULL);
+}
+
+static void read_test() {
+    PerfCounters* counters = perf_counters_open();
+    if (counters == NULL) {
+        return;
+    }
+    const uint32_t available = perf_counters_available(counters);
+    uint64_t before[PERF_COUNTER_COUNT];
+    uint64_t after[PERF_COUNTER_COUNT];
+    assert(perf_counters_read(counters, before));
+    spin();
+    assert(perf_counters_read(counters, after));
+
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if ((available & (UINT32_C(1) << i)) == 0) {
+            assert(before[i] == 0 && after[i] == 0);
+        } else {
+            assert(after[i] >= before[i]);
+        }
+    }
+    /*The loop has at least one instruction per iteration*/
+    if ((available & (UINT32_C(1) << PERF_COUNTER_INSTRUCTIONS)) != 0) {
+        assert(after[PERF_COUNTER_INSTRUCTIONS] - before[PERF_COUNTER_INSTRUCTIONS] >= 10000000);
+    }
+    if ((available & (UINT32_C(1) << PERF_COUNTER_CYCLES)) != 0) {
+        assert(after[PERF_COUNTER_CYCLES] > before[PERF_COUNTER_CYCLES]);
+    }
+    perf_counters_close(counters);
+}
+
+static void* count_in_thread(void* args) {
+    uint64_t* instructions = args;
+    PerfCounters* counters = perf_counters_open();
+    if (counters == NULL) {
+        return NULL;
+    }
+    uint64_t values[PERF_COUNTER_COUNT];
+    spin();
+    assert(perf_counters_read(counters, values));
+    *instructions = values[PERF_COUNTER_INSTRUCTIONS];
+    perf_counters_close(counters);
+    return NULL;
+}
+
+static void thread_test() {
+    PerfCounters* counters = perf_counters_open();
+    if (counters == NULL) {
+        return;
+    }
+    if ((perf_counters_available(counters) & (UINT32_C(1) << PERF_COUNTER_INSTRUCTIONS)) == 0) {
+        perf_counters_close(counters);
+        return;
+    }
+    uint64_t before[PERF_COUNTER_COUNT];
+    uint64_t after[PERF_COUNTER_COUNT];
+    uint64_t thread_instructions = 0;
+    pthread_t thread;
+
+    /*Work of another thread is not counted*/
+    assert(perf_counters_read(counters, before));
+    assert(pthread_create(&thread, NULL, count_in_thread, &thread_instructions) == 0);
+    pthread_join(thread, NULL);
+    assert(perf_counters_read(counters, after));
+    assert(thread_instructions >= 10000000);
+    assert(after[PERF_COUNTER_INSTRUCTIONS] - before[PERF_COUNTER_INSTRUCTIONS] < thread_instructions);
+    perf_counters_close(counters);
+}
+
+static void counter_to_str_test() {
+    assert(strcmp(perf_counter_to_str(PERF_COUNTER_CYCLES), "cycles") == 0);
+    assert(strcmp(perf_counter_to_str(PERF_COUNTER_CACHE_MISSES), "cache-misses") == 0);
+    assert(strcmp(perf_counter_to_str(PERF_COUNTER_BRANCH_MISSES), "branch-misses") == 0);
+    assert(strcmp(perf_counter_to_str(PERF_COUNTER_COUNT), "unknown") == 0);
+}
+
+int main() {
+    open_close_test();
+    read_test();
+    thread_test();
+    counter_to_str_test();
+    return 0;
+}
@@ -0,0 +1,136 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include "placement.h"
+#include "fake_tree.h"
+
+static void none_test(void);
+static void housekeeping_test(void);
+static void siblings_test(void);
+static void no_smt_test(void);
+static void apply_test(void);
+
+static char root[64];
+
+static void none_test() {
+    Placement* placement = placement_new("none", NULL);
+    assert(placement != NULL);
+    assert(placement_policy(placement) == PLACEMENT_POLICY_NONE);
+    assert(placement_stage_has_cpu(placement, PLACEMENT_STAGE_READER, 123));
+    placement_delete(placement);
+    placement_delete(NULL);
+
+    assert(placement_new("none:1", NULL) == NULL);
+    assert(placement_new("", NULL) == NULL);
+    assert(placement_new("anywhere", NULL) == NULL);
+}
+
+static void housekeeping_test() {
+    Placement* placement = placement_new("housekeeping:0-1,6", NULL);
+    assert(placement != NULL);
+    assert(placement_policy(placement) == PLACEMENT_POLICY_HOUSEKEEPING);
+    for (size_t stage = 0; stage < PLACEMENT_STAGE_COUNT; stage++) {
+        assert(placement_stage_has_cpu(placement, (EPlacementStage) stage, 0));
+        assert(placement_stage_has_cpu(placement, (EPlacementStage) stage, 1));
+        assert(!placement_stage_has_cpu(placement, (EPlacementStage) stage, 2));
+        assert(placement_stage_has_cpu(placement, (EPlacementStage) stage, 6));
+    }
+    placement_delete(placement);
+
+    assert(placement_new("housekeeping", NULL) == NULL);
+    assert(placement_new("housekeeping:", NULL) == NULL);
+    assert(placement_new("housekeeping:3-1", NULL) == NULL);
+    assert(placement_new("housekeeping:x", NULL) == NULL);
+}
+
+static void siblings_test() {
+    /*2 cores with 2 threads, siblings are n and n + 2*/
+    fake_tree_cpu_write(root, 0, 0, 0, "0,2");
+    fake_tree_cpu_write(root, 1, 0, 1, "1,3");
+    fake_tree_cpu_write(root, 2, 0, 0, "0,2");
+    fake_tree_cpu_write(root, 3, 0, 1, "1,3");
+    Topology* topology = topology_new(root);
+    assert(topology != NULL);
+
+    /*Topology is required*/
+    assert(placement_new("siblings", NULL) == NULL);
+
+    Placement* placement = placement_new("siblings:1", topology);
+    assert(placement != NULL);
+    assert(placement_policy(placement) == PLACEMENT_POLICY_SIBLINGS);
+    assert(placement_stage_has_cpu(placement, PLACEMENT_STAGE_READER, 1));
+    assert(!placement_stage_has_cpu(placement, PLACEMENT_STAGE_READER, 3));
+    assert(placement_stage_has_cpu(placement, PLACEMENT_STAGE_PARSER, 3));
+    assert(!placement_stage_has_cpu(placement, PLACEMENT_STAGE_PARSER, 1));
+    assert(placement_stage_has_cpu(placement, PLACEMENT_STAGE_PRINTER, 1));
+    assert(placement_stage_has_cpu(placement, PLACEMENT_STAGE_PRINTER, 3));
+    assert(!placement_stage_has_cpu(placement, PLACEMENT_STAGE_LOGGER, 0));
+    placement_delete(placement);
+
+    /*Default cpu is 0*/
+    placement = placement_new("siblings", topology);
+    assert(placement != NULL);
+    assert(placement_stage_has_cpu(placement, PLACEMENT_STAGE_READER, 0));
+    assert(placement_stage_has_cpu(placement, PLACEMENT_STAGE_PARSER, 2));
+    placement_delete(placement);
+
+    assert(placement_new("siblings:9", topology) == NULL);
+    assert(placement_new("siblings:1x", topology) == NULL);
+    topology_delete(topology);
+}
+
+static void no_smt_test() {
+    fake_tree_remove(root);
+    fake_tree_cpu_write(root, 0, 0, 0, "0");
+    fake_tree_cpu_write(root, 1, 0, 1, "1");
+    Topology* topology = topology_new(root);
+    assert(topology != NULL);
+
+    /*Without sibling reader and parser share the cpu*/
+    Placement* placement = placement_new("siblings:1", topology);
+    assert(placement != NULL);
+    assert(placement_stage_has_cpu(placement, PLACEMENT_STAGE_READER, 1));
+    assert(placement_stage_has_cpu(placement, PLACEMENT_STAGE_PARSER, 1));
+    assert(!placement_stage_has_cpu(placement, PLACEMENT_STAGE_PARSER, 0));
+    placement_delete(placement);
+    topology_delete(topology);
+}
+
+static void apply_test() {
+    /*Pin to a cpu the test is allowed to run on*/
+    cpu_set_t allowed;
+    assert(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+    size_t cpu = 0;
+    while (!CPU_ISSET(cpu, &allowed)) {
+        cpu++;
+    }
+    char spec[64];
+    snprintf(spec, sizeof(spec), "housekeeping:%zu", cpu);
+    Placement* placement = placement_new(spec, NULL);
+    assert(placement != NULL);
+    assert(placement_apply(placement, PLACEMENT_STAGE_PRINTER, pthread_self()));
+
+    cpu_set_t current;
+    assert(pthread_getaffinity_np(pthread_self(), sizeof(current), &current) == 0);
+    assert(CPU_COUNT(&current) == 1 && CPU_ISSET(cpu, &current));
+    placement_delete(placement);
+
+    placement = placement_new("none", NULL);
+    assert(placement_apply(placement, PLACEMENT_STAGE_PRINTER, pthread_self()));
+    placement_delete(placement);
+}
+
+int main() {
+    snprintf(root, sizeof(root), "/tmp/placement_test_%ld", (long) getpid());
+
+    none_test();
+    housekeeping_test();
+    siblings_test();
+    no_smt_test();
+    apply_test();
+    fake_tree_remove(root);
+    return 0;
+}
@@ -1,11 +1,16 @@
 #include <tgmath.h>
 #include <stdio.h>
+#include <string.h>
 #include "proc_parser.h"
 #include "assert.h"
 
 static void parse_line_test(void);
 static void compute_core_time_test(void);
 static void compute_core_usage_with_time(void);
+static void cpu_number_test(void);
+static void count_cores_test(void);
+static void counters_monotonic_test(void);
+static void compute_usage_reset_test(void);
 
 static void parse_line_test() {
 
@@ -89,12 +94,74 @@ static void compute_core_usage_with_time() {
     assert(fabs(expected_result - computed_result) < 0.1);
 }
 
+static void cpu_number_test() {
+    assert(proc_parser_cpu_number("cpu0 1 2 3") == 0);
+    assert(proc_parser_cpu_number("cpu127 1 2 3") == 127);
+    assert(proc_parser_cpu_number("cpu  1 2 3") == -1);
+    assert(proc_parser_cpu_number("intr 1 2 3") == -1);
+}
+
+static void count_cores_test() {
+    const char stat[] = "cpu  10 0 10 100 0 0 0 0 0 0\ncpu0 1 0 1 10 0 0 0 0 0 0\ncpu1 1 0 1 10 0 0 0 0 0 0\n"
+                        "intr 5 1 2\nctxt 100\n";
+    assert(proc_parser_count_cores(stat, strlen(stat)) == 2);
+    /*Offline cpu2 is missing, it is counted below cpu63*/
+    const char sparse[] = "cpu  10 0 10 100 0 0 0 0 0 0\ncpu0 1 0 1 10 0 0 0 0 0 0\ncpu63 1 0 1 10 0 0 0 0 0 0";
+    assert(proc_parser_count_cores(sparse, strlen(sparse)) == 64);
+    /*Number is not read past the length*/
+    assert(proc_parser_count_cores(sparse, strlen(sparse) - strlen("3 1 0 1 10 0 0 0 0 0 0")) == 7);
+    assert(proc_parser_count_cores("cpu  1 2 3\nintr 1", strlen("cpu  1 2 3\nintr 1")) == 0);
+    assert(proc_parser_count_cores("", 0) == 0);
+}
+
+static void counters_monotonic_test() {
+    const uint64_t previous[10] = {100, 0, 50, 1000, 10, 0, 5, 0, 0, 0};
+    uint64_t current[10] = {110, 0, 55, 1100, 10, 0, 5, 0, 0, 0};
+
+    assert(proc_parser_counters_monotonic(previous, previous));
+    assert(proc_parser_counters_monotonic(previous, current));
+    /*Every field is checked, even one that is not part of total*/
+    for (size_t i = 0; i < 10; i++) {
+        uint64_t reset[10];
+        for (size_t j = 0; j < 10; j++) {
+            reset[j] = current[j] + 1000;
+        }
+        reset[i] = previous[i] == 0 ? 0 : previous[i] - 1;
+        assert(proc_parser_counters_monotonic(previous, reset) == (previous[i] == 0));
+    }
+    /*Wraparound of 32-bit field*/
+    const uint64_t before_wrap[10] = {UINT32_MAX - 5, 0, 50, 1000, 10, 0, 5, 0, 0, 0};
+    current[0] = 3;
+    assert(!proc_parser_counters_monotonic(before_wrap, current));
+}
+
+static void compute_usage_reset_test() {
+    const ProcParserCpuTime previous = {.idle = 1000, .total = 2000};
+
+    /*Counters went backwards, unsigned delta would be huge*/
+    const ProcParserCpuTime reset = {.idle = 10, .total = 20};
+    assert(isnan(proc_parser_cpu_time_compute_usage(&previous, &reset)));
+    /*Idle went backwards while total grew*/
+    const ProcParserCpuTime idle_reset = {.idle = 900, .total = 2100};
+    assert(isnan(proc_parser_cpu_time_compute_usage(&previous, &idle_reset)));
+    /*No time elapsed*/
+    assert(isnan(proc_parser_cpu_time_compute_usage(&previous, &previous)));
+    /*Idle grew more than total, usage is not negative*/
+    const ProcParserCpuTime idle_only = {.idle = 1200, .total = 2100};
+    assert(proc_parser_cpu_time_compute_usage(&previous, &idle_only) == 0.0);
+    const ProcParserCpuTime busy = {.idle = 1000, .total = 2100};
+    assert(proc_parser_cpu_time_compute_usage(&previous, &busy) == 1.0);
+}
 
 int main() {
 
     parse_line_test();
     compute_core_usage_with_time();
     compute_core_time_test();
+    cpu_number_test();
+    count_cores_test();
+    counters_monotonic_test();
+    compute_usage_reset_test();
 
     return 0;
 }
@@ -0,0 +1,88 @@
+#include <tgmath.h>
+#include <string.h>
+#include "psi_parser.h"
+#include "assert.h"
+
+static void parse_line_test(void);
+static void stall_delta_test(void);
+static void resource_to_str_test(void);
+
+static void parse_line_test() {
+
+    {
+        const char line[] = "psi cpu some avg10=1.25 avg60=0.50 avg300=0.05 total=2956553";
+        PsiParserLine result;
+
+        assert(psi_parser_parse_line(line, &result) == PSI_PARSER_SUCCESS);
+        assert(result.resource == PSI_RESOURCE_CPU);
+        assert(result.kind == PSI_KIND_SOME);
+        assert(fabs(result.avg10 - 1.25) < 0.001);
+        assert(fabs(result.avg60 - 0.5) < 0.001);
+        assert(fabs(result.avg300 - 0.05) < 0.001);
+        assert(result.total == 2956553);
+    }
+
+    {
+        const char line[] = "psi memory full avg10=100.00 avg60=0.00 avg300=0.00 total=18446744073709551615";
+        PsiParserLine result;
+
+        assert(psi_parser_parse_line(line, &result) == PSI_PARSER_SUCCESS);
+        assert(result.resource == PSI_RESOURCE_MEMORY);
+        assert(result.kind == PSI_KIND_FULL);
+        assert(fabs(result.avg10 - 100.0) < 0.001);
+        assert(result.total == UINT64_MAX);
+    }
+
+    {
+        const char line[] = "psi io some avg10=0.00 avg60=0.00";
+        PsiParserLine result = {.total = 5};
+
+        assert(psi_parser_parse_line(line, &result) == PSI_PARSER_FAIL);
+        /*result shall not be altered on failure*/
+        assert(result.total == 5);
+    }
+
+    {
+        const char line[] = "psi disk some avg10=0.00 avg60=0.00 avg300=0.00 total=0";
+        PsiParserLine result;
+
+        assert(psi_parser_parse_line(line, &result) == PSI_PARSER_FAIL);
+    }
+
+    {
+        const char line[] = "psi cpu half avg10=0.00 avg60=0.00 avg300=0.00 total=0";
+        PsiParserLine result;
+
+        assert(psi_parser_parse_line(line, &result) == PSI_PARSER_FAIL);
+    }
+
+    {
+        const char line[] = "cpu0 123 123 0 213 123 1 48 9 10";
+        PsiParserLine result;
+
+        assert(psi_parser_parse_line(line, &result) == PSI_PARSER_DISCARD_LINE);
+    }
+}
+
+static void stall_delta_test() {
+    assert(psi_parser_stall_delta(100, 350) == 250);
+    assert(psi_parser_stall_delta(350, 350) == 0);
+    /*Counter going backwards shall not produce huge stall*/
+    assert(psi_parser_stall_delta(350, 100) == 0);
+}
+
+static void resource_to_str_test() {
+    assert(strcmp(psi_parser_resource_to_str(PSI_RESOURCE_CPU), "cpu") == 0);
+    assert(strcmp(psi_parser_resource_to_str(PSI_RESOURCE_IO), "io") == 0);
+    assert(strcmp(psi_parser_resource_to_str(PSI_RESOURCE_MEMORY), "memory") == 0);
+    assert(psi_parser_resource_to_str(PSI_RESOURCE_COUNT) == NULL);
+}
+
+int main() {
+
+    parse_line_test();
+    stall_delta_test();
+    resource_to_str_test();
+
+    return 0;
+}
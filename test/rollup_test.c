@@ -0,0 +1,188 @@
+#include <assert.h>
+#include <tgmath.h>
+#include "rollup.h"
+
+static void snapshot_set(Snapshot* snapshot, uint64_t seconds, double usage0, double usage1);
+static void new_test(void);
+static void window_test(void);
+static void alignment_test(void);
+static void tiers_test(void);
+static void clock_backwards_test(void);
+static void missing_core_test(void);
+static void weighted_test(void);
+
+static Snapshot snapshot;
+
+static void snapshot_set(Snapshot* const s, const uint64_t seconds, const double usage0, const double usage1) {
+    s->timestamp.tv_sec = (time_t) seconds;
+    s->timestamp.tv_nsec = 0;
+    s->number_of_cores = 2;
+    s->core_usage[0] = usage0;
+    s->core_usage[1] = usage1;
+}
+
+static void new_test() {
+    assert(rollup_new(0) == NULL);
+    Rollup* rollup = rollup_new(4);
+    assert(rollup != NULL);
+    for (size_t i = 0; i < ROLLUP_TIER_COUNT; i++) {
+        assert(rollup_completed(rollup, (ERollupTier) i) == NULL);
+    }
+    rollup_delete(rollup);
+    rollup_delete(NULL);
+}
+
+static void window_test() {
+    Rollup* rollup = rollup_new(2);
+
+    /*Window [1000, 1010) receives usages 1..10 on core 0 and constant 50 on core 1*/
+    for (uint64_t i = 0; i < 10; i++) {
+        snapshot_set(&snapshot, 1000 + i, (double) (i + 1) * 10.0, 50.0);
+        assert(!rollup_add(rollup, &snapshot));
+    }
+    snapshot_set(&snapshot, 1010, 0.0, 0.0);
+    assert(rollup_add(rollup, &snapshot));
+
+    const RollupWindow* window = rollup_completed(rollup, ROLLUP_TIER_10S);
+    assert(window != NULL);
+    assert(window->tier == ROLLUP_TIER_10S);
+    assert(window->start_ns == 1000ull * 1000000000u);
+    assert(window->number_of_samples == 10);
+    assert(window->number_of_cores == 2);
+    assert(window->cores[0].min == 10.0);
+    assert(window->cores[0].max == 100.0);
+    assert(fabs(window->cores[0].avg - 55.0) < 1e-9);
+    assert(window->cores[0].p95 >= 90.0 && window->cores[0].p95 <= 100.0);
+    assert(window->cores[1].min == 50.0);
+    assert(window->cores[1].max == 50.0);
+    assert(window->cores[1].avg == 50.0);
+    assert(window->cores[1].p95 == 50.0);
+    /*Statistics are stored core-major, as in rollup history files*/
+    assert(((const double*) window->cores)[ROLLUP_STATISTICS_COUNT + 2] == 50.0);
+
+    /*Minute window [960, 1020) is still open*/
+    assert(rollup_completed(rollup, ROLLUP_TIER_1MIN) == NULL);
+    rollup_delete(rollup);
+}
+
+static void alignment_test() {
+    Rollup* rollup = rollup_new(2);
+
+    /*First sample in the middle of a window does not start a new grid*/
+    snapshot_set(&snapshot, 1005, 1.0, 1.0);
+    rollup_add(rollup, &snapshot);
+    snapshot_set(&snapshot, 1009, 2.0, 2.0);
+    assert(!rollup_add(rollup, &snapshot));
+    snapshot_set(&snapshot, 1025, 3.0, 3.0);
+    assert(rollup_add(rollup, &snapshot));
+
+    const RollupWindow* window = rollup_completed(rollup, ROLLUP_TIER_10S);
+    assert(window->start_ns == 1000ull * 1000000000u);
+    assert(window->number_of_samples == 2);
+
+    /*Gap skips window [1010, 1020), next one starts at 1020*/
+    snapshot_set(&snapshot, 1030, 4.0, 4.0);
+    assert(rollup_add(rollup, &snapshot));
+    window = rollup_completed(rollup, ROLLUP_TIER_10S);
+    assert(window->start_ns == 1020ull * 1000000000u);
+    assert(window->number_of_samples == 1);
+    assert(window->cores[0].avg == 3.0);
+    rollup_delete(rollup);
+}
+
+static void tiers_test() {
+    Rollup* rollup = rollup_new(2);
+    size_t completed[ROLLUP_TIER_COUNT] = {0};
+
+    /*Two hours of samples every second starting at 00:00:00*/
+    for (uint64_t t = 0; t <= 7200; t++) {
+        snapshot_set(&snapshot, 3600 * 24 + t, (double) (t % 100), 25.0);
+        if (!rollup_add(rollup, &snapshot)) {
+            continue;
+        }
+        for (size_t i = 0; i < ROLLUP_TIER_COUNT; i++) {
+            const RollupWindow* window = rollup_completed(rollup, (ERollupTier) i);
+            if (window != NULL) {
+                assert(window->start_ns % rollup_tier_length_ns((ERollupTier) i) == 0);
+                assert(window->number_of_samples * 1000000000u == rollup_tier_length_ns((ERollupTier) i));
+                assert(window->cores[1].avg == 25.0);
+                completed[i]++;
+            }
+        }
+    }
+    assert(completed[ROLLUP_TIER_10S] == 720);
+    assert(completed[ROLLUP_TIER_1MIN] == 120);
+    assert(completed[ROLLUP_TIER_1H] == 2);
+    rollup_delete(rollup);
+}
+
+static void clock_backwards_test() {
+    Rollup* rollup = rollup_new(2);
+
+    snapshot_set(&snapshot, 1015, 10.0, 10.0);
+    rollup_add(rollup, &snapshot);
+    snapshot_set(&snapshot, 1003, 20.0, 20.0);
+    assert(!rollup_add(rollup, &snapshot));
+    snapshot_set(&snapshot, 1020, 0.0, 0.0);
+    assert(rollup_add(rollup, &snapshot));
+
+    const RollupWindow* window = rollup_completed(rollup, ROLLUP_TIER_10S);
+    assert(window->start_ns == 1010ull * 1000000000u);
+    assert(window->number_of_samples == 2);
+    assert(window->cores[0].max == 20.0);
+    rollup_delete(rollup);
+}
+
+static void missing_core_test() {
+    Rollup* rollup = rollup_new(3);
+
+    snapshot_set(&snapshot, 1000, NAN, 30.0);
+    rollup_add(rollup, &snapshot);
+    snapshot_set(&snapshot, 1010, 0.0, 0.0);
+    assert(rollup_add(rollup, &snapshot));
+
+    const RollupWindow* window = rollup_completed(rollup, ROLLUP_TIER_10S);
+    assert(window->number_of_cores == 3);
+    assert(isnan(window->cores[0].avg));
+    assert(window->cores[1].avg == 30.0);
+    /*Core not present in snapshots*/
+    assert(isnan(window->cores[2].min) && isnan(window->cores[2].p95));
+    rollup_delete(rollup);
+}
+
+static void weighted_test() {
+    Rollup* rollup = rollup_new(2);
+
+    /*Core 0 is busy during 9 snapshots 100 ms apart and idle during a single 8.1 s one*/
+    for (uint64_t i = 0; i < 9; i++) {
+        snapshot_set(&snapshot, 2000, 100.0, 50.0);
+        snapshot.interval_ns = 100000000u;
+        assert(!rollup_add(rollup, &snapshot));
+    }
+    snapshot_set(&snapshot, 2009, 0.0, 50.0);
+    snapshot.interval_ns = 8100000000u;
+    assert(!rollup_add(rollup, &snapshot));
+    snapshot_set(&snapshot, 2010, 0.0, 0.0);
+    snapshot.interval_ns = 0;
+    assert(rollup_add(rollup, &snapshot));
+
+    const RollupWindow* window = rollup_completed(rollup, ROLLUP_TIER_10S);
+    assert(window != NULL && window->number_of_samples == 10);
+    /*Average is the share of time, not of samples*/
+    assert(fabs(window->cores[0].avg - 10.0) < 1e-9);
+    assert(fabs(window->cores[1].avg - 50.0) < 1e-9);
+    assert(window->cores[0].min == 0.0 && window->cores[0].max == 100.0);
+    rollup_delete(rollup);
+}
+
+int main() {
+    assert(rollup_tier_length_ns(ROLLUP_TIER_1MIN) == 60ull * 1000000000u);
+    new_test();
+    window_test();
+    alignment_test();
+    tiers_test();
+    clock_backwards_test();
+    missing_core_test();
+    weighted_test();
+    return 0;
+}
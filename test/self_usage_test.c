@@ -0,0 +1,113 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "self_usage.h"
+#include "fake_tree.h"
+
+static void thread_write(unsigned long tid, uint64_t utime, uint64_t stime, size_t cpu);
+static void parse_stat_test(void);
+static void missing_root_test(void);
+static void update_test(void);
+static void real_proc_test(void);
+
+static char root[64];
+
+/**
+ * @brief Write stat of fake thread below root/self/task, with spaces and parentheses in the name
+ */
+static void thread_write(const unsigned long tid, const uint64_t utime, const uint64_t stime, const size_t cpu) {
+    char path[64];
+    char content[256];
+    snprintf(path, sizeof(path), "self/task/%lu/stat", tid);
+    snprintf(content, sizeof(content), "%lu (a (b) c) S 1 2 3 0 -1 4194560 100 0 0 0 %" PRIu64 " %" PRIu64 " 0 0 20 0 5 0 123 1000 200"
+             " 0 0 0 0 0 0 0 0 0 0 0 0 0 17 %zu 0 0 0 0 0\n", tid, utime, stime, cpu);
+    fake_tree_write(root, path, content);
+}
+
+static void parse_stat_test() {
+    uint64_t ticks = 0;
+    size_t cpu = 0;
+    const char line[] = "42 (tracker) R 1 42 42 0 -1 4194304 10 0 0 0 7 3 0 0 20 0 5 0 100 1000 300"
+                        " 0 0 0 0 0 0 0 0 0 0 0 0 0 17 5 0 0 0 0 0\n";
+    assert(self_usage_parse_stat(line, &ticks, &cpu));
+    assert(ticks == 10 && cpu == 5);
+
+    assert(!self_usage_parse_stat("42 tracker R 1", &ticks, &cpu));
+    assert(!self_usage_parse_stat("42 (tracker) R 1 2 3", &ticks, &cpu));
+    assert(!self_usage_parse_stat("", &ticks, &cpu));
+}
+
+static void missing_root_test() {
+    SelfUsage* self_usage = self_usage_new("/nonexistent/proc");
+    assert(self_usage != NULL);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    assert(snapshot != NULL);
+    assert(!self_usage_update(self_usage, snapshot));
+    free(snapshot);
+    self_usage_delete(self_usage);
+    self_usage_delete(NULL);
+}
+
+static void update_test() {
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    assert(snapshot != NULL);
+    /*Positions 0 and 1 are cpus 2 and 5*/
+    snapshot->number_of_cores = 2;
+    snapshot->core_cpu[0] = 2;
+    snapshot->core_cpu[1] = 5;
+    snapshot->core_time[0].total = 1000;
+    snapshot->core_time[1].total = 1000;
+    thread_write(10, 500, 100, 2);
+    thread_write(11, 50, 0, 5);
+
+    SelfUsage* self_usage = self_usage_new(root);
+    assert(self_usage != NULL);
+    assert(self_usage_update(self_usage, snapshot));
+    /*Nothing to compare with yet*/
+    assert(isnan(self_usage_get(self_usage, 0)));
+
+    /*Thread 10 used 10 of 100 ticks of cpu 2, thread 11 migrated to cpu 2 as well, new thread 12 ran on cpu 5*/
+    snapshot->core_time[0].total = 1100;
+    snapshot->core_time[1].total = 1200;
+    thread_write(10, 508, 102, 2);
+    thread_write(11, 55, 0, 2);
+    thread_write(12, 4, 6, 5);
+    assert(self_usage_update(self_usage, snapshot));
+    assert(fabs(self_usage_get(self_usage, 0) - 15.0) < 1e-9);
+    assert(fabs(self_usage_get(self_usage, 1) - 5.0) < 1e-9);
+    assert(isnan(self_usage_get(self_usage, 2)));
+
+    /*Core disappears from snapshot*/
+    snapshot->number_of_cores = 1;
+    snapshot->core_time[0].total = 1200;
+    assert(self_usage_update(self_usage, snapshot));
+    assert(self_usage_get(self_usage, 0) == 0.0);
+    assert(isnan(self_usage_get(self_usage, 1)));
+
+    self_usage_delete(self_usage);
+    free(snapshot);
+}
+
+static void real_proc_test() {
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    assert(snapshot != NULL);
+    SelfUsage* self_usage = self_usage_new("/proc");
+    assert(self_usage != NULL);
+    assert(self_usage_update(self_usage, snapshot));
+    self_usage_delete(self_usage);
+    free(snapshot);
+}
+
+int main() {
+    snprintf(root, sizeof(root), "/tmp/self_usage_test_%ld", (long) getpid());
+
+    parse_stat_test();
+    missing_root_test();
+    update_test();
+    real_proc_test();
+    fake_tree_remove(root);
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "snapshot_latency.h"
+
+static void new_delete_test(void);
+static void record_test(void);
+static void interval_test(void);
+static void format_test(void);
+static void line_test(void);
+
+static Snapshot snapshot;
+
+static void new_delete_test() {
+    assert(snapshot_latency_new(0) == NULL);
+    SnapshotLatency* latency = snapshot_latency_new(1);
+    assert(latency != NULL);
+    snapshot_latency_delete(latency);
+    snapshot_latency_delete(NULL);
+}
+
+static void record_test() {
+    SnapshotLatency* latency = snapshot_latency_new(100);
+    assert(latency != NULL);
+
+    /*Snapshot without stamp is not recorded*/
+    snapshot.capture_ns = 0;
+    snapshot.parsed_ns = 1000;
+    assert(!snapshot_latency_record(latency, &snapshot, 2000));
+    assert(snapshot_latency_total(latency, LATENCY_POINT_PARSE)->count == 0);
+
+    snapshot.capture_ns = 1000000;
+    snapshot.parsed_ns = 1000000 + 20;
+    assert(!snapshot_latency_record(latency, &snapshot, 1000000 + 50));
+    const LatencyHistogram* parse = snapshot_latency_total(latency, LATENCY_POINT_PARSE);
+    const LatencyHistogram* output = snapshot_latency_total(latency, LATENCY_POINT_OUTPUT);
+    assert(parse->count == 1 && parse->max_ns == 20);
+    assert(output->count == 1 && output->max_ns == 50);
+
+    /*Clock going backwards does not wrap the age*/
+    snapshot.parsed_ns = 10;
+    assert(!snapshot_latency_record(latency, &snapshot, 20));
+    assert(parse->count == 2 && parse->max_ns == 20 && parse->buckets[0] == 1);
+    assert(output->buckets[0] == 1);
+    snapshot_latency_delete(latency);
+}
+
+static void interval_test() {
+    SnapshotLatency* latency = snapshot_latency_new(3);
+    char message[SNAPSHOT_LATENCY_MESSAGE_SIZE];
+    assert(latency != NULL);
+
+    snapshot.capture_ns = 1000;
+    snapshot.parsed_ns = 2000;
+    assert(!snapshot_latency_record(latency, &snapshot, 3000));
+    assert(!snapshot_latency_record(latency, &snapshot, 3000));
+    assert(snapshot_latency_record(latency, &snapshot, 3000));
+    snapshot_latency_format(latency, message, sizeof(message));
+    assert(strncmp(message, "Latency over 3 snapshots:", 25) == 0);
+
+    /*The next interval starts empty, total keeps everything*/
+    assert(!snapshot_latency_record(latency, &snapshot, 1000 + 64000));
+    snapshot_latency_format(latency, message, sizeof(message));
+    assert(strncmp(message, "Latency over 1 snapshots:", 25) == 0);
+    assert(strstr(message, "output p50 64.00us") != NULL);
+    assert(snapshot_latency_total(latency, LATENCY_POINT_OUTPUT)->count == 4);
+    snapshot_latency_delete(latency);
+}
+
+static void format_test() {
+    SnapshotLatency* latency = snapshot_latency_new(1);
+    char message[SNAPSHOT_LATENCY_MESSAGE_SIZE];
+    assert(latency != NULL);
+
+    snapshot.capture_ns = 1000;
+    snapshot.parsed_ns = 1000 + 40;
+    assert(snapshot_latency_record(latency, &snapshot, 1000 + 50));
+    snapshot_latency_format(latency, message, sizeof(message));
+    assert(strcmp(message, "Latency over 1 snapshots: parse p50 0.04us p90 0.04us p99 0.04us max 0.04us,"
+                           " output p50 0.05us p90 0.05us p99 0.05us max 0.05us\n") == 0);
+
+    /*The longest possible report fits*/
+    snapshot.capture_ns = 1;
+    snapshot.parsed_ns = UINT64_MAX;
+    assert(snapshot_latency_record(latency, &snapshot, UINT64_MAX));
+    const int length = snapshot_latency_format(latency, message, sizeof(message));
+    assert(length > 0 && (size_t) length < sizeof(message));
+    snapshot_latency_delete(latency);
+}
+
+static void line_test() {
+    char line[32];
+    uint64_t capture_ns = 0;
+
+    snapshot_latency_format_line(UINT64_MAX, line, sizeof(line));
+    assert(line[strlen(line) - 1] == '\n');
+    line[strlen(line) - 1] = '\0';
+    assert(snapshot_latency_parse_line(line, &capture_ns) == SNAPSHOT_LATENCY_SUCCESS);
+    assert(capture_ns == UINT64_MAX);
+
+    assert(snapshot_latency_parse_line("tick 12345", &capture_ns) == SNAPSHOT_LATENCY_SUCCESS);
+    assert(capture_ns == 12345);
+    assert(snapshot_latency_parse_line("cpu0 1 2 3 4 5 6 7 8 9 10", &capture_ns) == SNAPSHOT_LATENCY_DISCARD_LINE);
+    assert(snapshot_latency_parse_line("tick ", &capture_ns) == SNAPSHOT_LATENCY_FAIL);
+    assert(snapshot_latency_parse_line("tick 12x", &capture_ns) == SNAPSHOT_LATENCY_FAIL);
+    assert(snapshot_latency_parse_line("tick -5", &capture_ns) == SNAPSHOT_LATENCY_FAIL);
+    assert(snapshot_latency_parse_line("tick 99999999999999999999999", &capture_ns) == SNAPSHOT_LATENCY_FAIL);
+    assert(capture_ns == 12345);
+
+    assert(strcmp(snapshot_latency_point_to_str(LATENCY_POINT_PARSE), "parse") == 0);
+    assert(strcmp(snapshot_latency_point_to_str(LATENCY_POINT_COUNT), "unknown") == 0);
+}
+
+int main() {
+    new_delete_test();
+    record_test();
+    interval_test();
+    format_test();
+    line_test();
+    return 0;
+}
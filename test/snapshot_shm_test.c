@@ -0,0 +1,177 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "snapshot_shm.h"
+
+enum {
+    number_of_readers = 4,
+    number_of_publications = 20000,
+};
+
+typedef struct ReaderResult {
+    size_t consistent_reads;
+} ReaderResult;
+
+static char segment_name[64];
+static atomic_bool writer_done;
+
+static void empty_segment_test(void);
+static void publish_read_test(void);
+static void concurrent_readers_test(void);
+static void open_missing_test(void);
+
+static void* reader_hammer(void* args);
+static void fill_snapshot(Snapshot* snapshot, uint64_t sequence);
+
+static void fill_snapshot(Snapshot* snapshot, uint64_t sequence) {
+    snapshot->sequence = sequence;
+    snapshot->timestamp.tv_sec = (time_t) sequence;
+    snapshot->timestamp.tv_nsec = 0;
+    snapshot->number_of_cores = 1 + sequence % 64;
+    for (size_t i = 0; i < snapshot->number_of_cores; i++) {
+        snapshot->core_usage[i] = (double) sequence;
+        snapshot->core_time[i] = (ProcParserCpuTime) {.total = sequence * 2, .idle = sequence};
+    }
+}
+
+static void* reader_hammer(void* args) {
+    ReaderResult* result = args;
+    SnapshotShm* reader = snapshot_shm_open(segment_name);
+    SnapshotShmRecord* record = malloc(sizeof(*record));
+    uint64_t last_sequence = 0;
+    assert(reader != NULL && record != NULL);
+
+    /*The last publication stays readable, so every reader finishes with at least one read*/
+    while (!atomic_load(&writer_done) || result->consistent_reads == 0) {
+        if (snapshot_shm_read(reader, record) != SNAPSHOT_SHM_SUCCESS) {
+            continue;
+        }
+        /*Every field shall come from the same publication*/
+        assert(record->sequence >= last_sequence);
+        assert(record->number_of_cores == 1 + record->sequence % 64);
+        assert(record->timestamp_ns == record->sequence * 1000000000u);
+        for (size_t i = 0; i < record->number_of_cores; i++) {
+            assert(record->core_usage[i] == (double) record->sequence);
+            assert(record->core_time[i].total == record->sequence * 2);
+            assert(record->core_time[i].idle == record->sequence);
+        }
+        last_sequence = record->sequence;
+        result->consistent_reads++;
+    }
+
+    free(record);
+    snapshot_shm_delete(reader);
+    return NULL;
+}
+
+static void empty_segment_test() {
+    SnapshotShm* writer = snapshot_shm_create(segment_name);
+    SnapshotShm* reader = snapshot_shm_open(segment_name);
+    SnapshotShmRecord* record = malloc(sizeof(*record));
+    assert(writer != NULL && reader != NULL && record != NULL);
+
+    assert(snapshot_shm_read(reader, record) == SNAPSHOT_SHM_EMPTY);
+    assert(snapshot_shm_read(NULL, record) == SNAPSHOT_SHM_NULL_ARGUMENT);
+    assert(snapshot_shm_read(reader, NULL) == SNAPSHOT_SHM_NULL_ARGUMENT);
+
+    free(record);
+    snapshot_shm_delete(reader);
+    snapshot_shm_delete(writer);
+}
+
+static void publish_read_test() {
+    SnapshotShm* writer = snapshot_shm_create(segment_name);
+    SnapshotShm* reader = snapshot_shm_open(segment_name);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    SnapshotShmRecord* record = malloc(sizeof(*record));
+    assert(writer != NULL && reader != NULL && snapshot != NULL && record != NULL);
+
+    fill_snapshot(snapshot, 7);
+    snapshot_shm_publish(writer, snapshot, NULL, 0, NULL);
+
+    assert(snapshot_shm_read(reader, record) == SNAPSHOT_SHM_SUCCESS);
+    assert(record->sequence == 7);
+    assert(record->number_of_cores == 8);
+    assert(record->core_usage[7] == 7.0);
+    assert(record->core_time[7].total == 14);
+    assert(!record->has_statistics);
+
+    /*Statistics of cores missing in them are NaN*/
+    double statistics[4 * USAGE_STATISTIC_COUNT];
+    for (size_t i = 0; i < 4 * USAGE_STATISTIC_COUNT; i++) {
+        statistics[i] = (double) i;
+    }
+    snapshot_shm_publish(writer, snapshot, statistics, 4, NULL);
+    assert(snapshot_shm_read(reader, record) == SNAPSHOT_SHM_SUCCESS);
+    assert(record->has_statistics);
+    assert(record->core_statistics[3 * USAGE_STATISTIC_COUNT + USAGE_STATISTIC_P95] == (double) (3 * USAGE_STATISTIC_COUNT + USAGE_STATISTIC_P95));
+    assert(isnan(record->core_statistics[4 * USAGE_STATISTIC_COUNT]));
+    assert(isnan(record->core_statistics[8 * USAGE_STATISTIC_COUNT - 1]));
+    assert(!record->has_overhead);
+
+    StageOverheadReport overhead = {.sequence = 1, .rss_kb = 100, .peak_rss_kb = 200};
+    overhead.cpu_us_per_snapshot[PLACEMENT_STAGE_PARSER] = 12.5;
+    snapshot_shm_publish(writer, snapshot, NULL, 0, &overhead);
+    assert(snapshot_shm_read(reader, record) == SNAPSHOT_SHM_SUCCESS);
+    assert(record->has_overhead);
+    assert(record->stage_cpu_us_per_snapshot[PLACEMENT_STAGE_PARSER] == 12.5);
+    assert(record->rss_kb == 100 && record->peak_rss_kb == 200);
+
+    free(record);
+    free(snapshot);
+    snapshot_shm_delete(reader);
+    snapshot_shm_delete(writer);
+}
+
+static void concurrent_readers_test() {
+    SnapshotShm* writer = snapshot_shm_create(segment_name);
+    Snapshot* snapshot = calloc(1, sizeof(*snapshot));
+    pthread_t readers[number_of_readers];
+    ReaderResult results[number_of_readers] = {0};
+    assert(writer != NULL && snapshot != NULL);
+
+    fill_snapshot(snapshot, 1);
+    snapshot_shm_publish(writer, snapshot, NULL, 0, NULL);
+    atomic_store(&writer_done, false);
+
+    for (size_t i = 0; i < number_of_readers; i++) {
+        if (pthread_create(&readers[i], NULL, reader_hammer, &results[i]) != 0) {
+            perror("Warning: thread creation failed\n");
+            return;
+        }
+    }
+
+    for (uint64_t sequence = 2; sequence < number_of_publications; sequence++) {
+        fill_snapshot(snapshot, sequence);
+        snapshot_shm_publish(writer, snapshot, NULL, 0, NULL);
+    }
+    atomic_store(&writer_done, true);
+
+    for (size_t i = 0; i < number_of_readers; i++) {
+        pthread_join(readers[i], NULL);
+        assert(results[i].consistent_reads > 0);
+    }
+
+    free(snapshot);
+    snapshot_shm_delete(writer);
+}
+
+static void open_missing_test() {
+    /*Writer unlinks the segment on delete*/
+    assert(snapshot_shm_open(segment_name) == NULL);
+}
+
+int main() {
+    snprintf(segment_name, sizeof(segment_name), "/snapshot_shm_test_%ld", (long) getpid());
+
+    empty_segment_test();
+    publish_read_test();
+    concurrent_readers_test();
+    open_missing_test();
+
+    return 0;
+}
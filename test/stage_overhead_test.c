@@ -0,0 +1,247 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "stage_overhead.h"
+#include "fake_tree.h"
+
+enum {
+    number_of_threads = 4,
+    accounts_per_thread = 1000,
+};
+
+static void status_write(uint64_t rss_kb, uint64_t peak_rss_kb);
+static void parse_status_test(void);
+static void interval_test(void);
+static void account_test(void);
+static void concurrent_account_test(void);
+static void format_test(void);
+static void hardware_test(void);
+static void format_hardware_test(void);
+static void real_proc_test(void);
+
+static void* account_hammer(void* args);
+
+static char root[64];
+
+/**
+ * @brief Write status of fake process below root/self
+ */
+static void status_write(const uint64_t rss_kb, const uint64_t peak_rss_kb) {
+    char content[256];
+    snprintf(content, sizeof(content), "Name:\ttracker\nVmPeak:\t   20000 kB\nVmSize:\t   10000 kB\nVmHWM:\t    %" PRIu64 " kB\n"
+             "VmRSS:\t    %" PRIu64 " kB\nThreads:\t5\n", peak_rss_kb, rss_kb);
+    fake_tree_write(root, "self/status", content);
+}
+
+static void parse_status_test() {
+    uint64_t rss_kb = 0;
+    uint64_t peak_rss_kb = 0;
+    assert(stage_overhead_parse_status("Name:\tx\nVmHWM:\t  2048 kB\nVmRSS:\t  1024 kB\n", &rss_kb, &peak_rss_kb));
+    assert(rss_kb == 1024 && peak_rss_kb == 2048);
+
+    /*Kernel threads have no memory lines*/
+    assert(!stage_overhead_parse_status("Name:\tkthreadd\nThreads:\t1\n", &rss_kb, &peak_rss_kb));
+    assert(!stage_overhead_parse_status("VmRSS:\t  1024 kB", &rss_kb, &peak_rss_kb));
+    assert(!stage_overhead_parse_status("", &rss_kb, &peak_rss_kb));
+}
+
+static void interval_test() {
+    assert(stage_overhead_new(root, 0, false) == NULL);
+
+    status_write(300, 400);
+    StageOverhead* stage_overhead = stage_overhead_new(root, 3, false);
+    assert(stage_overhead != NULL);
+    assert(stage_overhead_latest(stage_overhead) == NULL);
+
+    assert(stage_overhead_snapshot(stage_overhead) == NULL);
+    stage_overhead_account(stage_overhead, PLACEMENT_STAGE_PARSER, 0, 2);
+    assert(stage_overhead_snapshot(stage_overhead) == NULL);
+    const StageOverheadReport* report = stage_overhead_snapshot(stage_overhead);
+    assert(report != NULL && report == stage_overhead_latest(stage_overhead));
+    assert(report->sequence == 1 && report->number_of_snapshots == 3);
+    assert(report->messages[PLACEMENT_STAGE_PARSER] == 2);
+    assert(report->messages[PLACEMENT_STAGE_READER] == 0 && report->cpu_us[PLACEMENT_STAGE_READER] == 0);
+    /*Mark 0 means the whole CPU time of the thread*/
+    assert(report->cpu_us_per_snapshot[PLACEMENT_STAGE_PARSER] * 3 >= (double) report->cpu_us[PLACEMENT_STAGE_PARSER]);
+    assert(report->rss_kb == 300 && report->peak_rss_kb == 400);
+
+    /*Counters start from zero after every report*/
+    status_write(500, 600);
+    assert(stage_overhead_snapshot(stage_overhead) == NULL);
+    assert(stage_overhead_snapshot(stage_overhead) == NULL);
+    report = stage_overhead_snapshot(stage_overhead);
+    assert(report != NULL && report->sequence == 2);
+    assert(report->messages[PLACEMENT_STAGE_PARSER] == 0 && report->cpu_us[PLACEMENT_STAGE_PARSER] == 0);
+    assert(report->rss_kb == 500 && report->peak_rss_kb == 600);
+
+    /*Missing status does not prevent the report*/
+    fake_tree_remove(root);
+    assert(stage_overhead_snapshot(stage_overhead) == NULL);
+    assert(stage_overhead_snapshot(stage_overhead) == NULL);
+    report = stage_overhead_snapshot(stage_overhead);
+    assert(report != NULL && report->rss_kb == 0 && report->peak_rss_kb == 0);
+
+    stage_overhead_delete(stage_overhead);
+    stage_overhead_delete(NULL);
+}
+
+static void account_test() {
+    StageOverhead* stage_overhead = stage_overhead_new(root, 1, false);
+    assert(stage_overhead != NULL);
+
+    uint64_t mark_ns = stage_overhead_thread_cpu_ns();
+    volatile uint64_t sink = 0;
+    for (uint64_t i = 0; i < 20000000; i++) {
+        sink += i;
+    }
+    const uint64_t new_mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_PRINTER, mark_ns, 1);
+    assert(new_mark_ns > mark_ns);
+    /*Mark in the future is not accounted*/
+    stage_overhead_account(stage_overhead, PLACEMENT_STAGE_LOGGER, UINT64_MAX, 1);
+    /*Without accounting object only the clock is read*/
+    assert(stage_overhead_account(NULL, PLACEMENT_STAGE_PRINTER, new_mark_ns, 1) >= new_mark_ns);
+
+    const StageOverheadReport* report = stage_overhead_snapshot(stage_overhead);
+    assert(report != NULL);
+    assert(report->cpu_us[PLACEMENT_STAGE_PRINTER] == (new_mark_ns - mark_ns) / 1000);
+    assert(report->cpu_us[PLACEMENT_STAGE_PRINTER] > 0);
+    assert(report->messages[PLACEMENT_STAGE_PRINTER] == 1);
+    assert(report->cpu_us[PLACEMENT_STAGE_LOGGER] == 0 && report->messages[PLACEMENT_STAGE_LOGGER] == 1);
+
+    stage_overhead_delete(stage_overhead);
+}
+
+static void* account_hammer(void* args) {
+    StageOverhead* stage_overhead = args;
+    uint64_t mark_ns = stage_overhead_thread_cpu_ns();
+    for (size_t i = 0; i < accounts_per_thread; i++) {
+        mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_WATCHDOG, mark_ns, 1);
+    }
+    return NULL;
+}
+
+static void concurrent_account_test() {
+    StageOverhead* stage_overhead = stage_overhead_new(root, 1, false);
+    pthread_t threads[number_of_threads];
+    assert(stage_overhead != NULL);
+
+    for (size_t i = 0; i < number_of_threads; i++) {
+        assert(pthread_create(&threads[i], NULL, account_hammer, stage_overhead) == 0);
+    }
+    for (size_t i = 0; i < number_of_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    const StageOverheadReport* report = stage_overhead_snapshot(stage_overhead);
+    assert(report->messages[PLACEMENT_STAGE_WATCHDOG] == number_of_threads * accounts_per_thread);
+
+    stage_overhead_delete(stage_overhead);
+}
+
+static void format_test() {
+    StageOverheadReport report = {.sequence = 1, .number_of_snapshots = 2, .rss_kb = 1200, .peak_rss_kb = 1300};
+    report.cpu_us_per_snapshot[PLACEMENT_STAGE_READER] = 12.5;
+    report.cpu_us_per_snapshot[PLACEMENT_STAGE_PARSER] = 40.126;
+    char message[STAGE_OVERHEAD_MESSAGE_SIZE];
+
+    const int length = stage_overhead_format(&report, message, sizeof(message));
+    assert(length > 0 && (size_t) length == strlen(message));
+    assert(strcmp(message, "Overhead per snapshot: reader 12.50us parser 40.13us printer 0.00us logger 0.00us"
+                           " watchdog 0.00us rss 1200 kB peak 1300 kB\n") == 0);
+
+    /*Truncated output is terminated*/
+    char short_message[16];
+    assert(stage_overhead_format(&report, short_message, sizeof(short_message)) >= (int) sizeof(short_message));
+    assert(strlen(short_message) == sizeof(short_message) - 1);
+}
+
+static void hardware_test() {
+    StageOverhead* stage_overhead = stage_overhead_new(root, 1, true);
+    assert(stage_overhead != NULL);
+
+    /*The first accounting of the thread only opens its counters*/
+    uint64_t mark_ns = stage_overhead_account(stage_overhead, PLACEMENT_STAGE_PARSER, stage_overhead_thread_cpu_ns(), 0);
+    const StageOverheadReport* report = stage_overhead_snapshot(stage_overhead);
+    assert(report->hardware && report->hardware_mask[PLACEMENT_STAGE_PARSER] == 0);
+
+    volatile uint64_t sink = 0;
+    for (uint64_t i = 0; i < 10000000; i++) {
+        sink += i;
+    }
+    stage_overhead_account(stage_overhead, PLACEMENT_STAGE_PARSER, mark_ns, 1);
+    report = stage_overhead_snapshot(stage_overhead);
+    assert(report->hardware);
+    assert(report->hardware_mask[PLACEMENT_STAGE_READER] == 0);
+    /*Without access to perf_event_open only CPU time is accounted*/
+    const uint32_t mask = report->hardware_mask[PLACEMENT_STAGE_PARSER];
+    if ((mask & (UINT32_C(1) << PERF_COUNTER_INSTRUCTIONS)) != 0) {
+        assert(report->hardware_per_snapshot[PLACEMENT_STAGE_PARSER][PERF_COUNTER_INSTRUCTIONS] >= 10000000.0);
+    }
+    assert(report->cpu_us[PLACEMENT_STAGE_PARSER] > 0);
+    stage_overhead_delete(stage_overhead);
+
+    /*Without hardware counting nothing is opened*/
+    stage_overhead = stage_overhead_new(root, 1, false);
+    assert(stage_overhead != NULL);
+    stage_overhead_account(stage_overhead, PLACEMENT_STAGE_PARSER, 0, 1);
+    report = stage_overhead_snapshot(stage_overhead);
+    assert(!report->hardware && report->hardware_mask[PLACEMENT_STAGE_PARSER] == 0);
+    stage_overhead_delete(stage_overhead);
+}
+
+static void format_hardware_test() {
+    StageOverheadReport report = {.sequence = 1, .number_of_snapshots = 2, .hardware = true};
+    char message[STAGE_OVERHEAD_MESSAGE_SIZE];
+
+    stage_overhead_format_hardware(&report, message, sizeof(message));
+    assert(strcmp(message, "Hardware counters unavailable\n") == 0);
+
+    report.hardware_mask[PLACEMENT_STAGE_READER] = (UINT32_C(1) << PERF_COUNTER_COUNT) - 1;
+    report.hardware_mask[PLACEMENT_STAGE_PRINTER] = UINT32_C(1) << PERF_COUNTER_CYCLES;
+    report.hardware_per_snapshot[PLACEMENT_STAGE_READER][PERF_COUNTER_CYCLES] = 1200.4;
+    report.hardware_per_snapshot[PLACEMENT_STAGE_READER][PERF_COUNTER_INSTRUCTIONS] = 2500;
+    report.hardware_per_snapshot[PLACEMENT_STAGE_READER][PERF_COUNTER_CACHE_MISSES] = 3;
+    report.hardware_per_snapshot[PLACEMENT_STAGE_READER][PERF_COUNTER_BRANCH_MISSES] = 9;
+    report.hardware_per_snapshot[PLACEMENT_STAGE_PRINTER][PERF_COUNTER_CYCLES] = 700;
+    const int length = stage_overhead_format_hardware(&report, message, sizeof(message));
+    assert(length > 0 && (size_t) length == strlen(message));
+    assert(strcmp(message, "Hardware per snapshot: reader cycles 1200 instructions 2500 cache-misses 3 branch-misses 9,"
+                           " parser n/a, printer cycles 700, logger n/a, watchdog n/a\n") == 0);
+
+    /*Report with every counter of every stage fits*/
+    for (size_t i = 0; i < PLACEMENT_STAGE_COUNT; i++) {
+        report.hardware_mask[i] = (UINT32_C(1) << PERF_COUNTER_COUNT) - 1;
+        for (size_t j = 0; j < PERF_COUNTER_COUNT; j++) {
+            report.hardware_per_snapshot[i][j] = 1e12;
+        }
+    }
+    assert(stage_overhead_format_hardware(&report, message, sizeof(message)) < (int) sizeof(message));
+}
+
+static void real_proc_test() {
+    StageOverhead* stage_overhead = stage_overhead_new("/proc", 1, false);
+    assert(stage_overhead != NULL);
+    const StageOverheadReport* report = stage_overhead_snapshot(stage_overhead);
+    assert(report != NULL);
+    /*procfs may be missing in minimal containers*/
+    if (access("/proc/self/status", R_OK) == 0) {
+        assert(report->rss_kb > 0 && report->peak_rss_kb >= report->rss_kb);
+    }
+    stage_overhead_delete(stage_overhead);
+}
+
+int main() {
+    snprintf(root, sizeof(root), "/tmp/stage_overhead_%d", (int) getpid());
+    parse_status_test();
+    interval_test();
+    account_test();
+    concurrent_account_test();
+    format_test();
+    hardware_test();
+    format_hardware_test();
+    real_proc_test();
+    fake_tree_remove(root);
+    return 0;
+}
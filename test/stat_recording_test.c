@@ -0,0 +1,171 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "stat_recording.h"
+
+static void invalid_test(void);
+static void round_trip_test(void);
+static void shape_change_test(void);
+static void unsplittable_test(void);
+static void truncated_test(void);
+
+static char recording_path[64];
+
+static const char first[] = "cpu  10 0 20 300 4 0 5 0 0 0\n"
+                            "cpu0 10 0 20 300 4 0 5 0 0 0\n"
+                            "intr 12345 1 2\n";
+static const char second[] = "cpu  16 0 25 400 4 0 6 0 0 0\n"
+                             "cpu0 16 0 25 400 4 0 6 0 0 0\n"
+                             "intr 12300 1 2\n";
+static const char hotplug[] = "cpu  17 0 26 410 4 0 6 0 0 0\n"
+                              "cpu0 16 0 25 400 4 0 6 0 0 0\n"
+                              "cpu1 1 0 1 10 0 0 0 0 0 0\n";
+
+static void add_in_pieces(StatRecorder* recorder, const char* data) {
+    const size_t length = strlen(data);
+    assert(stat_recorder_add(recorder, data, length / 2));
+    assert(stat_recorder_add(recorder, data + length / 2, length - length / 2));
+}
+
+static void expect_record(StatReplay* replay, const char* data, uint64_t delay_ns) {
+    size_t length = 0;
+    assert(stat_replay_next(replay));
+    const char* content = stat_replay_data(replay, &length);
+    assert(length == strlen(data) && memcmp(content, data, length) == 0);
+    assert(stat_replay_delay_ns(replay) == delay_ns);
+}
+
+static long file_size(void) {
+    FILE* file = fopen(recording_path, "rb");
+    assert(file != NULL);
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+static void invalid_test() {
+    assert(stat_recorder_new("/nonexistent/recording") == NULL);
+    assert(stat_replay_new("/nonexistent/recording") == NULL);
+    stat_recorder_delete(NULL);
+    stat_replay_delete(NULL);
+
+    /*File without magic is not a recording*/
+    FILE* file = fopen(recording_path, "wb");
+    assert(file != NULL);
+    fputs("cpu  1 2 3\n", file);
+    fclose(file);
+    assert(stat_replay_new(recording_path) == NULL);
+}
+
+static void round_trip_test() {
+    StatRecorder* recorder = stat_recorder_new(recording_path);
+    assert(recorder != NULL);
+    add_in_pieces(recorder, first);
+    assert(stat_recorder_commit(recorder, 5000000000u));
+    const long raw_size = file_size();
+    /*Decrement of intr takes zigzag path*/
+    add_in_pieces(recorder, second);
+    assert(stat_recorder_commit(recorder, 5100000000u));
+    add_in_pieces(recorder, second);
+    assert(stat_recorder_commit(recorder, 5100000001u));
+    /*Unchanged text is stored as one byte per number*/
+    assert(file_size() - raw_size < (long) strlen(second));
+    stat_recorder_delete(recorder);
+
+    StatReplay* replay = stat_replay_new(recording_path);
+    assert(replay != NULL);
+    expect_record(replay, first, 0);
+    expect_record(replay, second, 100000000u);
+    expect_record(replay, second, 1);
+    assert(!stat_replay_next(replay));
+    stat_replay_delete(replay);
+}
+
+static void shape_change_test() {
+    StatRecorder* recorder = stat_recorder_new(recording_path);
+    assert(recorder != NULL);
+    /*Reserved buffers hold the larger record, smaller ones reuse them*/
+    assert(stat_recorder_reserve(recorder, sizeof(hotplug)));
+    add_in_pieces(recorder, first);
+    assert(stat_recorder_commit(recorder, 10));
+    add_in_pieces(recorder, hotplug);
+    assert(stat_recorder_commit(recorder, 20));
+    add_in_pieces(recorder, hotplug);
+    assert(stat_recorder_commit(recorder, 30));
+    stat_recorder_delete(recorder);
+
+    StatReplay* replay = stat_replay_new(recording_path);
+    assert(replay != NULL);
+    assert(stat_replay_reserve(replay, sizeof(hotplug)));
+    expect_record(replay, first, 0);
+    expect_record(replay, hotplug, 10);
+    expect_record(replay, hotplug, 10);
+    assert(!stat_replay_next(replay));
+    stat_replay_delete(replay);
+}
+
+static void unsplittable_test() {
+    static const char leading_zero[] = "cpu  007 1\n";
+    static const char huge[] = "cpu  123456789012345678901234 1\n";
+    static const char marker[] = "cpu  \001 1\n";
+    StatRecorder* recorder = stat_recorder_new(recording_path);
+    assert(recorder != NULL);
+    add_in_pieces(recorder, leading_zero);
+    assert(stat_recorder_commit(recorder, 1));
+    add_in_pieces(recorder, leading_zero);
+    assert(stat_recorder_commit(recorder, 2));
+    add_in_pieces(recorder, huge);
+    assert(stat_recorder_commit(recorder, 3));
+    add_in_pieces(recorder, marker);
+    assert(stat_recorder_commit(recorder, 4));
+    /*Record over the limit is dropped as whole*/
+    static char big[STAT_RECORDING_MAX_RECORD / 2 + 1];
+    assert(stat_recorder_add(recorder, big, sizeof(big)));
+    assert(!stat_recorder_add(recorder, big, sizeof(big)));
+    assert(!stat_recorder_commit(recorder, 5));
+    add_in_pieces(recorder, "");
+    assert(stat_recorder_commit(recorder, 6));
+    stat_recorder_delete(recorder);
+
+    StatReplay* replay = stat_replay_new(recording_path);
+    assert(replay != NULL);
+    expect_record(replay, leading_zero, 0);
+    expect_record(replay, leading_zero, 1);
+    expect_record(replay, huge, 1);
+    expect_record(replay, marker, 1);
+    expect_record(replay, "", 2);
+    assert(!stat_replay_next(replay));
+    stat_replay_delete(replay);
+}
+
+static void truncated_test() {
+    StatRecorder* recorder = stat_recorder_new(recording_path);
+    assert(recorder != NULL);
+    add_in_pieces(recorder, first);
+    assert(stat_recorder_commit(recorder, 1));
+    add_in_pieces(recorder, second);
+    assert(stat_recorder_commit(recorder, 2));
+    stat_recorder_delete(recorder);
+    assert(truncate(recording_path, file_size() - 1) == 0);
+
+    StatReplay* replay = stat_replay_new(recording_path);
+    assert(replay != NULL);
+    expect_record(replay, first, 0);
+    assert(!stat_replay_next(replay));
+    stat_replay_delete(replay);
+}
+
+int main() {
+    snprintf(recording_path, sizeof(recording_path), "/tmp/stat_recording_test_%ld", (long) getpid());
+
+    invalid_test();
+    round_trip_test();
+    shape_change_test();
+    unsplittable_test();
+    truncated_test();
+
+    unlink(recording_path);
+    return 0;
+}
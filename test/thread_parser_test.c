@@ -0,0 +1,248 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "thread_parser.h"
+#include "thread_logger.h"
+#include "logger_payload.h"
+
+static void first_tick_test(void);
+static void counter_reset_test(void);
+static void hotplug_test(void);
+static void baseline_test(void);
+static void feed_line_test(void);
+static void stale_test(void);
+static void too_many_cores_test(void);
+
+static PCPGuard logger_guard = PCP_GUARD_INITIALIZER;
+static CircularBuffer* logger_buffer;
+
+/**
+ * @brief Feed content and return the snapshot completed by it
+ */
+static const Snapshot* feed(ThreadParserState* state, const char* content) {
+    const Snapshot* result = NULL;
+    for (const char* input_char = content; *input_char != '\0'; input_char++) {
+        const Snapshot* snapshot = thread_parser_state_feed(state, *input_char, &logger_guard, logger_buffer);
+        result = snapshot != NULL ? snapshot : result;
+    }
+    return result;
+}
+
+/**
+ * @brief Write pending log entries to a temporary file and check whether one contains text
+ */
+static bool logged(const char* text) {
+    char content[1024] = {0};
+    FILE* file = tmpfile();
+    assert(file != NULL);
+    thread_logger_flush(&logger_guard, logger_buffer, file);
+    rewind(file);
+    fread(content, 1, sizeof(content) - 1, file);
+    fclose(file);
+    return strstr(content, text) != NULL;
+}
+
+static void first_tick_test() {
+    ThreadParserState* state = thread_parser_state_new(NULL);
+    assert(state != NULL);
+
+    const Snapshot* snapshot = feed(state, "cpu  30 0 0 70 0 0 0 0 0 0\n"
+                                           "cpu0 10 0 0 90 0 0 0 0 0 0\n"
+                                           "cpu1 20 0 0 80 0 0 0 0 0 0\n"
+                                           "intr 1\n");
+    assert(snapshot != NULL && snapshot->number_of_cores == 2);
+    /*Without baseline usage is computed since boot and nothing is invalid*/
+    assert(fabs(snapshot->core_usage[0] - 10.0) < 1e-9 && fabs(snapshot->core_usage[1] - 20.0) < 1e-9);
+    assert(!snapshot->core_invalid[0] && !snapshot->core_invalid[1]);
+    assert(snapshot->number_of_invalid_cores == 0);
+    assert(!logged("baseline"));
+    thread_parser_state_delete(state);
+}
+
+static void counter_reset_test() {
+    ThreadParserState* state = thread_parser_state_new(NULL);
+    assert(state != NULL);
+
+    feed(state, "cpu0 1000 0 0 9000 0 0 0 0 0 0\ncpu1 1000 0 0 9000 0 0 0 0 0 0\nintr 1\n");
+    /*cpu0 was reset*/
+    const Snapshot* snapshot = feed(state, "cpu0 5 0 0 5 0 0 0 0 0 0\n"
+                                           "cpu1 1050 0 0 9050 0 0 0 0 0 0\n"
+                                           "intr 1\n");
+    assert(snapshot != NULL);
+    assert(snapshot->core_invalid[0] && isnan(snapshot->core_usage[0]));
+    assert(!snapshot->core_invalid[1] && fabs(snapshot->core_usage[1] - 50.0) < 1e-9);
+    assert(snapshot->number_of_invalid_cores == 1);
+    assert(logged("Counters of 1 cores went backwards"));
+
+    snapshot = feed(state, "cpu0 5 0 0 5 0 0 0 0 0 0\n"
+                           "cpu1 1100 0 0 9100 0 0 0 50 0 0\n"
+                           "intr 1\n");
+    /*Single field (steal) of cpu1 goes backwards although total grows*/
+    snapshot = feed(state, "cpu0 5 0 0 5 0 0 0 0 0 0\n"
+                           "cpu1 1150 0 0 9250 0 0 0 10 0 0\n"
+                           "intr 1\n");
+    assert(!snapshot->core_invalid[0]);
+    assert(snapshot->core_invalid[1] && snapshot->number_of_invalid_cores == 1);
+
+    /*Baseline is re-established, the next tick is computed from the counters after the reset*/
+    snapshot = feed(state, "cpu0 35 0 0 75 0 0 0 0 0 0\n"
+                           "cpu1 1175 0 0 9325 0 0 0 10 0 0\n"
+                           "intr 1\n");
+    assert(!snapshot->core_invalid[0] && !snapshot->core_invalid[1]);
+    assert(snapshot->number_of_invalid_cores == 0);
+    assert(fabs(snapshot->core_usage[0] - 30.0) < 1e-9);
+    assert(fabs(snapshot->core_usage[1] - 25.0) < 1e-9);
+    logged("");
+    thread_parser_state_delete(state);
+}
+
+static void hotplug_test() {
+    ThreadParserState* state = thread_parser_state_new(NULL);
+    assert(state != NULL);
+
+    feed(state, "cpu0 100 0 0 900 0 0 0 0 0 0\ncpu1 500 0 0 500 0 0 0 0 0 0\ncpu2 200 0 0 800 0 0 0 0 0 0\nintr 1\n");
+    /*cpu1 went offline, cpu2 moved to its position and its counters must not be compared with cpu1*/
+    const Snapshot* snapshot = feed(state, "cpu0 150 0 0 950 0 0 0 0 0 0\n"
+                                           "cpu2 900 0 0 900 0 0 0 0 0 0\n"
+                                           "intr 1\n");
+    assert(snapshot->number_of_cores == 2);
+    assert(!snapshot->core_invalid[0] && fabs(snapshot->core_usage[0] - 50.0) < 1e-9);
+    assert(snapshot->core_invalid[1] && snapshot->core_cpu[1] == 2);
+
+    /*cpu1 is back at position 1, which held cpu2, position 2 is new and computed since boot*/
+    snapshot = feed(state, "cpu0 200 0 0 1000 0 0 0 0 0 0\n"
+                           "cpu1 0 0 0 10 0 0 0 0 0 0\n"
+                           "cpu2 950 0 0 950 0 0 0 0 0 0\n"
+                           "intr 1\n");
+    assert(snapshot->number_of_cores == 3);
+    assert(!snapshot->core_invalid[0] && snapshot->core_invalid[1] && !snapshot->core_invalid[2]);
+    assert(snapshot->number_of_invalid_cores == 1);
+    logged("");
+    thread_parser_state_delete(state);
+}
+
+static void baseline_test() {
+    ThreadParserState* state = thread_parser_state_new(NULL);
+    assert(state != NULL);
+
+    /*Baseline tick is not emitted*/
+    const Snapshot* snapshot = feed(state, "tick 100\n" THREAD_PARSER_BASELINE_LINE "\n"
+                                           "cpu  300 0 0 700 0 0 0 0 0 0\n"
+                                           "cpu0 100 0 0 900 0 0 0 0 0 0\n"
+                                           "cpu1 200 0 0 800 0 0 0 0 0 0\n"
+                                           "intr 1\n");
+    assert(snapshot == NULL);
+
+    /*The first snapshot holds usage since the baseline*/
+    snapshot = feed(state, "tick 200\n"
+                           "cpu  400 0 0 800 0 0 0 0 0 0\n"
+                           "cpu0 110 0 0 990 0 0 0 0 0 0\n"
+                           "cpu1 290 0 0 810 0 0 0 0 0 0\n"
+                           "intr 1\n");
+    assert(snapshot != NULL && snapshot->sequence == 1 && snapshot->capture_ns == 200);
+    assert(snapshot->number_of_cores == 2 && snapshot->number_of_invalid_cores == 0);
+    assert(fabs(snapshot->core_usage[0] - 10.0) < 1e-9 && fabs(snapshot->core_usage[1] - 90.0) < 1e-9);
+
+    assert(snapshot->first_complete);
+
+    /*Positions of the baseline are known, counter reset is detected in the first snapshot already*/
+    ThreadParserState* reset_state = thread_parser_state_new(NULL);
+    assert(reset_state != NULL);
+    feed(reset_state, THREAD_PARSER_BASELINE_LINE "\ncpu0 100 0 0 900 0 0 0 0 0 0\nintr 1\n");
+    snapshot = feed(reset_state, "cpu0 1 0 0 1 0 0 0 0 0 0\nintr 1\n");
+    assert(snapshot != NULL && snapshot->core_invalid[0] && snapshot->number_of_invalid_cores == 1);
+    /*Usage of every core is not known yet*/
+    assert(!snapshot->first_complete);
+    logged("");
+    thread_parser_state_delete(reset_state);
+    thread_parser_state_delete(state);
+}
+
+static void feed_line_test() {
+    ThreadParserState* state = thread_parser_state_new(NULL);
+    ThreadParserState* char_state = thread_parser_state_new(NULL);
+    assert(state != NULL && char_state != NULL);
+
+    /*Lines give the same snapshots as characters*/
+    const char* const lines[] = {"cpu0 100 0 0 900 0 0 0 0 0 0", "intr 1",
+                                 "tick 300", "cpu0 150 0 0 950 0 0 0 0 0 0", "intr 1"};
+    const Snapshot* snapshot = NULL;
+    const Snapshot* char_snapshot = NULL;
+    for (size_t i = 0; i < sizeof(lines) / sizeof(*lines); i++) {
+        snapshot = thread_parser_state_feed_line(state, lines[i], &logger_guard, logger_buffer);
+        char line[64];
+        snprintf(line, sizeof(line), "%s\n", lines[i]);
+        char_snapshot = feed(char_state, line);
+        assert((snapshot == NULL) == (char_snapshot == NULL));
+    }
+    assert(snapshot != NULL && snapshot->sequence == 2 && snapshot->capture_ns == 300);
+    assert(fabs(snapshot->core_usage[0] - 50.0) < 1e-9);
+    assert(snapshot->core_usage[0] == char_snapshot->core_usage[0]);
+    thread_parser_state_delete(char_state);
+    thread_parser_state_delete(state);
+}
+
+static void stale_test() {
+    ThreadParserState* state = thread_parser_state_new(NULL);
+    assert(state != NULL);
+
+    const Snapshot* snapshot = feed(state, "cpu0 100 0 0 900 0 0 0 0 0 0\ncpu1 100 0 0 900 0 0 0 0 0 0\nintr 1\n");
+    assert(snapshot->first_complete);
+    /*cpu0 was not updated since the previous tick, it has no usage but it is not a reset*/
+    snapshot = feed(state, "cpu0 100 0 0 900 0 0 0 0 0 0\n"
+                                           "cpu1 150 0 0 950 0 0 0 0 0 0\n"
+                                           "intr 1\n");
+    assert(snapshot->core_stale[0] && !snapshot->core_invalid[0] && isnan(snapshot->core_usage[0]));
+    assert(!snapshot->core_stale[1] && fabs(snapshot->core_usage[1] - 50.0) < 1e-9);
+    assert(snapshot->number_of_stale_cores == 1 && snapshot->number_of_invalid_cores == 0);
+    assert(!snapshot->first_complete);
+
+    /*Usage of cpu0 is computed since the tick it was updated last*/
+    snapshot = feed(state, "cpu0 130 0 0 970 0 0 0 0 0 0\n"
+                           "cpu1 150 0 0 1050 0 0 0 0 0 0\n"
+                           "intr 1\n");
+    assert(!snapshot->core_stale[0] && fabs(snapshot->core_usage[0] - 30.0) < 1e-9);
+    assert(fabs(snapshot->core_usage[1]) < 1e-9);
+    assert(snapshot->number_of_stale_cores == 0 && !snapshot->first_complete);
+    assert(!logged("went backwards"));
+    thread_parser_state_delete(state);
+}
+
+static void too_many_cores_test() {
+    ThreadParserState* state = thread_parser_state_new(NULL);
+    assert(state != NULL);
+
+    /*Cores above the snapshot are skipped with a single warning per tick*/
+    const Snapshot* snapshot = NULL;
+    for (int tick = 1; tick <= 2; tick++) {
+        char line[64];
+        for (int cpu = 0; cpu < SNAPSHOT_MAX_CORES + 3; cpu++) {
+            snprintf(line, sizeof(line), "cpu%d %d 0 0 %d 0 0 0 0 0 0", cpu, 100 * tick, 900 * tick);
+            thread_parser_state_feed_line(state, line, &logger_guard, logger_buffer);
+        }
+        snapshot = thread_parser_state_feed_line(state, "intr 1", &logger_guard, logger_buffer);
+        assert(snapshot != NULL && snapshot->number_of_cores == SNAPSHOT_MAX_CORES);
+        assert(circular_buffer_read_available(logger_buffer) == 1);
+        assert(logged("Too many cores"));
+    }
+    assert(fabs(snapshot->core_usage[SNAPSHOT_MAX_CORES - 1] - 10.0) < 1e-9);
+    thread_parser_state_delete(state);
+}
+
+int main() {
+    logger_buffer = circular_buffer_new(16, sizeof(LoggerPayload*));
+    assert(logger_buffer != NULL);
+
+    first_tick_test();
+    counter_reset_test();
+    hotplug_test();
+    baseline_test();
+    feed_line_test();
+    stale_test();
+    too_many_cores_test();
+
+    circular_buffer_delete(logger_buffer);
+    pcp_guard_destroy(&logger_guard);
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "topology.h"
+#include "fake_tree.h"
+
+static void missing_root_test(void);
+static void two_sockets_test(void);
+static void hotplug_test(void);
+static void no_numa_test(void);
+
+static char root[64];
+
+static void missing_root_test() {
+    assert(topology_new("/nonexistent/sysfs") == NULL);
+    topology_delete(NULL);
+}
+
+static void two_sockets_test() {
+    /*2 sockets with ids 0 and 3, 2 cores each with 2 threads; numbering as on x86: siblings are n and n + 4*/
+    fake_tree_cpu_write(root, 0, 0, 0, "0,4");
+    fake_tree_cpu_write(root, 1, 0, 1, "1,5");
+    fake_tree_cpu_write(root, 2, 3, 0, "2,6");
+    fake_tree_cpu_write(root, 3, 3, 1, "3,7");
+    fake_tree_cpu_write(root, 4, 0, 0, "0,4");
+    fake_tree_cpu_write(root, 5, 0, 1, "1,5");
+    fake_tree_cpu_write(root, 6, 3, 0, "2,6");
+    fake_tree_cpu_write(root, 7, 3, 1, "3,7");
+    fake_tree_write(root, "devices/system/cpu/cpu1/online", "1\n");
+    fake_tree_write(root, "devices/system/cpu/online", "0-7\n");
+    fake_tree_write(root, "devices/system/node/node0/cpulist", "0-1,4-5\n");
+    fake_tree_write(root, "devices/system/node/node2/cpulist", "2-3,6-7\n");
+    fake_tree_write(root, "devices/system/node/possible", "0,2\n");
+
+    Topology* topology = topology_new(root);
+    assert(topology != NULL);
+    assert(topology_number_of_packages(topology) == 2);
+    assert(topology_package_id(topology, 0) == 0);
+    assert(topology_package_id(topology, 1) == 3);
+    assert(topology_number_of_nodes(topology) == 2);
+    assert(topology_node_id(topology, 1) == 2);
+
+    const TopologyCpu* cpu = topology_cpu(topology, 6);
+    assert(cpu != NULL);
+    assert(cpu->package == 1 && cpu->node == 1);
+    assert(cpu->core_id == 0);
+    assert(cpu->first_sibling == 2 && cpu->thread == 1);
+    cpu = topology_cpu(topology, 1);
+    assert(cpu->package == 0 && cpu->node == 0 && cpu->first_sibling == 1 && cpu->thread == 0);
+    assert(topology_cpu(topology, 8) == NULL);
+    assert(topology_cpu(topology, SNAPSHOT_MAX_CORES) == NULL);
+
+    topology_delete(topology);
+}
+
+static void hotplug_test() {
+    /*Continues with the tree of two_sockets_test*/
+    Topology* topology = topology_new(root);
+    assert(topology != NULL);
+
+    /*Taking all cpus of socket 3 offline*/
+    for (size_t cpu = 2; cpu < 8; cpu += cpu == 3 ? 3 : 1) {
+        char path[64];
+        snprintf(path, sizeof(path), "devices/system/cpu/cpu%zu/online", cpu);
+        fake_tree_write(root, path, "0\n");
+    }
+    /*Topology is kept until rescan*/
+    assert(topology_cpu(topology, 2) != NULL);
+    assert(topology_rescan(topology));
+    assert(topology_cpu(topology, 2) == NULL);
+    assert(topology_cpu(topology, 4) != NULL);
+    assert(topology_number_of_packages(topology) == 1);
+    assert(topology_number_of_nodes(topology) == 1);
+
+    topology_delete(topology);
+}
+
+static void no_numa_test() {
+    fake_tree_remove(root);
+    fake_tree_cpu_write(root, 0, 0, 0, "0");
+    fake_tree_cpu_write(root, 1, 0, 1, "1");
+
+    Topology* topology = topology_new(root);
+    assert(topology != NULL);
+    assert(topology_number_of_nodes(topology) == 1);
+    assert(topology_node_id(topology, 0) == 0);
+    assert(topology_cpu(topology, 1)->node == 0);
+    /*Failed rescan leaves the topology intact*/
+    fake_tree_remove(root);
+    assert(!topology_rescan(topology));
+    assert(topology_cpu(topology, 1) != NULL && topology_cpu(topology, 1)->core_id == 1);
+    topology_delete(topology);
+}
+
+int main() {
+    snprintf(root, sizeof(root), "/tmp/topology_test_%ld", (long) getpid());
+
+    missing_root_test();
+    two_sockets_test();
+    hotplug_test();
+    no_numa_test();
+    fake_tree_remove(root);
+    return 0;
+}
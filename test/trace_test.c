@@ -0,0 +1,269 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "trace.h"
+
+enum {
+    dump_size = 4 * 1024 * 1024,
+    hammer_ring_size = 1024,
+    number_of_dumps = 50,
+};
+
+/**
+ * @brief Events of single dump with counts of beginnings and ends
+ */
+typedef struct DumpSummary {
+    size_t threads;
+    size_t begins[TRACE_EVENT_COUNT];
+    size_t ends[TRACE_EVENT_COUNT];
+    /*Timestamps of every thread never go backwards*/
+    bool ordered;
+} DumpSummary;
+
+static void new_delete_test(void);
+static void attach_test(void);
+static void record_test(void);
+static void wrap_test(void);
+static void dump_file_test(void);
+static void concurrent_dump_test(void);
+static void event_to_str_test(void);
+
+static void summarize(Trace* trace, DumpSummary* summary);
+static void* attach_worker(void* args);
+static void* hammer(void* args);
+
+static char* dump;
+static char dump_path[64];
+static atomic_bool hammer_done;
+
+/**
+ * @brief Dump trace into memory and count its events
+ */
+static void summarize(Trace* const trace, DumpSummary* const summary) {
+    FILE* stream = tmpfile();
+    assert(stream != NULL);
+    assert(trace_dump(trace, fileno(stream)));
+    const long length = (long) lseek(fileno(stream), 0, SEEK_CUR);
+    assert(length > 0 && length < dump_size);
+    rewind(stream);
+    assert(fread(dump, 1, (size_t) length, stream) == (size_t) length);
+    fclose(stream);
+    dump[length] = '\0';
+    assert(strncmp(dump, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 39) == 0);
+    assert(strcmp(dump + length - 4, "\n]}\n") == 0);
+
+    memset(summary, 0, sizeof(*summary));
+    summary->ordered = true;
+    double last_ts[TRACE_MAX_THREADS + 1] = {0};
+    for (const char* line = strchr(dump, '\n'); line != NULL; line = strchr(line + 1, '\n')) {
+        const char* event = line + 1;
+        if (strncmp(event, "{\"name\":\"thread_name\",\"ph\":\"M\"", 30) == 0) {
+            summary->threads++;
+            continue;
+        }
+        char name[32];
+        char phase;
+        double ts;
+        long pid;
+        size_t tid;
+        if (sscanf(event, "{\"name\":\"%31[^\"]\",\"cat\":\"pipeline\",\"ph\":\"%c\",\"ts\":%lf,\"pid\":%ld,\"tid\":%zu}",
+                   name, &phase, &ts, &pid, &tid) != 5) {
+            continue;
+        }
+        assert(pid == (long) getpid() && tid >= 1 && tid <= TRACE_MAX_THREADS);
+        summary->ordered = summary->ordered && ts >= last_ts[tid];
+        last_ts[tid] = ts;
+        for (size_t i = 0; i < TRACE_EVENT_COUNT; i++) {
+            if (strcmp(name, trace_event_to_str((ETraceEvent) i)) == 0) {
+                if (phase == 'B') {
+                    summary->begins[i]++;
+                } else {
+                    assert(phase == 'E');
+                    summary->ends[i]++;
+                }
+            }
+        }
+    }
+}
+
+static void new_delete_test() {
+    assert(trace_new(0) == NULL);
+    assert(trace_new(3) == NULL);
+    Trace* trace = trace_new(8);
+    assert(trace != NULL);
+    trace_delete(trace);
+    trace_delete(NULL);
+}
+
+static void* attach_worker(void* args) {
+    Trace* trace = args;
+    const bool attached = trace_thread_attach(trace, "worker with a very long name");
+    assert(attached == (trace_thread_ring != NULL));
+    TRACE_BEGIN(TRACE_EVENT_PRINT);
+    TRACE_END(TRACE_EVENT_PRINT);
+    return (void*) (size_t) attached;
+}
+
+static void attach_test() {
+    Trace* trace = trace_new(8);
+    pthread_t threads[TRACE_MAX_THREADS + 1];
+    size_t attached = 0;
+    assert(trace != NULL);
+
+    assert(!trace_thread_attach(NULL, "main"));
+    assert(trace_thread_ring == NULL);
+    for (size_t i = 0; i < TRACE_MAX_THREADS + 1; i++) {
+        assert(pthread_create(&threads[i], NULL, attach_worker, trace) == 0);
+        void* result;
+        pthread_join(threads[i], &result);
+        attached += (size_t) result;
+    }
+    assert(attached == TRACE_MAX_THREADS);
+
+    DumpSummary summary;
+    summarize(trace, &summary);
+    assert(summary.threads == TRACE_MAX_THREADS);
+    assert(summary.begins[TRACE_EVENT_PRINT] == TRACE_MAX_THREADS && summary.ends[TRACE_EVENT_PRINT] == TRACE_MAX_THREADS);
+    /*Names are truncated*/
+    assert(strstr(dump, "\"args\":{\"name\":\"worker with a v\"}") != NULL);
+    trace_delete(trace);
+}
+
+static void record_test() {
+    Trace* trace = trace_new(64);
+    assert(trace != NULL);
+
+    /*Events of a thread that is not attached are not recorded*/
+    TRACE_BEGIN(TRACE_EVENT_READ);
+    TRACE_END(TRACE_EVENT_READ);
+    DumpSummary summary;
+    summarize(trace, &summary);
+    assert(summary.threads == 0 && summary.begins[TRACE_EVENT_READ] == 0);
+
+    assert(trace_thread_attach(trace, "main"));
+    TRACE_BEGIN(TRACE_EVENT_PARSE);
+    TRACE_BEGIN(TRACE_EVENT_COMPUTE);
+    TRACE_END(TRACE_EVENT_COMPUTE);
+    TRACE_END(TRACE_EVENT_PARSE);
+    /*Event in progress*/
+    TRACE_BEGIN(TRACE_EVENT_DEQUEUE_WAIT);
+    summarize(trace, &summary);
+    assert(summary.threads == 1 && summary.ordered);
+    assert(strstr(dump, "\"args\":{\"name\":\"main\"}") != NULL);
+    assert(summary.begins[TRACE_EVENT_PARSE] == 1 && summary.ends[TRACE_EVENT_PARSE] == 1);
+    assert(summary.begins[TRACE_EVENT_COMPUTE] == 1 && summary.ends[TRACE_EVENT_COMPUTE] == 1);
+    assert(summary.begins[TRACE_EVENT_DEQUEUE_WAIT] == 1 && summary.ends[TRACE_EVENT_DEQUEUE_WAIT] == 0);
+    /*Nesting is kept*/
+    const char* parse_begin = strstr(dump, "\"name\":\"parse\",\"cat\":\"pipeline\",\"ph\":\"B\"");
+    const char* compute_begin = strstr(dump, "\"name\":\"compute\",\"cat\":\"pipeline\",\"ph\":\"B\"");
+    const char* parse_end = strstr(dump, "\"name\":\"parse\",\"cat\":\"pipeline\",\"ph\":\"E\"");
+    assert(parse_begin != NULL && parse_begin < compute_begin && compute_begin < parse_end);
+
+    trace_thread_attach(NULL, "main");
+    assert(trace_thread_ring == NULL);
+    trace_delete(trace);
+}
+
+static void wrap_test() {
+    Trace* trace = trace_new(8);
+    assert(trace != NULL);
+    assert(trace_thread_attach(trace, "main"));
+
+    /*12 records, the oldest 4 are overwritten: read begins before the ring and ends after it*/
+    TRACE_BEGIN(TRACE_EVENT_READ);
+    for (size_t i = 0; i < 5; i++) {
+        TRACE_BEGIN(TRACE_EVENT_COMPUTE);
+        TRACE_END(TRACE_EVENT_COMPUTE);
+    }
+    TRACE_END(TRACE_EVENT_READ);
+
+    DumpSummary summary;
+    summarize(trace, &summary);
+    /*End of compute without beginning and end of read are skipped*/
+    assert(summary.begins[TRACE_EVENT_COMPUTE] == 3 && summary.ends[TRACE_EVENT_COMPUTE] == 3);
+    assert(summary.begins[TRACE_EVENT_READ] == 0 && summary.ends[TRACE_EVENT_READ] == 0);
+
+    trace_thread_attach(NULL, "main");
+    trace_delete(trace);
+}
+
+static void dump_file_test() {
+    Trace* trace = trace_new(8);
+    assert(trace != NULL);
+    assert(!trace_dump_file(trace, -1));
+    const int file = open(dump_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    assert(file >= 0);
+    /*The previous dump is replaced, not appended to*/
+    assert(trace_dump_file(trace, file));
+    assert(trace_dump_file(trace, file));
+    close(file);
+
+    FILE* stream = fopen(dump_path, "r");
+    assert(stream != NULL);
+    char content[128];
+    const size_t length = fread(content, 1, sizeof(content) - 1, stream);
+    content[length] = '\0';
+    fclose(stream);
+    assert(strcmp(content, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n]}\n") == 0);
+
+    unlink(dump_path);
+    trace_delete(trace);
+}
+
+static void* hammer(void* args) {
+    Trace* trace = args;
+    assert(trace_thread_attach(trace, "hammer"));
+    while (!atomic_load(&hammer_done)) {
+        TRACE_BEGIN(TRACE_EVENT_ENQUEUE_WAIT);
+        TRACE_END(TRACE_EVENT_ENQUEUE_WAIT);
+    }
+    return NULL;
+}
+
+static void concurrent_dump_test() {
+    Trace* trace = trace_new(hammer_ring_size);
+    pthread_t thread;
+    assert(trace != NULL);
+
+    atomic_store(&hammer_done, false);
+    assert(pthread_create(&thread, NULL, hammer, trace) == 0);
+    for (size_t i = 0; i < number_of_dumps; i++) {
+        DumpSummary summary;
+        summarize(trace, &summary);
+        /*Records overwritten during the dump are dropped, the rest stays in order*/
+        assert(summary.ordered);
+        assert(summary.begins[TRACE_EVENT_ENQUEUE_WAIT] <= hammer_ring_size / 2 + 1);
+        assert(summary.ends[TRACE_EVENT_ENQUEUE_WAIT] <= summary.begins[TRACE_EVENT_ENQUEUE_WAIT]);
+    }
+    atomic_store(&hammer_done, true);
+    pthread_join(thread, NULL);
+
+    trace_delete(trace);
+}
+
+static void event_to_str_test() {
+    assert(strcmp(trace_event_to_str(TRACE_EVENT_READ), "read") == 0);
+    assert(strcmp(trace_event_to_str(TRACE_EVENT_DEQUEUE_WAIT), "dequeue_wait") == 0);
+    assert(strcmp(trace_event_to_str(TRACE_EVENT_LOG), "log") == 0);
+    assert(strcmp(trace_event_to_str(TRACE_EVENT_COUNT), "unknown") == 0);
+}
+
+int main() {
+    dump = malloc(dump_size);
+    assert(dump != NULL);
+    snprintf(dump_path, sizeof(dump_path), "/tmp/trace_%d.json", (int) getpid());
+    new_delete_test();
+    attach_test();
+    record_test();
+    wrap_test();
+    dump_file_test();
+    concurrent_dump_test();
+    event_to_str_test();
+    free(dump);
+    return 0;
+}
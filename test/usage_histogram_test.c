@@ -0,0 +1,73 @@
+#include <assert.h>
+#include <stddef.h>
+#include <tgmath.h>
+#include "usage_histogram.h"
+
+static void empty_test(void);
+static void quantile_test(void);
+static void add_remove_test(void);
+static void out_of_range_test(void);
+
+static void empty_test() {
+    UsageHistogram histogram;
+    usage_histogram_clear(&histogram);
+
+    assert(histogram.count == 0);
+    assert(isnan(usage_histogram_quantile(&histogram, 0.5)));
+    /*NaN is not counted*/
+    usage_histogram_add(&histogram, NAN);
+    assert(histogram.count == 0);
+}
+
+static void quantile_test() {
+    UsageHistogram histogram;
+    usage_histogram_clear(&histogram);
+
+    for (size_t i = 0; i < 100; i++) {
+        usage_histogram_add(&histogram, (double) i + 0.5);
+    }
+    assert(histogram.count == 100);
+    assert(fabs(usage_histogram_quantile(&histogram, 0.5) - 49.5) < 1.0);
+    assert(fabs(usage_histogram_quantile(&histogram, 0.95) - 94.5) < 1.0);
+    assert(fabs(usage_histogram_quantile(&histogram, 0.99) - 98.5) < 1.0);
+    assert(usage_histogram_quantile(&histogram, 0.0) < 1.0);
+    assert(usage_histogram_quantile(&histogram, 1.0) > 99.0);
+}
+
+static void add_remove_test() {
+    UsageHistogram histogram;
+    usage_histogram_clear(&histogram);
+
+    usage_histogram_add(&histogram, 10.0);
+    usage_histogram_add(&histogram, 90.0);
+    usage_histogram_remove(&histogram, 90.0);
+    assert(histogram.count == 1);
+    assert(fabs(usage_histogram_quantile(&histogram, 0.95) - 10.5) < 0.01);
+
+    /*Removing value that is not present shall not underflow*/
+    usage_histogram_remove(&histogram, 50.0);
+    assert(histogram.count == 1);
+}
+
+static void out_of_range_test() {
+    UsageHistogram histogram;
+    usage_histogram_clear(&histogram);
+
+    usage_histogram_add(&histogram, -5.0);
+    usage_histogram_add(&histogram, 100.0);
+    usage_histogram_add(&histogram, 250.0);
+    assert(histogram.buckets[0] == 1);
+    assert(histogram.buckets[USAGE_HISTOGRAM_BUCKETS - 1] == 2);
+    /*Quantile never exceeds 100%*/
+    assert(usage_histogram_quantile(&histogram, 1.0) == 100.0);
+}
+
+int main() {
+
+    empty_test();
+    quantile_test();
+    add_remove_test();
+    out_of_range_test();
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include <assert.h>
+#include <tgmath.h>
+#include "usage_stats.h"
+
+static void snapshot_set(Snapshot* snapshot, uint64_t milliseconds, double usage);
+static void new_test(void);
+static void ewma_test(void);
+static void ewma_period_test(void);
+static void sliding_quantile_test(void);
+static void constant_quantile_test(void);
+static void missing_core_test(void);
+static void mask_parse_test(void);
+
+static Snapshot snapshot;
+
+static void snapshot_set(Snapshot* const s, const uint64_t milliseconds, const double usage) {
+    s->timestamp.tv_sec = (time_t) (milliseconds / 1000);
+    s->timestamp.tv_nsec = (long) (milliseconds % 1000) * 1000000;
+    s->number_of_cores = 1;
+    s->core_usage[0] = usage;
+}
+
+static void new_test() {
+    assert(usage_stats_new(0, 10) == NULL);
+    assert(usage_stats_new(10, 0) == NULL);
+    UsageStats* stats = usage_stats_new(2, 10);
+    assert(stats != NULL);
+    assert(usage_stats_number_of_cores(stats) == 2);
+    assert(isnan(usage_stats_get(stats, 0, USAGE_STATISTIC_EWMA_10S)));
+    assert(isnan(usage_stats_get(stats, 2, USAGE_STATISTIC_P50)));
+    usage_stats_delete(stats);
+    usage_stats_delete(NULL);
+}
+
+static void ewma_test() {
+    UsageStats* stats = usage_stats_new(1, 10);
+
+    snapshot_set(&snapshot, 1000000, 0.0);
+    usage_stats_update(stats, &snapshot);
+    assert(usage_stats_get(stats, 0, USAGE_STATISTIC_EWMA_10S) == 0.0);
+
+    /*After one half-life the average is halfway to the new level*/
+    snapshot_set(&snapshot, 1010000, 100.0);
+    usage_stats_update(stats, &snapshot);
+    assert(fabs(usage_stats_get(stats, 0, USAGE_STATISTIC_EWMA_10S) - 50.0) < 1e-9);
+    assert(usage_stats_get(stats, 0, USAGE_STATISTIC_EWMA_1MIN) < usage_stats_get(stats, 0, USAGE_STATISTIC_EWMA_10S));
+    assert(usage_stats_get(stats, 0, USAGE_STATISTIC_EWMA_5MIN) < usage_stats_get(stats, 0, USAGE_STATISTIC_EWMA_1MIN));
+
+    /*Clock stepping backwards does not move the average*/
+    snapshot_set(&snapshot, 1005000, 0.0);
+    usage_stats_update(stats, &snapshot);
+    assert(fabs(usage_stats_get(stats, 0, USAGE_STATISTIC_EWMA_10S) - 50.0) < 1e-9);
+    usage_stats_delete(stats);
+}
+
+static void ewma_period_test() {
+    UsageStats* fast = usage_stats_new(1, 10);
+    UsageStats* slow = usage_stats_new(1, 10);
+
+    /*Usage covers the interval preceding the snapshot, the same signal sampled
+    every 100 ms and every 1 s gives the same average*/
+    for (uint64_t t = 0; t <= 30000; t += 100) {
+        snapshot_set(&snapshot, t, t <= 10000 ? 0.0 : 80.0);
+        usage_stats_update(fast, &snapshot);
+        if (t % 1000 == 0) {
+            usage_stats_update(slow, &snapshot);
+        }
+    }
+    assert(fabs(usage_stats_get(fast, 0, USAGE_STATISTIC_EWMA_10S) - usage_stats_get(slow, 0, USAGE_STATISTIC_EWMA_10S)) < 1e-6);
+    assert(fabs(usage_stats_get(fast, 0, USAGE_STATISTIC_EWMA_1MIN) - usage_stats_get(slow, 0, USAGE_STATISTIC_EWMA_1MIN)) < 1e-6);
+    usage_stats_delete(fast);
+    usage_stats_delete(slow);
+}
+
+static void sliding_quantile_test() {
+    UsageStats* stats = usage_stats_new(1, 100);
+
+    for (uint64_t i = 0; i < 100; i++) {
+        snapshot_set(&snapshot, i * 1000, (double) i + 0.5);
+        usage_stats_update(stats, &snapshot);
+    }
+    assert(fabs(usage_stats_get(stats, 0, USAGE_STATISTIC_P50) - 49.5) < 1.0);
+    assert(fabs(usage_stats_get(stats, 0, USAGE_STATISTIC_P95) - 94.5) < 1.0);
+    assert(fabs(usage_stats_get(stats, 0, USAGE_STATISTIC_P99) - 98.5) < 1.0);
+
+    /*Old samples leave the window*/
+    for (uint64_t i = 100; i < 200; i++) {
+        snapshot_set(&snapshot, i * 1000, 10.5);
+        usage_stats_update(stats, &snapshot);
+    }
+    assert(usage_stats_get(stats, 0, USAGE_STATISTIC_P99) == 10.5);
+
+    const double* values = usage_stats_values(stats);
+    assert(values[USAGE_STATISTIC_P50] == usage_stats_get(stats, 0, USAGE_STATISTIC_P50));
+    usage_stats_delete(stats);
+}
+
+static void constant_quantile_test() {
+    UsageStats* stats = usage_stats_new(1, 10);
+
+    snapshot_set(&snapshot, 0, 90.0);
+    usage_stats_update(stats, &snapshot);
+    snapshot_set(&snapshot, 1000, NAN);
+    usage_stats_update(stats, &snapshot);
+    for (uint64_t i = 2; i < 10; i++) {
+        snapshot_set(&snapshot, i * 1000, 37.0);
+        usage_stats_update(stats, &snapshot);
+    }
+    assert(usage_stats_get(stats, 0, USAGE_STATISTIC_P99) <= 90.0);
+
+    /*Once the peak leaves the window a core steady at 37 % reports exactly 37 %*/
+    snapshot_set(&snapshot, 10000, 37.0);
+    usage_stats_update(stats, &snapshot);
+    assert(usage_stats_get(stats, 0, USAGE_STATISTIC_P50) == 37.0);
+    assert(usage_stats_get(stats, 0, USAGE_STATISTIC_P95) == 37.0);
+    assert(usage_stats_get(stats, 0, USAGE_STATISTIC_P99) == 37.0);
+    usage_stats_delete(stats);
+}
+
+static void missing_core_test() {
+    UsageStats* stats = usage_stats_new(2, 4);
+
+    snapshot_set(&snapshot, 0, 20.0);
+    usage_stats_update(stats, &snapshot);
+    snapshot_set(&snapshot, 1000, NAN);
+    usage_stats_update(stats, &snapshot);
+
+    assert(usage_stats_get(stats, 0, USAGE_STATISTIC_EWMA_10S) == 20.0);
+    assert(usage_stats_get(stats, 0, USAGE_STATISTIC_P50) == 20.0);
+    /*Core absent from snapshots*/
+    assert(isnan(usage_stats_get(stats, 1, USAGE_STATISTIC_EWMA_10S)));
+    assert(isnan(usage_stats_get(stats, 1, USAGE_STATISTIC_P95)));
+    usage_stats_delete(stats);
+}
+
+static void mask_parse_test() {
+    uint32_t mask = 0;
+
+    assert(usage_stats_mask_parse("p95", &mask));
+    assert(mask == UINT32_C(1) << USAGE_STATISTIC_P95);
+    assert(usage_stats_mask_parse("ewma10s,ewma5m,p99", &mask));
+    assert(mask == ((UINT32_C(1) << USAGE_STATISTIC_EWMA_10S) | (UINT32_C(1) << USAGE_STATISTIC_EWMA_5MIN)
+                    | (UINT32_C(1) << USAGE_STATISTIC_P99)));
+
+    mask = 7;
+    assert(!usage_stats_mask_parse("p9", &mask));
+    assert(!usage_stats_mask_parse("p95,", &mask));
+    assert(!usage_stats_mask_parse("", &mask));
+    assert(mask == 7);
+}
+
+int main() {
+    new_test();
+    ewma_test();
+    ewma_period_test();
+    sliding_quantile_test();
+    constant_quantile_test();
+    missing_core_test();
+    mask_parse_test();
+    return 0;
+}